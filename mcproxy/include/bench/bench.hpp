@@ -0,0 +1,77 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <string>
+#include <list>
+#include <chrono>
+#include <functional>
+
+#define BENCH_DEFAULT_MIN_TIME 200 //msec, minimum duration of one run
+#define BENCH_DEFAULT_RUNS 5
+#define BENCH_DEFAULT_INTERFACE "lo" //the queriers and the report parser work on this interface
+#define BENCH_TABLE_NUMBER 4242 //kernel table of the proxy instance that receives the parsed reports
+
+/**
+ * @brief Microbenchmarks of the hot paths of the proxy. Each benchmark is calibrated to
+ * run at least the minimum time, then measured several times. The results are printed as
+ * CSV (one line per benchmark) to stdout, messages about skipped benchmarks go to stderr.
+ */
+class bench
+{
+private:
+    //runs the benchmark for the given number of operations and returns the measured time
+    using bench_fun = std::function<std::chrono::nanoseconds(unsigned long iterations)>;
+
+    struct bench_case {
+        std::string name;
+        std::string parameter;
+        bench_fun fun;
+    };
+
+    std::chrono::milliseconds m_min_time;
+    unsigned int m_runs;
+    std::string m_filter;
+    std::string m_if_name;
+    bool m_list_only;
+
+    std::list<bench_case> m_cases;
+
+    void help();
+    void add(const std::string& name, const std::string& parameter, bench_fun fun);
+    void run(const bench_case& bc);
+
+    void add_source_list_cases();
+    void add_addr_storage_cases();
+    void add_querier_cases();
+    void add_timing_cases();
+    void add_message_queue_cases();
+    void add_rule_matching_cases();
+    void add_report_parsing_cases();
+
+public:
+    bench(int arg_count, char* args[]);
+};
+
+#endif // BENCH_HPP
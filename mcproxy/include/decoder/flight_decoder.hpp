@@ -0,0 +1,67 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef FLIGHT_DECODER_HPP
+#define FLIGHT_DECODER_HPP
+
+#include "include/utils/flight_recorder.hpp"
+
+#include <string>
+#include <vector>
+
+#define FLIGHT_DECODER_MAX_RING_SIZE (1 << 20) //events per ring of a dump, larger headers are refused
+
+/**
+ * @brief Prints the events of a flight recorder dump of the proxy, all
+ * threads merged in the order of their time stamps. The dump must have been
+ * written on a host with the same byte order. The interface indexes are
+ * printed as numbers because the dump may come from another host.
+ */
+class flight_decoder
+{
+private:
+    struct thread_event {
+        const fr_ring_header* thread;
+        fr_event event;
+    };
+
+    std::string m_path;
+    std::string m_group_filter; //empty for all groups
+    long m_tid_filter; //-1 for all threads
+
+    fr_file_header m_header;
+    std::vector<fr_ring_header> m_threads;
+    std::vector<thread_event> m_events;
+
+    void help();
+    void read_file();
+    void print() const;
+
+    static std::string get_time(uint64_t time);
+    static addr_storage get_addr(uint8_t addr_family, const uint8_t* addr);
+    static std::string get_description(const fr_event& e);
+
+public:
+    flight_decoder(int arg_count, char* args[]);
+};
+
+#endif // FLIGHT_DECODER_HPP
@@ -126,6 +126,45 @@ void hc_log(int log_lvl, const char* function_name, const char* log_msg);
  */
 void hc_set_default_log_fun(int log_lvl);
 
+/**
+ * @brief Discard all log events with <code>level < @p log_lvl</code>.
+ *        Can be called at any time from any thread (also from a signal
+ *        handler), a value above <code>HC_LOG_FATAL_LVL</code> disables
+ *        the logging.
+ * @param log_lvl The desired logging level.
+ */
+void hc_set_log_lvl(int log_lvl);
+
+/**
+ * @brief Get the current logging level.
+ */
+int hc_get_log_lvl();
+
+/**
+ * @brief The current logging level, only accessed atomically. Use
+ *        {@link HC_LOG_ENABLED()} to check a level.
+ */
+extern int hc_log_lvl;
+
+/**
+ * @brief Switch to the asynchronous logging backend. Each thread copies
+ *        its log events as fixed-size binary records (time stamp, level,
+ *        call site and message) into its own lock-free ring buffer. A
+ *        background thread formats the records in time order and writes
+ *        them to @p file_name. If a ring buffer is full the event is
+ *        dropped, a logging thread never waits.
+ * @param log_lvl The desired logging level.
+ * @param file_name The log file, <code>NULL</code> for stderr.
+ * @returns @c 1 on success; otherwise @c 0
+ */
+int hc_start_async_log(int log_lvl, const char* file_name);
+
+/**
+ * @brief Write all pending records, stop the background thread and switch
+ *        back to the default log function.
+ */
+void hc_stop_async_log();
+
 /**
  * @brief Check if libHAMcast was compiled with logging enabled.
  * @returns @c 1 if logging is enabled; otherwise @c 0
@@ -138,8 +177,10 @@ int hc_logging_enabled();
 
 #ifdef __GNUC__
 #  define HC_FUN __PRETTY_FUNCTION__
+#  define HC_LOG_ENABLED(loglvl) ((loglvl) >= __atomic_load_n(&hc_log_lvl, __ATOMIC_RELAXED))
 #else
 #  define HC_FUN __FUNCTION__
+#  define HC_LOG_ENABLED(loglvl) ((loglvl) >= hc_get_log_lvl())
 #endif
 
 #if defined(HC_DOCUMENTATION)
@@ -204,10 +245,12 @@ int hc_logging_enabled();
 
 #define HC_DO_LOG(message, loglvl)                                             \
     {                                                                          \
-        std::ostringstream scoped_oss;                                         \
-        scoped_oss << message;                                                 \
-        std::string scoped_osss = scoped_oss.str();                            \
-        hc_log( loglvl , HC_FUN , scoped_osss.c_str());                        \
+        if (HC_LOG_ENABLED(loglvl)) {                                          \
+            std::ostringstream scoped_oss;                                     \
+            scoped_oss << message;                                             \
+            std::string scoped_osss = scoped_oss.str();                        \
+            hc_log( loglvl , HC_FUN , scoped_osss.c_str());                    \
+        }                                                                      \
     } ((void) 0)
 
 namespace
@@ -250,10 +293,9 @@ struct HC_trace_helper {
 #  define HC_PRINT(message) printf("%s", message);
 #endif
 
+//release builds keep all levels but trace, a disabled level costs one load and compare
 #ifndef HC_DOCUMENTATION
 #  ifndef DEBUG_MODE
-#    undef HC_DO_LOG
-#    define HC_DO_LOG(unused1, unused2)
 #    undef HC_LOG_TRACE
 #    define HC_LOG_TRACE(unused)
 #    undef HC_LOG_SCOPE
@@ -262,13 +304,8 @@ struct HC_trace_helper {
 #  define HC_LOG_DEBUG(message) HC_DO_LOG(message, HC_LOG_DEBUG_LVL)
 #  define HC_LOG_INFO(message)  HC_DO_LOG(message, HC_LOG_INFO_LVL)
 #  define HC_LOG_WARN(message)  HC_DO_LOG(message, HC_LOG_WARN_LVL)
-#  ifndef DEBUG_MODE
-#    define HC_LOG_ERROR(message) HC_PRINT("ERROR: " << message)
-#    define HC_LOG_FATAL(message) HC_PRINT("FATAL: " << message)
-#  else
-#    define HC_LOG_ERROR(message) HC_DO_LOG(message, HC_LOG_ERROR_LVL)
-#    define HC_LOG_FATAL(message) HC_DO_LOG(message, HC_LOG_FATAL_LVL)
-#  endif
+#  define HC_LOG_ERROR(message) HC_DO_LOG(message, HC_LOG_ERROR_LVL)
+#  define HC_LOG_FATAL(message) HC_DO_LOG(message, HC_LOG_FATAL_LVL)
 #endif
 
 // end of group Logging
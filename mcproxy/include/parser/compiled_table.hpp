@@ -0,0 +1,168 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef COMPILED_TABLE_HPP
+#define COMPILED_TABLE_HPP
+
+#include "include/utils/addr_storage.hpp"
+
+#include <vector>
+#include <list>
+#include <string>
+#include <utility>
+#include <memory>
+#include <cstdint>
+
+class table;
+class rule_addr;
+struct addr_match;
+
+/**
+ * @brief Host byte order representation of an IPv4 or IPv6 address
+ * that can be compared with two integer comparisons.
+ */
+struct addr_key {
+    uint64_t m_high;
+    uint64_t m_low;
+
+    addr_key();
+    addr_key(uint64_t high, uint64_t low);
+    explicit addr_key(const addr_storage& addr);
+
+    static addr_key min_key();
+    static addr_key max_key(int addr_family);
+
+    addr_key& operator++();
+    addr_key& operator--();
+
+    addr_storage to_addr_storage(int addr_family) const;
+    std::string to_string(int addr_family) const;
+};
+
+bool operator<(const addr_key& k1, const addr_key& k2);
+bool operator==(const addr_key& k1, const addr_key& k2);
+bool operator<=(const addr_key& k1, const addr_key& k2);
+
+/**
+ * @brief Closed interval [m_from, m_to] of addresses.
+ */
+struct key_interval {
+    addr_key m_from;
+    addr_key m_to;
+
+    key_interval() = default;
+    key_interval(const addr_key& from, const addr_key& to);
+};
+
+bool operator==(const key_interval& i1, const key_interval& i2);
+
+/**
+ * @brief Flat decision structure of a parsed table. All nested tables and
+ * table references are resolved once and group/source addresses are stored
+ * as sorted disjoint interval arrays. A match costs two binary searches per
+ * matching interface bucket instead of a walk over the rule list.
+ *
+ * The buckets are kept by interface name. The names are mapped to interface
+ * indexes lazily and mapped again after each link change reported by the
+ * if_monitor, so rules of interfaces that are created, recreated or renamed
+ * later match like the name based table::match.
+ */
+class compiled_table
+{
+private:
+    //all group ranges of a segment share the same set of allowed sources
+    struct group_segment {
+        key_interval m_group;
+        std::vector<key_interval> m_sources;
+    };
+
+    struct if_bucket {
+        //position in m_if_names + 1, 0 == every interface
+        unsigned int m_if_id;
+
+        //groups that match for every source
+        std::vector<key_interval> m_any_source_groups;
+
+        //disjoint and sorted by group address
+        std::vector<group_segment> m_segments;
+    };
+
+    struct flat_rule {
+        unsigned int m_if_id;
+        key_interval m_group;
+        key_interval m_source;
+    };
+
+    struct if_resolution {
+        //link generation of the if_monitor the names were mapped at
+        unsigned int m_generation;
+
+        //sorted by interface index, an interface index is mapped to its interface id
+        std::vector<std::pair<unsigned int, unsigned int>> m_if_ids;
+    };
+
+    std::vector<std::string> m_if_names;
+    std::vector<if_bucket> m_ipv4_buckets;
+    std::vector<if_bucket> m_ipv6_buckets;
+    unsigned int m_rule_count;
+
+    //shared between the worker threads of all proxy instances, accessed with std::atomic_load/std::atomic_store
+    mutable std::shared_ptr<const if_resolution> m_resolution;
+
+    using rule_list = std::list<std::pair<unsigned int, const rule_addr*>>;
+
+    void compile(const rule_list& rules, int addr_family, std::vector<if_bucket>& buckets);
+    if_bucket compile_bucket(unsigned int if_id, const std::vector<flat_rule>& rules, int addr_family) const;
+
+    //map the interface names to their current indexes if a link changed since the last call
+    std::shared_ptr<const if_resolution> resolve() const;
+    unsigned int get_if_id(unsigned int if_index) const;
+
+    static bool get_interval(const addr_match& am, int addr_family, key_interval& interval);
+
+    static void merge_intervals(std::vector<key_interval>& intervals);
+    static bool contains(const std::vector<key_interval>& intervals, const addr_key& key);
+    static bool match_bucket(const if_bucket& bucket, const addr_key& gkey, const addr_key& skey, bool source_valid);
+
+    std::string to_string(const std::vector<if_bucket>& buckets, int addr_family) const;
+public:
+    /**
+     * @brief Compile a table.
+     */
+    compiled_table(const table& t);
+
+    /**
+     * @brief Same semantic as table::match, but takes the index of the input interface.
+     */
+    bool match(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr) const;
+
+    /**
+     * @brief Number of flattened rules the table is compiled from.
+     */
+    unsigned int get_rule_count() const;
+
+    std::string to_string() const;
+
+    static void test_compiled_table();
+};
+
+#endif // COMPILED_TABLE_HPP
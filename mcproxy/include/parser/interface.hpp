@@ -29,15 +29,26 @@
 #include <chrono>
 
 #include "include/utils/addr_storage.hpp"
+#include "include/proxy/def.hpp"
+#include "include/parser/compiled_table.hpp"
+
+class rule_addr;
 
 struct addr_match {
     bool is_wildcard(const addr_storage& addr, int addr_family) const;
     virtual bool match(const addr_storage& addr) const = 0;
+
+    //lower and upper bound (including), a wildcard address means unbounded
+    virtual void get_bounds(addr_storage& from, addr_storage& to) const = 0;
     virtual std::string to_string() const = 0;
 };
 
 struct rule_box {
     virtual bool match(const std::string& if_name, const addr_storage& saddr, const addr_storage& gaddr) const = 0;
+
+    //append all rule_addr reachable from this rule_box, return false if a table reference can not be resolved
+    virtual bool collect_rules(std::list<const rule_addr*>& rule_list) const = 0;
+
     virtual std::string to_string() const = 0;
 };
 
@@ -47,6 +58,7 @@ class single_addr: public addr_match
 public:
     single_addr(const addr_storage& addr);
     bool match(const addr_storage& addr) const override;
+    void get_bounds(addr_storage& from, addr_storage& to) const override;
     std::string to_string() const override;
 };
 
@@ -59,6 +71,7 @@ public:
 
     //uncluding from and to
     bool match(const addr_storage& addr) const override;
+    void get_bounds(addr_storage& from, addr_storage& to) const override;
     std::string to_string() const override;
 };
 
@@ -69,7 +82,11 @@ class rule_addr : public rule_box
     std::unique_ptr<addr_match> m_source;
 public:
     rule_addr(const std::string& if_name, std::unique_ptr<addr_match> group, std::unique_ptr<addr_match> source);
+    const std::string& get_if_name() const;
+    const addr_match& get_group() const;
+    const addr_match& get_source() const;
     bool match(const std::string& if_name, const addr_storage& gaddr, const addr_storage& saddr) const override;
+    bool collect_rules(std::list<const rule_addr*>& rule_list) const override;
     std::string to_string() const override;
 };
 
@@ -82,6 +99,7 @@ public:
     table(const std::string& name, std::list<std::unique_ptr<rule_box>>&& rule_box_list);
     const std::string& get_name() const;
     bool match(const std::string& if_name, const addr_storage& gaddr, const addr_storage& saddr) const override;
+    bool collect_rules(std::list<const rule_addr*>& rule_list) const override;
     std::string to_string() const override;
     friend bool operator<(const table& t1, const table& t2);
 };
@@ -98,6 +116,7 @@ class rule_table : public rule_box
 public:
     rule_table(std::unique_ptr<table> t);
     bool match(const std::string& if_name, const addr_storage& gaddr, const addr_storage& saddr) const override;
+    bool collect_rules(std::list<const rule_addr*>& rule_list) const override;
     std::string to_string() const override;
 };
 
@@ -118,6 +137,7 @@ class rule_table_ref : public rule_box
 public:
     rule_table_ref(const std::string& table_name, const std::shared_ptr<const global_table_set>& global_table_set);
     bool match(const std::string& if_name, const addr_storage& gaddr, const addr_storage& saddr) const override;
+    bool collect_rules(std::list<const rule_addr*>& rule_list) const override;
     std::string to_string() const override;
 };
 
@@ -153,6 +173,7 @@ private:
     //RBT_FILTER
     rb_filter_type m_filter_type;
     std::unique_ptr<table> m_table;
+    std::unique_ptr<compiled_table> m_compiled_table;
 
     //RBT_RULE_MATCHING
     rb_rule_matching_type m_rule_matching_type;
@@ -176,6 +197,9 @@ public:
     const table& get_table() const;
     bool match(const std::string& if_name, const addr_storage& saddr, const addr_storage& gaddr) const;
 
+    //uses the compiled table, no interface name lookup and no rule list walk
+    bool match(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr) const;
+
     //RBT_RULE_MATCHING
     rb_rule_matching_type get_rule_matching_type() const;
     std::chrono::milliseconds get_timeout() const;
@@ -189,12 +213,15 @@ class interface
     std::unique_ptr<rule_binding> m_output_filter;
     std::unique_ptr<rule_binding> m_input_filter;
     bool match_filter(const std::string& input_if_name, const addr_storage& saddr, const addr_storage& gaddr, const std::unique_ptr<rule_binding>& filter) const;
+    bool match_filter(unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr, const std::unique_ptr<rule_binding>& filter) const;
 
 public:
     interface(const std::string& if_name);
     std::string get_if_name() const;
     bool match_output_filter(const std::string& input_if_name, const addr_storage& saddr, const addr_storage& gaddr) const;
     bool match_input_filter(const std::string& input_if_name, const addr_storage& saddr, const addr_storage& gaddr) const;
+    bool match_output_filter(unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr) const;
+    bool match_input_filter(unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr) const;
 
     std::string to_string_rule_binding() const;
     std::string to_string_interface() const;
@@ -209,6 +236,8 @@ class instance_definition
     std::string m_instance_name;
     int m_table_number;
     bool m_user_selected_table_number; 
+    mroute_backend m_mroute_backend;
+    upstream_report_mode m_upstream_report_mode;
     std::list<std::shared_ptr<interface>> m_upstreams;
     std::list<std::shared_ptr<interface>> m_downstreams;
 
@@ -216,13 +245,15 @@ class instance_definition
 
 public:
     instance_definition(const std::string& instance_name);
-    instance_definition(const std::string& instance_name, std::list<std::shared_ptr<interface>>&& upstreams, std::list<std::shared_ptr<interface>>&& downstreams, int table_number, bool user_selected_table_number);
+    instance_definition(const std::string& instance_name, std::list<std::shared_ptr<interface>>&& upstreams, std::list<std::shared_ptr<interface>>&& downstreams, int table_number, bool user_selected_table_number, mroute_backend mrb = MRB_SETSOCKOPT, upstream_report_mode urm = URM_KERNEL);
     const std::string& get_instance_name() const;
     const std::list<std::shared_ptr<interface>>& get_upstreams() const;
     const std::list<std::shared_ptr<interface>>& get_downstreams() const;
     const std::list<std::shared_ptr<rule_binding>>& get_global_settings() const;
     int get_table_number() const;
     bool get_user_selected_table_number() const; 
+    mroute_backend get_mroute_backend() const;
+    upstream_report_mode get_upstream_report_mode() const;
     friend bool operator<(const instance_definition& i1, const instance_definition& i2);
     friend class parser;
     std::string to_string_instance() const;
@@ -23,6 +23,8 @@
 #ifndef DEF_HPP
 #define DEF_HPP
 
+#include "include/utils/mem_arena.hpp"
+
 #include <netinet/in.h>
 
 #include <map>
@@ -47,6 +49,19 @@ std::string get_group_mem_protocol_name(group_mem_protocol gmp);
 enum mcast_addr_record_type {MODE_IS_INCLUDE = 1, MODE_IS_EXCLUDE = 2, CHANGE_TO_INCLUDE_MODE = 3, CHANGE_TO_EXCLUDE_MODE = 4, ALLOW_NEW_SOURCES = 5, BLOCK_OLD_SOURCES = 6};
 std::string get_mcast_addr_record_type_name(mcast_addr_record_type art);
 
+//how multicast routes are written to the kernel
+enum mroute_backend {MRB_SETSOCKOPT, MRB_NETLINK};
+std::string get_mroute_backend_name(mroute_backend mb);
+
+//who reports the upstream memberships, the kernel (socket joins) or the proxy itself
+enum upstream_report_mode {URM_KERNEL, URM_USERSPACE};
+std::string get_upstream_report_mode_name(upstream_report_mode urm);
+
+//processing stages of a group record from the socket to the multicast route in the kernel,
+//the querier stage contains the route calculation, the route calculation does not contain the kernel call
+enum latency_stage {LS_RECEIVE, LS_QUEUE, LS_QUERIER, LS_ROUTE_CALCULATION, LS_KERNEL_ADD_ROUTE, LS_COUNT};
+std::string get_latency_stage_name(latency_stage ls);
+
 //------------------------------------------------------------------------
 std::string time_to_string(const std::chrono::seconds& sec);
 std::string time_to_string(const std::chrono::milliseconds& msec);
@@ -54,7 +69,8 @@ std::string time_to_string(const std::chrono::milliseconds& msec);
 //------------------------------------------------------------------------
 std::string indention(std::string str);
 //------------------------------------------------------------------------
-template<typename T> using source_list = std::set<T>;
+//source lists of a group draw their nodes from the arena of its membership database, all other source lists use the heap
+template<typename T> using source_list = std::set<T, std::less<T>, arena_allocator<T, MAK_SOURCE>>;
 
 //A+B means the union of set A and B
 template<typename T>
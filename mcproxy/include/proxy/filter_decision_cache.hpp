@@ -0,0 +1,102 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef FILTER_DECISION_CACHE_HPP
+#define FILTER_DECISION_CACHE_HPP
+
+#include "include/utils/addr_storage.hpp"
+#include "include/parser/interface.hpp"
+
+#include <list>
+#include <map>
+#include <string>
+#include <tuple>
+
+#define FILTER_DECISION_CACHE_DEFAULT_SIZE 4096
+
+/**
+ * @brief Memorises the results of interface filter checks, keyed by
+ * (interface type, direction, checked interface, input interface, S, G).
+ * The least recently used decision is dropped if the cache is full.
+ * A cache size of 0 disables the cache.
+ */
+class filter_decision_cache
+{
+private:
+    struct decision_key {
+        decision_key(rb_interface_type interface_type, rb_interface_direction interface_direction, unsigned int checking_if_index, unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr);
+
+        rb_interface_type m_interface_type;
+        rb_interface_direction m_interface_direction;
+        unsigned int m_checking_if_index;
+        unsigned int m_input_if_index;
+        addr_storage m_gaddr;
+        addr_storage m_saddr;
+
+        friend bool operator<(const decision_key& k1, const decision_key& k2) {
+            return std::tie(k1.m_checking_if_index, k1.m_input_if_index, k1.m_interface_type, k1.m_interface_direction, k1.m_gaddr, k1.m_saddr) < std::tie(k2.m_checking_if_index, k2.m_input_if_index, k2.m_interface_type, k2.m_interface_direction, k2.m_gaddr, k2.m_saddr);
+        }
+    };
+
+    using lru_list = std::list<std::pair<decision_key, bool>>;
+
+    unsigned int m_max_size;
+
+    //most recently used decision at the front
+    lru_list m_lru_list;
+    std::map<decision_key, lru_list::iterator> m_decisions;
+
+    unsigned long m_hits;
+    unsigned long m_misses;
+    unsigned long m_evictions;
+    unsigned long m_invalidations;
+
+public:
+    filter_decision_cache(unsigned int max_size = FILTER_DECISION_CACHE_DEFAULT_SIZE);
+
+    /**
+     * @brief Search a cached decision.
+     * @return true if a decision was found, the decision is stored in the parameter decision.
+     */
+    bool lookup(rb_interface_type interface_type, rb_interface_direction interface_direction, unsigned int checking_if_index, unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr, bool& decision);
+
+    void insert(rb_interface_type interface_type, rb_interface_direction interface_direction, unsigned int checking_if_index, unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr, bool decision);
+
+    /**
+     * @brief Drop all cached decisions, e.g. because interfaces or rule bindings has changed.
+     */
+    void invalidate();
+
+    unsigned int size() const;
+    unsigned int get_max_size() const;
+
+    /**
+     * @brief Hits in relation to all lookups (0.0 - 1.0).
+     */
+    double get_hit_rate() const;
+
+    std::string to_string() const;
+
+    static void test_filter_decision_cache();
+};
+
+#endif // FILTER_DECISION_CACHE_HPP
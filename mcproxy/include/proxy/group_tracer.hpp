@@ -0,0 +1,150 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+/**
+ * @addtogroup mod_proxy Proxy
+ * @{
+ */
+
+#ifndef GROUP_TRACER_HPP
+#define GROUP_TRACER_HPP
+
+#include "include/utils/addr_storage.hpp"
+#include "include/proxy/timing_clock.hpp"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define GROUP_TRACER_MAX_EVENTS 100000 //the oldest events are dropped
+
+/**
+ * @brief Lanes of a group in the timeline.
+ */
+enum gt_lane {
+    GT_QUERIER = 1, //records, timers, filter mode changes and queries of the querier (worker thread)
+    GT_ROUTING, //route calculation and upstream reports (worker thread)
+    GT_KERNEL //routes and queries executed by the kernel io thread
+};
+std::string get_gt_lane_name(gt_lane lane);
+
+using gt_args = std::vector<std::pair<const char*, std::string>>;
+
+/**
+ * @brief An event of a traced group, complete events have a duration.
+ */
+struct gt_event {
+    timing_clock::time_point time;
+    std::chrono::microseconds duration;
+    bool is_complete;
+    std::string name;
+    gt_lane lane;
+    unsigned int if_index;
+    addr_storage gaddr;
+    gt_args args;
+};
+
+/**
+ * @brief Records a timeline of the querier and routing events of selected
+ * groups (group addresses or prefixes), set at runtime e.g. over the state
+ * socket. The timeline is exported in the Chrome trace event format (one
+ * process per group, one thread per lane) and can be loaded in
+ * chrome://tracing or Perfetto. Without a traced group the hooks only read
+ * an atomic flag. The traced prefixes are published as an immutable list,
+ * the check of a group does not take the lock of the recorded events.
+ */
+class group_tracer
+{
+private:
+    struct prefix {
+        addr_storage addr;
+        unsigned int length;
+    };
+
+    using prefix_list = std::vector<prefix>;
+
+    std::atomic<bool> m_enabled;
+
+    //only accessed with std::atomic_load() and std::atomic_store(), nullptr if disabled
+    std::shared_ptr<const prefix_list> m_prefixes;
+
+    mutable std::mutex m_lock;
+    std::deque<gt_event> m_events;
+    unsigned long m_dropped;
+
+    group_tracer();
+    group_tracer(const group_tracer&) = delete;
+    group_tracer& operator=(const group_tracer&) = delete;
+
+    bool is_matching(const addr_storage& gaddr) const;
+    void add_event(gt_event&& e);
+
+public:
+    static group_tracer& get_instance();
+
+    /**
+     * @brief Check cheaply whether the events of a group are recorded.
+     */
+    bool is_traced(const addr_storage& gaddr) const {
+        return m_enabled.load(std::memory_order_relaxed) && is_matching(gaddr);
+    }
+
+    /**
+     * @brief Record an event without duration if the group is traced.
+     */
+    void instant(gt_lane lane, const std::string& name, unsigned int if_index, const addr_storage& gaddr, gt_args&& args = gt_args());
+
+    /**
+     * @brief Record an event that started at start and ends now if the group is traced.
+     */
+    void complete(gt_lane lane, const std::string& name, unsigned int if_index, const addr_storage& gaddr, const timing_clock::time_point& start, gt_args&& args = gt_args());
+
+    /**
+     * @brief Trace the given groups and prefixes, e.g. "239.1.1.1 239.2.0.0/16 ff05::/16".
+     *        The recorded events are discarded.
+     * @return Return an error message, empty if the groups were set.
+     */
+    std::string set_groups(const std::string& groups);
+
+    /**
+     * @brief Stop tracing, the recorded events are kept for the export.
+     */
+    void disable();
+
+    /**
+     * @brief The traced groups and the number of recorded events.
+     */
+    std::string get_status() const;
+
+    /**
+     * @brief The recorded events in the Chrome trace event format (JSON object format).
+     */
+    std::string to_json() const;
+
+    static void test_group_tracer();
+};
+
+#endif // GROUP_TRACER_HPP
+/** @} */
@@ -28,7 +28,7 @@
 #ifndef IGMP_RECEIVER_HPP
 #define IGMP_RECEIVER_HPP
 
-#include "include/proxy/receiver.hpp"
+#include "include/proxy/proto_receiver.hpp"
 
 /**
  * @brief Size of the router alert option.
@@ -43,7 +43,7 @@
 /**
  * @brief Receive IGMP messages.
  */
-class igmp_receiver : public receiver
+class igmp_receiver : public proto_receiver<igmp_traits>
 {
 private:
 
@@ -51,11 +51,16 @@ private:
     int get_iov_min_size() override;
     void analyse_packet(struct msghdr* msg, int info_size) override;
 
+    //the report parsing benchmark calls analyse_packet() directly
+    friend class bench;
+
 public:
     /**
      * @brief Create an igmp_receiver.
      */
     igmp_receiver(proxy_instance* pr_i, const std::shared_ptr<const mroute_socket> mrt_sock,const std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode);
+
+    ~igmp_receiver();
 };
 
 #endif // IGMP_RECEIVER_HPP
@@ -28,27 +28,29 @@
 #ifndef IGMP_SENDER_HPP
 #define IGMP_SENDER_HPP
 
-#include "include/proxy/sender.hpp"
+#include "include/proxy/proto_sender.hpp"
 
 /**
  * @brief Generates IGMP messages.
  */
-class igmp_sender : public sender
+class igmp_sender final : public proto_sender<igmp_traits, igmp_sender>
 {
 private:
-    bool send_igmpv3_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag, const source_list<source>& slist) const;
+    friend class proto_sender<igmp_traits, igmp_sender>;
 
-public:
-    igmp_sender(const std::shared_ptr<const interfaces>& interfaces);
-
-    bool send_record(unsigned int if_index, mc_filter filter_mode, const addr_storage& gaddr, const source_list<source>& slist) const override;
+    //appends the query to buf, a specific query is patched from the template
+    void encode_query(const query_template& qt, const query_request& q, std::vector<unsigned char>& buf) const;
 
-    virtual bool send_general_query(unsigned int if_index, const timers_values& tv) const override;
+    //encodes the IP header, router alert option and IGMPv3 query of the interface
+    void build_query_template(unsigned int if_index, const timers_values& tv, query_template& qt) const;
 
-    bool send_mc_addr_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag) const override;
+    //records holds num_records packed group records
+    bool send_report_packet(unsigned int if_index, const std::vector<unsigned char>& records, unsigned int num_records) const;
 
-    bool send_mc_addr_and_src_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, source_list<source>& slist) const override;
+public:
+    igmp_sender(const std::shared_ptr<const interfaces>& interfaces);
 
+    static void test_igmp_sender();
 };
 
 #endif // IGMP_SENDER_HPP
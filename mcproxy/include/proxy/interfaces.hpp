@@ -30,6 +30,7 @@
 #include <map>
 #include <vector>
 #include <sstream>
+#include <mutex>
 
 class addr_storage;
 
@@ -46,7 +47,10 @@ private:
 
     //ipv4 only
     bool m_reset_reverse_path_filter;
-    if_prop m_if_prop;
+
+    //refreshed by the proxy instance on link and address changes while other threads read it
+    mutable if_prop m_if_prop;
+    mutable std::mutex m_if_prop_lock;
     reverse_path_filter m_reverse_path_filter;
 
     std::map<int, unsigned int> m_vif_if;
@@ -61,7 +65,7 @@ public:
     interfaces(int addr_family, bool reset_reverse_path_filter);
     ~interfaces();
 
-    bool refresh_network_interfaces();
+    bool refresh_network_interfaces() const;
 
     bool add_interface(const std::string& if_name);
     bool add_interface(unsigned int if_index);
@@ -71,10 +75,16 @@ public:
 
 
     int get_virtual_if_index(unsigned int if_index) const;
+
+    //virtual interface index ==> interface index of all interfaces in the kernel table
+    std::map<int, unsigned int> get_vif_map() const;
     addr_storage get_saddr(const std::string& if_name) const;
 
     static std::string get_if_name(unsigned int if_index);
 
+    //return 0 on error
+    static unsigned int get_mtu(unsigned int if_index);
+
     static unsigned int get_if_index(const std::string& if_name);
     static unsigned int get_if_index(const char* if_name);
     unsigned int get_if_index(int virtual_if_index) const;
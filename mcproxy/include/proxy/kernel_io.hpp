@@ -0,0 +1,183 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/**
+ * @addtogroup mod_proxy_instance Proxy Instance
+ * @{
+ */
+
+#ifndef KERNEL_IO_HPP
+#define KERNEL_IO_HPP
+
+#include "include/utils/addr_storage.hpp"
+#include "include/proxy/def.hpp"
+#include "include/proxy/message_format.hpp"
+#include "include/proxy/timers_values.hpp"
+#include "include/proxy/sender.hpp"
+
+#include <list>
+#include <map>
+#include <tuple>
+#include <thread>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <string>
+
+#define KERNEL_IO_QUERY_TICK 10 //msec
+
+class worker;
+class routing;
+
+enum kernel_op_type {
+    KOT_ADD_ROUTE, KOT_DEL_ROUTE, KOT_RECORD, KOT_GENERAL_QUERY, KOT_GROUP_QUERY, KOT_REPORT
+};
+
+/**
+ * @brief One queued kernel operation, only the fields of its type are used.
+ */
+struct kernel_op {
+    kernel_op_type type;
+    unsigned int if_index = 0; //interface index or input vif of a route
+    addr_storage gaddr;
+    addr_storage saddr;
+    std::list<int> output_vif;
+    mc_filter filter_mode = INCLUDE_MODE;
+    source_list<source> slist;
+    std::list<report_record> records;
+    std::shared_ptr<const timers_values> tv;
+    bool s_flag = false;
+    std::list<addr_storage> query_slist; //sources of a group and source specific query
+
+    std::string to_string() const;
+};
+
+//operation class, interface index, group, source and a sequence number for operations that are never coalesced
+using kernel_op_key = std::tuple<int, unsigned int, addr_storage, addr_storage, unsigned long>;
+
+/**
+ * @brief Executes the route, membership and query operations of a proxy
+ * instance on its own thread. The worker queues operations and releases them
+ * with commit(), usually once per processed message. A pending operation is
+ * dropped when a later one for the same route or the same upstream membership
+ * is queued (e.g. add then delete of (S,G) only deletes). The later operation
+ * takes the last position of the queue, so the operations reach the kernel in
+ * the order they were queued. After each batch the outcome is reported to the
+ * worker with a kernel_io_result_msg.
+ *
+ * Queries are held back for up to KERNEL_IO_QUERY_TICK, so that the queries
+ * of all queriers of the instance are sent in one batch with sendmmsg().
+ */
+class kernel_io
+{
+private:
+    const std::shared_ptr<const sender> m_sender;
+    const routing* const m_routing;
+    const worker* const m_reply_to;
+
+    //execute in the thread calling commit(), for the debug testing mode
+    const bool m_synchronous;
+
+    std::list<kernel_op> m_queue;
+    std::map<kernel_op_key, std::list<kernel_op>::iterator> m_index;
+    unsigned long m_seq;
+
+    bool m_running;
+    bool m_commit_pending;
+    bool m_busy;
+
+    //only queries are pending, they are released at m_query_deadline
+    bool m_query_tick_pending;
+    std::chrono::time_point<std::chrono::steady_clock> m_query_deadline;
+    std::unique_ptr<std::thread> m_thread;
+
+    mutable std::mutex m_global_lock;
+    std::condition_variable m_con_var;
+    std::condition_variable m_idle_con_var;
+
+    //statistics
+    unsigned long m_executed;
+    unsigned long m_coalesced;
+    unsigned long m_failed;
+
+    void worker_thread();
+    void enqueue(const kernel_op_key& key, const kernel_op& op);
+    void release(bool immediately);
+    bool execute(const kernel_op& op) const;
+    void execute_batch(const std::list<kernel_op>& batch);
+
+    kernel_io(const kernel_io&) = delete;
+    kernel_io& operator=(const kernel_io&) = delete;
+
+public:
+    /**
+     * @param sender sends reports and queries
+     * @param routing sets the multicast routes, must outlive the kernel_io
+     * @param reply_to receives the kernel_io_result_msg, can be nullptr
+     * @param synchronous execute the operations without an extra thread
+     */
+    kernel_io(const std::shared_ptr<const sender>& sender, const routing* routing, const worker* reply_to, bool synchronous = false);
+
+    virtual ~kernel_io();
+
+    void add_route(int input_vif, const addr_storage& gaddr, const addr_storage& saddr, const std::list<int>& output_vif);
+
+    void del_route(int vif, const addr_storage& gaddr, const addr_storage& saddr);
+
+    void send_record(unsigned int if_index, mc_filter filter_mode, const addr_storage& gaddr, const source_list<source>& slist);
+
+    void send_general_query(unsigned int if_index, const timers_values& tv);
+
+    void send_mc_addr_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag);
+
+    /**
+     * @brief Decrement the retransmission counters of slist now and queue up to two queries.
+     * @return Return true if a source has to be retransmitted again.
+     */
+    bool send_mc_addr_and_src_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, source_list<source>& slist);
+
+    void send_report(unsigned int if_index, const std::list<report_record>& records);
+
+    /**
+     * @brief Release all queued operations to the kernel, only queries wait for the query tick.
+     */
+    void commit();
+
+    /**
+     * @brief Release all queued operations and wait until they are executed,
+     *        e.g. before the virtual interfaces change.
+     */
+    void sync();
+
+    unsigned int get_pending_count() const;
+
+    std::string to_string() const;
+    friend std::ostream& operator<<(std::ostream& stream, const kernel_io& kio);
+
+    static std::string get_kernel_op_type_name(kernel_op_type kot);
+
+    static void test_kernel_io();
+};
+
+#endif // KERNEL_IO_HPP
+/** @} */
@@ -33,14 +33,18 @@
 #include <map>
 #include <chrono>
 #include <memory>
+#include <utility>
 
 struct gaddr_info {
-    gaddr_info(group_mem_protocol compatibility_mode_variable);
+    gaddr_info(group_mem_protocol compatibility_mode_variable, const std::shared_ptr<mem_arena>& arena = nullptr);
     gaddr_info(const gaddr_info&) = default;
     gaddr_info& operator=(const gaddr_info&) = default;
     gaddr_info(gaddr_info&&) = default;
     gaddr_info& operator=(gaddr_info && ) = default;
 
+    //arena of the membership database, the source lists and timers of this group return their nodes to its free lists
+    std::shared_ptr<mem_arena> arena;
+
     mc_filter filter_mode;
     std::shared_ptr<filter_timer_msg> shared_filter_timer;
 
@@ -59,13 +63,21 @@ struct gaddr_info {
     source_list<source> include_requested_list;
     source_list<source> exclude_list;
 
+    //sources of this group counted in the sources gauge of the querier
+    unsigned int metric_sources;
+
+    template<typename T, typename... Args>
+    std::shared_ptr<T> make_timer(Args&&... args) const {
+        return std::allocate_shared<T>(arena_allocator<T, MAK_TIMER>(arena), std::forward<Args>(args)...);
+    }
+
     bool is_in_backward_compatibility_mode() const;
     bool is_under_bakcward_compatibility_effects() const; 
     std::string to_string() const;
     friend std::ostream& operator<<(std::ostream& stream, const gaddr_info& g);
 };
 
-using gaddr_map = std::map<addr_storage, gaddr_info>;
+using gaddr_map = std::map<addr_storage, gaddr_info, std::less<addr_storage>, arena_allocator<std::pair<const addr_storage, gaddr_info>, MAK_GROUP>>;
 using gaddr_pair = std::pair<addr_storage, gaddr_info>;
 
 /**
@@ -83,8 +95,15 @@ struct membership_db {
 
     group_mem_protocol querier_version_mode; 
     bool is_querier;
+
+    std::shared_ptr<mem_arena> arena; //holds the group entries, their source lists and timers
     gaddr_map group_info; //subscribed multicast group with their source lists
 
+    /**
+     * @brief Memory used by the group entries, source entries and timers of this database.
+     */
+    std::string get_memory_report() const;
+
     static void test_arithmetic();
 
     std::string to_string() const;
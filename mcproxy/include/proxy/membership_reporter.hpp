@@ -0,0 +1,158 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/**
+ * @addtogroup mod_sender Sender
+ * @{
+ */
+
+#ifndef MEMBERSHIP_REPORTER_HPP
+#define MEMBERSHIP_REPORTER_HPP
+
+#include "include/utils/addr_storage.hpp"
+#include "include/proxy/def.hpp"
+#include "include/proxy/sender.hpp"
+#include "include/proxy/message_format.hpp"
+
+#include <map>
+#include <set>
+#include <list>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <string>
+
+#define MEMBERSHIP_REPORTER_UNSOLICITED_REPORT_INTERVAL 1000 //msec, RFC 3376 Section 8.11 and RFC 3810 Section 9.11
+
+class worker;
+class timing;
+class kernel_io;
+
+/**
+ * @brief Host part of the proxy (RFC 4605) on the upstream interfaces. The
+ * upstream memberships are reported by the proxy itself instead of joining
+ * them on a kernel socket, so their number is not limited by the kernel.
+ * State changes are collected until flush() and sent packed into as few
+ * reports as the MTU allows, each change is retransmitted [Robustness
+ * Variable] times of its upstream interface (RFC 3376 Section 5.1, RFC 3810
+ * Section 6.1). Queries of an
+ * upstream router are answered with the current state after a random delay.
+ */
+class membership_reporter
+{
+private:
+    struct group_state {
+        mc_filter filter_mode;
+        std::set<addr_storage> slist;
+    };
+
+    struct pending_change {
+        std::list<report_record> records;
+        unsigned int remaining; //transmissions
+        bool sent;
+    };
+
+    struct upstream_state {
+        upstream_state();
+
+        std::map<addr_storage, group_state> groups;
+        std::map<addr_storage, pending_change> changes;
+        std::shared_ptr<upstream_report_timer_msg> change_timer;
+
+        //answer to a query
+        bool general_query_pending;
+        std::set<addr_storage> queried_groups;
+        std::shared_ptr<upstream_report_timer_msg> response_timer;
+    };
+
+    const int m_addr_family;
+    const worker* const m_msg_worker;
+    const std::shared_ptr<kernel_io> m_kernel_io;
+    const std::shared_ptr<timing> m_timing;
+
+    std::map<unsigned int, unsigned int> m_robustness_variables; //registered upstream interfaces
+    std::map<unsigned int, upstream_state> m_upstreams;
+    std::set<unsigned int> m_unsent; //interfaces with state changes not sent yet
+    std::mt19937 m_random;
+
+    std::chrono::milliseconds get_random_delay(std::chrono::milliseconds max);
+    std::list<report_record> get_state_change_records(const addr_storage& gaddr, const group_state* old_state, const group_state& new_state) const;
+    report_record get_record(mcast_addr_record_type type, const addr_storage& gaddr, const std::set<addr_storage>& slist) const;
+
+    void send_changes(unsigned int if_index, upstream_state& us, bool first_transmission);
+    void send_current_state(unsigned int if_index, upstream_state& us);
+    void set_change_timer(unsigned int if_index, upstream_state& us);
+
+public:
+    /**
+     * @param addr_family AF_INET or AF_INET6
+     * @param msg_worker receives the timer events
+     * @param kio sends the reports
+     * @param timing triggers the retransmissions and delayed answers
+     * @param seed of the random report delays
+     */
+    membership_reporter(int addr_family, const worker* msg_worker, const std::shared_ptr<kernel_io>& kio, const std::shared_ptr<timing>& timing, unsigned int seed);
+
+    /**
+     * @brief Leave all reported groups.
+     */
+    virtual ~membership_reporter();
+
+    /**
+     * @brief Register an upstream interface.
+     * @param robustness_variable number of transmissions of a state change
+     */
+    void add_interface(unsigned int if_index, unsigned int robustness_variable);
+
+    /**
+     * @brief Set the membership of a registered upstream interface, replaces the former membership of the group.
+     */
+    void set_state(unsigned int if_index, mc_filter filter_mode, const addr_storage& gaddr, const source_list<source>& slist);
+
+    /**
+     * @brief Send all state changes since the last flush.
+     */
+    void flush();
+
+    /**
+     * @brief Answer a query received on an upstream interface.
+     * @param gaddr unspecified address for a general query
+     */
+    void receive_query(unsigned int if_index, const addr_storage& gaddr, std::chrono::milliseconds max_resp_time);
+
+    void timer_triggerd(const std::shared_ptr<proxy_msg>& msg);
+
+    /**
+     * @brief Leave all groups of an upstream interface.
+     */
+    void del_interface(unsigned int if_index);
+
+    unsigned int get_group_count() const;
+
+    std::string to_string() const;
+    friend std::ostream& operator<<(std::ostream& stream, const membership_reporter& mr);
+
+    static void test_membership_reporter();
+};
+
+#endif // MEMBERSHIP_REPORTER_HPP
+/** @} */
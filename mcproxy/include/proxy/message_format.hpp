@@ -29,9 +29,11 @@
 
 #include "include/hamcast_logging.h"
 #include "include/utils/addr_storage.hpp"
+#include "include/utils/if_monitor.hpp"
 #include "include/proxy/def.hpp"
 #include "include/proxy/interfaces.hpp"
 #include "include/proxy/timers_values.hpp"
+#include "include/proxy/timing_clock.hpp"
 #include "include/parser/interface.hpp"
 
 #include <iostream>
@@ -39,6 +41,7 @@
 #include <map>
 #include <memory>
 #include <chrono>
+#include <list>
 
 struct proxy_msg {
     enum message_type {
@@ -53,9 +56,14 @@ struct proxy_msg {
         RET_SOURCE_TIMER_MSG,
         OLDER_HOST_PRESENT_TIMER_MSG,
         GENERAL_QUERY_TIMER_MSG,
+        UPSTREAM_REPORT_TIMER_MSG,
         CONFIG_MSG,
         GROUP_RECORD_MSG,
-        DEBUG_MSG
+        QUERY_MSG,
+        KERNEL_IO_RESULT_MSG,
+        IF_STATE_MSG,
+        DEBUG_MSG,
+        STATE_MSG
     };
 
     enum message_priority {
@@ -77,9 +85,14 @@ struct proxy_msg {
             {RET_SOURCE_TIMER_MSG, "RET_SOURCE_TIMER_MSG"},
             {OLDER_HOST_PRESENT_TIMER_MSG, "OLDER_HOST_PRESENT_TIMER_MSG"},
             {GENERAL_QUERY_TIMER_MSG,      "GENERAL_QUERY_TIMER_MSG"     },
+            {UPSTREAM_REPORT_TIMER_MSG,    "UPSTREAM_REPORT_TIMER_MSG"   },
             {CONFIG_MSG,           "CONFIG_MSG"          },
             {GROUP_RECORD_MSG,     "GROUP_RECORD_MSG"    },
-            {DEBUG_MSG,            "DEBUG_MSG"           }
+            {QUERY_MSG,            "QUERY_MSG"           },
+            {KERNEL_IO_RESULT_MSG, "KERNEL_IO_RESULT_MSG"},
+            {IF_STATE_MSG,         "IF_STATE_MSG"        },
+            {DEBUG_MSG,            "DEBUG_MSG"           },
+            {STATE_MSG,            "STATE_MSG"           }
         };
         return name_map[mt];
     }
@@ -166,7 +179,7 @@ struct timer_msg : public proxy_msg {
         : proxy_msg(type, SYSTEMIC)
         , m_if_index(if_index)
         , m_gaddr(gaddr)
-        , m_end_time(std::chrono::steady_clock::now() + duration) {
+        , m_end_time(timing_clock::now() + duration) {
         HC_LOG_TRACE("");
     }
 
@@ -178,14 +191,18 @@ struct timer_msg : public proxy_msg {
         return m_gaddr;
     }
 
+    const std::chrono::time_point<std::chrono::steady_clock>& get_end_time() {
+        return m_end_time;
+    }
+
     bool is_remaining_time_greater_than(std::chrono::milliseconds comp_time) {
-        return (std::chrono::steady_clock::now() + comp_time) <= m_end_time;
+        return (timing_clock::now() + comp_time) <= m_end_time;
     }
 
     std::string get_remaining_time() {
         using namespace std::chrono;
         std::ostringstream s;
-        auto current_time = steady_clock::now();
+        auto current_time = timing_clock::now();
         auto time_span = m_end_time - current_time;
         double seconds = time_span.count()  * steady_clock::period::num / steady_clock::period::den;
         if (seconds >= 0) {
@@ -249,6 +266,13 @@ struct general_query_timer_msg : public timer_msg {
     }
 };
 
+//retransmission of state changes and delayed answers to queries on an upstream
+struct upstream_report_timer_msg : public timer_msg {
+    upstream_report_timer_msg(unsigned int if_index, std::chrono::milliseconds duration): timer_msg(UPSTREAM_REPORT_TIMER_MSG, if_index, addr_storage(), duration) {
+        HC_LOG_TRACE("");
+    }
+};
+
 struct new_source_timer_msg : public timer_msg {
     new_source_timer_msg(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr, std::chrono::milliseconds duration)
         : timer_msg(NEW_SOURCE_TIMER_MSG, if_index, gaddr, duration)
@@ -273,6 +297,13 @@ struct debug_msg : public proxy_msg {
     }
 };
 
+//publish a snapshot of the membership and routing tables
+struct state_msg : public proxy_msg {
+    state_msg(): proxy_msg(STATE_MSG, USER_INPUT) {
+        HC_LOG_TRACE("");
+    }
+};
+
 //------------------------------------------------------------------------
 
 struct source {
@@ -324,13 +355,15 @@ struct group_record_msg : public proxy_msg {
     //group_record_msg()
     //: group_record_msg(0, MODE_IS_INCLUDE, addr_storage(), source_list<source>(), IGMPv3) {}
 
-    group_record_msg(unsigned int if_index, mcast_addr_record_type record_type, const addr_storage& gaddr, source_list<source>&& slist, group_mem_protocol grp_mem_proto)
+    //receive_time: kernel time stamp of the report, the epoch if unknown
+    group_record_msg(unsigned int if_index, mcast_addr_record_type record_type, const addr_storage& gaddr, source_list<source>&& slist, group_mem_protocol grp_mem_proto, const std::chrono::system_clock::time_point& receive_time = std::chrono::system_clock::time_point())
         : proxy_msg(GROUP_RECORD_MSG, LOSEABLE)
         , m_if_index(if_index)
         , m_record_type(record_type)
         , m_gaddr(gaddr)
         , m_slist(slist)
-        , m_grp_mem_proto(grp_mem_proto){}
+        , m_grp_mem_proto(grp_mem_proto)
+        , m_receive_time(receive_time){}
 
     friend std::ostream& operator<<(std::ostream& stream, const group_record_msg& r) {
         return stream << r.to_string();
@@ -367,12 +400,55 @@ struct group_record_msg : public proxy_msg {
         return m_grp_mem_proto;
     }
 
+    const std::chrono::system_clock::time_point& get_receive_time() {
+        return m_receive_time;
+    }
+
+    void set_enqueue_time(const std::chrono::steady_clock::time_point& enqueue_time) {
+        m_enqueue_time = enqueue_time;
+    }
+
+    const std::chrono::steady_clock::time_point& get_enqueue_time() {
+        return m_enqueue_time;
+    }
+
 private:
     unsigned int m_if_index;
     mcast_addr_record_type m_record_type;
     addr_storage m_gaddr;
     source_list<source> m_slist;
     group_mem_protocol m_grp_mem_proto;
+
+    std::chrono::system_clock::time_point m_receive_time;
+    std::chrono::steady_clock::time_point m_enqueue_time;
+};
+
+//a membership query received on an interface, the group address is unspecified for general queries
+struct query_msg : public proxy_msg {
+    query_msg(unsigned int if_index, const addr_storage& gaddr, std::chrono::milliseconds max_resp_time)
+        : proxy_msg(QUERY_MSG, SYSTEMIC)
+        , m_if_index(if_index)
+        , m_gaddr(gaddr)
+        , m_max_resp_time(max_resp_time) {
+        HC_LOG_TRACE("");
+    }
+
+    unsigned int get_if_index() {
+        return m_if_index;
+    }
+
+    const addr_storage& get_gaddr() {
+        return m_gaddr;
+    }
+
+    std::chrono::milliseconds get_max_resp_time() {
+        return m_max_resp_time;
+    }
+
+private:
+    unsigned int m_if_index;
+    addr_storage m_gaddr;
+    std::chrono::milliseconds m_max_resp_time;
 };
 
 struct new_source_msg : public proxy_msg {
@@ -402,6 +478,52 @@ private:
     addr_storage m_saddr;
 };
 
+//------------------------------------------------------------------------
+struct kernel_io_result_msg : public proxy_msg {
+    kernel_io_result_msg(unsigned int executed, const std::list<std::string>& failures)
+        : proxy_msg(KERNEL_IO_RESULT_MSG, SYSTEMIC)
+        , m_executed(executed)
+        , m_failures(failures) {
+        HC_LOG_TRACE("");
+    }
+
+    //number of kernel operations of the batch
+    unsigned int get_executed() {
+        return m_executed;
+    }
+
+    //descriptions of the failed kernel operations
+    const std::list<std::string>& get_failures() {
+        return m_failures;
+    }
+
+private:
+    unsigned int m_executed;
+    std::list<std::string> m_failures;
+};
+
+//------------------------------------------------------------------------
+struct if_state_msg : public proxy_msg {
+    if_state_msg(unsigned int if_index, if_event ife)
+        : proxy_msg(IF_STATE_MSG, SYSTEMIC)
+        , m_if_index(if_index)
+        , m_if_event(ife) {
+        HC_LOG_TRACE("");
+    }
+
+    unsigned int get_if_index() {
+        return m_if_index;
+    }
+
+    if_event get_if_event() {
+        return m_if_event;
+    }
+
+private:
+    unsigned int m_if_index;
+    if_event m_if_event;
+};
+
 //------------------------------------------------------------------------
 struct config_msg : public proxy_msg {
     enum config_instruction {
@@ -412,13 +534,13 @@ struct config_msg : public proxy_msg {
         SET_GLOBAL_RULE_BINDING
     };
 
-    config_msg(config_instruction instruction, unsigned int if_index, unsigned int upstream_priority, const std::shared_ptr<interface>& interf)
+    config_msg(config_instruction instruction, unsigned int if_index, unsigned int upstream_priority, const std::shared_ptr<interface>& interf, const timers_values& tv = timers_values())
         : proxy_msg(CONFIG_MSG, SYSTEMIC)
         , m_instruction(instruction)
         , m_if_index(if_index)
         , m_upstream_priority(upstream_priority)
         , m_interface(interf)
-        , m_tv(timers_values()) {
+        , m_tv(tv) {
         if (instruction != DEL_DOWNSTREAM && instruction != ADD_UPSTREAM && instruction != DEL_UPSTREAM) {
             HC_LOG_ERROR("config_msg is incomplet, missing parameter timer_values");
             throw "config_msg is incomplet, missing parameter timer_values";
@@ -30,6 +30,8 @@
 #ifndef MESSAGE_QUEUE_HPP
 #define MESSAGE_QUEUE_HPP
 #include "include/hamcast_logging.h"
+#include "include/utils/metrics.hpp"
+#include "include/utils/flight_recorder.hpp"
 #include <thread>
 #include <condition_variable>
 #include <mutex>
@@ -47,9 +49,13 @@ private:
     std::priority_queue<T, std::vector<T>, Compare> m_q;
     unsigned int m_size;
 
-    std::mutex m_global_lock;
+    mutable std::mutex m_global_lock;
     std::condition_variable cond_empty;
 
+    //optional, nullptr if not published
+    metric_gauge* m_depth;
+    metric_counter* m_drops;
+
 public:
     /**
       * @brief Create a message_queue with a maximum size.
@@ -72,6 +78,11 @@ public:
       */
     int max_size() const;
 
+    /**
+     * @brief Publish the number of waiting messages and the dropped messages.
+     */
+    void set_metrics(metric_gauge* depth, metric_counter* drops);
+
     /**
      * @brief Add an element on tail or delete the element if the queue is full.
      */
@@ -92,10 +103,22 @@ template<typename T, typename Compare>
 message_queue<T, Compare>::message_queue(int size, Compare compare)
     : m_q(compare)
     , m_size(size)
+    , m_depth(nullptr)
+    , m_drops(nullptr)
 {
     HC_LOG_TRACE("");
 }
 
+template<typename T, typename Compare>
+void message_queue<T, Compare>::set_metrics(metric_gauge* depth, metric_counter* drops)
+{
+    HC_LOG_TRACE("");
+
+    std::lock_guard<std::mutex> lock(m_global_lock);
+    m_depth = depth;
+    m_drops = drops;
+}
+
 template<typename T, typename Compare>
 bool message_queue<T, Compare>::is_empty() const
 {
@@ -133,8 +156,15 @@ bool message_queue<T, Compare>::enqueue_loseable(const T& t)
         std::unique_lock<std::mutex> lock(m_global_lock);
         if (m_q.size() < m_size) {
             m_q.push(t);
+            if (m_depth != nullptr) {
+                m_depth->set(m_q.size());
+            }
         } else {
             HC_LOG_WARN("message_queue is full, failed to insert message");
+            if (m_drops != nullptr) {
+                m_drops->inc();
+            }
+            flight_recorder::record(FR_QUEUE_OVERFLOW, 0, addr_storage(), m_size);
             return false;
         }
     }
@@ -150,6 +180,9 @@ void message_queue<T, Compare>::enqueue(const T& t)
     {
         std::unique_lock<std::mutex> lock(m_global_lock);
         m_q.push(t);
+        if (m_depth != nullptr) {
+            m_depth->set(m_q.size());
+        }
     }
     cond_empty.notify_one();
     HC_LOG_DEBUG("!!!!!test2");
@@ -169,6 +202,9 @@ T message_queue<T, Compare>::dequeue(void)
 
         t = m_q.top();
         m_q.pop();
+        if (m_depth != nullptr) {
+            m_depth->set(m_q.size());
+        }
     }
     return t;
 }
@@ -28,7 +28,7 @@
 #ifndef MLD_RECEIVER_HPP
 #define MLD_RECEIVER_HPP
 
-#include "include/proxy/receiver.hpp"
+#include "include/proxy/proto_receiver.hpp"
 
 /**
  * @brief Cache Miss message received form the Linux Kernel identified by this ip verion.
@@ -38,7 +38,7 @@
 /**
  * @brief Receive MLD messages.
  */
-class mld_receiver : public receiver
+class mld_receiver : public proto_receiver<mld_traits>
 {
 private:
     int get_ctrl_min_size() override; //size in byte
@@ -47,6 +47,8 @@ private:
 
 public:
     mld_receiver(proxy_instance* pr_i, std::shared_ptr<const mroute_socket> mrt_sock, std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode);
+
+    ~mld_receiver();
 };
 
 #endif // MLD_RECEIVER_HPP
@@ -28,7 +28,7 @@
 #ifndef MLD_SENDER_HPP
 #define MLD_SENDER_HPP
 
-#include "include/proxy/sender.hpp"
+#include "include/proxy/proto_sender.hpp"
 
 /**
  * @brief This fields will fill by the Linux kernel.
@@ -48,25 +48,24 @@ typedef u_int16_t pad2 ; //padding
 /**
  * @brief Generates MLD messages.
  */
-class mld_sender: public sender
+class mld_sender final : public proto_sender<mld_traits, mld_sender>
 {
 private:
-    bool add_hbh_opt_header() const;
-
-    bool send_mldv2_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag, const source_list<source>& slist) const;
-
-public:
-    mld_sender(const std::shared_ptr<const interfaces>& interfaces);
+    friend class proto_sender<mld_traits, mld_sender>;
 
-    bool send_record(unsigned int if_index, mc_filter filter_mode, const addr_storage& gaddr, const source_list<source>& slist) const override;
+    bool add_hbh_opt_header() const;
 
-    virtual bool send_general_query(unsigned int if_index, const timers_values& tv) const override;
+    //appends the query to buf, a specific query is patched from the template
+    void encode_query(const query_template& qt, const query_request& q, std::vector<unsigned char>& buf) const;
 
-    bool send_mc_addr_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag) const override;
+    //encodes the MLDv2 query, the kernel adds the IPv6 header and the checksum
+    void build_query_template(unsigned int if_index, const timers_values& tv, query_template& qt) const;
 
-    bool send_mc_addr_and_src_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, source_list<source>& slist) const override;
+    //records holds num_records packed group records
+    bool send_report_packet(unsigned int if_index, const std::vector<unsigned char>& records, unsigned int num_records) const;
 
-    static void test_igmp_sender();
+public:
+    mld_sender(const std::shared_ptr<const interfaces>& interfaces);
 };
 
 #endif // MLD_SENDER_HPP
@@ -0,0 +1,119 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/**
+ * @addtogroup mod_receiver Receiver
+ * @{
+ */
+
+#ifndef PROTO_RECEIVER_HPP
+#define PROTO_RECEIVER_HPP
+
+#include "include/hamcast_logging.h"
+#include "include/proxy/receiver.hpp"
+#include "include/proxy/protocol_traits.hpp"
+#include "include/proxy/message_format.hpp"
+
+#include <cstring>
+
+/**
+ * @brief Receiver parts shared by IGMP and MLD. The group records of IGMPv3
+ * and MLDv2 reports are parsed with the record layout and the address type
+ * of Traits, so the record loop neither branches on the address family nor
+ * copies addresses of unknown size.
+ */
+template<typename Traits>
+class proto_receiver : public receiver
+{
+protected:
+    /**
+     * @brief Pass all group records of an IGMPv3 or MLDv2 report to the proxy instance.
+     * Records that exceed the received bytes are dropped.
+     * @param report first byte of the report header
+     * @param size received bytes from the report header on
+     */
+    void analyse_report(unsigned int if_index, const unsigned char* report, std::size_t size);
+
+public:
+    proto_receiver(proxy_instance* pr_i, const std::shared_ptr<const mroute_socket>& mrt_sock, const std::shared_ptr<const interfaces>& interfaces, bool in_debug_testing_mode);
+};
+
+template<typename Traits>
+proto_receiver<Traits>::proto_receiver(proxy_instance* pr_i, const std::shared_ptr<const mroute_socket>& mrt_sock, const std::shared_ptr<const interfaces>& interfaces, bool in_debug_testing_mode)
+    : receiver(pr_i, Traits::addr_family, mrt_sock, interfaces, in_debug_testing_mode)
+{
+    HC_LOG_TRACE("");
+}
+
+template<typename Traits>
+void proto_receiver<Traits>::analyse_report(unsigned int if_index, const unsigned char* report, std::size_t size)
+{
+    HC_LOG_TRACE("");
+    using report_type = typename Traits::report_type;
+    using record_type = typename Traits::record_type;
+    using addr_type = typename Traits::addr_type;
+
+    if (size < sizeof(report_type)) {
+        HC_LOG_DEBUG("report too short: " << size);
+        return;
+    }
+
+    int num_records = ntohs(reinterpret_cast<const report_type*>(report)->num_of_mc_records);
+    HC_LOG_DEBUG("\tnum of multicast records: " << num_records);
+
+    count_message(if_index, Traits::get_report_name());
+
+    std::size_t offset = sizeof(report_type);
+    for (int i = 0; i < num_records && offset + sizeof(record_type) <= size; ++i) {
+        const record_type* rec = reinterpret_cast<const record_type*>(report + offset);
+        mcast_addr_record_type rec_type = static_cast<mcast_addr_record_type>(rec->type);
+        unsigned int aux_size = rec->aux_data_len * 4; //RFC 3376 Section 4.2.6, RFC 3810 Section 5.2.6 Aux Data Len
+        unsigned int nos = ntohs(rec->num_of_srcs);
+
+        std::size_t src_offset = offset + sizeof(record_type);
+        offset = src_offset + nos * sizeof(addr_type) + aux_size;
+        if (offset > size) {
+            HC_LOG_DEBUG("record " << i << " exceeds the report");
+            return;
+        }
+
+        //the record is packed, the addresses may be unaligned
+        addr_type addr;
+        memcpy(&addr, &rec->gaddr, sizeof(addr));
+        addr_storage gaddr(addr);
+
+        source_list<source> slist;
+        for (unsigned int j = 0; j < nos; ++j) {
+            memcpy(&addr, report + src_offset + j * sizeof(addr_type), sizeof(addr));
+            slist.insert(addr_storage(addr));
+        }
+
+        HC_LOG_DEBUG("\trecord type: " << get_mcast_addr_record_type_name(rec_type));
+        HC_LOG_DEBUG("\tgaddr: " << gaddr);
+        HC_LOG_DEBUG("\tnumber of sources: " << slist.size());
+        HC_LOG_DEBUG("\tsource_list: " << slist);
+        add_record(std::make_shared<group_record_msg>(if_index, rec_type, gaddr, std::move(slist), Traits::version, m_receive_time));
+    }
+}
+
+#endif // PROTO_RECEIVER_HPP
+/** @} */
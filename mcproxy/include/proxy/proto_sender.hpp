@@ -0,0 +1,322 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/**
+ * @addtogroup mod_sender Sender
+ * @{
+ */
+
+#ifndef PROTO_SENDER_HPP
+#define PROTO_SENDER_HPP
+
+#include "include/hamcast_logging.h"
+#include "include/proxy/sender.hpp"
+#include "include/proxy/protocol_traits.hpp"
+#include "include/proxy/message_format.hpp"
+#include "include/proxy/group_tracer.hpp"
+#include "include/utils/flight_recorder.hpp"
+
+#include <list>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+
+/**
+ * @brief Sender parts shared by IGMP and MLD. The protocol is fixed at compile
+ * time by Traits and the queries are encoded by Derived::build_query_template()
+ * and Derived::encode_query(), which are called without virtual dispatch.
+ */
+template<typename Traits, typename Derived>
+class proto_sender : public sender
+{
+private:
+    const Derived& derived() const;
+
+protected:
+    /**
+     * @brief Encoded queries of an interface and the timers values they were built for.
+     */
+    struct query_template {
+        unsigned int robustness_variable;
+        std::chrono::seconds query_interval;
+        std::chrono::milliseconds query_response_interval;
+        std::chrono::milliseconds last_listener_query_time;
+
+        //complete general query
+        std::vector<unsigned char> general_query;
+
+        //query with the max response code of group specific queries, the group, sources and checksums are patched per query
+        std::vector<unsigned char> specific_query;
+
+        bool is_built_for(const timers_values& tv) const;
+    };
+
+    const addr_storage m_all_hosts_addr;
+
+    //queries are sent by the querier and the kernel io thread, they share the templates and the send buffer
+    mutable std::mutex m_query_lock;
+    mutable std::map<unsigned int, query_template> m_query_templates;
+    mutable std::vector<unsigned char> m_query_buf;
+    mutable std::vector<mroute_packet> m_query_packets;
+
+    //the template of the interface, (re)built by Derived::build_query_template() if the timers values changed; requires m_query_lock
+    const query_template& get_query_template(unsigned int if_index, const timers_values& tv) const;
+
+public:
+    proto_sender(const std::shared_ptr<const interfaces>& interfaces);
+
+    bool send_record(unsigned int if_index, mc_filter filter_mode, const addr_storage& gaddr, const source_list<source>& slist) const override final;
+
+    bool send_general_query(unsigned int if_index, const timers_values& tv) const override final;
+
+    bool send_mc_addr_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag) const override final;
+
+    bool send_mc_addr_and_src_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, source_list<source>& slist) const override final;
+
+    bool send_queries(std::vector<query_request>& queries) const override final;
+
+    bool send_report(unsigned int if_index, const std::list<report_record>& records) const override final;
+
+    void clear_query_templates(unsigned int if_index) const override final;
+};
+
+template<typename Traits, typename Derived>
+proto_sender<Traits, Derived>::proto_sender(const std::shared_ptr<const interfaces>& interfaces)
+    : sender(interfaces, Traits::version)
+    , m_all_hosts_addr(Traits::get_all_hosts_addr())
+{
+    HC_LOG_TRACE("");
+}
+
+template<typename Traits, typename Derived>
+const Derived& proto_sender<Traits, Derived>::derived() const
+{
+    return *static_cast<const Derived*>(this);
+}
+
+template<typename Traits, typename Derived>
+bool proto_sender<Traits, Derived>::query_template::is_built_for(const timers_values& tv) const
+{
+    return robustness_variable == tv.get_robustness_variable()
+           && query_interval == tv.get_query_interval()
+           && query_response_interval == tv.get_query_response_interval()
+           && last_listener_query_time == tv.get_last_listener_query_time();
+}
+
+template<typename Traits, typename Derived>
+const typename proto_sender<Traits, Derived>::query_template& proto_sender<Traits, Derived>::get_query_template(unsigned int if_index, const timers_values& tv) const
+{
+    HC_LOG_TRACE("");
+
+    auto it = m_query_templates.find(if_index);
+    if (it != std::end(m_query_templates) && it->second.is_built_for(tv)) {
+        return it->second;
+    }
+
+    query_template& qt = m_query_templates[if_index];
+    qt.robustness_variable = tv.get_robustness_variable();
+    qt.query_interval = tv.get_query_interval();
+    qt.query_response_interval = tv.get_query_response_interval();
+    qt.last_listener_query_time = tv.get_last_listener_query_time();
+    derived().build_query_template(if_index, tv, qt);
+
+    return qt;
+}
+
+template<typename Traits, typename Derived>
+void proto_sender<Traits, Derived>::clear_query_templates(unsigned int if_index) const
+{
+    HC_LOG_TRACE("");
+
+    std::lock_guard<std::mutex> lock(m_query_lock);
+    m_query_templates.erase(if_index);
+}
+
+template<typename Traits, typename Derived>
+bool proto_sender<Traits, Derived>::send_record(unsigned int if_index, mc_filter filter_mode, const addr_storage& gaddr, const source_list<source>& slist) const
+{
+    HC_LOG_TRACE("");
+
+    if (filter_mode == INCLUDE_MODE && slist.empty() ) {
+        m_membership_sockets.leave_group(if_index, gaddr);
+        return true;
+    } else if (filter_mode == EXCLUDE_MODE || filter_mode == INCLUDE_MODE) {
+        std::list<addr_storage> src_list;
+        for (auto & e : slist) {
+            src_list.push_back(e.saddr);
+        }
+
+        //joins the group on a socket with free capacity, the filter goes to the owning socket
+        return m_membership_sockets.set_source_filter(if_index, gaddr, filter_mode, src_list);
+    } else {
+        HC_LOG_ERROR("unknown filter mode");
+        return false;
+    }
+}
+
+template<typename Traits, typename Derived>
+bool proto_sender<Traits, Derived>::send_general_query(unsigned int if_index, const timers_values& tv) const
+{
+    HC_LOG_TRACE("");
+
+    std::vector<query_request> queries { query_request{if_index, &tv, addr_storage(Traits::addr_family), false, {}, false} };
+    return send_queries(queries);
+}
+
+template<typename Traits, typename Derived>
+bool proto_sender<Traits, Derived>::send_mc_addr_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag) const
+{
+    HC_LOG_TRACE("");
+
+    std::vector<query_request> queries { query_request{if_index, &tv, gaddr, s_flag, {}, false} };
+    return send_queries(queries);
+}
+
+template<typename Traits, typename Derived>
+bool proto_sender<Traits, Derived>::send_mc_addr_and_src_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, source_list<source>& slist) const
+{
+    HC_LOG_TRACE("");
+
+    std::list<addr_storage> slist_higher;
+    std::list<addr_storage> slist_lower;
+    bool rc = split_source_retransmissions(tv, slist, slist_higher, slist_lower);
+
+    std::vector<query_request> queries;
+    if (!slist_higher.empty()) {
+        queries.push_back(query_request{if_index, &tv, gaddr, true, std::move(slist_higher), false});
+    }
+
+    if (!slist_lower.empty()) {
+        queries.push_back(query_request{if_index, &tv, gaddr, false, std::move(slist_lower), false});
+    }
+
+    send_queries(queries);
+    return rc;
+}
+
+template<typename Traits, typename Derived>
+bool proto_sender<Traits, Derived>::send_queries(std::vector<query_request>& queries) const
+{
+    HC_LOG_TRACE("");
+
+    std::lock_guard<std::mutex> lock(m_query_lock);
+
+    //encode all queries first, m_query_buf may grow
+    std::vector<std::size_t> offsets;
+    offsets.reserve(queries.size() + 1);
+    m_query_buf.clear();
+    for (auto & e : queries) {
+        offsets.push_back(m_query_buf.size());
+        derived().encode_query(get_query_template(e.if_index, *e.tv), e, m_query_buf);
+    }
+    offsets.push_back(m_query_buf.size());
+
+    m_query_packets.clear();
+    for (unsigned int i = 0; i < queries.size(); ++i) {
+        const query_request& q = queries[i];
+        m_query_packets.push_back(mroute_packet{q.if_index, Traits::is_unspecified(q.gaddr) ? m_all_hosts_addr : q.gaddr, m_query_buf.data() + offsets[i], static_cast<unsigned int>(offsets[i + 1] - offsets[i]), false});
+    }
+
+    bool rc = m_sock.send_packets(m_query_packets);
+
+    for (unsigned int i = 0; i < queries.size(); ++i) {
+        queries[i].sent = m_query_packets[i].sent;
+        flight_recorder::record(FR_QUERY_SENT, queries[i].if_index, queries[i].gaddr, queries[i].slist.size(), (queries[i].s_flag ? 1 : 0) | (queries[i].sent ? 2 : 0));
+
+        group_tracer& gt = group_tracer::get_instance();
+        if (!Traits::is_unspecified(queries[i].gaddr) && gt.is_traced(queries[i].gaddr)) {
+            gt.instant(GT_KERNEL, "query_sent", queries[i].if_index, queries[i].gaddr, {{"sources", std::to_string(queries[i].slist.size())}, {"s_flag", queries[i].s_flag ? "true" : "false"}, {"result", queries[i].sent ? "ok" : "failed"}});
+        }
+    }
+
+    return rc;
+}
+
+template<typename Traits, typename Derived>
+bool proto_sender<Traits, Derived>::send_report(unsigned int if_index, const std::list<report_record>& records) const
+{
+    HC_LOG_TRACE("");
+    using record_type = typename Traits::record_type;
+    using addr_type = typename Traits::addr_type;
+
+    unsigned int mtu = interfaces::get_mtu(if_index);
+    if (mtu <= Traits::report_ip_overhead + sizeof(typename Traits::report_type) + sizeof(record_type) + sizeof(addr_type)) {
+        HC_LOG_ERROR("the mtu of interface " << interfaces::get_if_name(if_index) << " is too small: " << mtu);
+        return false;
+    }
+
+    //space for the group records of one report
+    const std::size_t max_size = mtu - Traits::report_ip_overhead - sizeof(typename Traits::report_type);
+
+    std::vector<unsigned char> buf;
+    buf.reserve(max_size);
+    unsigned int num_records = 0;
+    bool rc = true;
+
+    for (auto & r : records) {
+        auto src_it = std::begin(r.slist);
+        do {
+            //at least the record header and one source have to fit
+            if (buf.size() + sizeof(record_type) + (src_it != std::end(r.slist) ? sizeof(addr_type) : 0) > max_size) {
+                rc = derived().send_report_packet(if_index, buf, num_records) && rc;
+                buf.clear();
+                num_records = 0;
+            }
+
+            std::size_t nos = std::min<std::size_t>(std::distance(src_it, std::end(r.slist)), (max_size - buf.size() - sizeof(record_type)) / sizeof(addr_type));
+            std::size_t offset = buf.size();
+            buf.resize(offset + sizeof(record_type) + nos * sizeof(addr_type));
+
+            record_type* rec = reinterpret_cast<record_type*>(&buf[offset]);
+            rec->type = r.type;
+            rec->aux_data_len = 0;
+            rec->num_of_srcs = htons(nos);
+            rec->gaddr = Traits::get_addr(r.gaddr);
+
+            unsigned char* src = &buf[offset + sizeof(record_type)];
+            for (std::size_t i = 0; i < nos; ++i, ++src_it) {
+                memcpy(src, &Traits::get_addr(*src_it), sizeof(addr_type));
+                src += sizeof(addr_type);
+            }
+
+            ++num_records;
+
+            //RFC 3376 Section 4.2.16 and RFC 3810 Section 5.2.15: exclude records are truncated, all others are split
+            if (r.type == MODE_IS_EXCLUDE || r.type == CHANGE_TO_EXCLUDE_MODE) {
+                break;
+            }
+        } while (src_it != std::end(r.slist));
+    }
+
+    if (num_records > 0) {
+        rc = derived().send_report_packet(if_index, buf, num_records) && rc;
+    }
+
+    return rc;
+}
+
+#endif // PROTO_SENDER_HPP
+/** @} */
@@ -0,0 +1,129 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef PROTOCOL_TRAITS_HPP
+#define PROTOCOL_TRAITS_HPP
+
+#include "include/utils/addr_storage.hpp"
+#include "include/utils/mc_socket.hpp"
+#include "include/proxy/def.hpp"
+#include "include/proxy/timers_values.hpp"
+#include "include/utils/extended_igmp_defines.hpp"
+#include "include/utils/extended_mld_defines.hpp"
+
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip6.h>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Compile-time description of IGMPv3 (RFC 3376). Code that is
+ * instantiated with these traits needs no runtime checks of the address family.
+ */
+struct igmp_traits {
+    using addr_type = in_addr;
+    using max_resp_code_type = uint8_t;
+    using record_type = igmpv3_mc_record;
+    using report_type = igmpv3_mc_report;
+
+    static constexpr int addr_family = AF_INET;
+    static constexpr group_mem_protocol version = IGMPv3;
+
+    //bytes in front of the report header: IP header with router alert option
+    static constexpr unsigned int report_ip_overhead = sizeof(ip) + sizeof(router_alert_option);
+
+    static const char* get_all_hosts_addr() {
+        return IPV4_ALL_HOST_ADDR;
+    }
+
+    static const char* get_report_addr() {
+        return IPV4_IGMPV3_ADDR;
+    }
+
+    //message type of the receive counters
+    static const char* get_report_name() {
+        return "igmpv3_report";
+    }
+
+    static const addr_type& get_addr(const addr_storage& addr) {
+        return addr.get_in_addr();
+    }
+
+    static bool is_unspecified(const addr_storage& addr) {
+        return addr.get_in_addr().s_addr == INADDR_ANY;
+    }
+
+    static max_resp_code_type encode_max_resp(const timers_values& tv, const std::chrono::milliseconds& msec) {
+        return tv.maxrespi_to_maxrespc_igmpv3(msec);
+    }
+
+    static std::chrono::milliseconds decode_max_resp(const timers_values& tv, max_resp_code_type max_resp_code) {
+        return tv.maxrespc_igmpv3_to_maxrespi(max_resp_code);
+    }
+};
+
+/**
+ * @brief Compile-time description of MLDv2 (RFC 3810).
+ */
+struct mld_traits {
+    using addr_type = in6_addr;
+    using max_resp_code_type = uint16_t;
+    using record_type = mldv2_mc_record;
+    using report_type = mldv2_mc_report;
+
+    static constexpr int addr_family = AF_INET6;
+    static constexpr group_mem_protocol version = MLDv2;
+
+    //bytes in front of the report header: IPv6 header with hop-by-hop router alert option
+    static constexpr unsigned int report_ip_overhead = sizeof(ip6_hdr) + 8;
+
+    static const char* get_all_hosts_addr() {
+        return IPV6_ALL_NODES_ADDR;
+    }
+
+    static const char* get_report_addr() {
+        return IPV6_ALL_MLDv2_CAPABLE_ROUTERS;
+    }
+
+    static const char* get_report_name() {
+        return "mldv2_report";
+    }
+
+    static const addr_type& get_addr(const addr_storage& addr) {
+        return addr.get_in6_addr();
+    }
+
+    static bool is_unspecified(const addr_storage& addr) {
+        return IN6_IS_ADDR_UNSPECIFIED(&addr.get_in6_addr());
+    }
+
+    static max_resp_code_type encode_max_resp(const timers_values& tv, const std::chrono::milliseconds& msec) {
+        return tv.maxrespi_to_maxrespc_mldv2(msec);
+    }
+
+    static std::chrono::milliseconds decode_max_resp(const timers_values& tv, max_resp_code_type max_resp_code) {
+        return tv.maxrespc_mldv2_to_maxrespi(max_resp_code);
+    }
+};
+
+#endif // PROTOCOL_TRAITS_HPP
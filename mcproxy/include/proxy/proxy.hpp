@@ -36,9 +36,14 @@
 #include <memory>
 #include <map>
 
+#define PROXY_FLIGHT_RECORDER_DEFAULT_PATH "/var/run/mcproxy" //not /tmp, the dump runs as root
+
 class configuration;
 class timing;
 class proxy_instance;
+class if_monitor;
+class metrics_server;
+class state_server;
 
 /**
   * @brief start and maintain all proxy instances.
@@ -52,20 +57,49 @@ private:
     bool m_reset_rp_filter;
     std::string m_config_path;
 
+    //file of the asynchronous logging, empty for stderr
+    std::string m_log_path;
+
+    //unix socket of the metrics server, empty if disabled
+    std::string m_metrics_path;
+
+    //unix socket of the state server, empty if disabled
+    std::string m_state_path;
+
+    //the flight recorder is written to this file on SIGUSR1 or a fatal signal
+    std::string m_flight_recorder_path;
+    unsigned int m_filter_cache_size;
+    unsigned int m_stats_interval;
+
     std::unique_ptr<configuration> m_configuration;
     std::shared_ptr<timing> m_timing;
 
     //table (= interface index), proxy_instance
     std::map<int, std::unique_ptr<proxy_instance>> m_proxy_instances;
 
+    //forwards link and address changes to all proxy instances
+    std::unique_ptr<if_monitor> m_if_monitor;
+
+    //serves the metrics in Prometheus text format, nullptr if disabled
+    std::unique_ptr<metrics_server> m_metrics_server;
+
+    //serves the membership and routing tables of all proxy instances, nullptr if disabled
+    std::unique_ptr<state_server> m_state_server;
+
     void prozess_commandline_args(int arg_count, char* args[]);
     void help_output();
 
     void start_proxy_instances();
+    void start_if_monitor();
+    void start_metrics_server();
+    void start_state_server();
 
 
     static void signal_handler(int sig);
 
+    //cycles the log level through error, warn, info and debug (SIGUSR2)
+    static void log_lvl_handler(int sig);
+
     void start();
 
     unsigned int get_default_priority_interval();
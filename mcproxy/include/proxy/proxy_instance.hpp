@@ -34,6 +34,10 @@
 #include "include/proxy/def.hpp"
 #include "include/proxy/querier.hpp"
 #include "include/parser/interface.hpp"
+#include "include/proxy/filter_decision_cache.hpp"
+#include "include/proxy/stats_collector.hpp"
+#include "include/proxy/state_snapshot.hpp"
+#include "include/utils/metrics.hpp"
 
 #include <memory>
 #include <set>
@@ -43,11 +47,14 @@ class timing;
 class receiver;
 class sender;
 class routing;
+class kernel_io;
+class membership_reporter;
 class mroute_socket;
 class interface;
 class simple_mc_proxy_routing;
 class routing_management;
 class interface_memberships;
+class simulation;
 
 /**
  * @brief Represent a multicast proxy (RFC 4605)
@@ -86,8 +93,16 @@ private:
     //defines the mulitcast routing talbe, if set to 0 (default routing table) no other instances running on the system to simplifie the kernel calls.
     const std::string m_instance_name;
     const int m_table_number;
+    const mroute_backend m_mroute_backend;
+    const upstream_report_mode m_upstream_report_mode;
     const bool m_in_debug_testing_mode;
 
+    //maximum number of memorised filter decisions, 0 disables the cache
+    const unsigned int m_filter_cache_size;
+
+    //time between two samples of the traffic counters, 0 disables the stats collector
+    const std::chrono::milliseconds m_stats_interval;
+
     const std::shared_ptr<const interfaces> m_interfaces;
     const std::shared_ptr<timing> m_timing;
 
@@ -96,8 +111,23 @@ private:
 
     std::unique_ptr<receiver> m_receiver;
     std::unique_ptr<routing> m_routing;
+
+    //executes routes, reports and queries on its own thread, released after each message
+    std::shared_ptr<kernel_io> m_kernel_io;
+
+    //reports the upstream memberships if the proxy is the host (user_reports), otherwise nullptr
+    std::unique_ptr<membership_reporter> m_reporter;
+
+    //samples the interface and route counters of all tables on its own thread, nullptr if disabled
+    std::unique_ptr<stats_collector> m_stats_collector;
     std::unique_ptr<routing_management> m_routing_management;
 
+    //copy-on-write snapshots of the membership and routing tables, built on request
+    state_publisher m_state_publisher;
+
+    //processing time of the group records per stage, registered before the receiver starts
+    metric_histogram* m_latency[LS_COUNT];
+
     //to match the proxy debug output with the wireshark time stamp
     const std::chrono::time_point<std::chrono::steady_clock> m_proxy_start_time;
 
@@ -105,8 +135,14 @@ private:
 
     //if_indexes of the downstreams, querier
     //std::map<unsigned int, std::unique_ptr<querier>> m_querier;
+    //downstreams whose querier knows a group, filled by the queriers, destroyed after them
+    group_interface_index m_group_index;
+
     std::map<unsigned int, downstream_infos> m_downstreams;
 
+    //if_indexes of the up- and downstreams whose link is down, their vifs are removed
+    std::set<unsigned int> m_down_ifs;
+
     std::shared_ptr<rule_binding> m_upstream_input_rule;
     std::shared_ptr<rule_binding> m_upstream_output_rule;
 
@@ -115,14 +151,28 @@ private:
     bool init_sender();
     bool init_receiver();
     bool init_routing();
+    bool init_kernel_io();
+    bool init_reporter();
+    bool init_stats_collector();
     bool init_routing_management();
+    bool init_worker_thread();
+
+    //the membership reporter draws its random delays from this seed
+    unsigned int get_random_seed() const;
 
     //receives and process all events
     void worker_thread();
+    void handle_msg(const std::shared_ptr<proxy_msg>& msg);
+
+    //build and publish a state snapshot, shares the unchanged groups with the previous one
+    void publish_state_snapshot();
 
     //add and del interfaces
     void handle_config(const std::shared_ptr<config_msg>& msg);
 
+    //link and address changes of the interfaces
+    void handle_if_state(const std::shared_ptr<if_state_msg>& msg);
+
     bool is_upstream(unsigned int if_index) const;
     bool is_downstream(unsigned int if_index) const;
 
@@ -133,17 +183,37 @@ public:
     /**
      * @param group_mem_protocol Defines the highest group membership protocol version for IPv4 or Ipv6 to use.
      * @param table_number Set the multicast routing table. If set to 0 (default routing table) no other instances running on the system (this simplifie the kernel calls).
+     * @param mrb Write multicast routes with setsockopt or batched over rtnetlink.
+     * @param urm Report the upstream memberships by kernel socket joins or by the proxy itself.
      * @param interfaces Holds all possible needed information of all upstream and downstream interfaces.
      * @param shared_timing Stores and triggers all time-dependent events for this proxy instance.
+     * @param filter_cache_size Maximum number of memorised interface filter decisions, 0 disables the cache.
+     * @param stats_interval Time in milliseconds between two samples of the traffic counters, 0 disables the stats collector.
      * @param in_debug_testing_mode If true this proxy instance stops receiving group membership messages and prints a lot of status messages to the command line.
      */
-    proxy_instance(group_mem_protocol group_mem_protocol, const std::string& intance_name, int table_number, const std::shared_ptr<const interfaces>& interfaces, const std::shared_ptr<timing>& shared_timing, bool in_debug_testing_mode = false);
+    proxy_instance(group_mem_protocol group_mem_protocol, const std::string& intance_name, int table_number, mroute_backend mrb, upstream_report_mode urm, const std::shared_ptr<const interfaces>& interfaces, const std::shared_ptr<timing>& shared_timing, unsigned int filter_cache_size = FILTER_DECISION_CACHE_DEFAULT_SIZE, unsigned int stats_interval = STATS_COLLECTOR_DEFAULT_INTERVAL, bool in_debug_testing_mode = false);
 
     /**
      * @brief Release all resources.
      */
     virtual ~proxy_instance();
 
+    /**
+     * @brief The latest traffic statistics, nullptr if the stats collector is disabled. Can be called from any thread.
+     */
+    std::shared_ptr<const stats_snapshot> get_stats_snapshot() const;
+
+    /**
+     * @brief Request a snapshot of the membership and routing tables and wait for the worker to publish it. Can be called from any thread.
+     * @return Return the previous snapshot if the worker does not answer within the timeout, nullptr if there is none.
+     */
+    std::shared_ptr<const state_snapshot> get_state_snapshot(std::chrono::milliseconds timeout = std::chrono::milliseconds(STATE_SNAPSHOT_TIMEOUT));
+
+    /**
+     * @brief Record the duration of a processing stage of a group record. Can be called from any thread.
+     */
+    void record_latency(latency_stage ls, std::chrono::nanoseconds duration) const;
+
     static void test_querier(std::string if_name);
 
     static void test_a(std::function < void(mcast_addr_record_type, source_list<source>&&, group_mem_protocol) > send_record, std::function<void()> print_proxy_instance);
@@ -158,6 +228,7 @@ public:
     friend routing_management;
     friend simple_mc_proxy_routing;
     friend interface_memberships;
+    friend simulation;
 };
 
 #endif // PROXY_INSTANCE_HPP
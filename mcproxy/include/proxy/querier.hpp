@@ -25,14 +25,20 @@
 
 #include "include/proxy/membership_db.hpp"
 #include "include/proxy/timers_values.hpp"
+#include "include/proxy/group_tracer.hpp"
+#include "include/utils/metrics.hpp"
 
 #include <functional>
 #include <string>
 #include <memory>
 #include <functional>
+#include <map>
+#include <set>
+#include <unordered_map>
 
 class timing;
 class sender;
+class kernel_io;
 class worker;
 
 /**
@@ -41,6 +47,14 @@ class worker;
  */
 using callback_querier_state_change = std::function<void(unsigned int, const addr_storage&)>;
 
+/**
+ * @brief Downstream interfaces whose membership database contains a group
+ * (group address ==> interface indexes). The route calculation asks only
+ * their queriers instead of the queriers of all downstreams. It is a hash
+ * map, a lookup costs no address comparisons even with 100000 groups.
+ */
+using group_interface_index = std::unordered_map<addr_storage, std::set<unsigned int>>;
+
 /**
  * @brief Defines the behaviour of a multicast querier for a specific interface.
  */
@@ -52,10 +66,19 @@ private:
     membership_db m_db;
     timers_values m_timers_values;
     callback_querier_state_change m_cb_state_change;
+    group_interface_index* const m_group_index;
 
     const std::shared_ptr<const sender> m_sender;
+    const std::shared_ptr<kernel_io> m_kernel_io;
     const std::shared_ptr<timing> m_timing;
 
+    //the link is down, no general queries are sent
+    bool m_suspended;
+
+    //size of the membership database, updated after each change
+    metric_gauge& m_groups_gauge;
+    metric_gauge& m_sources_gauge;
+
     //join all router groups or leave them
     bool router_groups_function(bool subscribe) const;
     bool send_general_query();
@@ -93,6 +116,21 @@ private:
     //call the callback function querier_state_change
     void state_change_notification(const addr_storage& gaddr);
 
+    //count the sources of the group again, the group may have been deleted
+    void update_metrics(const addr_storage& gaddr);
+
+    //delete a group and its sources from the membership database
+    void erase_group(gaddr_map::iterator db_info_it);
+
+    //add or remove the interface of this querier at a group of the group interface index
+    void index_group(const addr_storage& gaddr, bool add);
+
+    //filter mode of a traced group, "none" if the group is not in the membership database
+    std::string get_trace_filter_mode(const addr_storage& gaddr) const;
+
+    //add a processed record or timer of a traced group and a change of its filter mode to the timeline
+    void trace_transition(const std::string& name, const addr_storage& gaddr, const timing_clock::time_point& start, const std::string& old_filter_mode, gt_args&& args = gt_args()) const;
+
 public:
     virtual ~querier();
 
@@ -100,12 +138,15 @@ public:
      * @param msg_worker Saves the message worker which receives all querier specific timer events and forward them back to this querier.
      * @param querier_version_mode Defines the highest group membership protocol version for IPv4 or Ipv6 to use.
      * @param if_index Interface index of the querier.
-     * @param sender For sending queriers and subscribing router specific groups.
+     * @param sender For subscribing router specific groups and sending source specific queries.
+     * @param kio For sending general and group specific queries asynchronously.
      * @param shared_timing Stores and triggers all time-dependent events for this querier.
      * @param tv contain all nessesary timers and values.
      * @param cb_state_change Callback function to publish querier state change informations.
+     * @param instance_name Name of the proxy instance, labels the metrics of the querier.
+     * @param group_index The querier adds its interface to the groups of its membership database, can be nullptr.
      */
-    querier(worker* msg_worker, group_mem_protocol querier_version_mode, int if_index, const std::shared_ptr<const sender>& sender, const std::shared_ptr<timing>& timing, const timers_values& tv, callback_querier_state_change cb_state_change);
+    querier(worker* msg_worker, group_mem_protocol querier_version_mode, int if_index, const std::shared_ptr<const sender>& sender, const std::shared_ptr<kernel_io>& kio, const std::shared_ptr<timing>& timing, const timers_values& tv, callback_querier_state_change cb_state_change, const std::string& instance_name, group_interface_index* group_index);
 
     /**
      * @brief All received group records of the interface maintained by this querier musst be submitted to this function. 
@@ -140,6 +181,23 @@ public:
      */
     void receive_query();
 
+    /**
+     * @brief Stop sending general queries, e.g. while the link is down.
+     */
+    void suspend();
+
+    /**
+     * @brief Send a general query immediately and restart the startup query sequence.
+     */
+    void resume();
+
+    bool is_suspended() const;
+
+    /**
+     * @return return the membership database of the interface
+     */
+    const membership_db& get_membership_db() const;
+
     /**
      * @return return the timers and counter values for a modification
      */
@@ -36,12 +36,15 @@
 #include "include/proxy/interfaces.hpp"
 #include "include/proxy/message_format.hpp"
 #include "include/proxy/def.hpp"
+#include "include/utils/metrics.hpp"
 
 #include <set>
 #include <thread>
 #include <mutex>
 #include <memory>
+#include <map>
 #include <sstream>
+#include <chrono>
 
 class proxy_instance;
 
@@ -67,8 +70,8 @@ private:
 
     std::mutex m_data_lock;
 
-    void stop();
-    void join();
+    //(interface index, message type literal) ==> counter, only used by the receiver thread
+    std::map<std::pair<unsigned int, const char*>, metric_counter*> m_message_counters;
 
 protected:
     const proxy_instance * const m_proxy_instance;
@@ -79,10 +82,28 @@ protected:
 
     const std::shared_ptr<const interfaces> m_interfaces;
 
+    //kernel time stamp of the message in analyse_packet(), the epoch if the kernel did not attach one
+    std::chrono::system_clock::time_point m_receive_time;
+
     void start();
 
+    //the derived receivers stop the thread in their destructors, it calls their functions
+    void stop();
+    void join();
+
     bool is_if_index_relevant(unsigned int if_index) const;
 
+    /**
+     * @brief Count a received message of a relevant interface.
+     * @param type message type as string literal, e.g. "igmpv3_report"
+     */
+    void count_message(unsigned int if_index, const char* type);
+
+    /**
+     * @brief Pass a group record to the proxy instance and measure the time since the report was received.
+     */
+    void add_record(const std::shared_ptr<group_record_msg>& msg) const;
+
     /**
      * @brief Get the size for the control buffer for recvmsg().
      */
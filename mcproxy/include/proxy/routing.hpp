@@ -31,6 +31,9 @@
 
 //#include "include/utils/mroute_socket.hpp"
 #include "include/utils/if_prop.hpp"
+#include "include/utils/mroute_netlink.hpp"
+#include "include/utils/metrics.hpp"
+#include "include/proxy/def.hpp"
 
 #include <set>
 #include <list>
@@ -51,12 +54,32 @@ private:
 
     const std::shared_ptr<const interfaces> m_interfaces;
     const std::shared_ptr<const mroute_socket> m_mrt_sock;
-    if_prop m_if_prop; //return interface properties
+    mutable if_prop m_if_prop; //return interface properties, refreshed for each added vif
 
     mutable std::set<unsigned int> m_added_ifs; 
 
+    //batches multicast routes if the netlink backend is selected, otherwise nullptr
+    mutable std::unique_ptr<mroute_netlink> m_netlink;
+
+    enum routing_op {
+        RO_ADD_VIF, RO_DEL_VIF, RO_ADD_ROUTE, RO_DEL_ROUTE, RO_FLUSH, RO_COUNT
+    };
+
+    //all and failed kernel operations, failures are counted in both
+    metric_counter* m_ops[RO_COUNT];
+    metric_counter* m_op_failures[RO_COUNT];
+
+    //duration of the kernel calls that add routes, nullptr if not measured
+    metric_histogram* m_add_route_latency;
+
+    //count the operation, return rc
+    bool count_op(routing_op op, bool rc) const;
+
+    bool add_kernel_route(int input_vif, const addr_storage& g_addr, const addr_storage& src_addr, const std::list<int>& output_vif) const;
+    bool del_kernel_route(int vif, const addr_storage& g_addr, const addr_storage& src_addr) const;
+
 public:
-    routing(int addr_family, std::shared_ptr<const mroute_socket> mrt_sock, std::shared_ptr<const interfaces> interfaces, int table_number);
+    routing(int addr_family, std::shared_ptr<const mroute_socket> mrt_sock, std::shared_ptr<const interfaces> interfaces, int table_number, mroute_backend mrb = MRB_SETSOCKOPT);
 
     virtual ~routing();
     /**
@@ -82,6 +105,21 @@ public:
       * @return Return true on success.
       */
     bool del_route(int vif, const addr_storage& g_addr, const addr_storage& src_addr) const;
+
+    /**
+      * @brief Send all batched multicast routes to the linux kernel.
+      *        Routes refused by the kernel are retried with the mroute socket.
+      * @return Return true on success.
+      */
+    bool flush() const;
+
+    mroute_backend get_mroute_backend() const;
+
+    /**
+      * @brief Measure the duration of the kernel calls that add multicast routes,
+      *        with the netlink backend the flush of a batch is measured. Call it before the routes are used.
+      */
+    void set_metrics(metric_histogram* add_route_latency);
 };
 
 #endif // ROUTING_HPP
@@ -33,6 +33,7 @@ struct proxy_msg;
 struct source;
 class proxy_instance;
 class addr_storage;
+class simple_routing_data;
 
 /**
  * @brief abstract interface of a summary of routing events 
@@ -49,6 +50,12 @@ public:
     virtual void event_querier_state_change(unsigned int if_index, const addr_storage& gaddr) = 0;
     virtual void timer_triggerd_maintain_routing_table(const std::shared_ptr<proxy_msg>& msg) = 0;
 
+    //interfaces, their link or address state or rule bindings of the proxy instance have changed
+    virtual void event_config_changed() {}
+
+    //known sources of the routing strategy, nullptr if it keeps none
+    virtual const simple_routing_data* get_routing_data() const {return nullptr;}
+
     virtual std::string to_string() const {return std::string();}
 
     friend std::ostream& operator<<(std::ostream& stream, const routing_management& rm) {
@@ -30,14 +30,38 @@
 #define SENDER_HPP
 
 #include "include/utils/mroute_socket.hpp"
+#include "include/utils/mc_socket_pool.hpp"
+#include "include/utils/addr_storage.hpp"
 #include "include/proxy/def.hpp"
 #include "include/proxy/interfaces.hpp"
 
 #include "memory"
+#include <list>
+#include <vector>
 
 class timers_values;
 struct source;
-class addr_storage;
+
+/**
+ * @brief One group record of an IGMPv3/MLDv2 membership report.
+ */
+struct report_record {
+    mcast_addr_record_type type;
+    addr_storage gaddr;
+    std::list<addr_storage> slist;
+};
+/**
+ * @brief One query of a batch of sender::send_queries().
+ */
+struct query_request {
+    unsigned int if_index;
+    const timers_values* tv;
+    addr_storage gaddr; //unspecified for a general query
+    bool s_flag;
+    std::list<addr_storage> slist;
+    bool sent;
+};
+
 /**
  * @brief Abstract basic sender class.
  */
@@ -49,10 +73,15 @@ protected:
 
     mroute_socket m_sock;
 
+    //upstream memberships of the kernel reports, only changed by the kernel io thread
+    mutable mc_socket_pool m_membership_sockets;
+
 public:
 
     sender(const std::shared_ptr<const interfaces>& interfaces, group_mem_protocol gmp);
 
+    group_mem_protocol get_group_mem_protocol() const;
+
     virtual bool send_record(unsigned int if_index, mc_filter filter_mode, const addr_storage& gaddr, const source_list<source>& slist) const;
 
     virtual bool send_general_query(unsigned int if_index, const timers_values& tv) const;
@@ -61,6 +90,37 @@ public:
 
     virtual bool send_mc_addr_and_src_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, source_list<source>& slist) const;
 
+    /**
+     * @brief Send the queries of several interfaces with one system call where possible.
+     * @return Return true if all queries were sent, the sent flag of each query tells which ones.
+     */
+    virtual bool send_queries(std::vector<query_request>& queries) const;
+
+    /**
+     * @brief Decrement the retransmission counters of slist and split the sources that are still
+     *        retransmitted by their source timer (RFC 3376 Section 6.6.3.2, RFC 3810 Section 7.6.3.2).
+     * @param slist_higher sources with a timer greater than the last listener query time, queried with the S flag
+     * @param slist_lower sources queried without the S flag
+     * @return Return true if a source has to be retransmitted again.
+     */
+    static bool split_source_retransmissions(const timers_values& tv, source_list<source>& slist, std::list<addr_storage>& slist_higher, std::list<addr_storage>& slist_lower);
+
+    /**
+     * @brief Send the records in as few membership reports as the MTU of the interface allows.
+     */
+    virtual bool send_report(unsigned int if_index, const std::list<report_record>& records) const;
+
+    /**
+     * @brief Forget the encoded queries of an interface, e.g. after its address changed.
+     */
+    virtual void clear_query_templates(unsigned int if_index) const;
+
+    /**
+     * @brief Occupancy of the membership sockets.
+     */
+    std::string to_string() const;
+    friend std::ostream& operator<<(std::ostream& stream, const sender& s);
+
     virtual ~sender();
 };
 
@@ -25,6 +25,7 @@
 
 #include "include/proxy/routing_management.hpp"
 #include "include/proxy/simple_routing_data.hpp"
+#include "include/proxy/filter_decision_cache.hpp"
 #include "include/parser/interface.hpp"
 
 #include <list>
@@ -53,6 +54,9 @@ private:
 
     void merge_membership_infos(source_state& merge_to, const source_state& merge_from) const;
 
+    //memberships of the downstreams that know the group, the others would only add INCLUDE{}
+    state_list get_downstream_states(const addr_storage& gaddr, const proxy_instance* pi) const;
+
     void process_upstream_in_first(const addr_storage& gaddr, const proxy_instance* pi);
     void process_upstream_in_mutex(const addr_storage& gaddr, const proxy_instance* pi, const simple_routing_data& routing_data);
 
@@ -73,6 +77,7 @@ class simple_mc_proxy_routing : public routing_management
 {
 private:
     simple_routing_data m_data;
+    mutable filter_decision_cache m_filter_cache;
 
     std::chrono::seconds get_source_life_time();
 
@@ -89,6 +94,7 @@ private:
     std::shared_ptr<new_source_timer_msg> set_source_timer(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr);
 
     bool check_interface(rb_interface_type interface_type, rb_interface_direction interface_direction, unsigned int checking_if_index, unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr) const;
+    bool check_interface_uncached(rb_interface_type interface_type, rb_interface_direction interface_direction, unsigned int checking_if_index, unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr) const;
 
     void process_membership_aggregation(rb_rule_matching_type rule_matching_type, const addr_storage& gaddr);
 
@@ -101,6 +107,10 @@ public:
 
     void timer_triggerd_maintain_routing_table(const std::shared_ptr<proxy_msg>& msg) override;
 
+    void event_config_changed() override;
+
+    const simple_routing_data* get_routing_data() const override;
+
     std::string to_string() const override;
 };
 
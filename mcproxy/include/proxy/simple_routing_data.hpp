@@ -24,15 +24,21 @@
 #define SIMPLE_ROUTING_DATA_HPP
 
 #include "include/proxy/def.hpp"
+#include "include/utils/mroute_stats.hpp"
 #include <map>
+#include <unordered_map>
 #include <memory>
 #include <string>
 #include <set>
+#include <vector>
 
 class addr_storage;
 struct source;
 struct timer_msg;
-class mroute_socket;
+class stats_collector;
+
+//all source timers that fire within this time share one dump of the kernel counters
+#define SIMPLE_ROUTING_DATA_STATS_MAX_AGE 1000 //msec
 
 struct sr_data_value {
     sr_data_value(const source_list<source>& slist, std::map<addr_storage, unsigned int> if_map)
@@ -45,9 +51,13 @@ struct sr_data_value {
     std::map<addr_storage, unsigned int> m_if_map;
 };
 
-using s_routing_data = std::map<addr_storage, sr_data_value>;
+//unordered, the groups are looked up for each cache miss and source timer
+using s_routing_data = std::unordered_map<addr_storage, sr_data_value>;
 using s_routing_data_pair = std::pair<addr_storage,sr_data_value>;
 
+//the groups sorted by their address, e.g. for an output
+std::vector<s_routing_data::const_iterator> get_sorted_groups(const s_routing_data& data);
+
 /**
  * @brief a small database for saving and maintaining multicast sources 
  */
@@ -56,11 +66,19 @@ class simple_routing_data
 private:
     s_routing_data m_data;
     group_mem_protocol m_group_mem_protocol;
-    const std::shared_ptr<const mroute_socket> m_mrt_sock;
-    unsigned long get_current_packet_count(const addr_storage& gaddr, const addr_storage& saddr);
+    mroute_stats m_stats;
+
+    //periodic samples of the kernel counters, nullptr if the stats collector is disabled
+    const stats_collector* const m_collector;
+
+    //return false if the kernel counters are not available
+    bool get_current_packet_count(const addr_storage& gaddr, const addr_storage& saddr, unsigned long& packet_count);
 
 public:
-    simple_routing_data(group_mem_protocol group_mem_protocol, const std::shared_ptr<const mroute_socket>& mrt_sock);
+    /**
+     * @param collector if not nullptr, its samples are used instead of an own dump of the kernel counters as long as they are fresh enough
+     */
+    simple_routing_data(group_mem_protocol group_mem_protocol, int table_number, const stats_collector* collector = nullptr);
 
     void set_source(unsigned int if_index, const addr_storage& gaddr, const source& saddr);
 
@@ -74,6 +92,9 @@ public:
 
     const std::map<addr_storage, unsigned int>& get_interface_map(const addr_storage& gaddr) const;
 
+    //all groups with their sources, unordered
+    const s_routing_data& get_data() const;
+
     std::string to_string() const;
     friend std::ostream& operator<<(std::ostream& stream, const simple_routing_data& srd); 
 
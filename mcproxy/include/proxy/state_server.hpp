@@ -0,0 +1,92 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/**
+ * @addtogroup mod_proxy Proxy
+ * @{
+ */
+
+#ifndef STATE_SERVER_HPP
+#define STATE_SERVER_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <functional>
+
+#define STATE_SERVER_BACKLOG 8
+#define STATE_SERVER_RECV_TIMEOUT 200 //msec to wait for a request
+#define STATE_SERVER_SEND_TIMEOUT 1000 //msec a client may stall the answer
+#define STATE_SERVER_RECV_BUF_SIZE 1024
+
+struct state_snapshot;
+
+/**
+ * @brief Serves the state snapshots of all proxy instances on a local Unix
+ * stream socket. A client sending "json" (or an HTTP GET request for a path
+ * ending with .json) gets a JSON document, any other client the text form.
+ * HTTP requests (e.g. curl --unix-socket) are answered with an HTTP response.
+ * The connection is closed after each answer, a client that does not read it
+ * within STATE_SERVER_SEND_TIMEOUT is dropped. The snapshots are serialised
+ * on the thread of the server, the workers of the proxy instances only copy
+ * the chunks of the changed groups.
+ *
+ * The group tracer is controlled with the commands "trace <group>[/<prefix
+ * length>] ..." (start tracing, discards the recorded events), "trace off"
+ * and "trace" (status). "trace.json" exports the recorded timeline in the
+ * Chrome trace event format. Over HTTP the arguments are passed as query,
+ * e.g. GET /trace?239.1.1.1+239.2.0.0/16.
+ */
+class state_server
+{
+private:
+    std::string m_path;
+    int m_sock;
+    int m_stop_pipe[2];
+
+    //requests a fresh snapshot of each proxy instance
+    const std::function<std::vector<std::shared_ptr<const state_snapshot>>()> m_get_snapshots;
+
+    std::unique_ptr<std::thread> m_thread;
+
+    void worker_thread();
+    void serve(int client) const;
+
+    //start or stop the group tracer, returns the status or an error message
+    std::string trace_command(const std::string& args) const;
+
+    state_server(const state_server&) = delete;
+    state_server& operator=(const state_server&) = delete;
+
+public:
+    /**
+     * @param path of the Unix socket, an existing socket file is replaced
+     * @param get_snapshots called on the thread of the server for each request
+     */
+    state_server(const std::string& path, std::function<std::vector<std::shared_ptr<const state_snapshot>>()> get_snapshots);
+
+    virtual ~state_server();
+};
+
+#endif // STATE_SERVER_HPP
+/** @} */
@@ -0,0 +1,380 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/**
+ * @addtogroup mod_proxy_instance Proxy Instance
+ * @{
+ */
+
+#ifndef STATE_SNAPSHOT_HPP
+#define STATE_SNAPSHOT_HPP
+
+#include "include/utils/addr_storage.hpp"
+#include "include/proxy/def.hpp"
+#include "include/proxy/timing_clock.hpp"
+#include "include/proxy/membership_db.hpp"
+#include "include/proxy/simple_routing_data.hpp"
+
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <condition_variable>
+
+#define STATE_SNAPSHOT_TIMEOUT 1000 //msec to wait for the worker of a proxy instance
+#define STATE_SNAPSHOT_CHUNK_SIZE 256 //groups per chunk of a snapshot map, a chunk is split at twice this size
+
+/**
+ * @brief A source of a membership or a route. A timer is the epoch of the
+ *        clock (time_point()) if it is not running.
+ */
+struct source_snapshot {
+    addr_storage saddr;
+    timing_clock::time_point timer;
+    long retransmission_count; //-1 if not in a retransmission state
+};
+
+/**
+ * @brief Membership state of one group on one downstream interface.
+ */
+struct group_snapshot {
+    group_mem_protocol compatibility_mode;
+    timing_clock::time_point older_host_present_timer;
+
+    mc_filter filter_mode;
+    timing_clock::time_point filter_timer;
+
+    timing_clock::time_point group_retransmission_timer;
+    int group_retransmission_count;
+    timing_clock::time_point source_retransmission_timer;
+
+    std::vector<source_snapshot> include_requested_list;
+    std::vector<source_snapshot> exclude_list;
+};
+
+/**
+ * @brief Known sources of one group and their input interfaces.
+ */
+struct route_snapshot {
+    //the timer of a source is the source life time
+    std::vector<std::pair<source_snapshot, unsigned int>> sources;
+};
+
+/**
+ * @brief Sorted map (group address ==> entry) of a snapshot, split into
+ * chunks of consecutive groups. The chunks and the entries are shared with
+ * older and newer snapshots as long as they do not change, a change copies
+ * only the chunks of the changed groups and the list of the chunks.
+ */
+template <typename T>
+class chunked_snapshot_map
+{
+public:
+    using value_type = std::pair<const addr_storage, std::shared_ptr<const T>>;
+
+    //group address ==> new entry, nullptr to remove the group
+    using change_list = std::vector<std::pair<addr_storage, std::shared_ptr<const T>>>;
+
+private:
+    using chunk = std::map<addr_storage, std::shared_ptr<const T>>;
+
+    //ordered by their groups, never empty
+    std::vector<std::shared_ptr<const chunk>> m_chunks;
+    std::size_t m_size = 0;
+
+    //the chunk that holds or would hold this group
+    std::size_t find_chunk(const addr_storage& gaddr) const {
+        auto it = std::upper_bound(std::begin(m_chunks), std::end(m_chunks), gaddr, [](const addr_storage & a, const std::shared_ptr<const chunk>& c) {
+            return a < c->begin()->first;
+        });
+        return it == std::begin(m_chunks) ? 0 : (it - std::begin(m_chunks)) - 1;
+    }
+
+public:
+    class const_iterator
+    {
+    private:
+        friend class chunked_snapshot_map;
+        const std::vector<std::shared_ptr<const chunk>>* m_chunks;
+        std::size_t m_chunk;
+        typename chunk::const_iterator m_it;
+
+        const_iterator(const std::vector<std::shared_ptr<const chunk>>* chunks, std::size_t c, typename chunk::const_iterator it)
+            : m_chunks(chunks), m_chunk(c), m_it(it) {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = chunked_snapshot_map::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        reference operator*() const {
+            return *m_it;
+        }
+
+        pointer operator->() const {
+            return &*m_it;
+        }
+
+        const_iterator& operator++() {
+            if (++m_it == (*m_chunks)[m_chunk]->end() && ++m_chunk < m_chunks->size()) {
+                m_it = (*m_chunks)[m_chunk]->begin();
+            }
+            return *this;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return m_chunk == other.m_chunk && (m_chunk == m_chunks->size() || m_it == other.m_it);
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    const_iterator begin() const {
+        return m_chunks.empty() ? end() : const_iterator(&m_chunks, 0, m_chunks.front()->begin());
+    }
+
+    const_iterator end() const {
+        return const_iterator(&m_chunks, m_chunks.size(), typename chunk::const_iterator());
+    }
+
+    const_iterator find(const addr_storage& gaddr) const {
+        if (!m_chunks.empty()) {
+            std::size_t c = find_chunk(gaddr);
+            auto it = m_chunks[c]->find(gaddr);
+            if (it != m_chunks[c]->end()) {
+                return const_iterator(&m_chunks, c, it);
+            }
+        }
+        return end();
+    }
+
+    const std::shared_ptr<const T>& at(const addr_storage& gaddr) const {
+        auto it = find(gaddr);
+        if (it == end()) {
+            throw std::out_of_range("chunked_snapshot_map::at");
+        }
+        return it->second;
+    }
+
+    std::size_t count(const addr_storage& gaddr) const {
+        return find(gaddr) != end() ? 1 : 0;
+    }
+
+    std::size_t size() const {
+        return m_size;
+    }
+
+    std::size_t get_chunk_count() const {
+        return m_chunks.size();
+    }
+
+    /**
+     * @brief Append a group greater than all groups of the map, used to build a new map.
+     */
+    void push_back(const addr_storage& gaddr, const std::shared_ptr<const T>& entry) {
+        std::shared_ptr<chunk> c;
+        if (m_chunks.empty() || m_chunks.back()->size() >= STATE_SNAPSHOT_CHUNK_SIZE) {
+            c = std::make_shared<chunk>();
+            m_chunks.push_back(c);
+        } else if (m_chunks.back().use_count() > 1) {
+            //shared with another map
+            c = std::make_shared<chunk>(*m_chunks.back());
+            m_chunks.back() = c;
+        } else {
+            c = std::const_pointer_cast<chunk>(m_chunks.back());
+        }
+        c->insert(c->end(), std::make_pair(gaddr, entry));
+        ++m_size;
+    }
+
+    /**
+     * @brief Apply the changes, sorted by their groups. Each affected chunk is copied once.
+     */
+    void apply(const change_list& changes) {
+        auto it = std::begin(changes);
+        while (it != std::end(changes)) {
+            std::size_t c = find_chunk(it->first);
+            auto result = m_chunks.empty() ? std::make_shared<chunk>() : std::make_shared<chunk>(*m_chunks[c]);
+
+            //all changes that belong to this chunk
+            for (; it != std::end(changes) && (c + 1 >= m_chunks.size() || it->first < m_chunks[c + 1]->begin()->first); ++it) {
+                m_size -= result->erase(it->first);
+                if (it->second != nullptr) {
+                    result->insert(std::make_pair(it->first, it->second));
+                    ++m_size;
+                }
+            }
+
+            if (m_chunks.empty()) {
+                if (!result->empty()) {
+                    m_chunks.push_back(result);
+                }
+            } else if (result->empty()) {
+                m_chunks.erase(std::begin(m_chunks) + c);
+            } else if (result->size() > 2 * STATE_SNAPSHOT_CHUNK_SIZE) {
+                auto middle = std::next(result->begin(), result->size() / 2);
+                auto second = std::make_shared<chunk>(middle, result->end());
+                result->erase(middle, result->end());
+                m_chunks[c] = result;
+                m_chunks.insert(std::begin(m_chunks) + c + 1, second);
+            } else {
+                m_chunks[c] = result;
+            }
+        }
+    }
+};
+
+using group_snapshot_map = chunked_snapshot_map<group_snapshot>;
+using route_snapshot_map = chunked_snapshot_map<route_snapshot>;
+
+/**
+ * @brief Membership database of one downstream interface.
+ */
+struct querier_snapshot {
+    unsigned int if_index = 0;
+    group_mem_protocol querier_version_mode = IGMPv3;
+    bool is_querier = false;
+    bool is_suspended = false;
+    timing_clock::time_point general_query_timer;
+    int startup_query_count = 0;
+    std::shared_ptr<const group_snapshot_map> groups;
+};
+
+/**
+ * @brief The membership and routing tables of a proxy instance at one point
+ *        in time. A published snapshot is never changed, readers can keep
+ *        and serialise it on any thread. The timers are written as the
+ *        remaining time at the time of the snapshot.
+ */
+struct state_snapshot {
+    unsigned long epoch = 0; //counts the published snapshots of the proxy instance
+    timing_clock::time_point time;
+
+    std::string instance_name;
+    int table_number = 0;
+    group_mem_protocol group_mem_protocol_version = IGMPv3;
+
+    //interface indexes in order of their priority
+    std::vector<unsigned int> upstreams;
+
+    //interface index ==> membership database
+    std::map<unsigned int, querier_snapshot> downstreams;
+
+    std::shared_ptr<const route_snapshot_map> routes;
+
+    std::string to_string() const;
+    std::string to_json() const;
+    friend std::ostream& operator<<(std::ostream& stream, const state_snapshot& s);
+};
+
+/**
+ * @brief Publishes the state snapshots of a proxy instance. The worker
+ * thread marks the groups changed by each message. A new snapshot copies
+ * only these groups, their chunks and the list of the chunks, and shares all
+ * other chunks with the previous snapshot. Building it costs the worker
+ * about STATE_SNAPSHOT_CHUNK_SIZE entries per changed group instead of the
+ * whole map.
+ * Formatting is left to the readers. Snapshots are built on request only,
+ * changes are not tracked before the first one.
+ */
+class state_publisher
+{
+private:
+    //only accessed by the worker thread
+    bool m_tracking;
+    bool m_all_dirty;
+    std::set<addr_storage> m_dirty;
+
+    //only accessed with std::atomic_load() and std::atomic_store()
+    std::shared_ptr<const state_snapshot> m_snapshot;
+
+    unsigned long m_epoch;
+    mutable std::mutex m_epoch_lock;
+    std::condition_variable m_epoch_con_var;
+
+    static std::shared_ptr<const group_snapshot> make_group_snapshot(const gaddr_info& ginfo);
+    static std::shared_ptr<const route_snapshot> make_route_snapshot(const sr_data_value& data);
+
+    state_publisher(const state_publisher&) = delete;
+    state_publisher& operator=(const state_publisher&) = delete;
+
+public:
+    state_publisher();
+
+    /**
+     * @brief The state of this group has changed since the last snapshot. Worker thread only.
+     */
+    void mark_dirty(const addr_storage& gaddr);
+
+    /**
+     * @brief Interfaces were added or removed, rebuild the next snapshot completely. Worker thread only.
+     */
+    void mark_all_dirty();
+
+    /**
+     * @brief Copy the chunks of the changed groups of a membership database. Worker thread only.
+     * @param previous groups of the same interface in the last snapshot, nullptr if unknown
+     */
+    std::shared_ptr<const group_snapshot_map> get_groups(const gaddr_map& groups, const std::shared_ptr<const group_snapshot_map>& previous) const;
+
+    /**
+     * @brief Copy the chunks of the changed groups of the routing data. Worker thread only.
+     * @param previous routes of the last snapshot, nullptr if unknown
+     */
+    std::shared_ptr<const route_snapshot_map> get_routes(const s_routing_data& data, const std::shared_ptr<const route_snapshot_map>& previous) const;
+
+    /**
+     * @brief Assign the next epoch to the snapshot, publish it and wake up the waiting readers. Worker thread only.
+     */
+    void publish(const std::shared_ptr<state_snapshot>& s);
+
+    /**
+     * @brief Epoch of the latest snapshot, 0 before the first one.
+     */
+    unsigned long get_epoch() const;
+
+    /**
+     * @brief The latest snapshot, nullptr before the first one. Lock-free for the reader.
+     */
+    std::shared_ptr<const state_snapshot> get_snapshot() const;
+
+    /**
+     * @brief Wait until a snapshot with at least this epoch is published.
+     * @return Return the latest snapshot, it is older if the timeout expired.
+     */
+    std::shared_ptr<const state_snapshot> wait_for_snapshot(unsigned long epoch, std::chrono::milliseconds timeout);
+
+    static void test_state_publisher();
+};
+
+#endif // STATE_SNAPSHOT_HPP
+/** @} */
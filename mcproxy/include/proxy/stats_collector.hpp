@@ -0,0 +1,160 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/**
+ * @addtogroup mod_proxy_instance Proxy Instance
+ * @{
+ */
+
+#ifndef STATS_COLLECTOR_HPP
+#define STATS_COLLECTOR_HPP
+
+#include "include/utils/addr_storage.hpp"
+#include "include/utils/mroute_stats.hpp"
+
+#include <map>
+#include <list>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#define STATS_COLLECTOR_DEFAULT_INTERVAL 1000 //msec, 0 disables the collector
+#define STATS_COLLECTOR_TOP_ROUTES 10 //routes with the highest byte rate in to_string()
+
+class mroute_socket;
+class interfaces;
+
+/**
+ * @brief A kernel counter and its rate since the previous sample.
+ */
+struct traffic_counter {
+    unsigned long packets = 0;
+    unsigned long bytes = 0;
+    double packet_rate = 0; //packets per second
+    double byte_rate = 0; //bytes per second
+};
+
+/**
+ * @brief Counters of one interface.
+ */
+struct vif_traffic {
+    traffic_counter in;
+    traffic_counter out;
+};
+
+/**
+ * @brief Counters of one (S,G) route.
+ */
+struct route_traffic {
+    unsigned int iif = 0; //interface index of the input interface, 0 if unknown
+    traffic_counter forwarded;
+    unsigned long wrong_if = 0;
+};
+
+/**
+ * @brief All counters of a proxy instance at one point in time. A published
+ *        snapshot is never changed, readers can keep it as long as they want.
+ */
+struct stats_snapshot {
+    std::chrono::steady_clock::time_point time;
+    std::chrono::milliseconds interval; //since the previous snapshot, 0 for the first one
+
+    //interface index ==> counters
+    std::map<unsigned int, vif_traffic> vifs;
+
+    //(group address, source address) ==> counters
+    std::map<std::pair<addr_storage, addr_storage>, route_traffic> routes;
+
+    /**
+     * @brief Routes sorted by their byte rate, the highest first.
+     */
+    std::list<std::pair<std::pair<addr_storage, addr_storage>, route_traffic>> get_top_routes(unsigned int count) const;
+
+    std::string to_string() const;
+    friend std::ostream& operator<<(std::ostream& stream, const stats_snapshot& s);
+};
+
+/**
+ * @brief Samples the virtual interface and multicast route counters of all
+ * kernel table of a proxy instance every interval on its own thread, one
+ * bulk pass per sample (a rtnetlink dump of the routes and one ioctl per
+ * virtual interface). The rates are computed against the previous sample.
+ * The latest snapshot is published with an atomic shared_ptr, readers never
+ * wait for the collector.
+ */
+class stats_collector
+{
+private:
+    const std::shared_ptr<const interfaces> m_interfaces;
+    const std::chrono::milliseconds m_interval;
+    const std::shared_ptr<const mroute_socket> m_mrt_sock;
+    mroute_stats m_mfc;
+
+    //only accessed with std::atomic_load() and std::atomic_store()
+    std::shared_ptr<const stats_snapshot> m_snapshot;
+
+    bool m_running;
+    std::mutex m_running_lock;
+    std::condition_variable m_running_con_var;
+    std::unique_ptr<std::thread> m_thread;
+
+    void worker_thread();
+
+    static void set_rate(traffic_counter& current, const traffic_counter* previous, double seconds);
+
+    stats_collector(const stats_collector&) = delete;
+    stats_collector& operator=(const stats_collector&) = delete;
+
+public:
+    /**
+     * @param mrt_sock mroute socket of the kernel table of the proxy instance
+     * @param interval time between two samples, 0 samples only on request
+     */
+    stats_collector(int addr_family, const std::shared_ptr<const interfaces>& interfaces, int table_number, const std::shared_ptr<const mroute_socket>& mrt_sock, const std::chrono::milliseconds& interval);
+
+    virtual ~stats_collector();
+
+    /**
+     * @brief Take a sample now and publish it.
+     * @return Return false if a counter could not be read, the snapshot is published anyway.
+     */
+    bool sample();
+
+    /**
+     * @brief The latest snapshot, nullptr before the first sample. Lock-free for the reader.
+     */
+    std::shared_ptr<const stats_snapshot> get_snapshot() const;
+
+    std::chrono::milliseconds get_interval() const;
+
+    std::string to_string() const;
+    friend std::ostream& operator<<(std::ostream& stream, const stats_collector& s);
+
+    static void test_stats_collector();
+};
+
+#endif // STATS_COLLECTOR_HPP
+/** @} */
@@ -30,6 +30,8 @@
 #define TIME_HPP
 
 #include "include/proxy/message_format.hpp"
+#include "include/proxy/timing_clock.hpp"
+#include "include/utils/metrics.hpp"
 
 #include <list>
 #include <thread>
@@ -45,8 +47,8 @@
 class worker;
 
 using timing_db_value = std::tuple<const worker*, std::shared_ptr<proxy_msg>>;
-using timing_db_key = std::chrono::time_point<std::chrono::steady_clock>;
-using timing_db = std::map<timing_db_key, timing_db_value>; 
+using timing_db_key = timing_clock::time_point;
+using timing_db = std::multimap<timing_db_key, timing_db_value>;
 using timing_db_pair = std::pair<timing_db_key, timing_db_value>;
 
 /**
@@ -61,9 +63,15 @@ private:
     std::unique_ptr<std::thread> m_thread;
     void worker_thread();
 
+    //deliver the reminders until now, m_global_lock is locked
+    void deliver(const timing_db_key& now);
+
     std::mutex m_global_lock;
     std::condition_variable m_con_var;
 
+    //number of reminders in m_db
+    metric_gauge& m_outstanding;
+
     void start();
     void stop();
     void join() const;
@@ -90,6 +98,19 @@ public:
      */
     void stop_all_time(const worker* msg_worker);
 
+#ifdef SIM
+    /**
+     * @brief Time of the earliest reminder.
+     * @return Return false if no reminder is stored.
+     */
+    bool get_next_time(timing_db_key& next);
+
+    /**
+     * @brief Set the virtual clock to until and deliver all reminders that are due.
+     */
+    void advance(const timing_db_key& until);
+#endif
+
     virtual ~timing();
     
         /**
@@ -0,0 +1,61 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/**
+ * @addtogroup mod_timer Timer
+ * @{
+ */
+
+#ifndef TIMING_CLOCK_HPP
+#define TIMING_CLOCK_HPP
+
+#include <chrono>
+
+/**
+ * @brief Clock of the timer events. The simulation build replaces the steady
+ * clock with a virtual clock that only the simulation advances.
+ */
+class timing_clock
+{
+public:
+    using time_point = std::chrono::time_point<std::chrono::steady_clock>;
+
+#ifdef SIM
+    static time_point now() {
+        return m_now;
+    }
+
+    static void set(const time_point& now) {
+        m_now = now;
+    }
+
+private:
+    static time_point m_now;
+#else
+    static time_point now() {
+        return std::chrono::steady_clock::now();
+    }
+#endif
+};
+
+#endif // TIMING_CLOCK_HPP
+/** @} */
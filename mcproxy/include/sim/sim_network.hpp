@@ -0,0 +1,173 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef SIM_NETWORK_HPP
+#define SIM_NETWORK_HPP
+
+#include "include/utils/addr_storage.hpp"
+#include "include/proxy/def.hpp"
+#include "include/proxy/message_format.hpp"
+#include "include/proxy/sender.hpp"
+#include "include/proxy/timing_clock.hpp"
+
+#include <string>
+#include <list>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <chrono>
+#include <ostream>
+
+#include <ifaddrs.h>
+
+#define SIM_IF_INDEX_BASE 1000 //interface index of sim0
+#define SIM_IF_NAME_PREFIX "sim"
+
+enum sim_op {
+    SO_ADD_VIF, SO_DEL_VIF, SO_ADD_ROUTE, SO_DEL_ROUTE, SO_GENERAL_QUERY, SO_GROUP_QUERY, SO_RECORD, SO_REPORT, SO_COUNT
+};
+
+/**
+ * @brief Hash of a (group, source) pair.
+ */
+struct sim_addr_pair_hash {
+    std::size_t operator()(const std::pair<addr_storage, addr_storage>& p) const {
+        std::hash<addr_storage> h;
+        return h(p.first) ^ (h(p.second) * 31);
+    }
+};
+
+/**
+ * @brief A query of the proxy, the simulated hosts answer it.
+ */
+struct sim_query {
+    unsigned int if_index;
+    addr_storage gaddr; //unspecified for a general query
+    std::chrono::milliseconds max_resp_time;
+    std::list<addr_storage> slist;
+};
+
+/**
+ * @brief The simulated interfaces and kernel of the simulation build. The
+ * fakes of the mroute socket, the interface properties and the route
+ * statistics and the simulated sender work on this state instead of the
+ * Linux kernel, and every operation is recorded.
+ */
+class sim_network
+{
+private:
+    struct sim_route {
+        int input_vif;
+        std::list<int> output_vif;
+
+        //forwarded packets, one per millisecond while the source is active
+        unsigned long packets;
+        bool counting;
+        timing_clock::time_point since;
+    };
+
+    int m_addr_family;
+    unsigned int m_seed;
+
+    //interface properties of the fake if_prop, a linked list of ifaddrs
+    std::vector<std::string> m_if_names;
+    std::vector<sockaddr_storage> m_if_addrs;
+    std::vector<sockaddr_storage> m_if_netmasks;
+    std::vector<struct ifaddrs> m_ifaddrs;
+
+    //kernel state of the fake mroute socket
+    std::map<int, unsigned int> m_vifs;
+    std::unordered_map<std::pair<addr_storage, addr_storage>, sim_route, sim_addr_pair_hash> m_routes; //(group, source)
+    std::unordered_set<std::pair<addr_storage, addr_storage>, sim_addr_pair_hash> m_active_sources;
+
+    //taken by the simulation after each step
+    std::vector<sim_query> m_queries;
+    std::vector<std::pair<addr_storage, addr_storage>> m_deleted_routes;
+
+    std::ostream* m_log;
+    unsigned long m_counters[SO_COUNT];
+
+    sim_network();
+
+    std::string get_vif_name(int vif) const;
+    static unsigned long get_packets(const sim_route& r);
+
+public:
+    static sim_network& get_instance();
+
+    sim_network(const sim_network&) = delete;
+    sim_network& operator=(const sim_network&) = delete;
+
+    /**
+     * @brief Create the interfaces sim0 .. sim<if_count - 1>.
+     * @param seed seeds the random numbers of the proxy, e.g. the delays of the upstream reports
+     */
+    void init(int addr_family, unsigned int if_count, unsigned int seed);
+
+    /**
+     * @brief Write each recorded operation with its virtual time to log, nullptr disables it.
+     */
+    void set_log(std::ostream* log);
+
+    int get_addr_family() const;
+    unsigned int get_if_count() const;
+    unsigned int get_seed() const;
+
+    //INTERFACES_UNKOWN_IF_INDEX and an empty string if the interface is not simulated
+    unsigned int get_if_index(const std::string& if_name) const;
+    std::string get_if_name(unsigned int if_index) const;
+
+    //first entry of the interface list, nullptr if no interface is simulated
+    struct ifaddrs* get_ifaddrs();
+
+    //mroute socket
+    bool add_vif(int vif, unsigned int if_index);
+    bool del_vif(int vif);
+    bool add_route(int input_vif, const addr_storage& gaddr, const addr_storage& saddr, const std::list<int>& output_vif);
+    bool del_route(int input_vif, const addr_storage& gaddr, const addr_storage& saddr);
+
+    bool has_route(const addr_storage& gaddr, const addr_storage& saddr) const;
+
+    //forwarded packets of a route, 0 if the route does not exist
+    unsigned long get_route_packets(const addr_storage& gaddr, const addr_storage& saddr) const;
+
+    //sources that send to a group, their routes forward packets
+    void set_source_active(const addr_storage& gaddr, const addr_storage& saddr, bool active);
+    bool is_source_active(const addr_storage& gaddr, const addr_storage& saddr) const;
+
+    //sender
+    void add_query(const sim_query& query);
+    void add_record(unsigned int if_index, mc_filter filter_mode, const addr_storage& gaddr, const source_list<source>& slist);
+    void add_report(unsigned int if_index, const std::list<report_record>& records);
+
+    std::vector<sim_query> take_queries();
+    std::vector<std::pair<addr_storage, addr_storage>> take_deleted_routes();
+
+    unsigned long get_counter(sim_op op) const;
+    unsigned int get_route_count() const;
+
+    static std::string get_sim_op_name(sim_op op);
+};
+
+#endif // SIM_NETWORK_HPP
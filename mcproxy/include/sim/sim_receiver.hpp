@@ -0,0 +1,61 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/**
+ * @addtogroup mod_receiver Receiver
+ * @{
+ */
+
+#ifndef SIM_RECEIVER_HPP
+#define SIM_RECEIVER_HPP
+
+#include "include/proxy/receiver.hpp"
+
+/**
+ * @brief Receiver of the simulation build. It has no thread, the simulation
+ * passes the scripted group records and cache misses in.
+ */
+class sim_receiver : public receiver
+{
+private:
+    int get_ctrl_min_size() override;
+    int get_iov_min_size() override;
+    void analyse_packet(struct msghdr* msg, int info_size) override;
+
+public:
+    sim_receiver(proxy_instance* pr_i, int addr_family, const std::shared_ptr<const mroute_socket> mrt_sock, const std::shared_ptr<const interfaces> interfaces);
+
+    /**
+     * @brief Pass a group record of a simulated host to the proxy instance.
+     * @return Return false if the interface is not relevant.
+     */
+    bool receive_record(unsigned int if_index, mcast_addr_record_type record_type, const addr_storage& gaddr, source_list<source>&& slist, group_mem_protocol gmp);
+
+    /**
+     * @brief Pass a cache miss of the simulated kernel to the proxy instance.
+     * @return Return false if the interface is not relevant.
+     */
+    bool receive_cache_miss(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr);
+};
+
+#endif // SIM_RECEIVER_HPP
+/** @} */
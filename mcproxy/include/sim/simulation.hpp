@@ -0,0 +1,166 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+#include "include/utils/addr_storage.hpp"
+#include "include/proxy/def.hpp"
+#include "include/proxy/timing_clock.hpp"
+#include "include/sim/sim_network.hpp"
+
+#include <string>
+#include <list>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <fstream>
+
+#define SIM_DEFAULT_GROUPS 1000
+#define SIM_DEFAULT_INTERFACES 32 //sim0 is the upstream, all others are downstreams
+#define SIM_DEFAULT_DURATION 3600 //sec, virtual time
+#define SIM_DEFAULT_MEMBERSHIP 10 //percent of the (downstream, group) pairs with a listener
+#define SIM_DEFAULT_HOLD_TIME 600 //sec, mean membership and pause time of a listener
+#define SIM_DEFAULT_JOIN_SPREAD 60 //sec, the first joins and sources start within this time
+#define SIM_DEFAULT_SOURCES 1 //per group
+#define SIM_DEFAULT_SEED 1
+#define SIM_CACHE_MISS_DELAY 1 //msec, until the next packet of an active source arrives after its route was deleted
+#define SIM_UNRESOLVED_TIMEOUT 10000 //msec, the kernel reports an active source without route again after this time
+
+class timing;
+class interfaces;
+class proxy_instance;
+class sim_receiver;
+
+/**
+ * @brief Deterministic simulation of one proxy instance. The timers run on a
+ * virtual clock, the kernel and the sender are replaced by the simulated
+ * network and the group records come from a population of simulated
+ * listeners and an optional script. The speed depends on the number of
+ * memberships, the default 1000 groups run about 3500 times faster than
+ * real time, 100000 groups on 32 interfaces about five times. Two runs with
+ * the same parameters produce the same operation log.
+ */
+class simulation
+{
+private:
+    enum sim_event_type {
+        SE_JOIN, SE_LEAVE, SE_ANSWER, SE_SOURCE_START, SE_SOURCE_STOP, SE_CACHE_MISS, SE_RECORD
+    };
+
+    struct sim_event {
+        sim_event_type type;
+        unsigned int if_index;
+        unsigned int id; //group index, source id for the source events, script record for SE_RECORD
+    };
+
+    //a multicast source on an input interface
+    struct sim_source {
+        unsigned int if_index;
+        addr_storage gaddr;
+        addr_storage saddr;
+        bool cache_miss_pending;
+    };
+
+    //group record of the script file
+    struct script_record {
+        mcast_addr_record_type record_type;
+        addr_storage gaddr;
+        std::list<addr_storage> slist;
+    };
+
+    group_mem_protocol m_gmp;
+    upstream_report_mode m_urm;
+    unsigned int m_group_count;
+    unsigned int m_if_count;
+    std::chrono::seconds m_duration;
+    unsigned int m_membership;
+    std::chrono::seconds m_hold_time;
+    std::chrono::seconds m_join_spread;
+    unsigned int m_source_count;
+    unsigned int m_seed;
+    std::string m_script_file;
+    std::string m_log_file;
+    bool m_print_state;
+
+    std::mt19937 m_random;
+    std::ofstream m_log;
+
+    sim_network& m_network;
+    std::shared_ptr<timing> m_timing;
+    std::shared_ptr<interfaces> m_interfaces;
+    std::unique_ptr<proxy_instance> m_proxy;
+    sim_receiver* m_receiver;
+
+    //events with equal times keep their insertion order
+    std::multimap<timing_clock::time_point, sim_event> m_events;
+    std::vector<script_record> m_script;
+
+    //source id ==> source
+    std::vector<sim_source> m_sources;
+    std::unordered_map<std::pair<addr_storage, addr_storage>, unsigned int, sim_addr_pair_hash> m_source_ids; //(group, source) ==> source id
+
+    //joined group indexes of each interface
+    std::vector<std::set<unsigned int>> m_joined;
+    std::unordered_map<addr_storage, unsigned int> m_group_index;
+
+    unsigned long m_event_count;
+    unsigned long m_record_count;
+    unsigned long m_message_count;
+
+    void help();
+    bool parse_script();
+
+    addr_storage get_group(unsigned int group) const;
+    addr_storage get_source(unsigned int source) const;
+
+    std::chrono::milliseconds get_uniform(std::chrono::milliseconds max);
+    std::chrono::milliseconds get_exponential(std::chrono::milliseconds mean);
+
+    void add_event(std::chrono::milliseconds delay, sim_event_type type, unsigned int if_index, unsigned int id);
+    unsigned int get_source_id(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr);
+
+    void init_proxy();
+    void init_population();
+    void run();
+
+    //process the messages of the proxy instance and the reactions of the simulated network
+    void drain();
+    void answer(const sim_query& q);
+
+    void handle_event(const sim_event& e);
+    void send_record(unsigned int if_index, mcast_addr_record_type record_type, const addr_storage& gaddr, const std::list<addr_storage>& slist);
+    //report the packets of an active source without route to the proxy until it has a route
+    void schedule_cache_miss(unsigned int source_id, std::chrono::milliseconds delay);
+
+    void print_summary(std::chrono::nanoseconds wall_time);
+
+public:
+    simulation(int arg_count, char* args[]);
+    ~simulation();
+};
+
+#endif // SIMULATION_HPP
@@ -0,0 +1,141 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef FLOW_TRAFFIC_HPP
+#define FLOW_TRAFFIC_HPP
+
+#include "include/utils/addr_storage.hpp"
+#include "include/utils/mc_socket.hpp"
+#include "include/utils/metrics.hpp"
+#include "include/proxy/def.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define FLOW_TRAFFIC_MAGIC 0x6d637066 //"mcpf"
+#define FLOW_TRAFFIC_DUPLICATE_WINDOW 1024 //sequence numbers, multiple of 64
+#define FLOW_TRAFFIC_STATUS_INTERVAL 1000 //msec
+#define FLOW_TRAFFIC_MAX_PACING_BURST 1000 //usec, traffic of one batch at most
+#define FLOW_TRAFFIC_RECEIVE_BUFFER (8 * 1024 * 1024) //byte
+
+/**
+ * @brief Binary header in front of each packet, network byte order.
+ */
+struct flow_header {
+    uint32_t magic;
+    uint32_t flow_id;
+    uint64_t sequence;
+    uint64_t send_time; //nsec since the epoch (CLOCK_REALTIME)
+} __attribute__ ((packed));
+
+/**
+ * @brief Settings of the high rate sender and receiver.
+ */
+struct flow_traffic_config {
+    std::string if_name;
+    addr_storage first_gaddr;
+    unsigned int group_count;
+
+    //sender: local source addresses, receiver: source filter; one flow per source and group
+    std::list<addr_storage> slist;
+    mc_filter filter_mode;
+
+    int port;
+    int ttl;
+    unsigned long packet_rate; //packets per second of all flows, 0 = as fast as possible
+    unsigned int packet_size; //udp payload in byte
+    unsigned int batch_size; //packets per sendmmsg/recvmmsg
+    unsigned long max_count; //packets, 0 = endless
+
+    bool print_status_msg;
+    bool save_to_file;
+    std::string file_name;
+    std::string file_operation_mode;
+    bool include_file_header;
+};
+
+/**
+ * @brief Sends numbered packets to many (S,G) flows at a paced rate or
+ * receives them and measures loss, reordering, duplicates and latency per
+ * flow. A flow is one source address and one group, flow ids are assigned
+ * source by source, so the sender and the receiver have to be configured
+ * with the same sources (in the same order) and groups.
+ */
+class flow_traffic
+{
+private:
+    //written only by the receiving thread, read by the status thread
+    struct flow_stats {
+        std::atomic<unsigned long> received;
+        std::atomic<unsigned long> duplicates;
+        std::atomic<unsigned long> reordered;
+        std::atomic<unsigned long> first_sequence;
+        std::atomic<unsigned long> highest_sequence;
+        bool started;
+        uint64_t window[FLOW_TRAFFIC_DUPLICATE_WINDOW / 64]; //received sequence numbers below highest_sequence
+        metric_histogram latency; //nsec
+
+        flow_stats();
+        unsigned long get_lost() const;
+    };
+
+    const flow_traffic_config m_config;
+    const unsigned int m_if_index;
+    std::vector<addr_storage> m_groups;
+    std::vector<addr_storage> m_sources; //an unspecified address if no source is given
+    unsigned int m_flow_count;
+
+    std::vector<std::unique_ptr<flow_stats>> m_flow_stats;
+    std::atomic<unsigned long> m_unknown;
+    std::atomic<unsigned long> m_total;
+
+    std::unique_ptr<mc_socket> create_socket() const;
+    unsigned int get_flow_id(unsigned int source_index, unsigned int group_index) const;
+
+    void analyse_packet(const unsigned char* buf, unsigned int size, uint64_t receive_time);
+    void print_receive_status() const;
+    void print_receive_summary(const std::chrono::steady_clock::duration& duration);
+
+    static uint64_t get_realtime_nsec();
+
+public:
+    /**
+     * @throw const char* if the interface or the addresses are invalid
+     */
+    flow_traffic(const flow_traffic_config& config);
+
+    /**
+     * @brief Send until running is false or max_count packets are sent.
+     */
+    void send(const bool& running);
+
+    /**
+     * @brief Join the groups and receive until running is false or max_count packets are received.
+     */
+    void receive(const bool& running);
+};
+
+#endif // FLOW_TRAFFIC_HPP
@@ -0,0 +1,183 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef HOST_POPULATION_HPP
+#define HOST_POPULATION_HPP
+
+#include "include/utils/addr_storage.hpp"
+#include "include/proxy/def.hpp"
+
+#include <chrono>
+#include <functional>
+#include <fstream>
+#include <list>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#define HOST_POPULATION_UNSOLICITED_REPORT_INTERVAL 1000 //msec, RFC 3376 and RFC 3810
+#define HOST_POPULATION_STATUS_INTERVAL 1000 //msec
+
+/**
+ * @brief Settings of a simulated host population.
+ */
+struct host_population_config {
+    std::string if_name;
+    std::string upstream_if_name; //empty if the upstream reaction is not measured
+    group_mem_protocol gmp;
+
+    addr_storage first_gaddr;
+    unsigned int group_count;
+    bool zipf_popularity; //otherwise all groups are equally popular
+
+    addr_storage first_host_addr;
+    unsigned int host_count;
+
+    mc_filter filter_mode;
+    std::list<addr_storage> slist;
+
+    unsigned int join_rate; //joins per second of the whole population
+    std::chrono::milliseconds hold_time; //mean membership time, 0 = endless
+    unsigned int zap_rate; //channel changes per second of the whole population
+    unsigned int robustness;
+    unsigned int seed;
+    unsigned long max_count; //joins, 0 = endless
+
+    bool print_status_msg;
+    bool save_to_file;
+    std::string file_name;
+    std::string file_operation_mode;
+    bool include_file_header;
+};
+
+/**
+ * @brief Simulates many IGMPv2/IGMPv3/MLDv1/MLDv2 hosts on one interface.
+ *
+ * The reports are crafted with the addresses of the simulated hosts and sent
+ * with a packet socket. The hosts join and leave groups with exponentially
+ * distributed intervals, change channels and answer the queries of the
+ * proxy within the max response time. If an upstream interface is given, the
+ * time from the first join (last leave) of a group to the matching upstream
+ * report of the proxy is recorded.
+ */
+class host_population
+{
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct record {
+        mcast_addr_record_type type;
+        addr_storage gaddr;
+    };
+
+    struct host {
+        addr_storage addr;
+        std::map<addr_storage, unsigned long> groups; //group address, membership id
+    };
+
+    const host_population_config m_config;
+    const int m_addr_family;
+    unsigned int m_if_index;
+    unsigned int m_upstream_if_index;
+    unsigned int m_mtu;
+
+    int m_sock;
+    int m_upstream_sock;
+
+    std::vector<host> m_hosts;
+    std::vector<addr_storage> m_groups;
+    std::map<addr_storage, unsigned int> m_group_members;
+    unsigned long m_membership_id;
+
+    std::mt19937 m_rand;
+    std::discrete_distribution<unsigned int> m_group_distribution;
+    std::multimap<clock::time_point, std::function<void()>> m_schedule;
+
+    //group address, time of the first join (last leave) of the population
+    std::map<addr_storage, clock::time_point> m_pending_joins;
+    std::map<addr_storage, clock::time_point> m_pending_leaves;
+    std::vector<double> m_join_latency; //msec
+    std::vector<double> m_leave_latency; //msec
+    std::ofstream m_file;
+
+    unsigned long m_joins;
+    unsigned long m_leaves;
+    unsigned long m_zaps;
+    unsigned long m_packets_sent;
+    unsigned long m_send_errors;
+    unsigned long m_queries;
+    unsigned long m_upstream_records;
+
+    int open_packet_socket(unsigned int if_index) const;
+
+    mcast_addr_record_type get_join_record_type() const;
+    mcast_addr_record_type get_leave_record_type() const;
+    mcast_addr_record_type get_current_state_record_type() const;
+    std::chrono::microseconds get_exponential_interval(double mean_msec);
+
+    void schedule(const std::chrono::microseconds& delay, const std::function<void()>& f);
+    void schedule_join();
+    void schedule_zap();
+    void schedule_leave(unsigned int host_index, const addr_storage& gaddr);
+
+    void join(unsigned int host_index, const addr_storage& gaddr);
+    void leave(unsigned int host_index, const addr_storage& gaddr, unsigned long membership_id);
+    void zap();
+
+    void add_member(const addr_storage& gaddr);
+    void del_member(const addr_storage& gaddr);
+
+    void send_state_change(unsigned int host_index, const std::list<record>& records);
+    void send_current_state(unsigned int host_index, const addr_storage& gaddr);
+
+    std::list<std::vector<unsigned char>> build_packets(const addr_storage& saddr, const std::list<record>& records) const;
+    std::vector<unsigned char> build_ipv4_packet(const addr_storage& saddr, const addr_storage& daddr, const std::vector<unsigned char>& payload) const;
+    std::vector<unsigned char> build_ipv6_packet(const addr_storage& saddr, const addr_storage& daddr, std::vector<unsigned char> payload) const;
+    bool send_packet(const std::vector<unsigned char>& packet);
+
+    void receive_packets(int sock, bool upstream);
+    void analyse_query(const unsigned char* buf, unsigned int size);
+    void analyse_upstream_report(const unsigned char* buf, unsigned int size);
+    const unsigned char* get_payload(const unsigned char* buf, unsigned int& size, addr_storage& saddr) const;
+    void answer_query(const addr_storage& gaddr, const std::chrono::milliseconds& max_resp_time);
+    void upstream_reaction(const addr_storage& gaddr, bool join);
+
+    void print_status() const;
+    void print_summary();
+    static std::string latency_to_string(std::vector<double>& latency);
+
+public:
+    /**
+     * @throw const char* if the interfaces or the addresses are invalid
+     */
+    host_population(const host_population_config& config);
+
+    ~host_population();
+
+    /**
+     * @brief Simulate the hosts until running is false or max_count joins are sent.
+     */
+    void run(const bool& running);
+};
+
+#endif // HOST_POPULATION_HPP
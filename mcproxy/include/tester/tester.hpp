@@ -63,6 +63,8 @@ private:
     std::string get_msg(const std::string& to_do, const std::string& proposal);
     std::chrono::milliseconds get_send_interval(const std::string& to_do);
     std::chrono::milliseconds get_lifetime(const std::string& to_do);
+    group_mem_protocol get_group_mem_protocol(const std::string& to_do, int addr_family);
+    addr_storage get_host_addr(const std::string& to_do, int addr_family);
 
     int get_int(const std::string& to_do, std::string&& compare, int default_return);
     bool get_boolean(const std::string& to_do, std::string&& compare, bool default_return);    
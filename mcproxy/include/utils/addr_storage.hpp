@@ -27,6 +27,7 @@
 #include <netinet/in.h>
 
 #include <string>
+#include <functional>
 
 /**
  * @brief Wrapper for IPv4 and IPv6 addresses.
@@ -254,4 +255,15 @@ public:
     static void test_addr_storage_b();
 };
 
+namespace std
+{
+/**
+ * @brief Hash of the address, keys the unordered maps of groups and sources.
+ */
+template<>
+struct hash<addr_storage> {
+    std::size_t operator()(const addr_storage& addr) const;
+};
+}
+
 #endif // ADDR_STORAGE_HPP
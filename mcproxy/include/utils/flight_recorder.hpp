@@ -0,0 +1,131 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef FLIGHT_RECORDER_HPP
+#define FLIGHT_RECORDER_HPP
+
+#include "include/utils/addr_storage.hpp"
+
+#include <string>
+#include <cstdint>
+
+#define FLIGHT_RECORDER_RING_SIZE 4096 //events per thread, a power of two
+#define FLIGHT_RECORDER_MAX_THREADS 64 //threads without a ring record nothing
+#define FLIGHT_RECORDER_PATH_SIZE 256
+#define FLIGHT_RECORDER_MAGIC "MCFR"
+#define FLIGHT_RECORDER_VERSION 1
+
+enum fr_event_type {
+    FR_RECORD_RECEIVED = 1, //arg: record type, arg2: number of sources
+    FR_TIMER_FIRED, //arg: message type, saddr: source of a new source timer
+    FR_QUERY_SENT, //gaddr: unspecified for a general query, arg: number of sources, arg2: bit 0 s-flag, bit 1 sent
+    FR_ROUTE_ADDED, //if_index: input interface, arg: number of output interfaces, arg2: 1 if successful
+    FR_ROUTE_DELETED, //if_index: input interface, arg2: 1 if successful
+    FR_QUEUE_OVERFLOW //arg: maximum size of the queue
+};
+std::string get_fr_event_type_name(fr_event_type type);
+
+/**
+ * @brief One event of the flight recorder, the file format is the memory
+ *        layout of the host.
+ */
+struct fr_event {
+    uint64_t time; //microseconds since the epoch
+    uint8_t type;
+    uint8_t addr_family; //of gaddr and saddr, 0 if the event has no address
+    uint16_t reserved;
+    uint32_t if_index;
+    uint32_t arg;
+    uint32_t arg2;
+    uint8_t gaddr[16];
+    uint8_t saddr[16];
+};
+
+/**
+ * @brief Header of a dump file, followed by ring_count rings.
+ */
+struct fr_file_header {
+    char magic[4];
+    uint16_t version;
+    uint16_t event_size;
+    uint32_t ring_size;
+    uint32_t ring_count;
+    uint32_t pid;
+    int32_t signal; //that triggered the dump, 0 if requested by the program
+    uint64_t time; //microseconds since the epoch
+};
+
+/**
+ * @brief Header of a ring in a dump file, followed by ring_size events.
+ *        The oldest event is at index head % ring_size if the ring is full.
+ */
+struct fr_ring_header {
+    uint32_t tid;
+    char thread_name[16];
+    uint32_t reserved;
+    uint64_t head; //number of recorded events
+};
+
+/**
+ * @brief Always-on recorder of the last events of each thread. Each thread
+ * writes to its own ring of fixed-size binary events without locks and
+ * without allocations after its first event, so the recorder stays enabled
+ * in release builds. On SIGUSR1 or on a fatal signal (SIGSEGV, SIGBUS,
+ * SIGFPE, SIGILL, SIGABRT) all rings are written to a file with
+ * async-signal-safe calls only. The dump file is read with the flight
+ * decoder (qmake CONFIG+=decoder). An event being written during the dump
+ * may be torn.
+ */
+class flight_recorder
+{
+private:
+    static void signal_handler(int sig);
+
+public:
+    /**
+     * @brief Record an event in the ring of the calling thread.
+     */
+    static void record(fr_event_type type, unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr, uint32_t arg = 0, uint32_t arg2 = 0);
+
+    /**
+     * @brief Record an event without a source address in the ring of the calling thread.
+     */
+    static void record(fr_event_type type, unsigned int if_index, const addr_storage& gaddr, uint32_t arg = 0, uint32_t arg2 = 0);
+
+    /**
+     * @brief Set the dump file and install the handlers of SIGUSR1 and the fatal signals.
+     */
+    static bool init(const std::string& path);
+
+    /**
+     * @brief Write all rings to the dump file. Async-signal-safe. An existing
+     *        file is removed and the dump file is created exclusively, it
+     *        fails if another file appears at the path in between.
+     * @param sig signal that triggered the dump, 0 if none
+     * @return Return false if no dump file is set or it could not be written.
+     */
+    static bool dump(int sig = 0);
+
+    static void test_flight_recorder();
+};
+
+#endif // FLIGHT_RECORDER_HPP
@@ -0,0 +1,109 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef IF_MONITOR_HPP
+#define IF_MONITOR_HPP
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <set>
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+#define IF_MONITOR_RECV_BUF_SIZE (16 * 1024)
+
+enum if_event {
+    IFE_LINK_UP, IFE_LINK_DOWN, IFE_ADDR_CHANGED
+};
+
+using if_monitor_callback = std::function<void(unsigned int, if_event)>;
+
+/**
+ * @brief Listens to the rtnetlink link and address notifications of the
+ * kernel (RTM_NEWLINK, RTM_DELLINK, RTM_NEWADDR, RTM_DELADDR). A link counts
+ * as running if it is up and has a carrier. Only changes are reported, an
+ * unknown link is assumed to be running. The state of the links is read with
+ * a link dump (RTM_GETLINK) at the start and after notifications were lost,
+ * so links that are down already or changed unnoticed are reported as well.
+ * The thread sleeps in poll() until the kernel sends a message, there is no
+ * polling interval.
+ */
+class if_monitor
+{
+private:
+    int m_addr_family;
+    if_monitor_callback m_cb;
+
+    int m_sock;
+    int m_stop_pipe[2];
+
+    std::set<unsigned int> m_links;
+    std::set<unsigned int> m_down_links;
+    std::unique_ptr<std::thread> m_thread;
+
+    //link dump in progress, its sequence number and the links it reported
+    bool m_dump_pending;
+    bool m_dump_again;
+    unsigned int m_dump_seq;
+    std::set<unsigned int> m_dump_links;
+
+    static std::atomic<unsigned int> m_link_generation;
+
+    void worker_thread();
+    void parse(const unsigned char* buf, int size);
+    void link_changed(unsigned int if_index, bool running);
+
+    bool request_link_dump();
+    void finish_link_dump();
+
+    if_monitor(const if_monitor&) = delete;
+    if_monitor& operator=(const if_monitor&) = delete;
+
+public:
+    /**
+     * @param addr_family only address changes of this family are reported (AF_INET or AF_INET6)
+     * @param cb called in the thread of the monitor
+     */
+    if_monitor(int addr_family, const if_monitor_callback& cb);
+
+    virtual ~if_monitor();
+
+    static std::string get_if_event_name(if_event ife);
+
+    /**
+     * @brief Counts the link notifications of all monitors, including new,
+     * removed and renamed links. Caches of interface name to index mappings
+     * are outdated if it changed.
+     */
+    static unsigned int get_link_generation();
+
+    /**
+     * @brief Print the link and address events of the system for some seconds.
+     */
+    static void test_if_monitor();
+};
+
+#endif // IF_MONITOR_HPP
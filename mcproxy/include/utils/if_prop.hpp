@@ -85,6 +85,16 @@ public:
      */
     virtual ~if_prop();
 
+    /**
+     * @brief Map an interface name to its index, 0 if the interface does not exist.
+     */
+    static unsigned int get_if_index(const char* if_name);
+
+    /**
+     * @brief Map an interface index to its name, an empty string if the interface does not exist.
+     */
+    static std::string get_if_name(unsigned int if_index);
+
     /**
      * @brief Check for a valid data structure.
      */
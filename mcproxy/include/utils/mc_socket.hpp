@@ -206,6 +206,13 @@ public:
      */
     bool set_receive_timeout(long msec) const;
 
+    /**
+     * @brief Let the kernel attach the receive time (SCM_TIMESTAMPNS, CLOCK_REALTIME)
+     *        to each message received with receive_msg().
+     * @return Return true on success.
+     */
+    bool set_receive_timestamp(bool enable) const;
+
     /**
      * @brief Choose a specific network interface
      * @return Return true on success.
@@ -296,6 +303,13 @@ public:
         return m_sock > 0;
     }
 
+    /**
+     * @brief Socket descriptor, e.g. to wait for several sockets with poll().
+     */
+    int get_socket() const {
+        return m_sock;
+    }
+
     /**
      * @brief Test a part of the class mc_socket.
      * @param ipverion "AF_INET" or "AF_INET6"
@@ -0,0 +1,114 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef MC_SOCKET_POOL_HPP
+#define MC_SOCKET_POOL_HPP
+
+#include "include/utils/mc_socket.hpp"
+#include "include/utils/addr_storage.hpp"
+
+#include <map>
+#include <list>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#define MC_SOCKET_POOL_IGMP_MAX_MEMBERSHIPS_PATH "/proc/sys/net/ipv4/igmp_max_memberships"
+#define MC_SOCKET_POOL_IGMP_MAX_MSF_PATH "/proc/sys/net/ipv4/igmp_max_msf"
+#define MC_SOCKET_POOL_MLD_MAX_MSF_PATH "/proc/sys/net/ipv6/mld_max_msf"
+
+/**
+ * @brief Shards group memberships across as many sockets as the kernel
+ * limits per socket (igmp_max_memberships, socket option memory) require.
+ * Each (interface, group) is owned by one socket, which also receives all
+ * source filter updates of the group. Sockets are opened on demand and
+ * closed when their last membership is left. A socket whose join fails with
+ * ENOBUFS or ENOMEM before the configured limit is considered full at its
+ * current occupancy, other errors are returned to the caller.
+ */
+class mc_socket_pool
+{
+private:
+    struct pool_socket {
+        std::unique_ptr<mc_socket> sock;
+        unsigned int memberships;
+        unsigned int capacity; //0 is unlimited
+    };
+
+    const int m_addr_family;
+
+    //0 is unlimited
+    unsigned int m_max_memberships;
+    unsigned int m_max_msf;
+
+    mutable std::mutex m_global_lock;
+    std::vector<pool_socket> m_sockets;
+
+    //(if_index, group address) ==> index of the owning socket
+    std::map<std::pair<unsigned int, addr_storage>, unsigned int> m_owner;
+
+    static unsigned int read_limit(const std::string& path);
+
+    bool open_socket(pool_socket& ps);
+    bool join(unsigned int if_index, const addr_storage& gaddr, unsigned int& index);
+    void release(unsigned int index);
+
+public:
+    /**
+     * @param addr_family AF_INET or AF_INET6
+     * @param max_memberships memberships per socket, 0 reads the kernel limit
+     */
+    mc_socket_pool(int addr_family, unsigned int max_memberships = 0);
+
+    mc_socket_pool(const mc_socket_pool&) = delete;
+    mc_socket_pool& operator=(const mc_socket_pool&) = delete;
+
+    /**
+     * @brief Join the group on a socket with free capacity if not joined yet and set its source filter on the owning socket.
+     * @param filter_mode MCAST_INCLUDE or MCAST_EXCLUDE
+     */
+    bool set_source_filter(unsigned int if_index, const addr_storage& gaddr, uint32_t filter_mode, const std::list<addr_storage>& src_list);
+
+    /**
+     * @brief Leave the group on its owning socket, a socket without memberships is closed.
+     */
+    bool leave_group(unsigned int if_index, const addr_storage& gaddr);
+
+    bool is_joined(unsigned int if_index, const addr_storage& gaddr) const;
+
+    unsigned int get_socket_count() const;
+    unsigned int get_membership_count() const;
+
+    /**
+     * @brief Number of memberships of each open socket.
+     */
+    std::vector<unsigned int> get_occupancy() const;
+
+    std::string to_string() const;
+    friend std::ostream& operator<<(std::ostream& stream, const mc_socket_pool& p);
+
+    static void test_mc_socket_pool();
+};
+
+#endif // MC_SOCKET_POOL_HPP
@@ -0,0 +1,166 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef MEM_ARENA_HPP
+#define MEM_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <new>
+
+//block sizes are rounded up to this alignment
+#define MEM_ARENA_ALIGNMENT 16
+//bigger blocks bypass the slab pools
+#define MEM_ARENA_MAX_BLOCK_SIZE 1024
+//a pool starts with a small chunk and doubles it on every refill
+#define MEM_ARENA_FIRST_CHUNK_BLOCKS 4
+#define MEM_ARENA_MAX_CHUNK_BLOCKS 64
+
+enum mem_arena_kind {MAK_GROUP = 0, MAK_SOURCE = 1, MAK_TIMER = 2, MAK_COUNT = 3};
+std::string get_mem_arena_kind_name(mem_arena_kind kind);
+
+/**
+ * @brief Slab allocator for the membership state of a querier. Blocks are
+ * carved from chunks per size class and recycled over a free list. All chunks
+ * are released at once when the arena is destroyed.
+ */
+class mem_arena
+{
+private:
+    struct free_block {
+        free_block* next;
+    };
+
+    struct pool {
+        free_block* free_list = nullptr;
+        unsigned int next_chunk_blocks = MEM_ARENA_FIRST_CHUNK_BLOCKS;
+    };
+
+    mutable std::mutex m_global_lock; //timer messages can be released by the timing thread
+
+    std::vector<pool> m_pools; //one pool per size class
+    std::vector<void*> m_chunks;
+
+    std::size_t m_bytes_reserved;
+    std::size_t m_bytes_in_use[MAK_COUNT];
+    std::size_t m_blocks_in_use[MAK_COUNT];
+
+    static std::size_t get_block_size(std::size_t bytes);
+    void refill(pool& p, std::size_t block_size);
+
+public:
+    mem_arena();
+    mem_arena(const mem_arena&) = delete;
+    mem_arena& operator=(const mem_arena&) = delete;
+
+    /**
+     * @brief Releases all chunks of the arena in one step.
+     */
+    virtual ~mem_arena();
+
+    void* allocate(std::size_t bytes, mem_arena_kind kind);
+    void deallocate(void* p, std::size_t bytes, mem_arena_kind kind);
+
+    /**
+     * @brief Bytes requested from the heap, including free blocks.
+     */
+    std::size_t get_bytes_reserved() const;
+    std::size_t get_bytes_in_use(mem_arena_kind kind) const;
+    std::size_t get_blocks_in_use(mem_arena_kind kind) const;
+
+    std::string to_string() const;
+    friend std::ostream& operator<<(std::ostream& stream, const mem_arena& m);
+
+    static void test_mem_arena();
+};
+
+/**
+ * @brief Stateful allocator for the standard containers that draws its
+ * memory from a mem_arena. A default constructed allocator has no arena and
+ * uses the global heap, so containers without an arena behave as before.
+ * Copy constructed containers fall back to the heap as well, which keeps
+ * temporary copies of a list out of the arena of its querier.
+ */
+template<typename T, mem_arena_kind Kind>
+class arena_allocator
+{
+private:
+    std::shared_ptr<mem_arena> m_arena;
+
+public:
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {
+        using other = arena_allocator<U, Kind>;
+    };
+
+    arena_allocator() noexcept = default;
+
+    explicit arena_allocator(const std::shared_ptr<mem_arena>& arena) noexcept
+        : m_arena(arena) {
+    }
+
+    template<typename U>
+    arena_allocator(const arena_allocator<U, Kind>& other) noexcept
+        : m_arena(other.get_arena()) {
+    }
+
+    T* allocate(std::size_t n) {
+        if (m_arena.get() != nullptr && n == 1) {
+            return static_cast<T*>(m_arena->allocate(sizeof(T), Kind));
+        } else {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        if (m_arena.get() != nullptr && n == 1) {
+            m_arena->deallocate(p, sizeof(T), Kind);
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    arena_allocator select_on_container_copy_construction() const {
+        return arena_allocator();
+    }
+
+    const std::shared_ptr<mem_arena>& get_arena() const {
+        return m_arena;
+    }
+
+    template<typename U>
+    bool operator==(const arena_allocator<U, Kind>& other) const {
+        return m_arena == other.get_arena();
+    }
+
+    template<typename U>
+    bool operator!=(const arena_allocator<U, Kind>& other) const {
+        return !(*this == other);
+    }
+};
+
+#endif // MEM_ARENA_HPP
@@ -0,0 +1,205 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define METRICS_SLOTS 16 //counter slots, threads beyond share them
+#define METRICS_CACHE_LINE 64
+#define METRICS_PREFIX "mcproxy_"
+
+//a histogram bucket covers 1/16 of a power of two, the reported quantiles are at most 6.25% too high
+#define METRICS_HISTOGRAM_SUB_BITS 5
+#define METRICS_HISTOGRAM_HALF (1 << (METRICS_HISTOGRAM_SUB_BITS - 1))
+#define METRICS_HISTOGRAM_BUCKETS ((64 - METRICS_HISTOGRAM_SUB_BITS + 2) * METRICS_HISTOGRAM_HALF)
+
+//label name, label value
+using metric_labels = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * @brief A monotonic counter. Each thread increments its own slot on its own
+ * cache line without a lock, a reader sums up all slots.
+ */
+class metric_counter
+{
+private:
+    struct slot {
+        std::atomic<unsigned long> value;
+        char padding[METRICS_CACHE_LINE - sizeof(std::atomic<unsigned long>)];
+    };
+
+    slot m_slots[METRICS_SLOTS];
+
+    metric_counter(const metric_counter&) = delete;
+    metric_counter& operator=(const metric_counter&) = delete;
+
+public:
+    metric_counter();
+
+    void inc(unsigned long n = 1) {
+        m_slots[get_thread_slot()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    unsigned long get() const;
+
+    static unsigned int get_thread_slot();
+};
+
+/**
+ * @brief A value that goes up and down, usually set by a single thread.
+ */
+class metric_gauge
+{
+private:
+    std::atomic<long> m_value;
+
+    metric_gauge(const metric_gauge&) = delete;
+    metric_gauge& operator=(const metric_gauge&) = delete;
+
+public:
+    metric_gauge();
+
+    void set(long value) {
+        m_value.store(value, std::memory_order_relaxed);
+    }
+
+    void add(long delta) {
+        m_value.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    long get() const;
+};
+
+/**
+ * @brief A distribution of durations in nanoseconds with log-linear buckets (like a HDR histogram):
+ * values below 32 are exact, larger ones keep their five most significant bits.
+ * Recording is a lock-free increment of a single bucket, the quantiles are computed by the reader.
+ */
+class metric_histogram
+{
+private:
+    std::atomic<unsigned long> m_buckets[METRICS_HISTOGRAM_BUCKETS];
+    std::atomic<unsigned long> m_count;
+    std::atomic<unsigned long> m_sum;
+
+    metric_histogram(const metric_histogram&) = delete;
+    metric_histogram& operator=(const metric_histogram&) = delete;
+
+public:
+    metric_histogram();
+
+    void record(unsigned long value) {
+        m_buckets[get_bucket(value)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    unsigned long get_count() const;
+
+    unsigned long get_sum() const;
+
+    /**
+     * @brief The highest value of the bucket that holds the quantile q (0 < q <= 1), 0 if empty.
+     */
+    unsigned long get_quantile(double q) const;
+
+    static unsigned int get_bucket(unsigned long value) {
+        if (value < 2 * METRICS_HISTOGRAM_HALF) {
+            return value;
+        }
+        unsigned int shift = (63 - __builtin_clzl(value)) - METRICS_HISTOGRAM_SUB_BITS + 1;
+        return (shift + 1) * METRICS_HISTOGRAM_HALF + ((value >> shift) - METRICS_HISTOGRAM_HALF);
+    }
+
+    static unsigned long get_bucket_upper_bound(unsigned int bucket);
+};
+
+/**
+ * @brief Registry of all counters and gauges of the process. Registration
+ * takes a lock and should happen once per call site (the returned reference
+ * stays valid until the end of the process), updates and reads are lock-free.
+ * The registry renders all metrics in the Prometheus text exposition format.
+ */
+class metrics
+{
+private:
+    enum metric_type {
+        MT_COUNTER, MT_GAUGE, MT_SUMMARY
+    };
+
+    struct family {
+        std::string help;
+        metric_type type;
+
+        //rendered labels ==> metric
+        std::map<std::string, std::unique_ptr<metric_counter>> counters;
+        std::map<std::string, std::unique_ptr<metric_gauge>> gauges;
+        std::map<std::string, std::unique_ptr<metric_histogram>> histograms;
+    };
+
+    mutable std::mutex m_lock;
+    std::map<std::string, family> m_families;
+
+    metrics() = default;
+    metrics(const metrics&) = delete;
+    metrics& operator=(const metrics&) = delete;
+
+    family& get_family(const std::string& name, const std::string& help, metric_type type);
+
+    static std::string render_labels(const metric_labels& labels);
+    static std::string escape_label_value(const std::string& value);
+    static std::string escape_help(const std::string& help);
+    static std::string add_label(const std::string& rendered_labels, const std::string& label);
+
+public:
+    static metrics& get_instance();
+
+    /**
+     * @param name without the prefix mcproxy_, counters should end with _total
+     */
+    metric_counter& get_counter(const std::string& name, const std::string& help, const metric_labels& labels = metric_labels());
+
+    metric_gauge& get_gauge(const std::string& name, const std::string& help, const metric_labels& labels = metric_labels());
+
+    /**
+     * @brief A histogram of nanoseconds, exported as a summary in seconds with the quantiles 0.5, 0.9, 0.99 and 0.999.
+     * @param name without the prefix mcproxy_, should end with _seconds
+     */
+    metric_histogram& get_histogram(const std::string& name, const std::string& help, const metric_labels& labels = metric_labels());
+
+    /**
+     * @brief All metrics in the Prometheus text exposition format (version 0.0.4).
+     */
+    std::string to_prometheus() const;
+
+    static void test_metrics();
+};
+
+#endif // METRICS_HPP
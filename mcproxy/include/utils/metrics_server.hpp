@@ -0,0 +1,69 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef METRICS_SERVER_HPP
+#define METRICS_SERVER_HPP
+
+#include <string>
+#include <memory>
+#include <thread>
+
+#define METRICS_SERVER_BACKLOG 8
+#define METRICS_SERVER_RECV_TIMEOUT 200 //msec to wait for a request
+#define METRICS_SERVER_SEND_TIMEOUT 1000 //msec a client may stall the answer
+#define METRICS_SERVER_RECV_BUF_SIZE 1024
+
+/**
+ * @brief Serves the metrics registry on a local Unix stream socket. A client
+ * sending an HTTP GET request (e.g. curl --unix-socket) gets an HTTP response,
+ * any other client the plain Prometheus text exposition. The connection is
+ * closed after each answer, a client that does not read it within
+ * METRICS_SERVER_SEND_TIMEOUT is dropped. The server runs on its own thread
+ * and only reads the lock-free metrics, it never waits for a proxy instance.
+ */
+class metrics_server
+{
+private:
+    std::string m_path;
+    int m_sock;
+    int m_stop_pipe[2];
+
+    std::unique_ptr<std::thread> m_thread;
+
+    void worker_thread();
+    void serve(int client) const;
+
+    metrics_server(const metrics_server&) = delete;
+    metrics_server& operator=(const metrics_server&) = delete;
+
+public:
+    /**
+     * @param path of the Unix socket, an existing socket file is replaced
+     */
+    metrics_server(const std::string& path);
+
+    virtual ~metrics_server();
+
+    static void test_metrics_server();
+};
+
+#endif // METRICS_SERVER_HPP
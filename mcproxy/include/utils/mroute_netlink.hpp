@@ -0,0 +1,138 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef MROUTE_NETLINK_HPP
+#define MROUTE_NETLINK_HPP
+
+#include "include/utils/addr_storage.hpp"
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <vector>
+#include <string>
+
+//a batch is sent as soon as it reaches this size
+#define MROUTE_NETLINK_MAX_BATCH_SIZE (32 * 1024)
+#define MROUTE_NETLINK_RECV_BUF_SIZE (16 * 1024)
+
+/**
+ * @brief A multicast forwarding cache operation that is waiting for its acknowledgement.
+ */
+struct mroute_netlink_op {
+    bool add; //RTM_NEWROUTE or RTM_DELROUTE
+    unsigned int input_if_index;
+    addr_storage saddr;
+    addr_storage gaddr;
+    std::list<int> output_vif;
+
+    std::string to_string() const;
+};
+
+/**
+ * @brief Programs the multicast forwarding cache of the Linux kernel with
+ * rtnetlink messages (RTNL_FAMILY_IPMR). Operations are collected in a batch
+ * and sent with a single sendmsg, the acknowledgements are collected without
+ * blocking. The kernel supports this only for IPv4 (Linux 4.8 and newer),
+ * MLD instances have to use the mroute socket.
+ */
+class mroute_netlink
+{
+private:
+    int m_sock;
+    int m_table;
+    uint32_t m_seq;
+    bool m_supported;
+
+    std::vector<unsigned char> m_batch;
+    std::list<std::pair<uint32_t, mroute_netlink_op>> m_batch_ops; //sequence number and operation
+
+    std::map<uint32_t, mroute_netlink_op> m_pending; //waiting for an acknowledgement
+    std::list<mroute_netlink_op> m_failed;
+
+    //sequence number of the latest operation of each route (source, group) that is queued or waiting for an acknowledgement
+    std::map<std::pair<addr_storage, addr_storage>, uint32_t> m_latest_seq;
+
+    bool queue(const mroute_netlink_op& op);
+
+    //the operation is finished, forget it as latest operation of its route
+    void finish(uint32_t seq, const mroute_netlink_op& op);
+
+    //retry the operation with the mroute socket unless a later operation of the same route was sent after it
+    void fail(uint32_t seq, mroute_netlink_op&& op);
+    void add_attr(unsigned short type, const void* data, unsigned int size);
+    void collect_acks();
+
+public:
+    /**
+     * @brief Open a rtnetlink socket for the multicast routing table table (0 is the default table).
+     */
+    mroute_netlink(int addr_family, int table);
+
+    mroute_netlink(const mroute_netlink&) = delete;
+    mroute_netlink& operator=(const mroute_netlink&) = delete;
+
+    virtual ~mroute_netlink();
+
+    /**
+     * @brief Queue a multicast route, it is sent with the next flush.
+     *        The kernel expects the input interface as interface index and
+     *        the output interfaces as virtual interface numbers.
+     * @return Return true on success.
+     */
+    bool add_mroute(unsigned int input_if_index, const addr_storage& saddr, const addr_storage& gaddr, const std::list<int>& output_vif);
+
+    /**
+     * @brief Queue the removal of a multicast route, it is sent with the next flush.
+     * @return Return true on success.
+     */
+    bool del_mroute(unsigned int input_if_index, const addr_storage& saddr, const addr_storage& gaddr);
+
+    /**
+     * @brief Send all queued operations with one sendmsg and collect the available acknowledgements.
+     * @return Return false if the batch could not be sent.
+     */
+    bool flush();
+
+    /**
+     * @brief Return and forget all operations the kernel refused, they can be retried with the mroute socket.
+     * An operation is only returned if no later operation of the same route was sent after it,
+     * so the retry can not overtake an operation the kernel already applied.
+     */
+    std::list<mroute_netlink_op> get_failed_ops();
+
+    /**
+     * @brief Return false after the kernel rejected the rtnetlink interface as a whole.
+     */
+    bool is_supported() const;
+
+    unsigned int get_pending_count() const;
+
+    bool is_batch_empty() const;
+
+    static void test_mroute_netlink();
+};
+
+#endif // MROUTE_NETLINK_HPP
@@ -29,12 +29,34 @@
 #include <linux/mroute6.h>
 
 #include <list>
+#include <map>
+#include <vector>
 
 #define MROUTE_RATE_LIMIT_ENDLESS 0
 #define MROUTE_TTL_THRESHOLD 1
 #define MROUTE_DEFAULT_TTL 1
+#define MROUTE_SENDMMSG_MAX_PACKETS 1024 //UIO_MAXIOV
 
-#define ADD_SIGNED_NUM_U16(r,a) (r)+= (a); (r)+= ((r)>>16)
+/**
+ * @brief A packet of mroute_socket::send_packets().
+ */
+struct mroute_packet {
+    unsigned int if_index; //egress interface
+    addr_storage dst;
+    const unsigned char* data;
+    unsigned int size;
+    bool sent;
+};
+
+/**
+ * @brief Packet and byte counters of one virtual interface.
+ */
+struct vif_counter {
+    unsigned long in_packets = 0;
+    unsigned long in_bytes = 0;
+    unsigned long out_packets = 0;
+    unsigned long out_bytes = 0;
+};
 
 /**
  * @brief Wrapper for a multicast socket with additional functions to manipulate Linux kernel tables.
@@ -42,6 +64,9 @@
 class mroute_socket: public mc_socket
 {
 private:
+    //the kernel ignores the sticky extension header for messages with ancillary data, send_packets() repeats it
+    mutable std::vector<unsigned char> m_ipv6_hop_by_hop;
+
     //not used
     bool create_udp_ipv4_socket() {
         return false;
@@ -124,6 +149,14 @@ public:
      */
     bool add_ipv6_extension_header(const unsigned char* buf, unsigned int buf_size) const;
 
+    /**
+     * @brief Send the packets with as few sendmmsg() calls as possible. The egress interface
+     *        of each packet is chosen with IP_PKTINFO/IPV6_PKTINFO, choose_if() is not needed.
+     *        A packet that failed is skipped and its sent flag stays false.
+     * @return Return true if all packets were sent.
+     */
+    bool send_packets(std::vector<mroute_packet>& packets) const;
+
     bool set_ipv4_receive_packets_with_router_alert_header(bool enable) const;
 
     /**
@@ -217,6 +250,13 @@ public:
      */
     bool get_vif_stats(int vif_index, struct sioc_vif_req* req_v4, struct sioc_mif_req6* req_v6) const;
 
+    /**
+     * @brief Read the counters of several virtual interfaces in one pass. A virtual interface
+     *        that is not in the kernel table (e.g. its link is down) is left out without an error.
+     * @return Return false if a counter could not be read for another reason.
+     */
+    bool get_vif_counters(const std::list<int>& vifs, std::map<int, vif_counter>& result) const;
+
     /**
      * @brief Get various statistics per multicast route.
      * @param source_addr is the defined source address of the requested multicast route
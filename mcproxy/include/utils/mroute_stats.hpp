@@ -0,0 +1,112 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef MROUTE_STATS_HPP
+#define MROUTE_STATS_HPP
+
+#include "include/utils/addr_storage.hpp"
+
+#include <map>
+#include <chrono>
+#include <string>
+#include <utility>
+
+#define MROUTE_STATS_RECV_BUF_SIZE (32 * 1024)
+//the worker thread gives up a dump that is not complete after this time
+#define MROUTE_STATS_DUMP_TIMEOUT 1000 //msec
+
+/**
+ * @brief Kernel counters of one multicast forwarding cache entry.
+ */
+struct mfc_counter {
+    unsigned long packets = 0;
+    unsigned long bytes = 0;
+    unsigned long wrong_if = 0; //packets received on another interface than the input interface
+    unsigned int iif = 0; //interface index of the input interface, 0 if unknown
+};
+
+//(group address, source address) ==> counters
+using mfc_counter_map = std::map<std::pair<addr_storage, addr_storage>, mfc_counter>;
+
+/**
+ * @brief Reads the packet counters of all multicast forwarding cache entries
+ * of one kernel table with a single rtnetlink dump (RTM_GETROUTE of
+ * RTNL_FAMILY_IPMR or RTNL_FAMILY_IP6MR).
+ */
+class mroute_stats
+{
+private:
+    int m_sock;
+    int m_addr_family;
+    int m_table;
+    uint32_t m_seq;
+
+    mfc_counter_map m_counters;
+
+    bool m_valid;
+    std::chrono::steady_clock::time_point m_last_refresh;
+
+    bool send_dump_request();
+    bool receive_dump(mfc_counter_map& result);
+
+public:
+    /**
+     * @brief Open a rtnetlink socket for the multicast routing table table (0 is the default table).
+     */
+    mroute_stats(int addr_family, int table);
+
+    mroute_stats(const mroute_stats&) = delete;
+    mroute_stats& operator=(const mroute_stats&) = delete;
+
+    virtual ~mroute_stats();
+
+    /**
+     * @brief Dump the counters of all multicast routes of the table.
+     * @return Return true on success, on failure the last snapshot is invalidated.
+     */
+    bool refresh();
+
+    /**
+     * @brief Refresh only if the snapshot is older than max_age.
+     */
+    bool refresh_if_older_than(const std::chrono::milliseconds& max_age);
+
+    /**
+     * @brief Return false if no valid snapshot is available. A route that
+     *        is not in the kernel table has a packet count of 0.
+     */
+    bool get_packet_count(const addr_storage& gaddr, const addr_storage& saddr, unsigned long& packet_count) const;
+
+    /**
+     * @brief All counters of the last snapshot, empty if it is invalid.
+     */
+    const mfc_counter_map& get_counters() const;
+
+    unsigned int size() const;
+
+    std::string to_string() const;
+    friend std::ostream& operator<<(std::ostream& stream, const mroute_stats& m);
+
+    static void test_mroute_stats();
+};
+
+#endif // MROUTE_STATS_HPP
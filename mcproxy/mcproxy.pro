@@ -10,14 +10,61 @@ tester {
     DEFINES += TESTER
 
     SOURCES += src/tester/config_map.cpp \
-           src/tester/tester.cpp
+           src/tester/tester.cpp \
+           src/tester/host_population.cpp \
+           src/tester/flow_traffic.cpp
 
     HEADERS += include/tester/config_map.hpp \
-           include/tester/tester.hpp
+           include/tester/tester.hpp \
+           include/tester/host_population.hpp \
+           include/tester/flow_traffic.hpp
 
     LIBS += -L/usr/lib -lboost_regex
 }
 
+bench {
+    CONFIG-=mcproxy #removes default mode
+    message("target bench")
+    TARGET = bench
+    DEFINES += BENCH
+
+    SOURCES += src/bench/bench.cpp
+
+    HEADERS += include/bench/bench.hpp
+}
+
+sim {
+    CONFIG-=mcproxy #removes default mode
+    message("target sim")
+    TARGET = sim
+    DEFINES += SIM
+
+    SOURCES += src/sim/simulation.cpp \
+           src/sim/sim_network.cpp \
+           src/sim/sim_sender.cpp \
+           src/sim/sim_receiver.cpp \
+           src/sim/sim_mroute_socket.cpp \
+           src/sim/sim_if_prop.cpp \
+           src/sim/sim_mroute_stats.cpp \
+           src/sim/sim_proxy_instance_io.cpp
+
+    HEADERS += include/sim/simulation.hpp \
+           include/sim/sim_network.hpp \
+           include/sim/sim_sender.hpp \
+           include/sim/sim_receiver.hpp
+}
+
+decoder {
+    CONFIG-=mcproxy #removes default mode
+    message("target flight_decoder")
+    TARGET = flight_decoder
+    DEFINES += DECODER
+
+    SOURCES += src/decoder/flight_decoder.cpp
+
+    HEADERS += include/decoder/flight_decoder.hpp
+}
+
 mcproxy { #default mode
     message("target mcproxy")
     TARGET = mcproxy
@@ -55,6 +102,14 @@ SOURCES += src/main.cpp \
            src/utils/mroute_socket.cpp \
            src/utils/if_prop.cpp \
            src/utils/reverse_path_filter.cpp \
+           src/utils/mem_arena.cpp \
+           src/utils/mroute_netlink.cpp \
+           src/utils/mroute_stats.cpp \
+           src/utils/if_monitor.cpp \
+           src/utils/mc_socket_pool.cpp \
+           src/utils/metrics.cpp \
+           src/utils/metrics_server.cpp \
+           src/utils/flight_recorder.cpp \
                #proxy
            src/proxy/proxy.cpp \
            src/proxy/sender.cpp \
@@ -64,6 +119,7 @@ SOURCES += src/main.cpp \
            src/proxy/mld_sender.cpp \
            src/proxy/igmp_sender.cpp \
            src/proxy/proxy_instance.cpp \
+           src/proxy/proxy_instance_io.cpp \
            src/proxy/routing.cpp \
            src/proxy/worker.cpp \
            src/proxy/timing.cpp \
@@ -76,26 +132,45 @@ SOURCES += src/main.cpp \
            src/proxy/def.cpp \
            src/proxy/simple_mc_proxy_routing.cpp \
            src/proxy/simple_routing_data.cpp \
+           src/proxy/filter_decision_cache.cpp \
+           src/proxy/kernel_io.cpp \
+           src/proxy/membership_reporter.cpp \
+           src/proxy/stats_collector.cpp \
+           src/proxy/state_snapshot.cpp \
+           src/proxy/state_server.cpp \
+           src/proxy/group_tracer.cpp \
                #parser
            src/parser/scanner.cpp \
            src/parser/token.cpp \
            src/parser/configuration.cpp \
            src/parser/parser.cpp \
-           src/parser/interface.cpp
+           src/parser/interface.cpp \
+           src/parser/compiled_table.cpp
 
 HEADERS += include/hamcast_logging.h \
                 #utils
            include/utils/mc_socket.hpp \
            include/utils/addr_storage.hpp \
            include/utils/reverse_path_filter.hpp \
+           include/utils/mem_arena.hpp \
            include/utils/mroute_socket.hpp \
+           include/utils/mroute_netlink.hpp \
+           include/utils/mroute_stats.hpp \
+           include/utils/if_monitor.hpp \
+           include/utils/mc_socket_pool.hpp \
+           include/utils/metrics.hpp \
+           include/utils/metrics_server.hpp \
+           include/utils/flight_recorder.hpp \
            include/utils/if_prop.hpp \
            include/utils/extended_mld_defines.hpp \
            include/utils/extended_igmp_defines.hpp \
                #proxy
            include/proxy/proxy.hpp \
            include/proxy/sender.hpp \
+           include/proxy/protocol_traits.hpp \
+           include/proxy/proto_sender.hpp \
            include/proxy/receiver.hpp \
+           include/proxy/proto_receiver.hpp \
            include/proxy/mld_receiver.hpp \
            include/proxy/igmp_receiver.hpp \
            include/proxy/mld_sender.hpp \
@@ -106,6 +181,7 @@ HEADERS += include/hamcast_logging.h \
            include/proxy/routing.hpp \
            include/proxy/worker.hpp \
            include/proxy/timing.hpp \
+           include/proxy/timing_clock.hpp \
            include/proxy/check_if.hpp \
            include/proxy/check_kernel.hpp \
            include/proxy/membership_db.hpp \
@@ -116,12 +192,27 @@ HEADERS += include/hamcast_logging.h \
            include/proxy/routing_management.hpp \
            include/proxy/simple_mc_proxy_routing.hpp \
            include/proxy/simple_routing_data.hpp \
+           include/proxy/filter_decision_cache.hpp \
+           include/proxy/kernel_io.hpp \
+           include/proxy/membership_reporter.hpp \
+           include/proxy/stats_collector.hpp \
+           include/proxy/state_snapshot.hpp \
+           include/proxy/state_server.hpp \
+           include/proxy/group_tracer.hpp \
                #parser
            include/parser/scanner.hpp \
            include/parser/token.hpp \
            include/parser/configuration.hpp \
            include/parser/parser.hpp \
-           include/parser/interface.hpp
+           include/parser/interface.hpp \
+           include/parser/compiled_table.hpp
+
+sim { #the simulated kernel replaces these
+    SOURCES -= src/utils/mroute_socket.cpp \
+           src/utils/if_prop.cpp \
+           src/utils/mroute_stats.cpp \
+           src/proxy/proxy_instance_io.cpp
+}
 
 LIBS += -L/usr/lib -lpthread 
 
@@ -0,0 +1,620 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/bench/bench.hpp"
+#include "include/utils/addr_storage.hpp"
+#include "include/utils/mroute_socket.hpp"
+#include "include/utils/extended_igmp_defines.hpp"
+#include "include/proxy/def.hpp"
+#include "include/proxy/message_format.hpp"
+#include "include/proxy/message_queue.hpp"
+#include "include/proxy/worker.hpp"
+#include "include/proxy/timing.hpp"
+#include "include/proxy/timers_values.hpp"
+#include "include/proxy/interfaces.hpp"
+#include "include/proxy/igmp_sender.hpp"
+#include "include/proxy/igmp_receiver.hpp"
+#include "include/proxy/kernel_io.hpp"
+#include "include/proxy/querier.hpp"
+#include "include/proxy/proxy_instance.hpp"
+#include "include/parser/interface.hpp"
+#include "include/parser/compiled_table.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <climits>
+#include <cstring>
+
+#include <unistd.h> //for getopt
+#include <netinet/ip.h>
+#include <arpa/inet.h>
+
+//keeps the compiler from optimising the measured operations away
+static volatile unsigned long bench_sink;
+
+//the timer messages of the benchmarked queriers and timings end up here
+class bench_worker : public worker
+{
+public:
+    bench_worker(): worker(UINT_MAX) {
+        HC_LOG_TRACE("");
+        start();
+    }
+
+    ~bench_worker() {
+        HC_LOG_TRACE("");
+        add_msg(std::make_shared<exit_cmd>());
+    }
+
+private:
+    void worker_thread() override {
+        HC_LOG_TRACE("");
+        while (m_running) {
+            if (m_job_queue.dequeue()->get_type() == proxy_msg::EXIT_MSG) {
+                stop();
+            }
+        }
+    }
+};
+
+//IPv4 address number i of the subnet base
+static addr_storage get_addr(uint32_t base, unsigned long i)
+{
+    in_addr a;
+    a.s_addr = htonl(base + static_cast<uint32_t>(i));
+    return addr_storage(a);
+}
+
+//IPv6 address number i of the /96 subnet prefix
+static addr_storage get_addr6(const std::string& prefix, unsigned long i)
+{
+    in6_addr a = addr_storage(prefix).get_in6_addr();
+    uint32_t low = htonl(static_cast<uint32_t>(i));
+    memcpy(&a.s6_addr[12], &low, sizeof(low));
+    return addr_storage(a);
+}
+
+static source_list<source> get_source_list(uint32_t base, unsigned long first, unsigned long count)
+{
+    source_list<source> slist;
+    for (unsigned long i = first; i < first + count; ++i) {
+        slist.insert(source(get_addr(base, i)));
+    }
+    return slist;
+}
+
+bench::bench(int arg_count, char* args[])
+    : m_min_time(BENCH_DEFAULT_MIN_TIME)
+    , m_runs(BENCH_DEFAULT_RUNS)
+    , m_if_name(BENCH_DEFAULT_INTERFACE)
+    , m_list_only(false)
+{
+    HC_LOG_TRACE("");
+
+    hc_set_default_log_fun(HC_LOG_FATAL_LVL);
+
+    int c;
+    while ((c = getopt(arg_count, args, "ht:r:b:i:l")) != -1) {
+        switch (c) {
+        case 'h':
+            help();
+            return;
+        case 't':
+            m_min_time = std::chrono::milliseconds(std::max(1, atoi(optarg)));
+            break;
+        case 'r':
+            m_runs = std::max(1, atoi(optarg));
+            break;
+        case 'b':
+            m_filter = optarg;
+            break;
+        case 'i':
+            m_if_name = optarg;
+            break;
+        case 'l':
+            m_list_only = true;
+            break;
+        default:
+            std::cerr << "Unknown argument! See help (-h) for more information." << std::endl;
+            return;
+        }
+    }
+
+    if (optind < arg_count) {
+        std::cerr << "Unknown option argument: " << args[optind] << std::endl;
+        return;
+    }
+
+    add_source_list_cases();
+    add_addr_storage_cases();
+    add_querier_cases();
+    add_timing_cases();
+    add_message_queue_cases();
+    add_rule_matching_cases();
+    add_report_parsing_cases();
+
+    if (m_list_only) {
+        for (auto & e : m_cases) {
+            std::cout << e.name << "," << e.parameter << std::endl;
+        }
+        return;
+    }
+
+    std::cout << "benchmark,parameter,iterations,runs,ns_per_op_median,ns_per_op_min,ns_per_op_max" << std::endl;
+    for (auto & e : m_cases) {
+        run(e);
+    }
+}
+
+void bench::help()
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+
+    cout << "Mcproxy microbenchmarks" << endl;
+
+    cout << "Project page: http://mcproxy.realmv6.org/" << endl;
+    cout << endl;
+    cout << "Usage:" << endl;
+    cout << "  bench [-h] [-l] [-t <msec>] [-r <runs>] [-b <filter>] [-i <interface>]" << endl;
+    cout << endl;
+    cout << "\t-h" << endl;
+    cout << "\t\tDisplay this help screen." << endl;
+
+    cout << "\t-l" << endl;
+    cout << "\t\tList the benchmarks without running them." << endl;
+
+    cout << "\t-t" << endl;
+    cout << "\t\tMinimum duration of one run in milliseconds (default " << BENCH_DEFAULT_MIN_TIME << ")." << endl;
+
+    cout << "\t-r" << endl;
+    cout << "\t\tNumber of measured runs of each benchmark (default " << BENCH_DEFAULT_RUNS << ")." << endl;
+
+    cout << "\t-b" << endl;
+    cout << "\t\tRun only the benchmarks whose name contains the filter." << endl;
+
+    cout << "\t-i" << endl;
+    cout << "\t\tInterface of the queriers and the report parser (default " << BENCH_DEFAULT_INTERFACE << ")," << endl;
+    cout << "\t\tthese benchmarks need root privileges and are skipped otherwise." << endl;
+
+    cout << endl;
+    cout << "\tThe results are printed as CSV, the times are nanoseconds per operation." << endl;
+}
+
+void bench::add(const std::string& name, const std::string& parameter, bench_fun fun)
+{
+    HC_LOG_TRACE("");
+
+    if (m_filter.empty() || name.find(m_filter) != std::string::npos) {
+        m_cases.push_back(bench_case {name, parameter, fun});
+    }
+}
+
+void bench::run(const bench_case& bc)
+{
+    HC_LOG_TRACE("");
+
+    try {
+        //calibrate the number of operations of one run
+        unsigned long iterations = 1;
+        std::chrono::nanoseconds elapsed = bc.fun(iterations);
+        while (elapsed < m_min_time) {
+            double factor = elapsed.count() > 0 ? 1.2 * std::chrono::duration_cast<std::chrono::nanoseconds>(m_min_time).count() / elapsed.count() : 100.0;
+            iterations = static_cast<unsigned long>(iterations * std::min(100.0, std::max(2.0, factor)));
+            elapsed = bc.fun(iterations);
+        }
+
+        std::vector<double> ns_per_op;
+        for (unsigned int i = 0; i < m_runs; ++i) {
+            ns_per_op.push_back(static_cast<double>(bc.fun(iterations).count()) / iterations);
+        }
+        std::sort(ns_per_op.begin(), ns_per_op.end());
+
+        std::cout << bc.name << "," << bc.parameter << "," << iterations << "," << m_runs << std::fixed << std::setprecision(1)
+                  << "," << ns_per_op[ns_per_op.size() / 2] << "," << ns_per_op.front() << "," << ns_per_op.back() << std::endl;
+        std::cout.unsetf(std::ios_base::floatfield);
+    } catch (const char* e) {
+        std::cerr << "skipped " << bc.name << " (" << bc.parameter << "): " << e << std::endl;
+    } catch (const std::string& e) {
+        std::cerr << "skipped " << bc.name << " (" << bc.parameter << "): " << e << std::endl;
+    }
+}
+
+void bench::add_source_list_cases()
+{
+    HC_LOG_TRACE("");
+    using namespace std::chrono;
+
+    for (unsigned long n : {10, 100, 1000}) {
+        //the second list overlaps the first one by half
+        auto a = std::make_shared<source_list<source>>(get_source_list(0x0a000000, 0, n));
+        auto b = std::make_shared<source_list<source>>(get_source_list(0x0a000000, n / 2, n));
+        std::string parameter = "n=" + std::to_string(n);
+
+        add("source_list_union", parameter, [a, b](unsigned long iterations) {
+            auto start = steady_clock::now();
+            for (unsigned long i = 0; i < iterations; ++i) {
+                bench_sink = (*a + *b).size();
+            }
+            return duration_cast<nanoseconds>(steady_clock::now() - start);
+        });
+
+        add("source_list_intersection", parameter, [a, b](unsigned long iterations) {
+            auto start = steady_clock::now();
+            for (unsigned long i = 0; i < iterations; ++i) {
+                bench_sink = (*a * *b).size();
+            }
+            return duration_cast<nanoseconds>(steady_clock::now() - start);
+        });
+
+        add("source_list_difference", parameter, [a, b](unsigned long iterations) {
+            auto start = steady_clock::now();
+            for (unsigned long i = 0; i < iterations; ++i) {
+                bench_sink = (*a - *b).size();
+            }
+            return duration_cast<nanoseconds>(steady_clock::now() - start);
+        });
+
+        //the copy is part of the measurement
+        add("source_list_union_assign", parameter, [a, b](unsigned long iterations) {
+            auto start = steady_clock::now();
+            for (unsigned long i = 0; i < iterations; ++i) {
+                source_list<source> c = *a;
+                c += *b;
+                bench_sink = c.size();
+            }
+            return duration_cast<nanoseconds>(steady_clock::now() - start);
+        });
+    }
+}
+
+void bench::add_addr_storage_cases()
+{
+    HC_LOG_TRACE("");
+    using namespace std::chrono;
+
+    const unsigned int count = 1024;
+    auto v4 = std::make_shared<std::vector<addr_storage>>();
+    auto v6 = std::make_shared<std::vector<addr_storage>>();
+    auto v4_strings = std::make_shared<std::vector<std::string>>();
+    auto v4_raw = std::make_shared<std::vector<in_addr>>();
+
+    std::mt19937 rand(1);
+    for (unsigned int i = 0; i < count; ++i) {
+        in_addr a;
+        a.s_addr = rand();
+        v4->push_back(addr_storage(a));
+        v4_raw->push_back(a);
+        v4_strings->push_back(v4->back().to_string());
+
+        in6_addr a6;
+        for (auto & e : a6.s6_addr) {
+            e = rand() % 4; //long common prefixes
+        }
+        v6->push_back(addr_storage(a6));
+    }
+
+    add("addr_storage_construct_string", "ipv4", [v4_strings, count](unsigned long iterations) {
+        auto start = steady_clock::now();
+        for (unsigned long i = 0; i < iterations; ++i) {
+            bench_sink = addr_storage((*v4_strings)[i % count]).get_addr_family();
+        }
+        return duration_cast<nanoseconds>(steady_clock::now() - start);
+    });
+
+    add("addr_storage_construct_in_addr", "ipv4", [v4_raw, count](unsigned long iterations) {
+        auto start = steady_clock::now();
+        for (unsigned long i = 0; i < iterations; ++i) {
+            bench_sink = addr_storage((*v4_raw)[i % count]).get_addr_family();
+        }
+        return duration_cast<nanoseconds>(steady_clock::now() - start);
+    });
+
+    for (auto & e : {std::make_pair(std::string("ipv4"), v4), std::make_pair(std::string("ipv6"), v6)}) {
+        auto v = e.second;
+
+        add("addr_storage_less", e.first, [v, count](unsigned long iterations) {
+            auto start = steady_clock::now();
+            for (unsigned long i = 0; i < iterations; ++i) {
+                bench_sink = (*v)[i % count] < (*v)[(i + 1) % count];
+            }
+            return duration_cast<nanoseconds>(steady_clock::now() - start);
+        });
+
+        add("addr_storage_equal", e.first, [v, count](unsigned long iterations) {
+            auto start = steady_clock::now();
+            for (unsigned long i = 0; i < iterations; ++i) {
+                bench_sink = (*v)[i % count] == (*v)[(i + 1) % count];
+            }
+            return duration_cast<nanoseconds>(steady_clock::now() - start);
+        });
+    }
+}
+
+void bench::add_querier_cases()
+{
+    HC_LOG_TRACE("");
+    using namespace std::chrono;
+
+    std::string if_name = m_if_name;
+    for (auto mode : {INCLUDE_MODE, EXCLUDE_MODE}) {
+        for (auto record_type : {MODE_IS_INCLUDE, MODE_IS_EXCLUDE, CHANGE_TO_INCLUDE_MODE, CHANGE_TO_EXCLUDE_MODE, ALLOW_NEW_SOURCES, BLOCK_OLD_SOURCES}) {
+            add("querier_receive_record", get_mc_filter_name(mode) + ":" + get_mcast_addr_record_type_name(record_type), [if_name, mode, record_type](unsigned long iterations) {
+                unsigned int if_index = interfaces::get_if_index(if_name);
+                if (if_index == 0) {
+                    throw "interface not found";
+                }
+
+                //the timing and the kernel io post to the worker, it has to outlive them
+                bench_worker w;
+                auto ifs = std::make_shared<interfaces>(AF_INET, false);
+                if (!ifs->add_interface(if_index)) {
+                    throw "failed to add the interface";
+                }
+                //the sender keeps a reference to this pointer
+                const std::shared_ptr<const interfaces> const_ifs = ifs;
+                auto shared_timing = std::make_shared<timing>();
+                auto s = std::make_shared<igmp_sender>(const_ifs);
+                auto kio = std::make_shared<kernel_io>(s, nullptr, &w);
+                querier q(&w, IGMPv3, if_index, s, kio, shared_timing, timers_values(), [](unsigned int, const addr_storage&) {}, "bench", nullptr);
+
+                //each operation uses its own group, prepared in the filter mode under test: INCLUDE {A, B} or EXCLUDE {} {A}
+                const source_list<source> prepare_slist = get_source_list(0x0a000000, 0, mode == INCLUDE_MODE ? 2 : 1);
+                const source_list<source> slist = get_source_list(0x0a000000, 1, 2);
+
+                nanoseconds elapsed(0);
+                for (unsigned long i = 0; i < iterations; ++i) {
+                    addr_storage gaddr = get_addr(0xef000001, i);
+
+                    source_list<source> tmp_prepare = prepare_slist;
+                    q.receive_record(std::make_shared<group_record_msg>(if_index, mode == INCLUDE_MODE ? ALLOW_NEW_SOURCES : MODE_IS_EXCLUDE, gaddr, std::move(tmp_prepare), IGMPv3));
+                    kio->commit();
+
+                    source_list<source> tmp = slist;
+                    auto msg = std::make_shared<group_record_msg>(if_index, record_type, gaddr, std::move(tmp), IGMPv3);
+
+                    auto start = steady_clock::now();
+                    q.receive_record(msg);
+                    elapsed += duration_cast<nanoseconds>(steady_clock::now() - start);
+
+                    kio->commit();
+                }
+
+                shared_timing->stop_all_time(&w);
+                return elapsed;
+            });
+        }
+    }
+}
+
+void bench::add_timing_cases()
+{
+    HC_LOG_TRACE("");
+    using namespace std::chrono;
+
+    add("timing_add_time", "", [](unsigned long iterations) {
+        bench_worker w;
+        timing t;
+        auto msg = std::make_shared<test_msg>(0, proxy_msg::SYSTEMIC);
+
+        auto start = steady_clock::now();
+        for (unsigned long i = 0; i < iterations; ++i) {
+            t.add_time(hours(1), &w, msg);
+        }
+        auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+
+        t.stop_all_time(&w);
+        return elapsed;
+    });
+}
+
+void bench::add_message_queue_cases()
+{
+    HC_LOG_TRACE("");
+    using namespace std::chrono;
+
+    for (unsigned int producers : {1, 2, 4, 8}) {
+        add("message_queue_enqueue_dequeue", "producers=" + std::to_string(producers), [producers](unsigned long iterations) {
+            message_queue<std::shared_ptr<proxy_msg>, comp_proxy_msg> q;
+            auto msg = std::make_shared<test_msg>(0, proxy_msg::LOSEABLE);
+            std::atomic<bool> go(false);
+
+            std::vector<std::thread> threads;
+            for (unsigned int p = 0; p < producers; ++p) {
+                unsigned long n = iterations / producers + (p == 0 ? iterations % producers : 0);
+                threads.push_back(std::thread([&q, &go, msg, n]() {
+                    while (!go.load()) {}
+                    for (unsigned long i = 0; i < n; ++i) {
+                        q.enqueue(msg);
+                    }
+                }));
+            }
+
+            //one consumer, like the worker thread of a proxy instance
+            auto start = steady_clock::now();
+            go.store(true);
+            for (unsigned long i = 0; i < iterations; ++i) {
+                q.dequeue();
+            }
+            auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+
+            for (auto & t : threads) {
+                t.join();
+            }
+            return elapsed;
+        });
+    }
+}
+
+void bench::add_rule_matching_cases()
+{
+    HC_LOG_TRACE("");
+    using namespace std::chrono;
+
+    std::string if_name = m_if_name;
+    for (int addr_family : {AF_INET, AF_INET6}) {
+        for (unsigned int rules : {10, 100, 1000, 100000}) {
+            auto group_addr = [addr_family](unsigned long i) {
+                return addr_family == AF_INET ? get_addr(0xef000000, i) : get_addr6("ff0e::", i);
+            };
+            auto source_addr = [addr_family](unsigned long i) {
+                return addr_family == AF_INET ? get_addr(0x0a000000, i) : get_addr6("2001:db8::", i);
+            };
+
+            //group ranges of 64 addresses, every fourth rule is restricted to a single source and is matched linear
+            std::list<std::unique_ptr<rule_box>> rb_list;
+            for (unsigned int i = 0; i < rules; ++i) {
+                std::unique_ptr<addr_match> group(new addr_range(group_addr(i * 128), group_addr(i * 128 + 63)));
+                std::unique_ptr<addr_match> source(i % 4 == 3 ? new single_addr(source_addr(i)) : new single_addr(addr_storage(addr_family)));
+                rb_list.push_back(std::unique_ptr<rule_box>(new rule_addr("", std::move(group), std::move(source))));
+            }
+            auto t = std::make_shared<table>("bench", std::move(rb_list));
+            auto ct = std::make_shared<compiled_table>(*t);
+
+            //half of the lookups match
+            const unsigned int count = 1024;
+            auto lookups = std::make_shared<std::vector<std::pair<addr_storage, addr_storage>>>();
+            std::mt19937 rand(1);
+            for (unsigned int i = 0; i < count; ++i) {
+                unsigned int rule = rand() % rules;
+                lookups->push_back(std::make_pair(group_addr(rule * 128 + rand() % 128), source_addr(rule)));
+            }
+
+            std::string parameter = std::string(addr_family == AF_INET ? "ipv4" : "ipv6") + ":rules=" + std::to_string(rules);
+
+            add("rule_match_table", parameter, [t, lookups, count, if_name](unsigned long iterations) {
+                auto start = steady_clock::now();
+                for (unsigned long i = 0; i < iterations; ++i) {
+                    auto& e = (*lookups)[i % count];
+                    bench_sink = t->match(if_name, e.first, e.second);
+                }
+                return duration_cast<nanoseconds>(steady_clock::now() - start);
+            });
+
+            add("rule_match_compiled_table", parameter, [ct, lookups, count, if_name](unsigned long iterations) {
+                unsigned int if_index = interfaces::get_if_index(if_name);
+                auto start = steady_clock::now();
+                for (unsigned long i = 0; i < iterations; ++i) {
+                    auto& e = (*lookups)[i % count];
+                    bench_sink = ct->match(if_index, e.first, e.second);
+                }
+                return duration_cast<nanoseconds>(steady_clock::now() - start);
+            });
+        }
+    }
+}
+
+void bench::add_report_parsing_cases()
+{
+    HC_LOG_TRACE("");
+    using namespace std::chrono;
+
+    std::string if_name = m_if_name;
+    for (auto size : {std::make_pair(1, 0), std::make_pair(8, 4), std::make_pair(64, 16)}) {
+        unsigned int records = size.first;
+        unsigned int sources = size.second;
+
+        add("igmpv3_report_parsing", "records=" + std::to_string(records) + ":sources=" + std::to_string(sources), [if_name, records, sources](unsigned long iterations) {
+            unsigned int if_index = interfaces::get_if_index(if_name);
+            if (if_index == 0) {
+                throw "interface not found";
+            }
+
+            auto ifs = std::make_shared<interfaces>(AF_INET, false);
+            if (!ifs->refresh_network_interfaces()) {
+                throw "failed to refresh the network interfaces";
+            }
+
+            addr_storage saddr = ifs->get_saddr(if_name);
+            if (saddr.get_addr_family() != AF_INET) {
+                throw "interface without IPv4 address";
+            }
+
+            //the parsed records are passed to the job queue of this proxy instance, it has no downstreams and drops them
+            proxy_instance pr_i(IGMPv3, "bench", BENCH_TABLE_NUMBER, MRB_SETSOCKOPT, URM_KERNEL, ifs, std::make_shared<timing>(), FILTER_DECISION_CACHE_DEFAULT_SIZE, 0);
+
+            auto mrt_sock = std::make_shared<mroute_socket>();
+            if (!mrt_sock->create_raw_ipv4_socket()) {
+                throw "failed to create a raw socket";
+            }
+            igmp_receiver r(&pr_i, mrt_sock, ifs, true);
+            r.registrate_interface(if_index);
+
+            //ip header with router alert option, report, records
+            std::vector<unsigned char> buf(r.get_iov_min_size(), 0);
+            struct ip* ip_hdr = reinterpret_cast<struct ip*>(buf.data());
+            unsigned int ip_hdr_size = sizeof(struct ip) + sizeof(router_alert_option);
+            unsigned int packet_size = ip_hdr_size + sizeof(igmpv3_mc_report) + records * (sizeof(igmpv3_mc_record) + sources * sizeof(in_addr));
+            if (packet_size > buf.size()) {
+                throw "report is too large";
+            }
+
+            ip_hdr->ip_v = 4;
+            ip_hdr->ip_hl = ip_hdr_size / 4;
+            ip_hdr->ip_len = htons(packet_size);
+            ip_hdr->ip_p = IPPROTO_IGMP;
+            ip_hdr->ip_src = saddr.get_in_addr();
+
+            igmpv3_mc_report* report = reinterpret_cast<igmpv3_mc_report*>(buf.data() + ip_hdr_size);
+            report->type = IGMP_V3_MEMBERSHIP_REPORT;
+            report->num_of_mc_records = htons(records);
+
+            unsigned char* pos = buf.data() + ip_hdr_size + sizeof(igmpv3_mc_report);
+            for (unsigned int i = 0; i < records; ++i) {
+                igmpv3_mc_record* rec = reinterpret_cast<igmpv3_mc_record*>(pos);
+                rec->type = sources > 0 ? ALLOW_NEW_SOURCES : CHANGE_TO_EXCLUDE_MODE;
+                rec->num_of_srcs = htons(sources);
+                rec->gaddr = get_addr(0xef000001, i).get_in_addr();
+                pos += sizeof(igmpv3_mc_record);
+                for (unsigned int j = 0; j < sources; ++j) {
+                    *reinterpret_cast<in_addr*>(pos) = get_addr(0x0a000000, j).get_in_addr();
+                    pos += sizeof(in_addr);
+                }
+            }
+
+            struct iovec iov;
+            iov.iov_base = buf.data();
+            iov.iov_len = buf.size();
+
+            struct msghdr msg;
+            msg.msg_name = nullptr;
+            msg.msg_namelen = 0;
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = nullptr;
+            msg.msg_controllen = 0;
+            msg.msg_flags = 0;
+
+            auto start = steady_clock::now();
+            for (unsigned long i = 0; i < iterations; ++i) {
+                r.analyse_packet(&msg, packet_size);
+            }
+            return duration_cast<nanoseconds>(steady_clock::now() - start);
+        });
+    }
+}
@@ -0,0 +1,251 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/decoder/flight_decoder.hpp"
+#include "include/proxy/def.hpp"
+#include "include/proxy/message_format.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include <unistd.h> //for getopt
+#include <string.h>
+#include <time.h>
+
+flight_decoder::flight_decoder(int arg_count, char* args[])
+    : m_tid_filter(-1)
+{
+    HC_LOG_TRACE("");
+
+    hc_set_default_log_fun(HC_LOG_FATAL_LVL);
+
+    int c;
+    while ((c = getopt(arg_count, args, "hg:t:")) != -1) {
+        switch (c) {
+        case 'h':
+            help();
+            return;
+        case 'g':
+            m_group_filter = addr_storage(std::string(optarg)).to_string();
+            break;
+        case 't':
+            m_tid_filter = atol(optarg);
+            break;
+        default:
+            std::cerr << "Unknown argument! See help (-h) for more information." << std::endl;
+            return;
+        }
+    }
+
+    if (optind + 1 != arg_count) {
+        std::cerr << "Expected one dump file! See help (-h) for more information." << std::endl;
+        return;
+    }
+    m_path = args[optind];
+
+    read_file();
+    print();
+}
+
+void flight_decoder::help()
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+
+    cout << "Mcproxy flight recorder decoder" << endl;
+
+    cout << "Project page: http://mcproxy.realmv6.org/" << endl;
+    cout << endl;
+    cout << "Usage:" << endl;
+    cout << "  flight_decoder [-h] [-g <group>] [-t <thread id>] <dump file>" << endl;
+    cout << endl;
+    cout << "\t-h" << endl;
+    cout << "\t\tDisplay this help screen." << endl;
+
+    cout << "\t-g" << endl;
+    cout << "\t\tPrint only the events of this group address." << endl;
+
+    cout << "\t-t" << endl;
+    cout << "\t\tPrint only the events of this thread." << endl;
+}
+
+void flight_decoder::read_file()
+{
+    HC_LOG_TRACE("");
+
+    std::ifstream file(m_path, std::ios::binary);
+    if (!file) {
+        throw "failed to open the dump file";
+    }
+
+    if (!file.read(reinterpret_cast<char*>(&m_header), sizeof(m_header)) || memcmp(m_header.magic, FLIGHT_RECORDER_MAGIC, sizeof(m_header.magic)) != 0) {
+        throw "not a flight recorder dump";
+    }
+
+    if (m_header.version != FLIGHT_RECORDER_VERSION || m_header.event_size != sizeof(fr_event)) {
+        throw "unsupported version of the flight recorder dump";
+    }
+
+    //the header sizes the buffers, a corrupted or crafted one must not exhaust the memory
+    uint32_t ring_size = m_header.ring_size;
+    if (ring_size == 0 || (ring_size & (ring_size - 1)) != 0 || ring_size > FLIGHT_DECODER_MAX_RING_SIZE) {
+        throw "invalid ring size in the flight recorder dump";
+    }
+
+    if (m_header.ring_count > FLIGHT_RECORDER_MAX_THREADS) {
+        throw "invalid ring count in the flight recorder dump";
+    }
+
+    //the addresses of the ring headers must not change while the events refer to them
+    m_threads.resize(m_header.ring_count);
+    std::vector<fr_event> ring(m_header.ring_size);
+    for (auto & t : m_threads) {
+        if (!file.read(reinterpret_cast<char*>(&t), sizeof(t)) || !file.read(reinterpret_cast<char*>(ring.data()), ring.size() * sizeof(fr_event))) {
+            throw "truncated flight recorder dump";
+        }
+
+        if (m_tid_filter >= 0 && t.tid != m_tid_filter) {
+            continue;
+        }
+
+        //oldest event first
+        uint64_t count = std::min<uint64_t>(t.head, m_header.ring_size);
+        for (uint64_t i = t.head - count; i < t.head; ++i) {
+            const fr_event& e = ring[i % m_header.ring_size];
+            if (!m_group_filter.empty() && (e.addr_family == 0 || get_addr(e.addr_family, e.gaddr).to_string() != m_group_filter)) {
+                continue;
+            }
+            m_events.push_back(thread_event{&t, e});
+        }
+    }
+
+    std::stable_sort(m_events.begin(), m_events.end(), [](const thread_event & l, const thread_event & r) {
+        return l.event.time < r.event.time;
+    });
+}
+
+void flight_decoder::print() const
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+
+    cout << "flight recorder of pid " << m_header.pid << " dumped at " << get_time(m_header.time);
+    if (m_header.signal != 0) {
+        cout << " on " << strsignal(m_header.signal);
+    }
+    cout << ", " << m_threads.size() << " threads, " << m_events.size() << " events" << endl;
+
+    for (auto & t : m_threads) {
+        cout << "thread " << t.tid << " (" << string(t.thread_name, strnlen(t.thread_name, sizeof(t.thread_name))) << "): " << t.head << " events";
+        if (t.head > m_header.ring_size) {
+            cout << ", the oldest " << t.head - m_header.ring_size << " overwritten";
+        }
+        cout << endl;
+    }
+    cout << endl;
+
+    for (auto & e : m_events) {
+        cout << get_time(e.event.time) << " " << e.thread->tid << " " << get_description(e.event) << endl;
+    }
+}
+
+std::string flight_decoder::get_time(uint64_t time)
+{
+    time_t seconds = time / 1000000;
+    tm t;
+    localtime_r(&seconds, &t);
+
+    char buf[32];
+    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &t);
+
+    std::ostringstream s;
+    s << buf << "." << std::setw(6) << std::setfill('0') << time % 1000000;
+    return s.str();
+}
+
+addr_storage flight_decoder::get_addr(uint8_t addr_family, const uint8_t* addr)
+{
+    if (addr_family == AF_INET) {
+        in_addr a;
+        memcpy(&a, addr, sizeof(a));
+        return addr_storage(a);
+    } else if (addr_family == AF_INET6) {
+        in6_addr a;
+        memcpy(&a, addr, sizeof(a));
+        return addr_storage(a);
+    } else {
+        return addr_storage();
+    }
+}
+
+std::string flight_decoder::get_description(const fr_event& e)
+{
+    std::ostringstream s;
+    fr_event_type type = static_cast<fr_event_type>(e.type);
+    s << get_fr_event_type_name(type);
+
+    std::string gaddr = e.addr_family != 0 ? get_addr(e.addr_family, e.gaddr).to_string() : "-";
+    addr_storage saddr = get_addr(e.addr_family, e.saddr);
+
+    switch (type) {
+    case FR_RECORD_RECEIVED:
+        s << " if:" << e.if_index << " " << gaddr << " " << get_mcast_addr_record_type_name(static_cast<mcast_addr_record_type>(e.arg)) << " sources:" << e.arg2;
+        break;
+    case FR_TIMER_FIRED:
+        s << " if:" << e.if_index << " " << gaddr;
+        if (e.arg == proxy_msg::NEW_SOURCE_TIMER_MSG) {
+            s << " source:" << saddr;
+        }
+        s << " " << proxy_msg::get_message_type_name(static_cast<proxy_msg::message_type>(e.arg));
+        break;
+    case FR_QUERY_SENT:
+        //the group address of a general query is unspecified
+        s << " if:" << e.if_index << " " << (std::all_of(std::begin(e.gaddr), std::end(e.gaddr), [](uint8_t b) {
+            return b == 0;
+        }) ? "general" : gaddr) << " sources:" << e.arg;
+        if (e.arg2 & 1) {
+            s << " s-flag";
+        }
+        if (!(e.arg2 & 2)) {
+            s << " not sent";
+        }
+        break;
+    case FR_ROUTE_ADDED:
+        s << " if:" << e.if_index << " (" << saddr << "," << gaddr << ") outputs:" << e.arg << (e.arg2 != 0 ? "" : " failed");
+        break;
+    case FR_ROUTE_DELETED:
+        s << " if:" << e.if_index << " (" << saddr << "," << gaddr << ")" << (e.arg2 != 0 ? "" : " failed");
+        break;
+    case FR_QUEUE_OVERFLOW:
+        s << " size:" << e.arg;
+        break;
+    default:
+        s << " type:" << static_cast<int>(e.type);
+        break;
+    }
+
+    return s.str();
+}
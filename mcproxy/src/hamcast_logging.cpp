@@ -22,19 +22,37 @@
 #include <fstream>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <cstdint>
+#include <cstring>
 #include <chrono>
 #include <atomic>
+#include <memory>
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <iostream>
 //#include <boost/thread.hpp>
 //#include <boost/date_time.hpp>
 
 #include "include/hamcast_logging.h"
 
-#ifdef DEBUG_MODE
+#define HC_ASYNC_LOG_MSG_SIZE 216 //record size is 256 byte
+#define HC_ASYNC_LOG_RING_SIZE 1024 //records per thread, power of two
+#define HC_ASYNC_LOG_WRITE_INTERVAL 20 //msec
+
+extern "C" {
+int hc_log_lvl = HC_LOG_ERROR_LVL;
+}
 
 namespace
 {
+#ifdef DEBUG_MODE
 std::atomic<hc_log_fun_t> m_log_fun(nullptr);
+#else
+void log_stderr_fun(int lvl, const char* fun_name, const char* line);
+std::atomic<hc_log_fun_t> m_log_fun(log_stderr_fun);
+#endif
 
 std::mutex m_next_id_mtx;
 std::uint32_t m_next_id = 0;
@@ -45,6 +63,45 @@ std::uint32_t next_session_id()
     return m_next_id++;
 }
 
+const char* lvl_name(int lvl)
+{
+    switch (lvl) {
+    case HC_LOG_TRACE_LVL:
+        return "TRACE";
+    case HC_LOG_DEBUG_LVL:
+        return "DEBUG";
+    case HC_LOG_INFO_LVL:
+        return "INFO";
+    case HC_LOG_WARN_LVL:
+        return "WARN";
+    case HC_LOG_ERROR_LVL:
+        return "ERROR";
+    case HC_LOG_FATAL_LVL:
+        return "FATAL";
+    default:
+        return "";
+    }
+}
+
+std::uint64_t time_stamp_now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void format_line(std::ostream& os, std::uint64_t time_stamp, int lvl, const char* fun, const char* what)
+{
+    os.width(28);
+    os << std::left << time_stamp;
+    os.width(7);
+    os << std::left << lvl_name(lvl);
+    os.width(80);
+    os << std::left << fun;
+    os.width(0);
+    os << " " << what; //long function names are not cut
+    os << "\n";
+}
+
+#ifdef DEBUG_MODE
 class logger
 {
     bool m_enabled;
@@ -72,40 +129,9 @@ public:
         //using boost::get_system_time;
         //using boost::posix_time::to_iso_extended_string;
         //std::string time_stamp = to_iso_extended_string(get_system_time());
-       
-        unsigned long long time_stamp = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
         std::ostringstream os;
-        os.width(28);
-        os << std::left << time_stamp;
-        os.width(7);
-        os << std::left;
-        switch (lvl) {
-        case HC_LOG_TRACE_LVL:
-            os << "TRACE";
-            break;
-        case HC_LOG_DEBUG_LVL:
-            os << "DEBUG";
-            break;
-        case HC_LOG_INFO_LVL:
-            os << "INFO";
-            break;
-        case HC_LOG_WARN_LVL:
-            os << "WARN";
-            break;
-        case HC_LOG_ERROR_LVL:
-            os << "ERROR";
-            break;
-        case HC_LOG_FATAL_LVL:
-            os << "FATAL";
-            break;
-        default:
-            break;
-        }
-        os.width(80);
-        os << std::left << fun;
-        os.width(0);
-        os << what;
-        os << "\n";
+        format_line(os, time_stamp_now(), lvl, fun, what);
         std::string oss = os.str();
         m_stream << oss;
         m_stream.flush();
@@ -123,40 +149,212 @@ void log_all_fun(int lvl, const char* fun_name, const char* line)
 {
     m_logger.log(lvl, fun_name, line);
 }
-
-void log_debug_fun(int lvl, const char* fun_name, const char* line)
+#else
+void log_stderr_fun(int lvl, const char* fun_name, const char* line)
 {
-    if (lvl >= HC_LOG_DEBUG_LVL) {
-        log_all_fun(lvl, fun_name, line);
-    }
+    std::cerr << lvl_name(lvl) << ": " << fun_name << ": " << line << std::endl;
 }
+#endif
+
+//fixed-size binary log event, the function name is a string literal and identifies the call site
+struct log_record {
+    std::uint64_t time_stamp;
+    const char* fun;
+    std::int32_t lvl;
+    std::uint32_t thread_id;
+    std::uint32_t size;
+    std::uint32_t truncated;
+    char msg[HC_ASYNC_LOG_MSG_SIZE];
+};
 
-void log_info_fun(int lvl, const char* fun_name, const char* line)
+//single producer (the owning thread), single consumer (the writer thread)
+struct log_ring {
+    log_ring()
+        : id(next_session_id())
+        , head(0)
+        , tail(0)
+        , dropped(0)
+        , closed(false) {}
+
+    const std::uint32_t id;
+    std::atomic<std::uint32_t> head; //next record to write, only changed by the producer
+    std::atomic<std::uint32_t> tail; //next record to read, only changed by the consumer
+    std::atomic<std::uint32_t> dropped;
+    std::atomic<bool> closed; //owning thread has terminated
+    log_record records[HC_ASYNC_LOG_RING_SIZE];
+};
+
+class async_logger
 {
-    if (lvl >= HC_LOG_INFO_LVL) {
-        log_all_fun(lvl, fun_name, line);
+    std::mutex m_rings_lock;
+    std::list<std::shared_ptr<log_ring>> m_rings;
+
+    std::ostream* m_out;
+    std::ofstream m_file;
+
+    bool m_running;
+    std::mutex m_running_lock;
+    std::condition_variable m_running_con_var;
+    std::thread m_thread;
+
+    std::vector<log_record> m_batch;
+
+    void drain() {
+        std::vector<std::shared_ptr<log_ring>> rings;
+        {
+            std::lock_guard<std::mutex> lock(m_rings_lock);
+            rings.assign(std::begin(m_rings), std::end(m_rings));
+        }
+
+        m_batch.clear();
+        for (auto & r : rings) {
+            bool closed = r->closed.load(std::memory_order_acquire);
+            std::uint32_t head = r->head.load(std::memory_order_acquire);
+            std::uint32_t tail = r->tail.load(std::memory_order_relaxed);
+            for (; tail != head; ++tail) {
+                m_batch.push_back(r->records[tail % HC_ASYNC_LOG_RING_SIZE]);
+            }
+            r->tail.store(tail, std::memory_order_release);
+
+            std::uint32_t dropped = r->dropped.exchange(0, std::memory_order_relaxed);
+            if (dropped > 0) {
+                std::ostringstream os;
+                os << dropped << " log events dropped, ring buffer full";
+                m_batch.push_back(log_record());
+                log_record& rec = m_batch.back();
+                rec.time_stamp = time_stamp_now();
+                rec.fun = "async_logger";
+                rec.lvl = HC_LOG_WARN_LVL;
+                rec.thread_id = r->id;
+                rec.size = std::min(os.str().size(), sizeof(rec.msg));
+                rec.truncated = 0;
+                memcpy(rec.msg, os.str().data(), rec.size);
+            }
+
+            if (closed && head == tail) {
+                std::lock_guard<std::mutex> lock(m_rings_lock);
+                m_rings.remove(r);
+            }
+        }
+
+        std::stable_sort(std::begin(m_batch), std::end(m_batch), [](const log_record & a, const log_record & b) {
+            return a.time_stamp < b.time_stamp;
+        });
+
+        for (auto & rec : m_batch) {
+            std::string what(rec.msg, rec.size);
+            if (rec.truncated > 0) {
+                what += "...";
+            }
+            std::ostringstream fun;
+            fun << "[" << rec.thread_id << "] " << rec.fun;
+            format_line(*m_out, rec.time_stamp, rec.lvl, fun.str().c_str(), what.c_str());
+        }
+
+        if (!m_batch.empty()) {
+            m_out->flush();
+        }
     }
-}
 
-void log_warn_fun(int lvl, const char* fun_name, const char* line)
-{
-    if (lvl >= HC_LOG_INFO_LVL) {
-        log_all_fun(lvl, fun_name, line);
+    void writer_thread() {
+        std::unique_lock<std::mutex> lock(m_running_lock);
+        while (m_running) {
+            m_running_con_var.wait_for(lock, std::chrono::milliseconds(HC_ASYNC_LOG_WRITE_INTERVAL), [this]() {
+                return !m_running;
+            });
+            lock.unlock();
+            drain();
+            lock.lock();
+        }
     }
-}
 
-void log_error_fun(int lvl, const char* fun_name, const char* line)
-{
-    if (lvl >= HC_LOG_ERROR_LVL) {
-        log_all_fun(lvl, fun_name, line);
+public:
+    async_logger(const char* file_name)
+        : m_out(&std::cerr)
+        , m_running(true) {
+        if (file_name != nullptr) {
+            m_file.open(file_name, std::ofstream::out | std::ofstream::app);
+            if (!m_file.is_open()) {
+                throw "failed to open log file";
+            }
+            m_out = &m_file;
+        }
+        m_thread = std::thread(&async_logger::writer_thread, this);
     }
-}
 
-void log_fatal_fun(int lvl, const char* fun_name, const char* line)
+    ~async_logger() {
+        {
+            std::lock_guard<std::mutex> lock(m_running_lock);
+            m_running = false;
+        }
+        m_running_con_var.notify_all();
+        m_thread.join();
+        drain();
+    }
+
+    std::shared_ptr<log_ring> add_ring() {
+        auto r = std::make_shared<log_ring>();
+        std::lock_guard<std::mutex> lock(m_rings_lock);
+        m_rings.push_back(r);
+        return r;
+    }
+};
+
+//guards the lifetime of the async logger against hc_stop_async_log()
+std::mutex m_async_logger_lock;
+std::shared_ptr<async_logger> m_async_logger;
+std::atomic<std::uint32_t> m_async_generation(0);
+
+//log function to restore by hc_stop_async_log()
+hc_log_fun_t m_sync_log_fun = nullptr;
+
+//ring buffer of the calling thread, registered at its first log event
+struct thread_ring {
+    std::shared_ptr<log_ring> ring;
+    std::uint32_t generation = 0;
+
+    ~thread_ring() {
+        if (ring != nullptr) {
+            ring->closed.store(true, std::memory_order_release);
+        }
+    }
+};
+
+thread_local thread_ring m_thread_ring;
+
+void log_async_fun(int lvl, const char* fun_name, const char* line)
 {
-    if (lvl >= HC_LOG_FATAL_LVL) {
-        log_all_fun(lvl, fun_name, line);
+    std::uint32_t generation = m_async_generation.load(std::memory_order_acquire);
+    if (m_thread_ring.ring == nullptr || m_thread_ring.generation != generation) {
+        std::lock_guard<std::mutex> lock(m_async_logger_lock);
+        if (m_async_logger == nullptr) {
+            return;
+        }
+        if (m_thread_ring.ring != nullptr) {
+            m_thread_ring.ring->closed.store(true, std::memory_order_release);
+        }
+        m_thread_ring.ring = m_async_logger->add_ring();
+        m_thread_ring.generation = generation;
     }
+
+    log_ring& r = *m_thread_ring.ring;
+    std::uint32_t head = r.head.load(std::memory_order_relaxed);
+    if (head - r.tail.load(std::memory_order_acquire) >= HC_ASYNC_LOG_RING_SIZE) {
+        r.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    log_record& rec = r.records[head % HC_ASYNC_LOG_RING_SIZE];
+    std::size_t size = strlen(line);
+    rec.time_stamp = time_stamp_now();
+    rec.fun = fun_name;
+    rec.lvl = lvl;
+    rec.thread_id = r.id;
+    rec.size = std::min(size, sizeof(rec.msg));
+    rec.truncated = size - rec.size;
+    memcpy(rec.msg, line, rec.size);
+
+    r.head.store(head + 1, std::memory_order_release);
 }
 
 } // namespace <anonymous>
@@ -173,66 +371,73 @@ extern "C" void hc_set_log_fun(hc_log_fun_t function_ptr)
 
 extern "C" void hc_log(int loglvl, const char* func_name, const char* msg)
 {
-    if (m_log_fun) {
-        m_log_fun(loglvl, func_name, msg);
+    if (!HC_LOG_ENABLED(loglvl)) {
+        return;
     }
-}
 
-extern "C" void hc_set_default_log_fun(int log_lvl)
-{
-    switch (log_lvl) {
-    case HC_LOG_DEBUG_LVL:
-        hc_set_log_fun(log_debug_fun);
-        break;
-    case HC_LOG_INFO_LVL:
-        hc_set_log_fun(log_info_fun);
-        break;
-    case HC_LOG_WARN_LVL:
-        hc_set_log_fun(log_warn_fun);
-        break;
-    case HC_LOG_ERROR_LVL:
-        hc_set_log_fun(log_error_fun);
-        break;
-    case HC_LOG_FATAL_LVL:
-        hc_set_log_fun(log_fatal_fun);
-        break;
-    default:
-        hc_set_log_fun(log_all_fun);
+    hc_log_fun_t fun = m_log_fun;
+    if (fun) {
+        fun(loglvl, func_name, msg);
     }
 }
 
-extern "C" int hc_logging_enabled()
+extern "C" void hc_set_log_lvl(int log_lvl)
 {
-    return 1;
+    __atomic_store_n(&hc_log_lvl, log_lvl, __ATOMIC_RELAXED);
 }
 
-#else // ifndef DEBUG_MODE
-
-namespace
+extern "C" int hc_get_log_lvl()
 {
-void log_nothing(int, const char*, const char*) { }
+    return __atomic_load_n(&hc_log_lvl, __ATOMIC_RELAXED);
 }
 
-extern "C" hc_log_fun_t hc_get_log_fun()
+extern "C" void hc_set_default_log_fun(int log_lvl)
 {
-    return log_nothing;
+    hc_set_log_lvl(log_lvl);
+#ifdef DEBUG_MODE
+    hc_set_log_fun(log_all_fun);
+#else
+    hc_set_log_fun(log_stderr_fun);
+#endif
 }
 
-extern "C" void hc_set_log_fun(hc_log_fun_t)
+extern "C" int hc_start_async_log(int log_lvl, const char* file_name)
 {
-}
+    std::lock_guard<std::mutex> lock(m_async_logger_lock);
+    if (m_async_logger == nullptr) {
+        try {
+            m_async_logger = std::make_shared<async_logger>(file_name);
+        } catch (const char* e) {
+            std::cerr << "ERROR: " << e << std::endl;
+            return 0;
+        }
+        m_async_generation++;
+        m_sync_log_fun = m_log_fun;
+    }
 
-extern "C" void hc_log(int, const char*, const char*)
-{
+    hc_set_log_lvl(log_lvl);
+    hc_set_log_fun(log_async_fun);
+    return 1;
 }
 
-extern "C" void hc_set_default_log_fun(int)
+extern "C" void hc_stop_async_log()
 {
+    std::shared_ptr<async_logger> l;
+    {
+        std::lock_guard<std::mutex> lock(m_async_logger_lock);
+        if (m_async_logger == nullptr) {
+            return;
+        }
+        hc_set_log_fun(m_sync_log_fun);
+        l.swap(m_async_logger);
+        m_async_generation++;
+    }
+
+    //joins the writer thread and writes the remaining records
+    l.reset();
 }
 
 extern "C" int hc_logging_enabled()
 {
-    return 0;
+    return 1;
 }
-
-#endif // ifndef DEBUG_MODE
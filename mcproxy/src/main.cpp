@@ -23,7 +23,15 @@
 #include "include/utils/if_prop.hpp"
 #include "include/utils/mc_socket.hpp"
 #include "include/utils/mroute_socket.hpp"
+#include "include/utils/mroute_netlink.hpp"
+#include "include/utils/mroute_stats.hpp"
+#include "include/utils/if_monitor.hpp"
+#include "include/utils/mc_socket_pool.hpp"
+#include "include/utils/metrics.hpp"
+#include "include/utils/metrics_server.hpp"
+#include "include/utils/flight_recorder.hpp"
 #include "include/utils/addr_storage.hpp"
+#include "include/utils/mem_arena.hpp"
 #include "include/proxy/proxy.hpp"
 #include "include/proxy/timing.hpp"
 #include "include/proxy/check_if.hpp"
@@ -34,9 +42,19 @@
 #include "include/proxy/proxy_instance.hpp"
 #include "include/proxy/simple_mc_proxy_routing.hpp"
 #include "include/proxy/simple_routing_data.hpp"
+#include "include/proxy/filter_decision_cache.hpp"
 #include "include/proxy/igmp_sender.hpp"
+#include "include/proxy/kernel_io.hpp"
+#include "include/proxy/membership_reporter.hpp"
+#include "include/proxy/stats_collector.hpp"
+#include "include/proxy/state_snapshot.hpp"
+#include "include/proxy/group_tracer.hpp"
 #include "include/parser/configuration.hpp"
+#include "include/parser/compiled_table.hpp"
 #include "include/tester/tester.hpp"
+#include "include/bench/bench.hpp"
+#include "include/sim/simulation.hpp"
+#include "include/decoder/flight_decoder.hpp"
 
 #include <iostream>
 #include <unistd.h>
@@ -52,6 +70,24 @@ int main(int arg_count, char* args[])
     } catch (const char* e) {
         std::cout << e << std::endl;
     }
+#elif defined(BENCH)
+    try {
+        bench b(arg_count, args);
+    } catch (const char* e) {
+        std::cout << e << std::endl;
+    }
+#elif defined(SIM)
+    try {
+        simulation s(arg_count, args);
+    } catch (const char* e) {
+        std::cout << e << std::endl;
+    }
+#elif defined(DECODER)
+    try {
+        flight_decoder d(arg_count, args);
+    } catch (const char* e) {
+        std::cout << e << std::endl;
+    }
 #else
     try {
         proxy p(arg_count, args);
@@ -59,6 +95,9 @@ int main(int arg_count, char* args[])
         std::cout << e << std::endl;
     }
 
+    //write the pending log records
+    hc_stop_async_log();
+
     //test_test();
 #endif
 
@@ -76,6 +115,15 @@ void test_log()
     HC_LOG_WARN("HC_LOG_WARN");
     HC_LOG_ERROR("HC_LOG_ERROR");
     HC_LOG_FATAL("HC_LOG_FATAL");
+
+    hc_start_async_log(HC_LOG_DEBUG_LVL, "async.log");
+    HC_LOG_DEBUG("async HC_LOG_DEBUG");
+    HC_LOG_INFO("async HC_LOG_INFO");
+    hc_set_log_lvl(HC_LOG_WARN_LVL);
+    HC_LOG_INFO("async HC_LOG_INFO (must not be logged)");
+    HC_LOG_WARN("async HC_LOG_WARN");
+    HC_LOG_ERROR("async HC_LOG_ERROR");
+    hc_stop_async_log();
 }
 
 void test_test()
@@ -85,15 +133,30 @@ void test_test()
     //addr_storage::test_addr_storage_a();
     //addr_storage::test_addr_storage_b();
     //membership_db::test_arithmetic();
+    //mem_arena::test_mem_arena();
     //timers_values::test_timers_values();
     //timers_values::test_timers_values_copy();
     //timing::test_timing();
     //worker::test_worker();
     //proxy_instance::test_querier("lo");
     //simple_routing_data::test_simple_routing_data();
+    //filter_decision_cache::test_filter_decision_cache();
     //igmp_sender::test_igmp_sender();
+    //kernel_io::test_kernel_io();
+    //membership_reporter::test_membership_reporter();
+    //stats_collector::test_stats_collector();
+    //state_publisher::test_state_publisher();
+    //group_tracer::test_group_tracer();
     //mroute_socket::quick_test();
+    //mroute_netlink::test_mroute_netlink();
+    //mroute_stats::test_mroute_stats();
+    //if_monitor::test_if_monitor();
+    //mc_socket_pool::test_mc_socket_pool();
+    //metrics::test_metrics();
+    //metrics_server::test_metrics_server();
+    //flight_recorder::test_flight_recorder();
     //configuration::test_configuration();
+    //compiled_table::test_compiled_table();
     //if_prop::test_if_prop();
 }
 #endif /* DEBUG_MODE */
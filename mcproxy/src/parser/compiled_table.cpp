@@ -0,0 +1,527 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/parser/compiled_table.hpp"
+#include "include/parser/interface.hpp"
+#include "include/proxy/interfaces.hpp"
+#include "include/utils/if_monitor.hpp"
+
+#include <netinet/in.h>
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+
+//-----------------------------------------------------
+addr_key::addr_key()
+    : m_high(0)
+    , m_low(0)
+{
+}
+
+addr_key::addr_key(uint64_t high, uint64_t low)
+    : m_high(high)
+    , m_low(low)
+{
+}
+
+addr_key::addr_key(const addr_storage& addr)
+    : m_high(0)
+    , m_low(0)
+{
+    if (addr.get_addr_family() == AF_INET) {
+        m_low = ntohl(addr.get_in_addr().s_addr);
+    } else if (addr.get_addr_family() == AF_INET6) {
+        const uint8_t* a = addr.get_in6_addr().s6_addr;
+        for (unsigned int i = 0; i < 8; ++i) {
+            m_high = (m_high << 8) | a[i];
+            m_low = (m_low << 8) | a[i + 8];
+        }
+    }
+}
+
+addr_key addr_key::min_key()
+{
+    return addr_key(0, 0);
+}
+
+addr_key addr_key::max_key(int addr_family)
+{
+    if (addr_family == AF_INET) {
+        return addr_key(0, 0xffffffff);
+    } else {
+        return addr_key(static_cast<uint64_t>(-1), static_cast<uint64_t>(-1));
+    }
+}
+
+addr_key& addr_key::operator++()
+{
+    if (++m_low == 0) {
+        ++m_high;
+    }
+    return *this;
+}
+
+addr_key& addr_key::operator--()
+{
+    if (m_low-- == 0) {
+        --m_high;
+    }
+    return *this;
+}
+
+addr_storage addr_key::to_addr_storage(int addr_family) const
+{
+    if (addr_family == AF_INET) {
+        in_addr a;
+        a.s_addr = htonl(static_cast<uint32_t>(m_low));
+        return addr_storage(a);
+    } else {
+        in6_addr a;
+        for (unsigned int i = 0; i < 8; ++i) {
+            a.s6_addr[i] = static_cast<uint8_t>(m_high >> (56 - 8 * i));
+            a.s6_addr[i + 8] = static_cast<uint8_t>(m_low >> (56 - 8 * i));
+        }
+        return addr_storage(a);
+    }
+}
+
+std::string addr_key::to_string(int addr_family) const
+{
+    return to_addr_storage(addr_family).to_string();
+}
+
+bool operator<(const addr_key& k1, const addr_key& k2)
+{
+    return k1.m_high < k2.m_high || (k1.m_high == k2.m_high && k1.m_low < k2.m_low);
+}
+
+bool operator==(const addr_key& k1, const addr_key& k2)
+{
+    return k1.m_high == k2.m_high && k1.m_low == k2.m_low;
+}
+
+bool operator<=(const addr_key& k1, const addr_key& k2)
+{
+    return !(k2 < k1);
+}
+//-----------------------------------------------------
+key_interval::key_interval(const addr_key& from, const addr_key& to)
+    : m_from(from)
+    , m_to(to)
+{
+}
+
+bool operator==(const key_interval& i1, const key_interval& i2)
+{
+    return i1.m_from == i2.m_from && i1.m_to == i2.m_to;
+}
+//-----------------------------------------------------
+compiled_table::compiled_table(const table& t)
+    : m_rule_count(0)
+    , m_resolution(nullptr)
+{
+    HC_LOG_TRACE("");
+
+    std::list<const rule_addr*> tmp_rule_list;
+    if (!t.collect_rules(tmp_rule_list)) {
+        HC_LOG_WARN("table " << t.get_name() << " contains unresolved table references, they will never match");
+    }
+
+    for (auto r : tmp_rule_list) {
+        if (!r->get_if_name().empty()) {
+            m_if_names.push_back(r->get_if_name());
+        }
+    }
+    std::sort(m_if_names.begin(), m_if_names.end());
+    m_if_names.erase(std::unique(m_if_names.begin(), m_if_names.end()), m_if_names.end());
+
+    rule_list rules;
+    for (auto r : tmp_rule_list) {
+        unsigned int if_id = 0;
+        if (!r->get_if_name().empty()) {
+            if_id = std::lower_bound(m_if_names.begin(), m_if_names.end(), r->get_if_name()) - m_if_names.begin() + 1;
+        }
+        rules.push_back(std::make_pair(if_id, r));
+    }
+    m_rule_count = rules.size();
+
+    compile(rules, AF_INET, m_ipv4_buckets);
+    compile(rules, AF_INET6, m_ipv6_buckets);
+}
+
+void compiled_table::compile(const rule_list& rules, int addr_family, std::vector<if_bucket>& buckets)
+{
+    HC_LOG_TRACE("");
+
+    std::vector<flat_rule> flat_rules;
+    for (auto & e : rules) {
+        flat_rule fr;
+        fr.m_if_id = e.first;
+        if (get_interval(e.second->get_group(), addr_family, fr.m_group) && get_interval(e.second->get_source(), addr_family, fr.m_source)) {
+            flat_rules.push_back(fr);
+        }
+    }
+
+    std::stable_sort(flat_rules.begin(), flat_rules.end(), [](const flat_rule & r1, const flat_rule & r2) {
+        return r1.m_if_id < r2.m_if_id;
+    });
+
+    //one bucket per interface, the wildcard interface (0) comes first
+    for (auto it = flat_rules.begin(); it != flat_rules.end();) {
+        auto end_it = std::find_if(it, flat_rules.end(), [&](const flat_rule & r) {
+            return r.m_if_id != it->m_if_id;
+        });
+
+        buckets.push_back(compile_bucket(it->m_if_id, std::vector<flat_rule>(it, end_it), addr_family));
+        it = end_it;
+    }
+}
+
+compiled_table::if_bucket compiled_table::compile_bucket(unsigned int if_id, const std::vector<flat_rule>& rules, int addr_family) const
+{
+    HC_LOG_TRACE("");
+    const key_interval all_addrs(addr_key::min_key(), addr_key::max_key(addr_family));
+
+    if_bucket result;
+    result.m_if_id = if_id;
+
+    std::vector<flat_rule> restricted_rules;
+    for (auto & r : rules) {
+        if (r.m_source == all_addrs) {
+            result.m_any_source_groups.push_back(r.m_group);
+        } else {
+            restricted_rules.push_back(r);
+        }
+    }
+    merge_intervals(result.m_any_source_groups);
+
+    if (restricted_rules.empty()) {
+        return result;
+    }
+
+    //split the group address space into elementary segments, inside of a segment the set of covering rules is constant
+    std::vector<addr_key> points;
+    for (auto & r : restricted_rules) {
+        points.push_back(r.m_group.m_from);
+        if (!(r.m_group.m_to == all_addrs.m_to)) {
+            addr_key tmp = r.m_group.m_to;
+            points.push_back(++tmp);
+        }
+    }
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+
+    std::sort(restricted_rules.begin(), restricted_rules.end(), [](const flat_rule & r1, const flat_rule & r2) {
+        return r1.m_group.m_from < r2.m_group.m_from;
+    });
+
+    std::vector<const flat_rule*> active_rules;
+    auto next_rule = restricted_rules.begin();
+    for (unsigned int i = 0; i < points.size(); ++i) {
+        key_interval segment(points[i], all_addrs.m_to);
+        if (i + 1 < points.size()) {
+            segment.m_to = points[i + 1];
+            --segment.m_to;
+        }
+
+        while (next_rule != restricted_rules.end() && next_rule->m_group.m_from <= segment.m_from) {
+            active_rules.push_back(&(*next_rule));
+            ++next_rule;
+        }
+
+        active_rules.erase(std::remove_if(active_rules.begin(), active_rules.end(), [&](const flat_rule * r) {
+            return r->m_group.m_to < segment.m_from;
+        }), active_rules.end());
+
+        if (active_rules.empty()) {
+            continue;
+        }
+
+        std::vector<key_interval> sources;
+        for (auto r : active_rules) {
+            sources.push_back(r->m_source);
+        }
+        merge_intervals(sources);
+
+        if (!result.m_segments.empty()) {
+            group_segment& last = result.m_segments.back();
+            addr_key tmp = last.m_group.m_to;
+            if (++tmp == segment.m_from && last.m_sources == sources) {
+                last.m_group.m_to = segment.m_to;
+                continue;
+            }
+        }
+
+        group_segment gs;
+        gs.m_group = segment;
+        gs.m_sources = std::move(sources);
+        result.m_segments.push_back(std::move(gs));
+    }
+
+    return result;
+}
+
+bool compiled_table::get_interval(const addr_match& am, int addr_family, key_interval& interval)
+{
+    addr_storage from;
+    addr_storage to;
+    am.get_bounds(from, to);
+
+    if (am.is_wildcard(from, addr_family)) {
+        interval.m_from = addr_key::min_key();
+    } else if (from.get_addr_family() == addr_family) {
+        interval.m_from = addr_key(from);
+    } else {
+        return false;
+    }
+
+    if (am.is_wildcard(to, addr_family)) {
+        interval.m_to = addr_key::max_key(addr_family);
+    } else if (to.get_addr_family() == addr_family) {
+        interval.m_to = addr_key(to);
+    } else {
+        return false;
+    }
+
+    return interval.m_from <= interval.m_to;
+}
+
+void compiled_table::merge_intervals(std::vector<key_interval>& intervals)
+{
+    if (intervals.empty()) {
+        return;
+    }
+
+    std::sort(intervals.begin(), intervals.end(), [](const key_interval & i1, const key_interval & i2) {
+        return i1.m_from < i2.m_from;
+    });
+
+    unsigned int last = 0;
+    for (unsigned int i = 1; i < intervals.size(); ++i) {
+        addr_key tmp = intervals[last].m_to;
+        if (intervals[i].m_from <= intervals[last].m_to || ++tmp == intervals[i].m_from) {
+            if (intervals[last].m_to < intervals[i].m_to) {
+                intervals[last].m_to = intervals[i].m_to;
+            }
+        } else {
+            intervals[++last] = intervals[i];
+        }
+    }
+    intervals.resize(last + 1);
+}
+
+bool compiled_table::contains(const std::vector<key_interval>& intervals, const addr_key& key)
+{
+    auto it = std::upper_bound(intervals.begin(), intervals.end(), key, [](const addr_key & k, const key_interval & i) {
+        return k < i.m_from;
+    });
+
+    if (it == intervals.begin()) {
+        return false;
+    }
+
+    --it;
+    return key <= it->m_to;
+}
+
+bool compiled_table::match_bucket(const if_bucket& bucket, const addr_key& gkey, const addr_key& skey, bool source_valid)
+{
+    if (contains(bucket.m_any_source_groups, gkey)) {
+        return true;
+    }
+
+    if (!source_valid || bucket.m_segments.empty()) {
+        return false;
+    }
+
+    auto it = std::upper_bound(bucket.m_segments.begin(), bucket.m_segments.end(), gkey, [](const addr_key & k, const group_segment & gs) {
+        return k < gs.m_group.m_from;
+    });
+
+    if (it == bucket.m_segments.begin()) {
+        return false;
+    }
+
+    --it;
+    return gkey <= it->m_group.m_to && contains(it->m_sources, skey);
+}
+
+std::shared_ptr<const compiled_table::if_resolution> compiled_table::resolve() const
+{
+    HC_LOG_TRACE("");
+
+    //read the generation first, a link change during the mapping is mapped again by the next call
+    unsigned int generation = if_monitor::get_link_generation();
+    auto result = std::atomic_load(&m_resolution);
+    if (result != nullptr && result->m_generation == generation) {
+        return result;
+    }
+
+    auto resolution = std::make_shared<if_resolution>();
+    resolution->m_generation = generation;
+    for (unsigned int i = 0; i < m_if_names.size(); ++i) {
+        unsigned int if_index = interfaces::get_if_index(m_if_names[i]);
+        if (if_index != 0) {
+            resolution->m_if_ids.push_back(std::make_pair(if_index, i + 1));
+        } else {
+            HC_LOG_DEBUG("interface " << m_if_names[i] << " not found, its rules match nothing until it exists");
+        }
+    }
+    std::sort(resolution->m_if_ids.begin(), resolution->m_if_ids.end());
+
+    result = resolution;
+    std::atomic_store(&m_resolution, result);
+    return result;
+}
+
+unsigned int compiled_table::get_if_id(unsigned int if_index) const
+{
+    HC_LOG_TRACE("");
+
+    if (m_if_names.empty()) {
+        return 0;
+    }
+
+    auto resolution = resolve();
+    auto& if_ids = resolution->m_if_ids;
+    auto it = std::lower_bound(if_ids.begin(), if_ids.end(), std::make_pair(if_index, 0u));
+    if (it != if_ids.end() && it->first == if_index) {
+        return it->second;
+    } else {
+        return 0;
+    }
+}
+
+bool compiled_table::match(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr) const
+{
+    HC_LOG_TRACE("");
+
+    const std::vector<if_bucket>* buckets;
+    if (gaddr.get_addr_family() == AF_INET) {
+        buckets = &m_ipv4_buckets;
+    } else if (gaddr.get_addr_family() == AF_INET6) {
+        buckets = &m_ipv6_buckets;
+    } else {
+        HC_LOG_ERROR("wrong address family");
+        return false;
+    }
+
+    if (buckets->empty()) {
+        return false;
+    }
+
+    addr_key gkey(gaddr);
+    addr_key skey(saddr);
+    bool source_valid = saddr.get_addr_family() == gaddr.get_addr_family();
+
+    if (buckets->front().m_if_id == 0 && match_bucket(buckets->front(), gkey, skey, source_valid)) {
+        return true;
+    }
+
+    if (if_index == 0) {
+        return false;
+    }
+
+    unsigned int if_id = get_if_id(if_index);
+    if (if_id == 0) {
+        return false;
+    }
+
+    auto it = std::lower_bound(buckets->begin(), buckets->end(), if_id, [](const if_bucket & b, unsigned int id) {
+        return b.m_if_id < id;
+    });
+
+    return it != buckets->end() && it->m_if_id == if_id && match_bucket(*it, gkey, skey, source_valid);
+}
+
+unsigned int compiled_table::get_rule_count() const
+{
+    HC_LOG_TRACE("");
+    return m_rule_count;
+}
+
+std::string compiled_table::to_string(const std::vector<if_bucket>& buckets, int addr_family) const
+{
+    std::ostringstream s;
+    for (auto & b : buckets) {
+        s << (b.m_if_id == 0 ? std::string("*") : m_if_names[b.m_if_id - 1]) << ":" << std::endl;
+
+        for (auto & g : b.m_any_source_groups) {
+            s << "\t" << g.m_from.to_string(addr_family) << " - " << g.m_to.to_string(addr_family) << " | *" << std::endl;
+        }
+
+        for (auto & gs : b.m_segments) {
+            s << "\t" << gs.m_group.m_from.to_string(addr_family) << " - " << gs.m_group.m_to.to_string(addr_family) << " |";
+            for (auto & src : gs.m_sources) {
+                s << " " << src.m_from.to_string(addr_family) << " - " << src.m_to.to_string(addr_family);
+            }
+            s << std::endl;
+        }
+    }
+    return s.str();
+}
+
+std::string compiled_table::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+    s << "compiled from " << m_rule_count << " rules" << std::endl;
+    s << "-- IPv4 --" << std::endl << to_string(m_ipv4_buckets, AF_INET);
+    s << "-- IPv6 --" << std::endl << to_string(m_ipv6_buckets, AF_INET6);
+    return s.str();
+}
+
+#ifdef DEBUG_MODE
+void compiled_table::test_compiled_table()
+{
+    using namespace std;
+    cout << "##-- test compiled table --##" << endl;
+
+    std::list<std::unique_ptr<rule_box>> rb_list;
+    rb_list.push_back(std::unique_ptr<rule_box>(new rule_addr("", std::unique_ptr<addr_match>(new addr_range(addr_storage("239.1.0.0"), addr_storage("239.1.255.255"))), std::unique_ptr<addr_match>(new single_addr(addr_storage(AF_INET))))));
+    rb_list.push_back(std::unique_ptr<rule_box>(new rule_addr("lo", std::unique_ptr<addr_match>(new single_addr(addr_storage("239.2.0.1"))), std::unique_ptr<addr_match>(new addr_range(addr_storage("10.0.0.0"), addr_storage("10.0.0.255"))))));
+    rb_list.push_back(std::unique_ptr<rule_box>(new rule_addr("", std::unique_ptr<addr_match>(new addr_range(addr_storage("239.2.0.0"), addr_storage("239.2.0.10"))), std::unique_ptr<addr_match>(new single_addr(addr_storage("10.0.1.1"))))));
+    rb_list.push_back(std::unique_ptr<rule_box>(new rule_addr("", std::unique_ptr<addr_match>(new addr_range(addr_storage("ff05::"), addr_storage(AF_INET6))), std::unique_ptr<addr_match>(new single_addr(addr_storage(AF_INET6))))));
+    table t("test", std::move(rb_list));
+    compiled_table ct(t);
+    cout << t.to_string() << endl;
+    cout << ct.to_string() << endl;
+
+    auto check = [&](const std::string & if_name, const std::string & gaddr, const std::string & saddr) {
+        unsigned int if_index = if_name.empty() ? 0 : interfaces::get_if_index(if_name);
+        bool expected = t.match(if_name, addr_storage(gaddr), addr_storage(saddr));
+        bool result = ct.match(if_index, addr_storage(gaddr), addr_storage(saddr));
+        cout << if_name << "(" << gaddr << " | " << saddr << ") ==> " << (result ? "true" : "false") << " " << (expected == result ? "OK!" : "FAILED!") << endl;
+    };
+
+    check("", "239.1.2.3", "1.1.1.1");
+    check("", "239.0.255.255", "1.1.1.1");
+    check("lo", "239.2.0.1", "10.0.0.17");
+    check("lo", "239.2.0.1", "10.0.1.1");
+    check("lo", "239.2.0.1", "10.0.1.2");
+    check("", "239.2.0.1", "10.0.0.17");
+    check("lo", "239.2.0.11", "10.0.1.1");
+    check("", "ff05::1", "2001::1");
+    check("", "ff02::1", "2001::1");
+}
+#endif /* DEBUG_MODE */
@@ -44,6 +44,12 @@ bool single_addr::match(const addr_storage& addr) const
     return addr == m_addr || is_wildcard(m_addr, addr.get_addr_family());
 }
 
+void single_addr::get_bounds(addr_storage& from, addr_storage& to) const
+{
+    from = m_addr;
+    to = m_addr;
+}
+
 std::string single_addr::to_string() const
 {
     return m_addr.to_string();
@@ -61,6 +67,12 @@ bool addr_range::match(const addr_storage& addr) const
     return (addr >= m_from || is_wildcard(m_from, addr.get_addr_family())) && (addr <= m_to || is_wildcard(m_to, addr.get_addr_family()) );
 }
 
+void addr_range::get_bounds(addr_storage& from, addr_storage& to) const
+{
+    from = m_from;
+    to = m_to;
+}
+
 std::string addr_range::to_string() const
 {
     std::ostringstream s;
@@ -76,6 +88,21 @@ rule_addr::rule_addr(const std::string& if_name, std::unique_ptr<addr_match> gro
     HC_LOG_TRACE("");
 }
 
+const std::string& rule_addr::get_if_name() const
+{
+    return m_if_name;
+}
+
+const addr_match& rule_addr::get_group() const
+{
+    return *m_group;
+}
+
+const addr_match& rule_addr::get_source() const
+{
+    return *m_source;
+}
+
 bool rule_addr::match(const std::string& if_name, const addr_storage& gaddr, const addr_storage& saddr) const
 {
     if (m_if_name.empty()) {
@@ -85,6 +112,12 @@ bool rule_addr::match(const std::string& if_name, const addr_storage& gaddr, con
     }
 }
 
+bool rule_addr::collect_rules(std::list<const rule_addr*>& rule_list) const
+{
+    rule_list.push_back(this);
+    return true;
+}
+
 std::string rule_addr::to_string() const
 {
     std::ostringstream s;
@@ -121,6 +154,15 @@ bool table::match(const std::string& if_name, const addr_storage& gaddr, const a
     return false;
 }
 
+bool table::collect_rules(std::list<const rule_addr*>& rule_list) const
+{
+    bool rc = true;
+    for (auto & e : m_rule_box_list) {
+        rc = e->collect_rules(rule_list) && rc;
+    }
+    return rc;
+}
+
 std::string table::to_string() const
 {
     std::ostringstream s;
@@ -187,6 +229,11 @@ bool rule_table::match(const std::string& if_name, const addr_storage& gaddr, co
     return m_table->match(if_name, gaddr, saddr);
 }
 
+bool rule_table::collect_rules(std::list<const rule_addr*>& rule_list) const
+{
+    return m_table->collect_rules(rule_list);
+}
+
 std::string rule_table::to_string() const
 {
     return m_table->to_string();
@@ -209,6 +256,17 @@ bool rule_table_ref::match(const std::string& if_name, const addr_storage& gaddr
     }
 }
 
+bool rule_table_ref::collect_rules(std::list<const rule_addr*>& rule_list) const
+{
+    auto t = m_global_table_set->get_table(m_table_name);
+    if (t == nullptr) {
+        HC_LOG_ERROR("table " << m_table_name << " not found");
+        return false;
+    } else {
+        return t->collect_rules(rule_list);
+    }
+}
+
 std::string rule_table_ref::to_string() const
 {
     std::ostringstream s;
@@ -224,10 +282,14 @@ rule_binding::rule_binding(const std::string& instance_name, rb_interface_type i
     , m_filter_direction(filter_direction)
     , m_filter_type(filter_type)
     , m_table(std::move(filter_table))
+    , m_compiled_table(nullptr)
     , m_rule_matching_type(RMT_UNDEFINED)
     , m_timeout(std::chrono::milliseconds(0))
 {
     HC_LOG_TRACE("");
+    if (m_table != nullptr) {
+        m_compiled_table.reset(new compiled_table(*m_table));
+    }
 }
 
 rule_binding::rule_binding(const std::string& instance_name, rb_interface_type interface_type, const std::string& if_name, rb_interface_direction filter_direction, rb_rule_matching_type rule_matching_type, const std::chrono::milliseconds& timeout)
@@ -238,6 +300,7 @@ rule_binding::rule_binding(const std::string& instance_name, rb_interface_type i
     , m_filter_direction(filter_direction)
     , m_filter_type(FT_UNDEFINED)
     , m_table(nullptr)
+    , m_compiled_table(nullptr)
     , m_rule_matching_type(rule_matching_type)
     , m_timeout(timeout)
 {
@@ -312,6 +375,20 @@ bool rule_binding::match(const std::string& if_name, const addr_storage& saddr,
     return false;
 }
 
+bool rule_binding::match(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr) const
+{
+    HC_LOG_TRACE("");
+    if (m_compiled_table != nullptr) {
+        if (m_filter_type == FT_BLACKLIST) {
+            return !m_compiled_table->match(if_index, gaddr, saddr);
+        } else if (m_filter_type == FT_WHITELIST) {
+            return m_compiled_table->match(if_index, gaddr, saddr);
+        }
+    }
+
+    return false;
+}
+
 std::string rule_binding::to_string() const
 {
     HC_LOG_TRACE("");
@@ -432,6 +509,18 @@ bool interface::match_input_filter(const std::string& input_if_name, const addr_
     return match_filter(input_if_name, saddr, gaddr, m_input_filter);
 }
 
+bool interface::match_output_filter(unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr) const
+{
+    HC_LOG_TRACE("");
+    return match_filter(input_if_index, gaddr, saddr, m_output_filter);
+}
+
+bool interface::match_input_filter(unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr) const
+{
+    HC_LOG_TRACE("");
+    return match_filter(input_if_index, gaddr, saddr, m_input_filter);
+}
+
 std::string interface::to_string_rule_binding() const
 {
     HC_LOG_TRACE("");
@@ -467,6 +556,15 @@ bool interface::match_filter(const std::string& input_if_name, const addr_storag
     }
 }
 
+bool interface::match_filter(unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr, const std::unique_ptr<rule_binding>& filter) const
+{
+    if (filter != nullptr) {
+        return filter->match(input_if_index, gaddr, saddr);
+    } else {
+        return true; //default behaviour
+    }
+}
+
 bool operator<(const interface& i1, const interface& i2)
 {
     return i1.m_if_name.compare(i2.m_if_name) < 0;
@@ -485,14 +583,18 @@ instance_definition::instance_definition(const std::string& instance_name)
     : m_instance_name(instance_name)
     , m_table_number(0)
     , m_user_selected_table_number(false)
+    , m_mroute_backend(MRB_SETSOCKOPT)
+    , m_upstream_report_mode(URM_KERNEL)
 {
     HC_LOG_TRACE("");
 }
 
-instance_definition::instance_definition(const std::string& instance_name, std::list<std::shared_ptr<interface>>&& upstreams, std::list<std::shared_ptr<interface>>&& downstreams, int table_number, bool user_selected_table_number)
+instance_definition::instance_definition(const std::string& instance_name, std::list<std::shared_ptr<interface>>&& upstreams, std::list<std::shared_ptr<interface>>&& downstreams, int table_number, bool user_selected_table_number, mroute_backend mrb, upstream_report_mode urm)
     : m_instance_name(instance_name)
     , m_table_number(table_number)
     , m_user_selected_table_number(user_selected_table_number)
+    , m_mroute_backend(mrb)
+    , m_upstream_report_mode(urm)
     , m_upstreams(std::move(upstreams))
     , m_downstreams(std::move(downstreams))
 {
@@ -535,6 +637,18 @@ bool instance_definition::get_user_selected_table_number() const
     return m_user_selected_table_number;
 }
 
+mroute_backend instance_definition::get_mroute_backend() const
+{
+    HC_LOG_TRACE("");
+    return m_mroute_backend;
+}
+
+upstream_report_mode instance_definition::get_upstream_report_mode() const
+{
+    HC_LOG_TRACE("");
+    return m_upstream_report_mode;
+}
+
 bool operator<(const instance_definition& i1, const instance_definition& i2)
 {
     return i1.m_instance_name.compare(i2.m_instance_name) < 0;
@@ -544,7 +658,25 @@ std::string instance_definition::to_string_instance() const
 {
     HC_LOG_TRACE("");
     std::ostringstream s;
-    s << "pinstance " << m_instance_name << ": ";
+    s << "pinstance " << m_instance_name;
+    std::list<std::string> options;
+    if (m_user_selected_table_number) {
+        options.push_back(std::to_string(m_table_number));
+    }
+    if (m_mroute_backend != MRB_SETSOCKOPT) {
+        options.push_back(get_mroute_backend_name(m_mroute_backend));
+    }
+    if (m_upstream_report_mode != URM_KERNEL) {
+        options.push_back(get_upstream_report_mode_name(m_upstream_report_mode));
+    }
+    if (!options.empty()) {
+        s << " (";
+        for (auto it = options.begin(); it != options.end(); ++it) {
+            s << (it == options.begin() ? "" : " ") << *it;
+        }
+        s << ")";
+    }
+    s << ": ";
     for (auto & e : m_upstreams) {
         s << e->to_string_interface() << " ";
     }
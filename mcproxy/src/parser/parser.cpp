@@ -109,12 +109,14 @@ void parser::parse_instance_definition(inst_def_set& ids)
     HC_LOG_TRACE("");
 
     //pinstance = "pinstance" @instance_name@ (instance_definition | interface_rule_binding);
-    //instance_definition = ":" {@if_name@} "==>" @if_name@ {@if_name@};
+    //instance_definition = ["(" {@table_number@ | "netlink" | "setsockopt" | "kernel_reports" | "user_reports"} ")"] ":" {@if_name@} "==>" @if_name@ {@if_name@};
     std::list<std::shared_ptr<interface>> upstreams;
     std::list<std::shared_ptr<interface>> downstreams;
     std::string instance_name;
     int table_number = 0;
     bool user_selected_table_number = false;
+    mroute_backend mrb = MRB_SETSOCKOPT;
+    upstream_report_mode urm = URM_KERNEL;
 
     if (get_parser_type() == PT_INSTANCE_DEFINITION) {
         get_next_token();
@@ -123,23 +125,37 @@ void parser::parse_instance_definition(inst_def_set& ids)
             get_next_token();
 
             if (m_current_token.get_type() == TT_LEFT_BRACKET) {
+                //instance options: a table number, the backend for multicast routes and/or who reports the upstream memberships
                 get_next_token();
-                if (m_current_token.get_type() == TT_STRING) {
-                    try {
-                        table_number = std::stoi(m_current_token.get_string());
-                        user_selected_table_number = true;
-                    } catch (std::logic_error e) {
-                        HC_LOG_ERROR("failed to parse line " << m_current_line << " table number: " << table_number << " is not a number");
-                        throw "failed to parse config file";
-                    }
+                if (m_current_token.get_type() != TT_STRING) {
+                    HC_LOG_ERROR("failed to parse line " << m_current_line << " instance " << instance_name << " with unknown table number");
+                    throw "failed to parse config file";
+                }
 
-                    get_next_token();
-                    if (m_current_token.get_type() == TT_RIGHT_BRACKET) {
-                        get_next_token();
+                while (m_current_token.get_type() == TT_STRING) {
+                    const std::string& option = m_current_token.get_string();
+                    if (option == get_mroute_backend_name(MRB_NETLINK)) {
+                        mrb = MRB_NETLINK;
+                    } else if (option == get_mroute_backend_name(MRB_SETSOCKOPT)) {
+                        mrb = MRB_SETSOCKOPT;
+                    } else if (option == get_upstream_report_mode_name(URM_USERSPACE)) {
+                        urm = URM_USERSPACE;
+                    } else if (option == get_upstream_report_mode_name(URM_KERNEL)) {
+                        urm = URM_KERNEL;
                     } else {
-                        HC_LOG_ERROR("failed to parse line " << m_current_line << " instance " << instance_name << " with unknown table number");
-                        throw "failed to parse config file";
+                        try {
+                            table_number = std::stoi(option);
+                            user_selected_table_number = true;
+                        } catch (std::logic_error e) {
+                            HC_LOG_ERROR("failed to parse line " << m_current_line << " table number: " << option << " is not a number");
+                            throw "failed to parse config file";
+                        }
                     }
+                    get_next_token();
+                }
+
+                if (m_current_token.get_type() == TT_RIGHT_BRACKET) {
+                    get_next_token();
                 } else {
                     HC_LOG_ERROR("failed to parse line " << m_current_line << " instance " << instance_name << " with unknown table number");
                     throw "failed to parse config file";
@@ -162,7 +178,7 @@ void parser::parse_instance_definition(inst_def_set& ids)
                     }
 
                     if (downstreams.size() > 0 && m_current_token.get_type() == TT_NIL) {
-                        if (!ids.insert(std::make_shared<instance_definition>(instance_name, std::move(upstreams), std::move(downstreams), table_number, user_selected_table_number))) {
+                        if (!ids.insert(std::make_shared<instance_definition>(instance_name, std::move(upstreams), std::move(downstreams), table_number, user_selected_table_number, mrb, urm))) {
                             HC_LOG_ERROR("failed to parse line " << m_current_line << " instance " << instance_name << " already exists");
                             throw "failed to parse config file";
                         } else {
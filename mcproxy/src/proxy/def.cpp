@@ -102,6 +102,36 @@ std::string get_mcast_addr_record_type_name(mcast_addr_record_type art)
     return name_map[art];
 }
 
+std::string get_mroute_backend_name(mroute_backend mb)
+{
+    std::map<mroute_backend, std::string> name_map = {
+        {MRB_SETSOCKOPT, "setsockopt"},
+        {MRB_NETLINK,    "netlink"   }
+    };
+    return name_map[mb];
+}
+
+std::string get_upstream_report_mode_name(upstream_report_mode urm)
+{
+    std::map<upstream_report_mode, std::string> name_map = {
+        {URM_KERNEL,    "kernel_reports"},
+        {URM_USERSPACE, "user_reports"  }
+    };
+    return name_map[urm];
+}
+
+std::string get_latency_stage_name(latency_stage ls)
+{
+    std::map<latency_stage, std::string> name_map = {
+        {LS_RECEIVE,           "receive"          },
+        {LS_QUEUE,             "queue"            },
+        {LS_QUERIER,           "querier"          },
+        {LS_ROUTE_CALCULATION, "route_calculation"},
+        {LS_KERNEL_ADD_ROUTE,  "kernel_add_route" }
+    };
+    return name_map[ls];
+}
+
 std::string time_to_string(const std::chrono::seconds& sec)
 {
     std::ostringstream s;
@@ -0,0 +1,167 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/proxy/filter_decision_cache.hpp"
+
+#include <sstream>
+#include <iostream>
+
+filter_decision_cache::decision_key::decision_key(rb_interface_type interface_type, rb_interface_direction interface_direction, unsigned int checking_if_index, unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr)
+    : m_interface_type(interface_type)
+    , m_interface_direction(interface_direction)
+    , m_checking_if_index(checking_if_index)
+    , m_input_if_index(input_if_index)
+    , m_gaddr(gaddr)
+    , m_saddr(saddr)
+{
+}
+
+filter_decision_cache::filter_decision_cache(unsigned int max_size)
+    : m_max_size(max_size)
+    , m_hits(0)
+    , m_misses(0)
+    , m_evictions(0)
+    , m_invalidations(0)
+{
+    HC_LOG_TRACE("");
+}
+
+bool filter_decision_cache::lookup(rb_interface_type interface_type, rb_interface_direction interface_direction, unsigned int checking_if_index, unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr, bool& decision)
+{
+    HC_LOG_TRACE("");
+
+    if (m_max_size == 0) {
+        return false;
+    }
+
+    auto it = m_decisions.find(decision_key(interface_type, interface_direction, checking_if_index, input_if_index, gaddr, saddr));
+    if (it != m_decisions.end()) {
+        ++m_hits;
+        m_lru_list.splice(m_lru_list.begin(), m_lru_list, it->second);
+        decision = it->second->second;
+        return true;
+    } else {
+        ++m_misses;
+        return false;
+    }
+}
+
+void filter_decision_cache::insert(rb_interface_type interface_type, rb_interface_direction interface_direction, unsigned int checking_if_index, unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr, bool decision)
+{
+    HC_LOG_TRACE("");
+
+    if (m_max_size == 0) {
+        return;
+    }
+
+    decision_key key(interface_type, interface_direction, checking_if_index, input_if_index, gaddr, saddr);
+    auto it = m_decisions.find(key);
+    if (it != m_decisions.end()) {
+        it->second->second = decision;
+        m_lru_list.splice(m_lru_list.begin(), m_lru_list, it->second);
+        return;
+    }
+
+    if (m_decisions.size() >= m_max_size) {
+        m_decisions.erase(m_lru_list.back().first);
+        m_lru_list.pop_back();
+        ++m_evictions;
+    }
+
+    m_lru_list.push_front(std::make_pair(key, decision));
+    m_decisions.insert(std::make_pair(key, m_lru_list.begin()));
+}
+
+void filter_decision_cache::invalidate()
+{
+    HC_LOG_TRACE("");
+    m_decisions.clear();
+    m_lru_list.clear();
+    ++m_invalidations;
+}
+
+unsigned int filter_decision_cache::size() const
+{
+    HC_LOG_TRACE("");
+    return m_decisions.size();
+}
+
+unsigned int filter_decision_cache::get_max_size() const
+{
+    HC_LOG_TRACE("");
+    return m_max_size;
+}
+
+double filter_decision_cache::get_hit_rate() const
+{
+    HC_LOG_TRACE("");
+    unsigned long lookups = m_hits + m_misses;
+    if (lookups == 0) {
+        return 0.0;
+    } else {
+        return static_cast<double>(m_hits) / lookups;
+    }
+}
+
+std::string filter_decision_cache::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+    s << "##-- filter decision cache --##" << std::endl;
+    if (m_max_size == 0) {
+        s << "disabled";
+    } else {
+        s << "size: " << m_decisions.size() << "/" << m_max_size;
+        s << " hits: " << m_hits << " misses: " << m_misses;
+        s << " hit rate: " << get_hit_rate() * 100 << "%";
+        s << " evictions: " << m_evictions << " invalidations: " << m_invalidations;
+    }
+    return s.str();
+}
+
+#ifdef DEBUG_MODE
+void filter_decision_cache::test_filter_decision_cache()
+{
+    using namespace std;
+    cout << "##-- test filter decision cache --##" << endl;
+
+    filter_decision_cache c(2);
+    bool decision = false;
+    addr_storage g1("239.1.1.1");
+    addr_storage g2("239.1.1.2");
+    addr_storage g3("239.1.1.3");
+    addr_storage s("10.0.0.1");
+
+    cout << "empty cache miss ==> " << (!c.lookup(IT_DOWNSTREAM, ID_OUT, 1, 2, g1, s, decision) ? "OK!" : "FAILED!") << endl;
+    c.insert(IT_DOWNSTREAM, ID_OUT, 1, 2, g1, s, true);
+    c.insert(IT_DOWNSTREAM, ID_OUT, 1, 2, g2, s, false);
+    cout << "hit g1 ==> " << (c.lookup(IT_DOWNSTREAM, ID_OUT, 1, 2, g1, s, decision) && decision ? "OK!" : "FAILED!") << endl;
+    cout << "other direction miss ==> " << (!c.lookup(IT_DOWNSTREAM, ID_IN, 1, 2, g1, s, decision) ? "OK!" : "FAILED!") << endl;
+    c.insert(IT_DOWNSTREAM, ID_OUT, 1, 2, g3, s, true); //evicts g2
+    cout << "g2 evicted ==> " << (!c.lookup(IT_DOWNSTREAM, ID_OUT, 1, 2, g2, s, decision) ? "OK!" : "FAILED!") << endl;
+    cout << "g1 still cached ==> " << (c.lookup(IT_DOWNSTREAM, ID_OUT, 1, 2, g1, s, decision) ? "OK!" : "FAILED!") << endl;
+    c.invalidate();
+    cout << "invalidated ==> " << (c.size() == 0 ? "OK!" : "FAILED!") << endl;
+    cout << c.to_string() << endl;
+}
+#endif /* DEBUG_MODE */
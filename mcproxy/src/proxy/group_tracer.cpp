@@ -0,0 +1,301 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+#include "include/hamcast_logging.h"
+#include "include/proxy/group_tracer.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <string.h>
+
+std::string get_gt_lane_name(gt_lane lane)
+{
+    HC_LOG_TRACE("");
+
+    switch (lane) {
+    case GT_QUERIER:
+        return "querier";
+    case GT_ROUTING:
+        return "routing";
+    case GT_KERNEL:
+        return "kernel";
+    default:
+        return "ERROR";
+    }
+}
+
+namespace
+{
+std::string json_string(const std::string& str)
+{
+    std::ostringstream s;
+    s << "\"";
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            s << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            s << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+        } else {
+            s << c;
+        }
+    }
+    s << "\"";
+    return s.str();
+}
+
+//the first length bits of both addresses are equal
+bool is_prefix_of(const addr_storage& prefix, unsigned int length, const addr_storage& addr)
+{
+    if (prefix.get_addr_family() != addr.get_addr_family()) {
+        return false;
+    }
+
+    const unsigned char* p;
+    const unsigned char* a;
+    if (addr.get_addr_family() == AF_INET) {
+        p = reinterpret_cast<const unsigned char*>(&prefix.get_in_addr());
+        a = reinterpret_cast<const unsigned char*>(&addr.get_in_addr());
+    } else {
+        p = prefix.get_in6_addr().s6_addr;
+        a = addr.get_in6_addr().s6_addr;
+    }
+
+    unsigned int bytes = length / 8;
+    if (memcmp(p, a, bytes) != 0) {
+        return false;
+    }
+
+    unsigned int bits = length % 8;
+    if (bits == 0) {
+        return true;
+    }
+
+    unsigned char mask = static_cast<unsigned char>(0xff << (8 - bits));
+    return (p[bytes] & mask) == (a[bytes] & mask);
+}
+}
+
+group_tracer::group_tracer()
+    : m_enabled(false)
+    , m_prefixes(nullptr)
+    , m_dropped(0)
+{
+    HC_LOG_TRACE("");
+}
+
+group_tracer& group_tracer::get_instance()
+{
+    static group_tracer gt;
+    return gt;
+}
+
+bool group_tracer::is_matching(const addr_storage& gaddr) const
+{
+    auto prefixes = std::atomic_load(&m_prefixes);
+    return prefixes != nullptr && std::any_of(prefixes->begin(), prefixes->end(), [&](const prefix & p) {
+        return is_prefix_of(p.addr, p.length, gaddr);
+    });
+}
+
+void group_tracer::add_event(gt_event&& e)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    //the groups may have changed since the caller checked them
+    if (!m_enabled.load(std::memory_order_relaxed) || !is_matching(e.gaddr)) {
+        return;
+    }
+
+    if (m_events.size() >= GROUP_TRACER_MAX_EVENTS) {
+        m_events.pop_front();
+        ++m_dropped;
+    }
+    m_events.push_back(std::move(e));
+}
+
+void group_tracer::instant(gt_lane lane, const std::string& name, unsigned int if_index, const addr_storage& gaddr, gt_args&& args)
+{
+    HC_LOG_TRACE("");
+    add_event(gt_event{timing_clock::now(), std::chrono::microseconds(0), false, name, lane, if_index, gaddr, std::move(args)});
+}
+
+void group_tracer::complete(gt_lane lane, const std::string& name, unsigned int if_index, const addr_storage& gaddr, const timing_clock::time_point& start, gt_args&& args)
+{
+    HC_LOG_TRACE("");
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(timing_clock::now() - start);
+    add_event(gt_event{start, duration, true, name, lane, if_index, gaddr, std::move(args)});
+}
+
+std::string group_tracer::set_groups(const std::string& groups)
+{
+    HC_LOG_TRACE("");
+
+    auto prefixes = std::make_shared<prefix_list>();
+    std::istringstream is(groups);
+    std::string token;
+    while (is >> token) {
+        auto slash = token.find('/');
+        addr_storage addr(token.substr(0, slash));
+        if (!addr.is_valid() || !addr.is_multicast_addr()) {
+            return "invalid group address: " + token;
+        }
+
+        unsigned int max_length = addr.get_addr_family() == AF_INET ? 32 : 128;
+        unsigned int length = max_length;
+        if (slash != std::string::npos) {
+            std::string len = token.substr(slash + 1);
+            if (len.empty() || len.size() > 3 || len.find_first_not_of("0123456789") != std::string::npos || std::stoul(len) > max_length) {
+                return "invalid prefix length: " + token;
+            }
+            length = std::stoul(len);
+        }
+
+        prefixes->push_back(prefix{addr, length});
+    }
+
+    if (prefixes->empty()) {
+        return "no group address given";
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    std::atomic_store(&m_prefixes, std::shared_ptr<const prefix_list>(prefixes));
+    m_events.clear();
+    m_dropped = 0;
+    m_enabled.store(true);
+    return "";
+}
+
+void group_tracer::disable()
+{
+    HC_LOG_TRACE("");
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_enabled.store(false);
+    std::atomic_store(&m_prefixes, std::shared_ptr<const prefix_list>());
+}
+
+std::string group_tracer::get_status() const
+{
+    HC_LOG_TRACE("");
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    std::ostringstream s;
+    auto prefixes = std::atomic_load(&m_prefixes);
+    if (m_enabled.load() && prefixes != nullptr) {
+        s << "tracing:";
+        for (auto & e : *prefixes) {
+            s << " " << e.addr << "/" << e.length;
+        }
+    } else {
+        s << "tracing disabled";
+    }
+    s << std::endl << "events: " << m_events.size() << " (dropped: " << m_dropped << ")";
+    return s.str();
+}
+
+std::string group_tracer::to_json() const
+{
+    HC_LOG_TRACE("");
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    std::ostringstream s;
+
+    //one process per group in the order of their first event
+    std::map<addr_storage, unsigned int> pids;
+    for (auto & e : m_events) {
+        pids.insert(std::make_pair(e.gaddr, pids.size() + 1));
+    }
+
+    s << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":" << m_dropped << "},\"traceEvents\":[";
+    bool first = true;
+    for (auto & e : pids) {
+        s << (first ? "" : ",") << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << e.second << ",\"args\":{\"name\":" << json_string("group " + e.first.to_string()) << "}}";
+        s << ",{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":" << e.second << ",\"args\":{\"sort_index\":" << e.second << "}}";
+        for (gt_lane lane : {GT_QUERIER, GT_ROUTING, GT_KERNEL}) {
+            s << ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << e.second << ",\"tid\":" << lane << ",\"args\":{\"name\":" << json_string(get_gt_lane_name(lane)) << "}}";
+        }
+        first = false;
+    }
+
+    for (auto & e : m_events) {
+        s << (first ? "" : ",") << "{\"name\":" << json_string(e.name) << ",\"cat\":" << json_string(get_gt_lane_name(e.lane));
+        if (e.is_complete) {
+            s << ",\"ph\":\"X\",\"dur\":" << e.duration.count();
+        } else {
+            s << ",\"ph\":\"i\",\"s\":\"t\"";
+        }
+        s << ",\"ts\":" << std::chrono::duration_cast<std::chrono::microseconds>(e.time.time_since_epoch()).count();
+        s << ",\"pid\":" << pids[e.gaddr] << ",\"tid\":" << e.lane;
+        s << ",\"args\":{\"if_index\":" << e.if_index;
+        for (auto & a : e.args) {
+            s << "," << json_string(a.first) << ":" << json_string(a.second);
+        }
+        s << "}}";
+        first = false;
+    }
+    s << "]}";
+    return s.str();
+}
+
+#ifdef DEBUG_MODE
+void group_tracer::test_group_tracer()
+{
+    HC_LOG_TRACE("");
+    using namespace std;
+    cout << "##-- test group_tracer --##" << endl;
+
+    group_tracer& gt = group_tracer::get_instance();
+    addr_storage g1("239.1.1.1");
+    addr_storage g2("239.1.2.1");
+    addr_storage g3("ff05::1:3");
+
+    cout << "disabled: " << (!gt.is_traced(g1) ? "OK" : "FAILED") << endl;
+
+    bool ok = !gt.set_groups("10.0.0.1").empty() && !gt.set_groups("239.1.1.0/33").empty() && !gt.set_groups("239.1.1.0/").empty() && !gt.set_groups("").empty();
+    cout << "invalid groups: " << (ok ? "OK" : "FAILED") << endl;
+
+    ok = gt.set_groups("239.1.1.0/24 ff05::1:3").empty() && gt.is_traced(g1) && !gt.is_traced(g2) && gt.is_traced(g3) && !gt.is_traced(addr_storage("ff05::1:4"));
+    ok = ok && gt.set_groups("239.0.0.0/8").empty() && gt.is_traced(g1) && gt.is_traced(g2) && !gt.is_traced(g3) && !gt.is_traced(addr_storage("224.0.0.22"));
+    cout << "prefix matching: " << (ok ? "OK" : "FAILED") << endl;
+
+    gt.set_groups("239.1.1.1 239.1.2.1");
+    auto start = timing_clock::now();
+    gt.instant(GT_QUERIER, "filter_mode", 1, g1, {{"from", "INCLUDE"}, {"to", "EXCLUDE"}});
+    gt.complete(GT_ROUTING, "state_change", 1, g1, start);
+    gt.instant(GT_KERNEL, "route_added", 2, g2);
+    gt.instant(GT_KERNEL, "route_added", 2, g3); //not traced
+
+    string json = gt.to_json();
+    ok = json.find("\"name\":\"group 239.1.1.1\"") != string::npos && json.find("\"name\":\"group 239.1.2.1\"") != string::npos;
+    ok = ok && json.find("\"ph\":\"X\"") != string::npos && json.find("\"from\":\"INCLUDE\"") != string::npos;
+    ok = ok && json.find("ff05") == string::npos;
+    cout << "export: " << (ok ? "OK" : "FAILED") << endl;
+
+    gt.disable();
+    gt.instant(GT_KERNEL, "route_deleted", 2, g1);
+    ok = !gt.is_traced(g1) && gt.get_status().find("events: 3") != string::npos;
+    cout << "disable: " << (ok ? "OK" : "FAILED") << endl;
+}
+#endif /* DEBUG_MODE */
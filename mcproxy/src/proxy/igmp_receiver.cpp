@@ -74,13 +74,21 @@ void print_buf(const unsigned char * buf, unsigned int size)
 }
 #endif /* DEBUG_MODE */
 
-igmp_receiver::igmp_receiver(proxy_instance* pr_i, const std::shared_ptr<const mroute_socket> mrt_sock, const std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode): receiver(pr_i, AF_INET, mrt_sock, interfaces, in_debug_testing_mode)
+igmp_receiver::igmp_receiver(proxy_instance* pr_i, const std::shared_ptr<const mroute_socket> mrt_sock, const std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode): proto_receiver<igmp_traits>(pr_i, mrt_sock, interfaces, in_debug_testing_mode)
 {
     HC_LOG_TRACE("");
 
     start();
 }
 
+igmp_receiver::~igmp_receiver()
+{
+    HC_LOG_TRACE("");
+
+    stop();
+    join();
+}
+
 int igmp_receiver::get_iov_min_size()
 {
     HC_LOG_TRACE("");
@@ -96,7 +104,7 @@ int igmp_receiver::get_ctrl_min_size()
     return 0;
 }
 
-void igmp_receiver::analyse_packet(struct msghdr* msg, int)
+void igmp_receiver::analyse_packet(struct msghdr* msg, int info_size)
 {
     HC_LOG_TRACE("");
 
@@ -133,6 +141,7 @@ void igmp_receiver::analyse_packet(struct msghdr* msg, int)
                 return;
             }
 
+            count_message(if_index, "cache_miss");
             m_proxy_instance->add_msg(std::make_shared<new_source_msg>(if_index, gaddr, saddr));
             break;
         }
@@ -162,22 +171,18 @@ void igmp_receiver::analyse_packet(struct msghdr* msg, int)
 
             if (igmp_hdr->igmp_type == IGMP_V2_MEMBERSHIP_REPORT) {
                 HC_LOG_DEBUG("\treport received");
-                m_proxy_instance->add_msg(std::make_shared<group_record_msg>(if_index, MODE_IS_EXCLUDE, gaddr, source_list<source>(), IGMPv2));
+                count_message(if_index, "igmpv2_report");
+                add_record(std::make_shared<group_record_msg>(if_index, MODE_IS_EXCLUDE, gaddr, source_list<source>(), IGMPv2, m_receive_time));
             } else if (igmp_hdr->igmp_type == IGMP_V2_LEAVE_GROUP) {
                 HC_LOG_DEBUG("\tleave group received");
-                m_proxy_instance->add_msg(std::make_shared<group_record_msg>(if_index, CHANGE_TO_INCLUDE_MODE, gaddr, source_list<source>(), IGMPv2));
+                count_message(if_index, "igmpv2_leave");
+                add_record(std::make_shared<group_record_msg>(if_index, CHANGE_TO_INCLUDE_MODE, gaddr, source_list<source>(), IGMPv2, m_receive_time));
             } else {
                 HC_LOG_ERROR("unkown igmp type: " << igmp_hdr->igmp_type); 
             }
         } else if (igmp_hdr->igmp_type == IGMP_V3_MEMBERSHIP_REPORT) {
             HC_LOG_DEBUG("IGMP_V3_MEMBERSHIP_REPORT received");
 
-            igmpv3_mc_report* v3_report = reinterpret_cast<igmpv3_mc_report*>(igmp_hdr);
-            igmpv3_mc_record* rec = reinterpret_cast<igmpv3_mc_record*>(reinterpret_cast<unsigned char*>(v3_report) + sizeof(igmpv3_mc_report));
-
-            int num_records = ntohs(v3_report->num_of_mc_records);
-            HC_LOG_DEBUG("\tnum of multicast records: " << num_records);
-
             saddr = ip_hdr->ip_src;
             HC_LOG_DEBUG("\tsaddr: " << saddr);
 
@@ -192,35 +197,33 @@ void igmp_receiver::analyse_packet(struct msghdr* msg, int)
                 return;
             }
 
-            for (int i = 0; i < num_records; ++i) {
-                mcast_addr_record_type rec_type = static_cast<mcast_addr_record_type>(rec->type);
-                unsigned int aux_size = rec->aux_data_len * 4; //RFC 3376 Section 4.2.6 Aux Data Len
-                int nos = ntohs(rec->num_of_srcs);
-
-                gaddr = addr_storage(rec->gaddr);
-                source_list<source> slist;
-
-                in_addr* src = reinterpret_cast<in_addr*>(reinterpret_cast<unsigned char*>(rec) + sizeof(igmpv3_mc_record));
-                for (int j = 0; j < nos; ++j) {
-                    slist.insert(addr_storage(*src));
-                    ++src;
-                }
-
-                HC_LOG_DEBUG("\trecord type: " << get_mcast_addr_record_type_name(rec_type));
-                HC_LOG_DEBUG("\tgaddr: " << gaddr);
-                HC_LOG_DEBUG("\tnumber of sources: " << slist.size());
-                HC_LOG_DEBUG("\tsource_list: " << slist);
-                m_proxy_instance->add_msg(std::make_shared<group_record_msg>(if_index, rec_type, gaddr, move(slist), IGMPv3));
-
-                rec = reinterpret_cast<igmpv3_mc_record*>(reinterpret_cast<unsigned char*>(rec) + sizeof(igmpv3_mc_record) + nos * sizeof(in_addr) + aux_size);
-            }
+            unsigned int offset = reinterpret_cast<unsigned char*>(igmp_hdr) - reinterpret_cast<unsigned char*>(msg->msg_iov->iov_base);
+            analyse_report(if_index, reinterpret_cast<unsigned char*>(igmp_hdr), info_size > static_cast<int>(offset) ? info_size - offset : 0);
 
         } else if (igmp_hdr->igmp_type == IGMP_V1_MEMBERSHIP_REPORT) {
             HC_LOG_DEBUG("IGMP_V1_MEMBERSHIP_REPORT received");
             HC_LOG_WARN("protocol not supported");
         } else if (igmp_hdr->igmp_type == IGMP_MEMBERSHIP_QUERY) {
             HC_LOG_DEBUG("IGMP_MEMBERSHIP_QUERY received");
-            HC_LOG_WARN("querier election is not implemented");
+
+            saddr = ip_hdr->ip_src;
+            HC_LOG_DEBUG("\tsaddr: " << saddr);
+
+            if ((if_index = m_interfaces->get_if_index(saddr)) == 0) {
+                HC_LOG_DEBUG("no if_index found");
+                return;
+            }
+
+            if (!is_if_index_relevant(if_index)) {
+                HC_LOG_DEBUG("interface is not relevant");
+                return;
+            }
+
+            //answered by the membership reporter on an upstream
+            count_message(if_index, "igmp_query");
+            gaddr = igmp_hdr->igmp_group;
+            auto max_resp_time = timers_values().maxrespc_igmpv3_to_maxrespi(igmp_hdr->igmp_code);
+            m_proxy_instance->add_msg(std::make_shared<query_msg>(if_index, gaddr, max_resp_time));
         } else {
             HC_LOG_WARN("unknown IGMP-packet");
             HC_LOG_WARN("type: " << igmp_hdr->igmp_type);
@@ -31,120 +31,73 @@
 #include <net/if.h>
 
 #include <memory>
+#include <cstring>
+#include <functional>
+#include <algorithm>
+#include <iostream>
 
-igmp_sender::igmp_sender(const std::shared_ptr<const interfaces>& interfaces): sender(interfaces, IGMPv3)
+igmp_sender::igmp_sender(const std::shared_ptr<const interfaces>& interfaces)
+    : proto_sender<igmp_traits, igmp_sender>(interfaces)
 {
     HC_LOG_TRACE("");
 
-    if (is_IPv4(m_group_mem_protocol)) {
-        if (!m_sock.set_no_ip_hdr(true)) {
-            throw "failed to set no ip hdr";
-        }
-    } else {
-        HC_LOG_ERROR("wrong address family: " << get_group_mem_protocol_name(m_group_mem_protocol));
-        throw "wrong address family";
+    if (!m_sock.set_no_ip_hdr(true)) {
+        throw "failed to set no ip hdr";
     }
 }
 
-bool igmp_sender::send_record(unsigned int if_index, mc_filter filter_mode, const addr_storage& gaddr, const source_list<source>& slist) const
+void igmp_sender::encode_query(const query_template& qt, const query_request& q, std::vector<unsigned char>& buf) const
 {
     HC_LOG_TRACE("");
 
-    if (filter_mode == INCLUDE_MODE && slist.empty() ) {
-        m_sock.leave_group(gaddr, if_index);
-        return true;
-    } else if (filter_mode == EXCLUDE_MODE || filter_mode == INCLUDE_MODE) {
-        m_sock.join_group(gaddr, if_index);
-        std::list<addr_storage> src_list;
-        for (auto & e : slist) {
-            src_list.push_back(e.saddr);
-        }
-
-        return m_sock.set_source_filter(if_index, gaddr, filter_mode, src_list);
-    } else {
-        HC_LOG_ERROR("unknown filter mode");
-        return false;
+    if (igmp_traits::is_unspecified(q.gaddr)) { //general query
+        buf.insert(buf.end(), qt.general_query.begin(), qt.general_query.end());
+        return;
     }
-}
 
-bool igmp_sender::send_general_query(unsigned int if_index, const timers_values& tv) const
-{
-    HC_LOG_TRACE("");
-
-    return send_igmpv3_query(if_index, tv, addr_storage(AF_INET), false, source_list<source>());
-}
+    //all other types of queries
+    std::size_t offset = buf.size();
+    unsigned int size = qt.specific_query.size() + (q.slist.size() * sizeof(igmp_traits::addr_type));
+    buf.resize(offset + size);
+    memcpy(&buf[offset], qt.specific_query.data(), qt.specific_query.size());
 
-bool igmp_sender::send_mc_addr_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag) const
-{
-    HC_LOG_TRACE("");
-
-    return send_igmpv3_query(if_index, tv, gaddr, s_flag, source_list<source>());
-}
-
-bool igmp_sender::send_mc_addr_and_src_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, source_list<source>& slist) const
-{
-    HC_LOG_TRACE("");
-
-    source_list<source> slist_lower;
-    source_list<source> slist_higher;
-    bool rc = false;
-    for (auto & e : slist) {
-        if (e.retransmission_count > 0) {
-            e.retransmission_count--;
-
-            if (e.retransmission_count > 0 ) {
-                rc = true;
-            }
-
-            if (e.shared_source_timer.get() != nullptr) {
-                if (e.shared_source_timer->is_remaining_time_greater_than(tv.get_last_listener_query_time())) {
-                    slist_higher.insert(e);
-                } else {
-                    slist_lower.insert(e);
-                }
-            } else {
-                HC_LOG_ERROR("the shared source timer shouldnt be null");
-            }
-        }
-    }
+    //-------------------------------------------------------------------
+    //patch ip header
+    ip* ip_hdr = reinterpret_cast<ip*>(&buf[offset]);
+    ip_hdr->ip_len = htons(size);
+    ip_hdr->ip_dst = q.gaddr.get_in_addr();
+    ip_hdr->ip_sum = 0;
+    ip_hdr->ip_sum = m_sock.calc_checksum(reinterpret_cast<unsigned char*>(ip_hdr), sizeof(ip) + sizeof(router_alert_option));
 
-    if (!slist_higher.empty()) {
-        send_igmpv3_query(if_index, tv, gaddr, true, slist_higher);
-    }
+    //-------------------------------------------------------------------
+    //patch igmpv3 query
+    igmpv3_query* query = reinterpret_cast<igmpv3_query*>(&buf[offset + sizeof(ip) + sizeof(router_alert_option)]);
+    query->igmp_group = igmp_traits::get_addr(q.gaddr);
+    query->suppress = q.s_flag;
+    query->num_of_srcs = htons(q.slist.size());
 
-    if (!slist_lower.empty()) {
-        send_igmpv3_query(if_index, tv, gaddr, false, slist_lower);
+    //-------------------------------------------------------------------
+    //add sources
+    igmp_traits::addr_type* source_ptr = reinterpret_cast<igmp_traits::addr_type*>(reinterpret_cast<unsigned char*>(query) + sizeof(igmpv3_query));
+    for (auto & e : q.slist) {
+        *source_ptr = igmp_traits::get_addr(e);
+        source_ptr++;
     }
 
-    return rc;
+    query->igmp_cksum = 0;
+    query->igmp_cksum = m_sock.calc_checksum(reinterpret_cast<unsigned char*>(query), (sizeof(igmpv3_query) + (q.slist.size() * sizeof(igmp_traits::addr_type))));
 }
 
-bool igmp_sender::send_igmpv3_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag, const source_list<source>& slist) const
+void igmp_sender::build_query_template(unsigned int if_index, const timers_values& tv, query_template& qt) const
 {
     HC_LOG_TRACE("");
 
-    std::unique_ptr<unsigned char[]> packet;
-    unsigned int size;
-
-    if (slist.empty()) {
-        size = sizeof(ip) + sizeof(router_alert_option) + sizeof(igmpv3_query);
-        packet.reset(new unsigned char[size]);
-    } else { //all other types of queries
-        size = sizeof(ip) + sizeof(router_alert_option) + sizeof(igmpv3_query) + (slist.size() * sizeof(in_addr));
-        packet.reset(new unsigned char[size]);
-    }
-
-    addr_storage dst_addr;
-
-    if (gaddr == addr_storage(AF_INET)) { //is general query
-        dst_addr = IPV4_ALL_HOST_ADDR;
-    } else {
-        dst_addr = gaddr;
-    }
+    unsigned int size = sizeof(ip) + sizeof(router_alert_option) + sizeof(igmpv3_query);
+    qt.general_query.assign(size, 0);
 
     //-------------------------------------------------------------------
     //fill ip header
-    ip* ip_hdr = reinterpret_cast<ip*>(packet.get());
+    ip* ip_hdr = reinterpret_cast<ip*>(qt.general_query.data());
 
     ip_hdr->ip_v = 4;
     ip_hdr->ip_hl = (sizeof(ip) + sizeof(router_alert_option)) / 4;
@@ -156,7 +109,7 @@ bool igmp_sender::send_igmpv3_query(unsigned int if_index, const timers_values&
     ip_hdr->ip_p = IPPROTO_IGMP;
     ip_hdr->ip_sum = 0;
     ip_hdr->ip_src = m_interfaces->get_saddr(interfaces::get_if_name(if_index)).get_in_addr();
-    ip_hdr->ip_dst = dst_addr.get_in_addr();
+    ip_hdr->ip_dst = m_all_hosts_addr.get_in_addr();
 
     //-------------------------------------------------------------------
     //fill router_alert_option header
@@ -170,17 +123,11 @@ bool igmp_sender::send_igmpv3_query(unsigned int if_index, const timers_values&
     igmpv3_query* query = reinterpret_cast<igmpv3_query*>(reinterpret_cast<unsigned char*>(ra_hdr) + sizeof(router_alert_option));
 
     query->igmp_type = IGMP_MEMBERSHIP_QUERY;
-
-    if (gaddr == addr_storage(AF_INET)) { //general query
-        query->igmp_code = tv.maxrespi_to_maxrespc_igmpv3(tv.get_query_response_interval());
-    } else {
-        query->igmp_code = tv.maxrespi_to_maxrespc_igmpv3(tv.get_last_listener_query_time());
-    }
-
+    query->igmp_code = igmp_traits::encode_max_resp(tv, tv.get_query_response_interval());
     query->igmp_cksum = 0;
-    query->igmp_group = gaddr.get_in_addr();
+    query->igmp_group = in_addr();
     query->resv2 = 0;
-    query->suppress = s_flag;
+    query->suppress = false;
 
     if (tv.get_robustness_variable() <= 7) {
         query->qrv = tv.get_robustness_variable();
@@ -189,24 +136,134 @@ bool igmp_sender::send_igmpv3_query(unsigned int if_index, const timers_values&
     }
 
     query->qqic = tv.qqi_to_qqic(tv.get_query_interval());
-    query->num_of_srcs = ntohs(slist.size());
+    query->num_of_srcs = 0;
+
+    qt.specific_query = qt.general_query;
+
+    query->igmp_cksum = m_sock.calc_checksum(reinterpret_cast<unsigned char*>(query), sizeof(igmpv3_query));
+
+    //the specific queries use the last listener query time as max response time
+    igmpv3_query* specific_query = reinterpret_cast<igmpv3_query*>(qt.specific_query.data() + sizeof(ip) + sizeof(router_alert_option));
+    specific_query->igmp_code = igmp_traits::encode_max_resp(tv, tv.get_last_listener_query_time());
+}
+
+bool igmp_sender::send_report_packet(unsigned int if_index, const std::vector<unsigned char>& records, unsigned int num_records) const
+{
+    HC_LOG_TRACE("");
+
+    unsigned int size = sizeof(ip) + sizeof(router_alert_option) + sizeof(igmpv3_mc_report) + records.size();
+    std::unique_ptr<unsigned char[]> packet(new unsigned char[size]);
+    addr_storage dst_addr(igmp_traits::get_report_addr());
 
     //-------------------------------------------------------------------
-    //add sources
-    if (!slist.empty()) {
-        in_addr* source_ptr = reinterpret_cast<in_addr*>(reinterpret_cast<unsigned char*>(query) + sizeof(igmpv3_query));
-        for (auto & e : slist) {
-            *source_ptr = e.saddr.get_in_addr();
-            source_ptr++;
-        }
-    }
+    //fill ip header
+    ip* ip_hdr = reinterpret_cast<ip*>(packet.get());
 
-    query->igmp_cksum = m_sock.calc_checksum(reinterpret_cast<unsigned char*>(query), (sizeof(igmpv3_query) + (slist.size() * sizeof(in_addr))));
+    ip_hdr->ip_v = 4;
+    ip_hdr->ip_hl = (sizeof(ip) + sizeof(router_alert_option)) / 4;
+    ip_hdr->ip_tos = 0xc0; //RFC 3376 Section 4: Internetwork Control
+    ip_hdr->ip_len = htons(size);
+    ip_hdr->ip_id = 0;
+    ip_hdr->ip_off = htons(0 | IP_DF);
+    ip_hdr->ip_ttl = 1;
+    ip_hdr->ip_p = IPPROTO_IGMP;
+    ip_hdr->ip_sum = 0;
+    ip_hdr->ip_src = m_interfaces->get_saddr(interfaces::get_if_name(if_index)).get_in_addr();
+    ip_hdr->ip_dst = dst_addr.get_in_addr();
+
+    //-------------------------------------------------------------------
+    //fill router_alert_option header
+    router_alert_option* ra_hdr = reinterpret_cast<router_alert_option*>(reinterpret_cast<unsigned char*>(ip_hdr) + sizeof(ip));
+    *ra_hdr = router_alert_option();
+
+    ip_hdr->ip_sum = m_sock.calc_checksum(reinterpret_cast<unsigned char*>(ip_hdr), sizeof(ip) + sizeof(router_alert_option));
+
+    //-------------------------------------------------------------------
+    //fill igmpv3 report
+    igmpv3_mc_report* report = reinterpret_cast<igmpv3_mc_report*>(reinterpret_cast<unsigned char*>(ra_hdr) + sizeof(router_alert_option));
+
+    report->type = IGMP_V3_MEMBERSHIP_REPORT;
+    report->reservedA = 0;
+    report->checksum = 0;
+    report->reservedB = 0;
+    report->num_of_mc_records = htons(num_records);
+
+    memcpy(reinterpret_cast<unsigned char*>(report) + sizeof(igmpv3_mc_report), records.data(), records.size());
+
+    report->checksum = m_sock.calc_checksum(reinterpret_cast<unsigned char*>(report), sizeof(igmpv3_mc_report) + records.size());
 
     if (!m_sock.choose_if(if_index)) {
         return false;
     }
 
-    return m_sock.send_packet(dst_addr, reinterpret_cast<unsigned char*>(ip_hdr), size);
+    return m_sock.send_packet(dst_addr, packet.get(), size);
 }
 
+#ifdef DEBUG_MODE
+void igmp_sender::test_igmp_sender()
+{
+    using namespace std;
+    const unsigned int count = 100000;
+    const unsigned int batch_size = 32;
+    const unsigned int if_index = interfaces::get_if_index("lo");
+    auto ifs = make_shared<const interfaces>(AF_INET, false);
+    igmp_sender s(ifs);
+    timers_values tv;
+    addr_storage gaddr("239.1.1.1");
+
+    list<addr_storage> slist;
+    addr_storage saddr("10.0.0.1");
+    for (int i = 0; i < 16; ++i, ++saddr) {
+        slist.push_back(saddr);
+    }
+
+    vector<query_request> general_queries(batch_size, query_request{if_index, &tv, addr_storage(AF_INET), false, {}, false});
+    vector<query_request> source_queries(1, query_request{if_index, &tv, gaddr, false, slist, false});
+
+    cout << "##-- encoded query templates (one thread on lo) --##" << endl;
+
+    //f sends queries_per_call queries
+    auto bench = [&](const string & name, unsigned int queries_per_call, const function<void()>& f) {
+        auto start = chrono::steady_clock::now();
+        for (unsigned int i = 0; i < count / queries_per_call; ++i) {
+            f();
+        }
+        auto usec = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        cout << name << ": " << (usec > 0 ? (count / queries_per_call) * queries_per_call * 1000000ULL / usec : 0) << " queries/s" << endl;
+    };
+
+    bench("encode general query", 1, [&]() {
+        query_template qt;
+        s.build_query_template(if_index, tv, qt);
+    });
+
+    bench("send general query", 1, [&]() {
+        s.send_general_query(if_index, tv);
+    });
+
+    bench("send general query, template rebuilt", 1, [&]() {
+        s.clear_query_templates(if_index);
+        s.send_general_query(if_index, tv);
+    });
+
+    bench("send group specific query", 1, [&]() {
+        s.send_mc_addr_specific_query(if_index, tv, gaddr, false);
+    });
+
+    bench("send group and source specific query (16 sources)", 1, [&]() {
+        s.send_queries(source_queries);
+    });
+
+    bench("send general queries, batches of " + std::to_string(batch_size), batch_size, [&]() {
+        s.send_queries(general_queries);
+    });
+
+    cout << "all queries of the last batch sent: " << (all_of(general_queries.begin(), general_queries.end(), [](const query_request & q) {
+        return q.sent;
+    }) ? "ok" : "failed") << endl;
+
+    tv.set_query_interval(chrono::seconds(60));
+    s.send_general_query(if_index, tv);
+    cout << "template rebuilt for new timers values: " << (s.m_query_templates.at(if_index).query_interval == chrono::seconds(60) ? "ok" : "failed") << endl;
+}
+#endif /* DEBUG_MODE */
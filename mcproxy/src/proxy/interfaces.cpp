@@ -26,6 +26,11 @@
 #include <linux/mroute6.h>
 
 #include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
 #include <vector>
 
 interfaces::interfaces(int addr_family, bool reset_reverse_path_filter)
@@ -116,9 +121,10 @@ bool interfaces::del_interface(unsigned int if_index)
     }
 }
 
-bool interfaces::refresh_network_interfaces()
+bool interfaces::refresh_network_interfaces() const
 {
     HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_if_prop_lock);
     return m_if_prop.refresh_network_interfaces();
 }
 
@@ -131,7 +137,7 @@ unsigned int interfaces::get_if_index(const std::string& if_name)
 unsigned int interfaces::get_if_index(const char* if_name)
 {
     HC_LOG_TRACE("");
-    return if_nametoindex(if_name);
+    return if_prop::get_if_index(if_name);
 }
 
 unsigned int interfaces::get_if_index(int virtual_if_index) const
@@ -162,9 +168,14 @@ int interfaces::get_virtual_if_index(unsigned int if_index) const
 addr_storage interfaces::get_saddr(const std::string& if_name) const
 {
     HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_if_prop_lock);
 
     if (m_addr_family == AF_INET) {
         auto tmp = m_if_prop.get_ip4_if(if_name);
+        if (tmp == nullptr || tmp->ifa_addr == nullptr) { //the address can be removed at runtime
+            HC_LOG_WARN("no ipv4 address on interface: " << if_name);
+            return addr_storage();
+        }
         return addr_storage(*tmp->ifa_addr);
     } else if  (m_addr_family == AF_INET6) {
         auto addr_list = m_if_prop.get_ip6_if(if_name);
@@ -183,15 +194,39 @@ addr_storage interfaces::get_saddr(const std::string& if_name) const
 std::string interfaces::get_if_name(unsigned int if_index)
 {
     HC_LOG_TRACE("");
-    char tmp[IF_NAMESIZE];
-    const char* if_name = if_indextoname(if_index, tmp);
-    if (if_name == nullptr) {
+    std::string if_name = if_prop::get_if_name(if_index);
+    if (if_name.empty()) {
+        HC_LOG_WARN("cannot map if_index (#" << if_index << ") to if_name");
+    }
+    return if_name;
+}
+
+unsigned int interfaces::get_mtu(unsigned int if_index)
+{
+    HC_LOG_TRACE("");
+
+    ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    if (if_indextoname(if_index, ifr.ifr_name) == nullptr) {
         HC_LOG_WARN("cannot map if_index (#" << if_index << ") to if_name");
-        return std::string();
+        return 0;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        HC_LOG_ERROR("failed to create socket! Error: " << strerror(errno) << " errno: " << errno);
+        return 0;
+    }
+
+    unsigned int mtu = 0;
+    if (ioctl(sock, SIOCGIFMTU, &ifr) < 0) {
+        HC_LOG_ERROR("failed to get mtu of interface: " << ifr.ifr_name << "! Error: " << strerror(errno) << " errno: " << errno);
     } else {
-        return std::string(if_name);
+        mtu = ifr.ifr_mtu;
     }
 
+    close(sock);
+    return mtu;
 }
 
 unsigned int interfaces::get_if_index(const addr_storage& saddr) const
@@ -202,6 +237,7 @@ unsigned int interfaces::get_if_index(const addr_storage& saddr) const
     addr_storage src_subnet;
 
     const if_prop_map* prop_map;
+    std::lock_guard<std::mutex> lock(m_if_prop_lock);
 
     if (saddr.get_addr_family() == AF_INET) {
         prop_map = m_if_prop.get_if_props();
@@ -258,10 +294,17 @@ int interfaces::get_free_vif_number() const
     return INTERFACES_UNKOWN_VIF_INDEX;
 }
 
+std::map<int, unsigned int> interfaces::get_vif_map() const
+{
+    HC_LOG_TRACE("");
+    return m_vif_if;
+}
+
 
 bool interfaces::is_interface(unsigned if_index, unsigned int interface_flags) const
 {
     HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_if_prop_lock);
     if (m_addr_family == AF_INET) {
         const struct ifaddrs* prop = m_if_prop.get_ip4_if(get_if_name(if_index));
         if (prop != nullptr) {
@@ -0,0 +1,485 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/proxy/kernel_io.hpp"
+#include "include/proxy/sender.hpp"
+#include "include/proxy/routing.hpp"
+#include "include/proxy/worker.hpp"
+
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+std::string kernel_op::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+    s << kernel_io::get_kernel_op_type_name(type) << "(";
+    switch (type) {
+    case KOT_ADD_ROUTE:
+    case KOT_DEL_ROUTE:
+        s << "vif:" << if_index << ", " << saddr << ", " << gaddr;
+        break;
+    case KOT_RECORD:
+        s << interfaces::get_if_name(if_index) << ", " << gaddr << ", " << get_mc_filter_name(filter_mode);
+        break;
+    case KOT_GENERAL_QUERY:
+        s << interfaces::get_if_name(if_index);
+        break;
+    case KOT_GROUP_QUERY:
+        s << interfaces::get_if_name(if_index) << ", " << gaddr;
+        if (!query_slist.empty()) {
+            s << ", sources:" << query_slist.size();
+        }
+        break;
+    case KOT_REPORT:
+        s << interfaces::get_if_name(if_index) << ", records:" << records.size();
+        break;
+    }
+    s << ")";
+    return s.str();
+}
+
+kernel_io::kernel_io(const std::shared_ptr<const sender>& sender, const routing* routing, const worker* reply_to, bool synchronous)
+    : m_sender(sender)
+    , m_routing(routing)
+    , m_reply_to(reply_to)
+    , m_synchronous(synchronous)
+    , m_seq(0)
+    , m_running(false)
+    , m_commit_pending(false)
+    , m_busy(false)
+    , m_query_tick_pending(false)
+    , m_thread(nullptr)
+    , m_executed(0)
+    , m_coalesced(0)
+    , m_failed(0)
+{
+    HC_LOG_TRACE("");
+
+    if (!m_synchronous) {
+        m_running = true;
+        m_thread.reset(new std::thread(&kernel_io::worker_thread, this));
+    }
+}
+
+kernel_io::~kernel_io()
+{
+    HC_LOG_TRACE("");
+
+    //the last operations, e.g. leaving the upstream groups
+    sync();
+
+    if (m_thread) {
+        {
+            std::lock_guard<std::mutex> lock(m_global_lock);
+            m_running = false;
+        }
+        m_con_var.notify_one();
+        m_thread->join();
+    }
+}
+
+void kernel_io::worker_thread()
+{
+    HC_LOG_TRACE("");
+
+    while (true) {
+        std::list<kernel_op> batch;
+
+        {
+            std::unique_lock<std::mutex> lock(m_global_lock);
+            while (!m_commit_pending && m_running) {
+                if (m_query_tick_pending) {
+                    if (m_con_var.wait_until(lock, m_query_deadline) == std::cv_status::timeout) {
+                        m_commit_pending = true;
+                    }
+                } else {
+                    m_con_var.wait(lock);
+                }
+            }
+
+            if (!m_commit_pending) {
+                break;
+            }
+
+            batch.splice(batch.end(), m_queue);
+            m_index.clear();
+            m_commit_pending = false;
+            m_query_tick_pending = false;
+            m_busy = true;
+        }
+
+        execute_batch(batch);
+
+        {
+            std::lock_guard<std::mutex> lock(m_global_lock);
+            m_busy = false;
+        }
+        m_idle_con_var.notify_all();
+    }
+
+    HC_LOG_DEBUG("worker thread kernel_io end");
+}
+
+void kernel_io::enqueue(const kernel_op_key& key, const kernel_op& op)
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        //the pending operation is superseded, the new one is queued behind the
+        //operations queued in between, so it can not overtake them
+        m_queue.erase(it->second);
+        it->second = m_queue.insert(m_queue.end(), op);
+        ++m_coalesced;
+    } else {
+        m_index.insert(std::make_pair(key, m_queue.insert(m_queue.end(), op)));
+    }
+}
+
+bool kernel_io::execute(const kernel_op& op) const
+{
+    HC_LOG_TRACE("");
+
+    switch (op.type) {
+    case KOT_ADD_ROUTE:
+        if (m_routing == nullptr) {
+            HC_LOG_ERROR("no routing module available");
+            return false;
+        }
+        return m_routing->add_route(op.if_index, op.gaddr, op.saddr, op.output_vif);
+    case KOT_DEL_ROUTE:
+        if (m_routing == nullptr) {
+            HC_LOG_ERROR("no routing module available");
+            return false;
+        }
+        return m_routing->del_route(op.if_index, op.gaddr, op.saddr);
+    case KOT_RECORD:
+        return m_sender->send_record(op.if_index, op.filter_mode, op.gaddr, op.slist);
+    case KOT_REPORT:
+        return m_sender->send_report(op.if_index, op.records);
+    default:
+        HC_LOG_ERROR("unknown kernel operation");
+        return false;
+    }
+}
+
+void kernel_io::execute_batch(const std::list<kernel_op>& batch)
+{
+    HC_LOG_TRACE("");
+    std::list<std::string> failures;
+    bool has_routes = false;
+
+    //consecutive queries of all interfaces are sent together, but not ahead
+    //of the operations queued before them
+    std::vector<const kernel_op*> query_ops;
+    std::vector<query_request> queries;
+
+    auto send_queries = [&]() {
+        if (!queries.empty() && !m_sender->send_queries(queries)) {
+            for (unsigned int i = 0; i < queries.size(); ++i) {
+                if (!queries[i].sent) {
+                    HC_LOG_DEBUG("kernel operation failed: " << query_ops[i]->to_string());
+                    failures.push_back(query_ops[i]->to_string());
+                }
+            }
+        }
+        query_ops.clear();
+        queries.clear();
+    };
+
+    for (auto & e : batch) {
+        if (e.type == KOT_GENERAL_QUERY || e.type == KOT_GROUP_QUERY) {
+            query_ops.push_back(&e);
+            queries.push_back(query_request{e.if_index, e.tv.get(), e.type == KOT_GENERAL_QUERY ? addr_storage(get_addr_family(m_sender->get_group_mem_protocol())) : e.gaddr, e.s_flag, e.query_slist, false});
+            continue;
+        }
+
+        send_queries();
+
+        if (!execute(e)) {
+            HC_LOG_DEBUG("kernel operation failed: " << e.to_string());
+            failures.push_back(e.to_string());
+        }
+
+        has_routes = has_routes || e.type == KOT_ADD_ROUTE || e.type == KOT_DEL_ROUTE;
+    }
+
+    send_queries();
+
+    //all routes of this batch in one netlink message
+    if (has_routes && m_routing != nullptr && !m_routing->flush()) {
+        failures.push_back("flush of the batched routes");
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_global_lock);
+        m_executed += batch.size();
+        m_failed += failures.size();
+    }
+
+    if (m_reply_to != nullptr && !batch.empty()) {
+        m_reply_to->add_msg(std::make_shared<kernel_io_result_msg>(batch.size(), failures));
+    }
+}
+
+void kernel_io::add_route(int input_vif, const addr_storage& gaddr, const addr_storage& saddr, const std::list<int>& output_vif)
+{
+    HC_LOG_TRACE("");
+    kernel_op op;
+    op.type = KOT_ADD_ROUTE;
+    op.if_index = input_vif;
+    op.gaddr = gaddr;
+    op.saddr = saddr;
+    op.output_vif = output_vif;
+
+    //a (S,G) has only one route per table
+    enqueue(kernel_op_key(KOT_ADD_ROUTE, 0, gaddr, saddr, 0), op);
+}
+
+void kernel_io::del_route(int vif, const addr_storage& gaddr, const addr_storage& saddr)
+{
+    HC_LOG_TRACE("");
+    kernel_op op;
+    op.type = KOT_DEL_ROUTE;
+    op.if_index = vif;
+    op.gaddr = gaddr;
+    op.saddr = saddr;
+
+    //same key as add_route()
+    enqueue(kernel_op_key(KOT_ADD_ROUTE, 0, gaddr, saddr, 0), op);
+}
+
+void kernel_io::send_record(unsigned int if_index, mc_filter filter_mode, const addr_storage& gaddr, const source_list<source>& slist)
+{
+    HC_LOG_TRACE("");
+    kernel_op op;
+    op.type = KOT_RECORD;
+    op.if_index = if_index;
+    op.gaddr = gaddr;
+    op.filter_mode = filter_mode;
+    op.slist = slist;
+
+    //the last membership state of a group wins
+    enqueue(kernel_op_key(KOT_RECORD, if_index, gaddr, addr_storage(), 0), op);
+}
+
+void kernel_io::send_general_query(unsigned int if_index, const timers_values& tv)
+{
+    HC_LOG_TRACE("");
+    kernel_op op;
+    op.type = KOT_GENERAL_QUERY;
+    op.if_index = if_index;
+    op.tv = std::make_shared<timers_values>(tv);
+
+    //queries are never coalesced
+    enqueue(kernel_op_key(KOT_GENERAL_QUERY, if_index, addr_storage(), addr_storage(), ++m_seq), op);
+}
+
+void kernel_io::send_mc_addr_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag)
+{
+    HC_LOG_TRACE("");
+    kernel_op op;
+    op.type = KOT_GROUP_QUERY;
+    op.if_index = if_index;
+    op.gaddr = gaddr;
+    op.tv = std::make_shared<timers_values>(tv);
+    op.s_flag = s_flag;
+
+    enqueue(kernel_op_key(KOT_GROUP_QUERY, if_index, gaddr, addr_storage(), ++m_seq), op);
+}
+
+bool kernel_io::send_mc_addr_and_src_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, source_list<source>& slist)
+{
+    HC_LOG_TRACE("");
+    std::list<addr_storage> slist_higher;
+    std::list<addr_storage> slist_lower;
+    bool rc = sender::split_source_retransmissions(tv, slist, slist_higher, slist_lower);
+
+    auto tv_copy = std::make_shared<timers_values>(tv);
+    auto add = [&](bool s_flag, std::list<addr_storage>& sources) {
+        kernel_op op;
+        op.type = KOT_GROUP_QUERY;
+        op.if_index = if_index;
+        op.gaddr = gaddr;
+        op.tv = tv_copy;
+        op.s_flag = s_flag;
+        op.query_slist = std::move(sources);
+
+        enqueue(kernel_op_key(KOT_GROUP_QUERY, if_index, gaddr, addr_storage(), ++m_seq), op);
+    };
+
+    if (!slist_higher.empty()) {
+        add(true, slist_higher);
+    }
+
+    if (!slist_lower.empty()) {
+        add(false, slist_lower);
+    }
+
+    return rc;
+}
+
+void kernel_io::send_report(unsigned int if_index, const std::list<report_record>& records)
+{
+    HC_LOG_TRACE("");
+    kernel_op op;
+    op.type = KOT_REPORT;
+    op.if_index = if_index;
+    op.records = records;
+
+    //reports carry state changes and are never coalesced
+    enqueue(kernel_op_key(KOT_REPORT, if_index, addr_storage(), addr_storage(), ++m_seq), op);
+}
+
+void kernel_io::commit()
+{
+    HC_LOG_TRACE("");
+    release(false);
+}
+
+void kernel_io::release(bool immediately)
+{
+    HC_LOG_TRACE("");
+
+    if (m_synchronous) {
+        std::list<kernel_op> batch;
+        {
+            std::lock_guard<std::mutex> lock(m_global_lock);
+            batch.splice(batch.end(), m_queue);
+            m_index.clear();
+        }
+        execute_batch(batch);
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(m_global_lock);
+            if (m_queue.empty()) {
+                return;
+            }
+
+            bool only_queries = std::all_of(m_queue.begin(), m_queue.end(), [](const kernel_op & op) {
+                return op.type == KOT_GENERAL_QUERY || op.type == KOT_GROUP_QUERY;
+            });
+
+            if (immediately || !only_queries) {
+                m_commit_pending = true;
+            } else if (!m_query_tick_pending) {
+                //wait for the queries of the other queriers
+                m_query_tick_pending = true;
+                m_query_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(KERNEL_IO_QUERY_TICK);
+            } else {
+                return;
+            }
+        }
+        m_con_var.notify_one();
+    }
+}
+
+void kernel_io::sync()
+{
+    HC_LOG_TRACE("");
+    release(true);
+
+    if (!m_synchronous) {
+        std::unique_lock<std::mutex> lock(m_global_lock);
+        m_idle_con_var.wait(lock, [this]() {
+            return !m_commit_pending && !m_busy;
+        });
+    }
+}
+
+unsigned int kernel_io::get_pending_count() const
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+    return m_queue.size();
+}
+
+std::string kernel_io::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+    std::ostringstream s;
+    s << "kernel io: pending:" << m_queue.size() << " executed:" << m_executed << " coalesced:" << m_coalesced << " failed:" << m_failed;
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const kernel_io& kio)
+{
+    return stream << kio.to_string();
+}
+
+std::string kernel_io::get_kernel_op_type_name(kernel_op_type kot)
+{
+    HC_LOG_TRACE("");
+
+    std::map<kernel_op_type, std::string> name_map = {
+        {KOT_ADD_ROUTE,     "ADD_ROUTE"    },
+        {KOT_DEL_ROUTE,     "DEL_ROUTE"    },
+        {KOT_RECORD,        "RECORD"       },
+        {KOT_GENERAL_QUERY, "GENERAL_QUERY"},
+        {KOT_GROUP_QUERY,   "GROUP_QUERY"  },
+        {KOT_REPORT,        "REPORT"       }
+    };
+    return name_map[kot];
+}
+
+#ifdef DEBUG_MODE
+void kernel_io::test_kernel_io()
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+    cout << "##-- test kernel io --##" << endl;
+
+    const shared_ptr<const interfaces> ifs;
+    auto s = make_shared<sender>(ifs, IGMPv3);
+
+    //without routing module, routes fail
+    kernel_io kio(s, nullptr, nullptr);
+    timers_values tv;
+    addr_storage g1("239.1.1.1");
+    addr_storage g2("239.1.1.2");
+    addr_storage s1("10.0.0.1");
+
+    cout << "add and delete (10.0.0.1, 239.1.1.1)" << endl;
+    kio.add_route(1, g1, s1, {2, 3});
+    kio.del_route(1, g1, s1);
+    cout << "two reports for 239.1.1.2" << endl;
+    kio.send_record(1, INCLUDE_MODE, g2, source_list<source>());
+    kio.send_record(1, EXCLUDE_MODE, g2, source_list<source>());
+    cout << "two general queries" << endl;
+    kio.send_general_query(1, tv);
+    kio.send_general_query(1, tv);
+    cout << "pending (expected 4): " << kio.get_pending_count() << endl;
+    cout << "add (10.0.0.1, 239.1.1.1) again, it is queued last" << endl;
+    kio.add_route(1, g1, s1, {2});
+    cout << "pending (expected 4): " << kio.get_pending_count() << endl;
+
+    kio.sync();
+    cout << kio << endl;
+    cout << "expected: executed:4 coalesced:3 failed:1" << endl;
+}
+#endif /* DEBUG_MODE */
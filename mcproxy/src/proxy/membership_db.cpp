@@ -82,14 +82,18 @@ void membership_db::test_arithmetic()
 }
 #endif /* DEBUG_MODE */
 
-gaddr_info::gaddr_info(group_mem_protocol compatibility_mode_variable)
-    : filter_mode(INCLUDE_MODE)
+gaddr_info::gaddr_info(group_mem_protocol compatibility_mode_variable, const std::shared_ptr<mem_arena>& arena)
+    : arena(arena)
+    , filter_mode(INCLUDE_MODE)
     , shared_filter_timer(nullptr)
     , compatibility_mode_variable(compatibility_mode_variable)
     , older_host_present_timer(nullptr)  
     , group_retransmission_timer(nullptr)
     , group_retransmission_count(-1) //not in a retransmission state
     , source_retransmission_timer(nullptr)
+    , include_requested_list(source_list<source>::allocator_type(arena))
+    , exclude_list(source_list<source>::allocator_type(arena))
+    , metric_sources(0)
 {
     HC_LOG_TRACE("");
 }
@@ -153,7 +157,8 @@ membership_db::membership_db(group_mem_protocol querier_version_mode)
     , startup_query_count(0)
     , querier_version_mode(querier_version_mode)
     , is_querier(true)
-
+    , arena(std::make_shared<mem_arena>())
+    , group_info(gaddr_map::allocator_type(arena))
 {
     HC_LOG_TRACE("");
 }
@@ -178,6 +183,32 @@ std::string membership_db::to_string() const
     return s.str();
 }
 
+std::string membership_db::get_memory_report() const
+{
+    using namespace std;
+    size_t reserved = arena->get_bytes_reserved();
+    size_t group_bytes = arena->get_bytes_in_use(MAK_GROUP);
+    size_t source_count = arena->get_blocks_in_use(MAK_SOURCE);
+    size_t source_bytes = arena->get_bytes_in_use(MAK_SOURCE);
+    size_t timer_count = arena->get_blocks_in_use(MAK_TIMER);
+    size_t timer_bytes = arena->get_bytes_in_use(MAK_TIMER);
+
+    ostringstream s;
+    s << "memory reserved: " << reserved << " bytes" << endl;
+    s << "groups: " << group_info.size() << " (" << group_bytes << " bytes";
+    if (!group_info.empty()) {
+        s << ", " << reserved / group_info.size() << " bytes per group in total";
+    }
+    s << ")" << endl;
+    s << "sources: " << source_count << " (" << source_bytes << " bytes";
+    if (source_count > 0) {
+        s << ", " << source_bytes / source_count << " bytes per source";
+    }
+    s << ")" << endl;
+    s << "timers: " << timer_count << " (" << timer_bytes << " bytes)";
+    return s.str();
+}
+
 std::ostream& operator<<(std::ostream& stream, const membership_db& mdb)
 {
     return stream << mdb.to_string();
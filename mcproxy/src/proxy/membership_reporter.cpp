@@ -0,0 +1,442 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/proxy/membership_reporter.hpp"
+#include "include/proxy/kernel_io.hpp"
+#include "include/proxy/timing.hpp"
+#include "include/proxy/interfaces.hpp"
+#include "include/proxy/worker.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <iostream>
+
+membership_reporter::upstream_state::upstream_state()
+    : general_query_pending(false)
+{
+    HC_LOG_TRACE("");
+}
+
+membership_reporter::membership_reporter(int addr_family, const worker* msg_worker, const std::shared_ptr<kernel_io>& kio, const std::shared_ptr<timing>& timing, unsigned int seed)
+    : m_addr_family(addr_family)
+    , m_msg_worker(msg_worker)
+    , m_kernel_io(kio)
+    , m_timing(timing)
+    , m_random(seed)
+{
+    HC_LOG_TRACE("");
+
+    if (m_kernel_io == nullptr) {
+        HC_LOG_ERROR("membership reporter without kernel io");
+        throw "membership reporter without kernel io";
+    }
+}
+
+membership_reporter::~membership_reporter()
+{
+    HC_LOG_TRACE("");
+
+    while (!m_upstreams.empty()) {
+        del_interface(m_upstreams.begin()->first);
+    }
+}
+
+std::chrono::milliseconds membership_reporter::get_random_delay(std::chrono::milliseconds max)
+{
+    HC_LOG_TRACE("");
+    if (max.count() <= 0) {
+        return std::chrono::milliseconds(0);
+    }
+
+    std::uniform_int_distribution<long> dist(0, max.count());
+    return std::chrono::milliseconds(dist(m_random));
+}
+
+report_record membership_reporter::get_record(mcast_addr_record_type type, const addr_storage& gaddr, const std::set<addr_storage>& slist) const
+{
+    HC_LOG_TRACE("");
+    report_record rr;
+    rr.type = type;
+    rr.gaddr = gaddr;
+    rr.slist.assign(slist.begin(), slist.end());
+    return rr;
+}
+
+std::list<report_record> membership_reporter::get_state_change_records(const addr_storage& gaddr, const group_state* old_state, const group_state& new_state) const
+{
+    HC_LOG_TRACE("");
+    std::list<report_record> result;
+
+    //a group without state is INCLUDE({})
+    const mc_filter old_mode = old_state != nullptr ? old_state->filter_mode : INCLUDE_MODE;
+    const std::set<addr_storage> empty;
+    const std::set<addr_storage>& a = old_state != nullptr ? old_state->slist : empty;
+    const std::set<addr_storage>& b = new_state.slist;
+
+    auto diff = [](const std::set<addr_storage>& l, const std::set<addr_storage>& r) {
+        std::set<addr_storage> d;
+        std::set_difference(l.begin(), l.end(), r.begin(), r.end(), std::inserter(d, d.end()));
+        return d;
+    };
+
+    //RFC 3376 Section 5.1, RFC 3810 Section 6.1
+    if (old_mode == new_state.filter_mode) {
+        std::set<addr_storage> allow;
+        std::set<addr_storage> block;
+
+        if (new_state.filter_mode == INCLUDE_MODE) {
+            allow = diff(b, a);
+            block = diff(a, b);
+        } else {
+            allow = diff(a, b);
+            block = diff(b, a);
+        }
+
+        if (!allow.empty()) {
+            result.push_back(get_record(ALLOW_NEW_SOURCES, gaddr, allow));
+        }
+
+        if (!block.empty()) {
+            result.push_back(get_record(BLOCK_OLD_SOURCES, gaddr, block));
+        }
+    } else if (new_state.filter_mode == EXCLUDE_MODE) {
+        result.push_back(get_record(CHANGE_TO_EXCLUDE_MODE, gaddr, b));
+    } else {
+        result.push_back(get_record(CHANGE_TO_INCLUDE_MODE, gaddr, b));
+    }
+
+    return result;
+}
+
+void membership_reporter::add_interface(unsigned int if_index, unsigned int robustness_variable)
+{
+    HC_LOG_TRACE("");
+    m_robustness_variables[if_index] = robustness_variable > 0 ? robustness_variable : 1;
+}
+
+void membership_reporter::set_state(unsigned int if_index, mc_filter filter_mode, const addr_storage& gaddr, const source_list<source>& slist)
+{
+    HC_LOG_TRACE("");
+
+    auto rit = m_robustness_variables.find(if_index);
+    if (rit == std::end(m_robustness_variables)) {
+        HC_LOG_ERROR("upstream interface " << interfaces::get_if_name(if_index) << " not registered");
+        return;
+    }
+
+    group_state new_state;
+    new_state.filter_mode = filter_mode;
+    for (auto & e : slist) {
+        new_state.slist.insert(e.saddr);
+    }
+
+    auto& us = m_upstreams[if_index];
+    auto git = us.groups.find(gaddr);
+    const group_state* old_state = git != std::end(us.groups) ? &git->second : nullptr;
+
+    if (old_state == nullptr) {
+        if (new_state.filter_mode == INCLUDE_MODE && new_state.slist.empty()) {
+            return;
+        }
+    } else if (old_state->filter_mode == new_state.filter_mode && old_state->slist == new_state.slist) {
+        return;
+    }
+
+    pending_change pc;
+    auto cit = us.changes.find(gaddr);
+    if (cit != std::end(us.changes)) {
+        //the former change is not sent or still retransmitted, so the router may
+        //not know which state a difference refers to, report the whole new state instead
+        pc.records.push_back(get_record(new_state.filter_mode == EXCLUDE_MODE ? CHANGE_TO_EXCLUDE_MODE : CHANGE_TO_INCLUDE_MODE, gaddr, new_state.slist));
+    } else {
+        pc.records = get_state_change_records(gaddr, old_state, new_state);
+    }
+    pc.remaining = rit->second;
+    pc.sent = false;
+    us.changes[gaddr] = pc;
+
+    if (new_state.filter_mode == INCLUDE_MODE && new_state.slist.empty()) {
+        us.groups.erase(gaddr);
+    } else {
+        us.groups[gaddr] = new_state;
+    }
+
+    m_unsent.insert(if_index);
+}
+
+void membership_reporter::send_changes(unsigned int if_index, upstream_state& us, bool first_transmission)
+{
+    HC_LOG_TRACE("");
+    std::list<report_record> records;
+
+    for (auto it = us.changes.begin(); it != us.changes.end();) {
+        auto& pc = it->second;
+        if (pc.sent != first_transmission) {
+            records.insert(records.end(), pc.records.begin(), pc.records.end());
+            pc.sent = true;
+            --pc.remaining;
+        }
+
+        if (pc.remaining == 0) {
+            it = us.changes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (!records.empty()) {
+        m_kernel_io->send_report(if_index, records);
+    }
+}
+
+void membership_reporter::set_change_timer(unsigned int if_index, upstream_state& us)
+{
+    HC_LOG_TRACE("");
+    if (us.changes.empty() || us.change_timer != nullptr || m_timing == nullptr) {
+        return;
+    }
+
+    auto delay = get_random_delay(std::chrono::milliseconds(MEMBERSHIP_REPORTER_UNSOLICITED_REPORT_INTERVAL));
+    us.change_timer = std::make_shared<upstream_report_timer_msg>(if_index, delay);
+    m_timing->add_time(delay, m_msg_worker, us.change_timer);
+}
+
+void membership_reporter::flush()
+{
+    HC_LOG_TRACE("");
+
+    for (auto if_index : m_unsent) {
+        auto it = m_upstreams.find(if_index);
+        if (it != std::end(m_upstreams)) {
+            send_changes(if_index, it->second, true);
+            set_change_timer(if_index, it->second);
+        }
+    }
+
+    m_unsent.clear();
+}
+
+void membership_reporter::send_current_state(unsigned int if_index, upstream_state& us)
+{
+    HC_LOG_TRACE("");
+    std::list<report_record> records;
+
+    auto add_record = [&](const addr_storage & gaddr, const group_state & gs) {
+        records.push_back(get_record(gs.filter_mode == EXCLUDE_MODE ? MODE_IS_EXCLUDE : MODE_IS_INCLUDE, gaddr, gs.slist));
+    };
+
+    if (us.general_query_pending) {
+        for (auto & e : us.groups) {
+            add_record(e.first, e.second);
+        }
+    } else {
+        //a group and source specific query is answered with the whole group state
+        for (auto & gaddr : us.queried_groups) {
+            auto git = us.groups.find(gaddr);
+            if (git != std::end(us.groups)) {
+                add_record(git->first, git->second);
+            }
+        }
+    }
+
+    us.general_query_pending = false;
+    us.queried_groups.clear();
+
+    if (!records.empty()) {
+        m_kernel_io->send_report(if_index, records);
+    }
+}
+
+void membership_reporter::receive_query(unsigned int if_index, const addr_storage& gaddr, std::chrono::milliseconds max_resp_time)
+{
+    HC_LOG_TRACE("");
+
+    auto it = m_upstreams.find(if_index);
+    if (it == std::end(m_upstreams)) {
+        return;
+    }
+    auto& us = it->second;
+
+    if (gaddr == addr_storage(m_addr_family)) {
+        us.general_query_pending = true;
+    } else if (us.groups.find(gaddr) != std::end(us.groups)) {
+        us.queried_groups.insert(gaddr);
+    } else {
+        return;
+    }
+
+    auto delay = get_random_delay(max_resp_time);
+    if (delay.count() == 0 || m_timing == nullptr) {
+        us.response_timer = nullptr;
+        send_current_state(if_index, us);
+    } else if (us.response_timer == nullptr || us.response_timer->is_remaining_time_greater_than(delay)) {
+        //RFC 3376 Section 5.2, an earlier answer is never delayed
+        us.response_timer = std::make_shared<upstream_report_timer_msg>(if_index, delay);
+        m_timing->add_time(delay, m_msg_worker, us.response_timer);
+    }
+}
+
+void membership_reporter::timer_triggerd(const std::shared_ptr<proxy_msg>& msg)
+{
+    HC_LOG_TRACE("");
+    if (msg->get_type() != proxy_msg::UPSTREAM_REPORT_TIMER_MSG) {
+        HC_LOG_ERROR("unknown timer message format");
+        return;
+    }
+
+    auto tm = std::static_pointer_cast<upstream_report_timer_msg>(msg);
+    auto it = m_upstreams.find(tm->get_if_index());
+    if (it == std::end(m_upstreams)) {
+        return;
+    }
+    auto& us = it->second;
+
+    if (tm == us.change_timer) {
+        us.change_timer = nullptr;
+        send_changes(tm->get_if_index(), us, false);
+        set_change_timer(tm->get_if_index(), us);
+    } else if (tm == us.response_timer) {
+        us.response_timer = nullptr;
+        send_current_state(tm->get_if_index(), us);
+    } else {
+        HC_LOG_DEBUG("filtered timer message");
+    }
+
+    if (us.groups.empty() && us.changes.empty()) {
+        m_upstreams.erase(it);
+    }
+}
+
+void membership_reporter::del_interface(unsigned int if_index)
+{
+    HC_LOG_TRACE("");
+    m_robustness_variables.erase(if_index);
+
+    auto it = m_upstreams.find(if_index);
+    if (it == std::end(m_upstreams)) {
+        return;
+    }
+
+    std::list<report_record> records;
+    for (auto & e : it->second.groups) {
+        records.push_back(get_record(CHANGE_TO_INCLUDE_MODE, e.first, std::set<addr_storage>()));
+    }
+
+    if (!records.empty()) {
+        m_kernel_io->send_report(if_index, records);
+    }
+
+    m_upstreams.erase(it);
+    m_unsent.erase(if_index);
+}
+
+unsigned int membership_reporter::get_group_count() const
+{
+    HC_LOG_TRACE("");
+    unsigned int result = 0;
+    for (auto & e : m_upstreams) {
+        result += e.second.groups.size();
+    }
+    return result;
+}
+
+std::string membership_reporter::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+    s << "##-- membership reporter --##";
+    for (auto & e : m_upstreams) {
+        s << std::endl << "upstream interface: " << interfaces::get_if_name(e.first);
+        s << " (pending changes: " << e.second.changes.size() << ")";
+        for (auto & g : e.second.groups) {
+            s << std::endl << "\t" << g.first << " " << get_mc_filter_name(g.second.filter_mode) << " {";
+            for (auto it = g.second.slist.begin(); it != g.second.slist.end(); ++it) {
+                s << (it == g.second.slist.begin() ? "" : ", ") << *it;
+            }
+            s << "}";
+        }
+    }
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const membership_reporter& mr)
+{
+    HC_LOG_TRACE("");
+    return stream << mr.to_string();
+}
+
+#ifdef DEBUG_MODE
+void membership_reporter::test_membership_reporter()
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+    cout << "##-- test membership reporter --##" << endl;
+
+    const shared_ptr<const interfaces> ifs;
+    auto s = make_shared<sender>(ifs, IGMPv3);
+    auto kio = make_shared<kernel_io>(s, nullptr, nullptr, true);
+
+    addr_storage g1("239.1.1.1");
+    addr_storage g2("239.1.1.2");
+    source_list<source> sl1 {source(addr_storage("10.0.0.1")), source(addr_storage("10.0.0.2"))};
+    source_list<source> sl2 {source(addr_storage("10.0.0.2")), source(addr_storage("10.0.0.3"))};
+    {
+        membership_reporter mr(AF_INET, nullptr, kio, nullptr, 1);
+        mr.add_interface(1, 2);
+
+        cout << "join 239.1.1.1 INCLUDE{10.0.0.1, 10.0.0.2} and 239.1.1.2 EXCLUDE{}" << endl;
+        mr.set_state(1, INCLUDE_MODE, g1, sl1);
+        mr.set_state(1, EXCLUDE_MODE, g2, source_list<source>());
+        mr.flush();
+        kio->sync();
+        cout << "expected: one report with ALLOW and TO_EX" << endl;
+
+        cout << "239.1.1.1 INCLUDE{10.0.0.2, 10.0.0.3} (pending retransmission)" << endl;
+        mr.set_state(1, INCLUDE_MODE, g1, sl2);
+        mr.flush();
+        kio->sync();
+        cout << "expected: TO_IN{10.0.0.2, 10.0.0.3}" << endl;
+
+        cout << mr << endl;
+
+        cout << "general query" << endl;
+        mr.receive_query(1, addr_storage(AF_INET), std::chrono::milliseconds(0));
+        kio->sync();
+        cout << "expected: IS_IN and IS_EX" << endl;
+
+        cout << "leave all groups" << endl;
+    }
+    kio->sync();
+    cout << "expected: TO_IN{} for both groups" << endl;
+
+    cout << "state change records" << endl;
+    membership_reporter mr(AF_INET, nullptr, kio, nullptr, 1);
+    group_state a {INCLUDE_MODE, {addr_storage("10.0.0.1"), addr_storage("10.0.0.2")}};
+    group_state b {INCLUDE_MODE, {addr_storage("10.0.0.2"), addr_storage("10.0.0.3")}};
+    for (auto & e : mr.get_state_change_records(g1, &a, b)) {
+        cout << get_mcast_addr_record_type_name(e.type) << " " << e.slist.size() << endl;
+    }
+    cout << "expected: ALLOW 1 and BLOCK 1" << endl;
+}
+#endif /* DEBUG_MODE */
@@ -35,7 +35,7 @@
 #include <net/if.h>
 
 mld_receiver::mld_receiver(proxy_instance* pr_i, const std::shared_ptr<const mroute_socket> mrt_sock, const std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode)
-    : receiver(pr_i, AF_INET6, mrt_sock, interfaces, in_debug_testing_mode)
+    : proto_receiver<mld_traits>(pr_i, mrt_sock, interfaces, in_debug_testing_mode)
 {
     HC_LOG_TRACE("");
     if (!m_mrt_sock->set_ipv6_recv_icmpv6_msg()) {
@@ -49,6 +49,14 @@ mld_receiver::mld_receiver(proxy_instance* pr_i, const std::shared_ptr<const mro
     start();
 }
 
+mld_receiver::~mld_receiver()
+{
+    HC_LOG_TRACE("");
+
+    stop();
+    join();
+}
+
 int mld_receiver::get_iov_min_size()
 {
     HC_LOG_TRACE("");
@@ -64,7 +72,7 @@ int mld_receiver::get_ctrl_min_size()
     return sizeof(struct cmsghdr) + sizeof(struct in6_pktinfo);
 }
 
-void mld_receiver::analyse_packet(struct msghdr* msg, int)
+void mld_receiver::analyse_packet(struct msghdr* msg, int info_size)
 {
     HC_LOG_TRACE("");
 
@@ -99,6 +107,7 @@ void mld_receiver::analyse_packet(struct msghdr* msg, int)
                 return;
             }
 
+            count_message(if_index, "cache_miss");
             m_proxy_instance->add_msg(std::make_shared<new_source_msg>(if_index, gaddr, saddr));
             break;
         }
@@ -133,10 +142,12 @@ void mld_receiver::analyse_packet(struct msghdr* msg, int)
 
         if (hdr->mld_type == MLD_LISTENER_REPORT) {
             HC_LOG_DEBUG("\treport received");
-            m_proxy_instance->add_msg(std::make_shared<group_record_msg>(if_index, MODE_IS_EXCLUDE, gaddr, source_list<source>(), MLDv1));
+            count_message(if_index, "mldv1_report");
+            add_record(std::make_shared<group_record_msg>(if_index, MODE_IS_EXCLUDE, gaddr, source_list<source>(), MLDv1, m_receive_time));
         } else if (hdr->mld_type == MLD_LISTENER_REDUCTION) {
             HC_LOG_DEBUG("\tlistener reduction received");
-            m_proxy_instance->add_msg(std::make_shared<group_record_msg>(if_index, CHANGE_TO_INCLUDE_MODE, gaddr, source_list<source>(), MLDv1));
+            count_message(if_index, "mldv1_done");
+            add_record(std::make_shared<group_record_msg>(if_index, CHANGE_TO_INCLUDE_MODE, gaddr, source_list<source>(), MLDv1, m_receive_time));
         } else {
             HC_LOG_ERROR("unkown mld type: " << hdr->mld_type);
         }
@@ -154,12 +165,6 @@ void mld_receiver::analyse_packet(struct msghdr* msg, int)
             return;
         }
 
-        mldv2_mc_report* v3_report = reinterpret_cast<mldv2_mc_report*>(hdr);
-        mldv2_mc_record* rec = reinterpret_cast<mldv2_mc_record*>(reinterpret_cast<unsigned char*>(v3_report) + sizeof(mldv2_mc_report));
-
-        int num_records = ntohs(v3_report->num_of_mc_records);
-        HC_LOG_DEBUG("\tnum of multicast records: " << num_records);
-
         if_index = packet_info->ipi6_ifindex;
         HC_LOG_DEBUG("\treceived on interface:" << interfaces::get_if_name(if_index));
 
@@ -168,31 +173,34 @@ void mld_receiver::analyse_packet(struct msghdr* msg, int)
             return;
         }
 
-        for (int i = 0; i < num_records; ++i) {
-            mcast_addr_record_type rec_type = static_cast<mcast_addr_record_type>(rec->type);
-            unsigned int aux_size = rec->aux_data_len * 4; //RFC 3810 Section 5.2.6 Aux Data Len
-            int nos = ntohs(rec->num_of_srcs);
+        analyse_report(if_index, reinterpret_cast<unsigned char*>(hdr), info_size);
+    } else if (hdr->mld_type == MLD_LISTENER_QUERY) {
+        HC_LOG_DEBUG("MLD_LISTENER_QUERY received");
 
-            gaddr = addr_storage(rec->gaddr);
-            source_list<source> slist;
+        struct in6_pktinfo* packet_info = nullptr;
 
-            in6_addr* src = reinterpret_cast<in6_addr*>(reinterpret_cast<unsigned char*>(rec) + sizeof(mldv2_mc_record));
-            for (int j = 0; j < nos; ++j) {
-                slist.insert(addr_storage(*src));
-                ++src;
+        for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != nullptr; cmsgptr = CMSG_NXTHDR(msg, cmsgptr)) {
+            if (cmsgptr->cmsg_len > 0 && cmsgptr->cmsg_level == IPPROTO_IPV6 && cmsgptr->cmsg_type == IPV6_PKTINFO ) {
+                packet_info = (struct in6_pktinfo*)CMSG_DATA(cmsgptr);
             }
+        }
+        if (packet_info == nullptr) {
+            return;
+        }
 
-            HC_LOG_DEBUG("\trecord type: " << get_mcast_addr_record_type_name(rec_type));
-            HC_LOG_DEBUG("\tgaddr: " << gaddr);
-            HC_LOG_DEBUG("\tnumber of sources: " << slist.size());
-            HC_LOG_DEBUG("\tsource_list: " << slist);
-            m_proxy_instance->add_msg(std::make_shared<group_record_msg>(if_index, rec_type, gaddr, move(slist), MLDv2));
+        if_index = packet_info->ipi6_ifindex;
+        HC_LOG_DEBUG("\treceived on interface:" << interfaces::get_if_name(if_index));
 
-            rec = reinterpret_cast<mldv2_mc_record*>(reinterpret_cast<unsigned char*>(rec) + sizeof(mldv2_mc_record) + nos * sizeof(in6_addr) + aux_size);
+        if (!is_if_index_relevant(if_index)) {
+            HC_LOG_DEBUG("interface is not relevant");
+            return;
         }
-    } else if (hdr->mld_type == MLD_LISTENER_QUERY) {
-        HC_LOG_DEBUG("MLD_LISTENER_QUERY received");
-        HC_LOG_WARN("querier election is not implemented");
+
+        //answered by the membership reporter on an upstream
+        count_message(if_index, "mld_query");
+        gaddr = hdr->mld_addr;
+        auto max_resp_time = timers_values().maxrespc_mldv2_to_maxrespi(ntohs(hdr->mld_maxdelay));
+        m_proxy_instance->add_msg(std::make_shared<query_msg>(if_index, gaddr, max_resp_time));
     } else {
         HC_LOG_DEBUG("unknown MLD-packet: " << (int)(hdr->mld_type));
     }
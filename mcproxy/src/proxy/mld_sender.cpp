@@ -30,130 +30,62 @@
 #include <netinet/ip6.h>
 
 #include <memory>
+#include <cstring>
 
-mld_sender::mld_sender(const std::shared_ptr<const interfaces>& interfaces): sender(interfaces, MLDv2)
+mld_sender::mld_sender(const std::shared_ptr<const interfaces>& interfaces)
+    : proto_sender<mld_traits, mld_sender>(interfaces)
 {
     HC_LOG_TRACE("");
 
-    if (is_IPv6(m_group_mem_protocol)) {
-        if (!m_sock.set_ipv6_auto_icmp6_checksum_calc(true)) {
-            throw "failed to set default icmmpv6 checksum";
-        }
-        if (!add_hbh_opt_header()) {
-            throw "failed to add router alert header";
-        }
-    } else {
-        HC_LOG_ERROR("wrong address family: " << get_group_mem_protocol_name(m_group_mem_protocol));
-        throw "wrong address family";
+    if (!m_sock.set_ipv6_auto_icmp6_checksum_calc(true)) {
+        throw "failed to set default icmmpv6 checksum";
     }
-}
-
-bool mld_sender::send_record(unsigned int if_index, mc_filter filter_mode, const addr_storage& gaddr, const source_list<source>& slist) const
-{
-    HC_LOG_TRACE("");
-
-    if (filter_mode == INCLUDE_MODE && slist.empty() ) {
-        m_sock.leave_group(gaddr, if_index);
-        return true;
-    } else if (filter_mode == EXCLUDE_MODE || filter_mode == EXCLUDE_MODE) {
-        m_sock.join_group(gaddr, if_index);
-        std::list<addr_storage> src_list;
-        for (auto & e : slist) {
-            src_list.push_back(e.saddr);
-        }
-
-        return m_sock.set_source_filter(if_index, gaddr, filter_mode, src_list);
-    } else {
-        HC_LOG_ERROR("unknown filter mode");
-        return false;
+    if (!add_hbh_opt_header()) {
+        throw "failed to add router alert header";
     }
 }
 
-bool mld_sender::send_general_query(unsigned int if_index, const timers_values& tv) const
+void mld_sender::encode_query(const query_template& qt, const query_request& q, std::vector<unsigned char>& buf) const
 {
     HC_LOG_TRACE("");
 
-    return send_mldv2_query(if_index, tv, addr_storage(AF_INET6), false, source_list<source>());
-}
-
-bool mld_sender::send_mc_addr_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag) const
-{
-    HC_LOG_TRACE("");
-
-    return send_mldv2_query(if_index, tv, gaddr, s_flag, source_list<source>());
-}
-
-bool mld_sender::send_mc_addr_and_src_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, source_list<source>& slist) const
-{
-    HC_LOG_TRACE("");
-
-    source_list<source> slist_lower;
-    source_list<source> slist_higher;
-    bool rc = false;
-    for (auto & e : slist) {
-        if (e.retransmission_count > 0) {
-            e.retransmission_count--;
-
-            if (e.retransmission_count > 0 ) {
-                rc = true;
-            }
-
-            if (e.shared_source_timer.get() != nullptr) {
-                if (e.shared_source_timer->is_remaining_time_greater_than(tv.get_last_listener_query_time())) {
-                    slist_higher.insert(e);
-                } else {
-                    slist_lower.insert(e);
-                }
-            } else {
-                HC_LOG_ERROR("the shared source timer shouldnt be null");
-            }
-        }
+    if (mld_traits::is_unspecified(q.gaddr)) { //general query
+        buf.insert(buf.end(), qt.general_query.begin(), qt.general_query.end());
+        return;
     }
 
-    if (!slist_higher.empty()) {
-        send_mldv2_query(if_index, tv, gaddr, true, slist_higher);
-    }
+    //all other types of queries
+    std::size_t offset = buf.size();
+    buf.resize(offset + qt.specific_query.size() + (q.slist.size() * sizeof(mld_traits::addr_type)));
+    memcpy(&buf[offset], qt.specific_query.data(), qt.specific_query.size());
 
-    if (!slist_lower.empty()) {
-        send_mldv2_query(if_index, tv, gaddr, false, slist_lower);
-    }
+    mldv2_query* query = reinterpret_cast<mldv2_query*>(&buf[offset]);
+    query->gaddr = mld_traits::get_addr(q.gaddr);
+    query->suppress = q.s_flag;
+    query->num_of_srcs = htons(q.slist.size());
 
-    return rc;
+    mld_traits::addr_type* source_ptr = reinterpret_cast<mld_traits::addr_type*>(&buf[offset + sizeof(mldv2_query)]);
+    for (auto & e : q.slist) {
+        *source_ptr = mld_traits::get_addr(e);
+        source_ptr++;
+    }
 }
 
-bool mld_sender::send_mldv2_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag, const source_list<source>& slist) const
+void mld_sender::build_query_template(unsigned int, const timers_values& tv, query_template& qt) const
 {
     HC_LOG_TRACE("");
 
-    std::unique_ptr<mldv2_query> q;
-    unsigned int size;
-
-    if (slist.empty()) {
-        size = sizeof(mldv2_query);
-        q.reset(new mldv2_query);
-    } else {
-        size = sizeof(mldv2_query) + (slist.size() * sizeof(in6_addr));
-        q.reset(reinterpret_cast<mldv2_query*>(new unsigned char[size]));
-    }
+    qt.general_query.assign(sizeof(mldv2_query), 0);
+    mldv2_query* q = reinterpret_cast<mldv2_query*>(qt.general_query.data());
 
     q->type = MLD_LISTENER_QUERY;
     q->code = 0;
     q->checksum = MC_MASSAGES_AUTO_FILL;
-
-    addr_storage dst_addr;
-
-    if (gaddr == addr_storage(AF_INET6)) { //general query
-        dst_addr = IPV6_ALL_NODES_ADDR;
-        q->max_resp_delay = htons(tv.maxrespi_to_maxrespc_mldv2(tv.get_query_response_interval()));
-    } else { //all other types of queries
-        dst_addr = gaddr;
-        q->max_resp_delay = htons(tv.maxrespi_to_maxrespc_mldv2(tv.get_last_listener_query_time()));
-    }
-
+    q->max_resp_delay = htons(mld_traits::encode_max_resp(tv, tv.get_query_response_interval()));
     q->reserved = 0;
-    q->gaddr = gaddr.get_in6_addr();
+    q->gaddr = in6_addr();
     q->resv2 = 0;
-    q->suppress = s_flag;
+    q->suppress = false;
 
     if (tv.get_robustness_variable() <= 7) {
         q->qrv = tv.get_robustness_variable();
@@ -162,21 +94,35 @@ bool mld_sender::send_mldv2_query(unsigned int if_index, const timers_values& tv
     }
 
     q->qqic = tv.qqi_to_qqic(tv.get_query_interval());
-    q->num_of_srcs = ntohs(slist.size());
-
-    if (!slist.empty()) {
-        in6_addr* source_ptr = reinterpret_cast<in6_addr*>(reinterpret_cast<unsigned char*>(q.get()) + sizeof(mldv2_query));
-        for (auto & e : slist) {
-            *source_ptr = e.saddr.get_in6_addr();
-            source_ptr++;
-        }
-    }
+    q->num_of_srcs = 0;
+
+    //the specific queries use the last listener query time as max response delay
+    qt.specific_query = qt.general_query;
+    reinterpret_cast<mldv2_query*>(qt.specific_query.data())->max_resp_delay = htons(mld_traits::encode_max_resp(tv, tv.get_last_listener_query_time()));
+}
+
+bool mld_sender::send_report_packet(unsigned int if_index, const std::vector<unsigned char>& records, unsigned int num_records) const
+{
+    HC_LOG_TRACE("");
+
+    unsigned int size = sizeof(mldv2_mc_report) + records.size();
+    std::unique_ptr<unsigned char[]> packet(new unsigned char[size]);
+    addr_storage dst_addr(mld_traits::get_report_addr());
+
+    mldv2_mc_report* report = reinterpret_cast<mldv2_mc_report*>(packet.get());
+    report->type = MLD_V2_LISTENER_REPORT;
+    report->reservedA = 0;
+    report->checksum = MC_MASSAGES_AUTO_FILL;
+    report->reservedB = 0;
+    report->num_of_mc_records = htons(num_records);
+
+    memcpy(packet.get() + sizeof(mldv2_mc_report), records.data(), records.size());
 
     if (!m_sock.choose_if(if_index)) {
         return false;
     }
 
-    return m_sock.send_packet(dst_addr, reinterpret_cast<unsigned char*>(q.get()), size);
+    return m_sock.send_packet(dst_addr, packet.get(), size);
 }
 
 bool mld_sender::add_hbh_opt_header() const
@@ -29,6 +29,10 @@
 #include "include/proxy/proxy_instance.hpp"
 //#include "include/proxy/proxy_configuration.hpp"
 #include "include/parser/configuration.hpp"
+#include "include/utils/if_monitor.hpp"
+#include "include/utils/metrics_server.hpp"
+#include "include/utils/flight_recorder.hpp"
+#include "include/proxy/state_server.hpp"
 
 #include <iostream>
 #include <sstream>
@@ -44,6 +48,12 @@ proxy::proxy(int arg_count, char* args[])
     , m_print_proxy_status(false)
     , m_reset_rp_filter(false)
     , m_config_path(CONFIGURATION_DEFAULT_CONIG_PATH)
+    , m_log_path()
+    , m_metrics_path()
+    , m_state_path()
+    , m_flight_recorder_path(std::string(PROXY_FLIGHT_RECORDER_DEFAULT_PATH) + "-" + std::to_string(getpid()) + ".flight")
+    , m_filter_cache_size(FILTER_DECISION_CACHE_DEFAULT_SIZE)
+    , m_stats_interval(STATS_COLLECTOR_DEFAULT_INTERVAL)
     , m_configuration(nullptr)
     , m_timing(std::make_shared<timing>())
 {
@@ -51,9 +61,14 @@ proxy::proxy(int arg_count, char* args[])
 
     signal(SIGINT, proxy::signal_handler);
     signal(SIGTERM, proxy::signal_handler);
+    signal(SIGUSR2, proxy::log_lvl_handler);
 
     prozess_commandline_args(arg_count, args);
 
+    if (!flight_recorder::init(m_flight_recorder_path)) {
+        throw "failed to initialise the flight recorder";
+    }
+
     //admin test
     // Check root privilegis
     if (geteuid() != 0) {  //no root privilegis
@@ -65,6 +80,12 @@ proxy::proxy(int arg_count, char* args[])
 
     start_proxy_instances();
 
+    start_if_monitor();
+
+    start_metrics_server();
+
+    start_state_server();
+
     start();
 }
 
@@ -91,7 +112,7 @@ void proxy::help_output()
     cout << "Usage:" << endl;
     cout << "  mcproxy [-h]" << endl;
     cout << "  mcproxy [-c]" << endl;
-    cout << "  mcproxy [-r] [-d] [-s] [-v [-v]] [-f <config file>]" << endl;
+    cout << "  mcproxy [-r] [-d] [-s] [-v [-v]] [-m <cache size>] [-t <msec>] [-l <log file>] [-p <metrics socket>] [-u <state socket>] [-o <dump file>] [-f <config file>]" << endl;
     cout << endl;
     cout << "\t-h" << endl;
     cout << "\t\tDisplay this help screen." << endl;
@@ -109,6 +130,38 @@ void proxy::help_output()
 
     cout << "\t-v" << endl;
     cout << "\t\tBe verbose. Give twice to see even more messages" << endl;
+    cout << "\t\t(without -d: warnings, twice also infos). The log level can" << endl;
+    cout << "\t\tbe changed at runtime with SIGUSR2, it cycles through" << endl;
+    cout << "\t\terror, warn, info and debug." << endl;
+
+    cout << "\t-l" << endl;
+    cout << "\t\tWrite the log messages to this file instead of stderr" << endl;
+    cout << "\t\t(without -d)." << endl;
+
+    cout << "\t-m" << endl;
+    cout << "\t\tMaximum number of memorised filter decisions per proxy" << endl;
+    cout << "\t\tinstance (default " << FILTER_DECISION_CACHE_DEFAULT_SIZE << ", 0 disables the cache)." << endl;
+
+    cout << "\t-t" << endl;
+    cout << "\t\tInterval in milliseconds to sample the interface and route" << endl;
+    cout << "\t\tcounters (default " << STATS_COLLECTOR_DEFAULT_INTERVAL << ", 0 disables the sampling)." << endl;
+
+    cout << "\t-p" << endl;
+    cout << "\t\tServe counters and gauges in Prometheus text format on" << endl;
+    cout << "\t\tthis unix socket (e.g. curl --unix-socket <socket> http:/metrics)." << endl;
+
+    cout << "\t-u" << endl;
+    cout << "\t\tServe the membership and routing tables of all proxy" << endl;
+    cout << "\t\tinstances on this unix socket, as text or as JSON if the" << endl;
+    cout << "\t\trequest is \"json\" (e.g. curl --unix-socket <socket> http://localhost/state.json)." << endl;
+    cout << "\t\tThe request \"trace <group>[/<prefix length>] ...\" records a timeline" << endl;
+    cout << "\t\tof these groups, \"trace off\" stops it and \"trace.json\" exports it" << endl;
+    cout << "\t\tin the Chrome trace event format." << endl;
+
+    cout << "\t-o" << endl;
+    cout << "\t\tWrite the flight recorder (the last events of each thread)" << endl;
+    cout << "\t\tto this file on SIGUSR1 or a fatal signal (default" << endl;
+    cout << "\t\t" << PROXY_FLIGHT_RECORDER_DEFAULT_PATH << "-<pid>.flight)." << endl;
 
     cout << "\t-f" << endl;
     cout << "\t\tTo specify the configuration file." << endl;
@@ -127,7 +180,7 @@ void proxy::prozess_commandline_args(int arg_count, char* args[])
     if (arg_count == 1) {
 
     } else {
-        for (int c; (c = getopt(arg_count, args, "hrdsvcf:")) != -1;) {
+        for (int c; (c = getopt(arg_count, args, "hrdsvcm:t:l:p:u:o:f:")) != -1;) {
             switch (c) {
             case 'h':
                 help_output();
@@ -148,6 +201,34 @@ void proxy::prozess_commandline_args(int arg_count, char* args[])
             case 'v':
                 m_verbose_lvl++;
                 break;
+            case 'm':
+                try {
+                    m_filter_cache_size = std::stoul(optarg);
+                } catch (std::exception&) {
+                    HC_LOG_ERROR("invalid filter decision cache size: " << optarg);
+                    throw "invalid filter decision cache size";
+                }
+                break;
+            case 't':
+                try {
+                    m_stats_interval = std::stoul(optarg);
+                } catch (std::exception&) {
+                    HC_LOG_ERROR("invalid stats interval: " << optarg);
+                    throw "invalid stats interval";
+                }
+                break;
+            case 'l':
+                m_log_path = std::string(optarg);
+                break;
+            case 'p':
+                m_metrics_path = std::string(optarg);
+                break;
+            case 'u':
+                m_state_path = std::string(optarg);
+                break;
+            case 'o':
+                m_flight_recorder_path = std::string(optarg);
+                break;
             case 'f':
                 m_config_path = std::string(optarg);
                 //if (args[optind][0] != '-') {
@@ -170,7 +251,17 @@ void proxy::prozess_commandline_args(int arg_count, char* args[])
     }
 
     if (!is_logging) {
-        hc_set_default_log_fun(HC_LOG_ERROR_LVL); //no fatal logs defined
+        //written asynchronously by a background thread, errors only unless verbose
+        int log_lvl = HC_LOG_ERROR_LVL; //no fatal logs defined
+        if (m_verbose_lvl == 1) {
+            log_lvl = HC_LOG_WARN_LVL;
+        } else if (m_verbose_lvl >= 2) {
+            log_lvl = HC_LOG_INFO_LVL;
+        }
+
+        if (!hc_start_async_log(log_lvl, m_log_path.empty() ? nullptr : m_log_path.c_str())) {
+            throw "failed to start logging";
+        }
     } else {
         if (m_verbose_lvl == 0) {
             hc_set_default_log_fun(HC_LOG_DEBUG_LVL);
@@ -218,7 +309,7 @@ void proxy::start_proxy_instances()
 
         auto& interfaces = m_configuration->get_interfaces_for_pinstance(instance_name);
 
-        std::unique_ptr<proxy_instance> pr_i(new proxy_instance(m_configuration->get_group_mem_protocol(), instance_name, table_number, interfaces, m_timing));
+        std::unique_ptr<proxy_instance> pr_i(new proxy_instance(m_configuration->get_group_mem_protocol(), instance_name, table_number, pinstance->get_mroute_backend(), pinstance->get_upstream_report_mode(), interfaces, m_timing, m_filter_cache_size, m_stats_interval));
 
         //global rule bindung      
         auto& global_settings = pinstance->get_global_settings();
@@ -226,6 +317,14 @@ void proxy::start_proxy_instances()
                 pr_i->add_msg(std::make_shared<config_msg>(config_msg::SET_GLOBAL_RULE_BINDING, r));
         }
 
+        //robustness and timers of the queriers and of the upstream reports
+        timers_values tv;
+        //std::cout << "!!!!!!!!!!!!!!!!!!!!!!!!!!!!!here I mod the timers and values for debugging aim" << std::endl;
+        //tv.set_query_interval(std::chrono::seconds(15));
+        //tv.set_startup_query_interval(std::chrono::seconds(15));
+        //tv.set_last_listener_query_count(2);
+        //tv.set_last_listener_query_interval(std::chrono::seconds(4));
+
         //add upstream
         unsigned int upstream_priority = 0;
         for (auto & u : upstreams) {
@@ -234,7 +333,7 @@ void proxy::start_proxy_instances()
                 HC_LOG_ERROR("failed to map upstream interface " << u->get_if_name() << " interface index");
                 throw "interface not found";
             }
-            pr_i->add_msg(std::make_shared<config_msg>(config_msg::ADD_UPSTREAM, if_index, upstream_priority, u));
+            pr_i->add_msg(std::make_shared<config_msg>(config_msg::ADD_UPSTREAM, if_index, upstream_priority, u, tv));
             upstream_priority+=get_default_priority_interval();
         }
 
@@ -246,13 +345,6 @@ void proxy::start_proxy_instances()
                 throw "interface not found";
             }
 
-            timers_values tv;
-            //std::cout << "!!!!!!!!!!!!!!!!!!!!!!!!!!!!!here I mod the timers and values for debugging aim" << std::endl;
-            //tv.set_query_interval(std::chrono::seconds(15));
-            //tv.set_startup_query_interval(std::chrono::seconds(15));
-            //tv.set_last_listener_query_count(2);
-            //tv.set_last_listener_query_interval(std::chrono::seconds(4));
-
             pr_i->add_msg(std::make_shared<config_msg>(config_msg::ADD_DOWNSTREAM, if_index, d, tv));
         }
 
@@ -263,6 +355,42 @@ void proxy::start_proxy_instances()
 
 }
 
+void proxy::start_if_monitor()
+{
+    HC_LOG_TRACE("");
+
+    m_if_monitor.reset(new if_monitor(get_addr_family(m_configuration->get_group_mem_protocol()), [this](unsigned int if_index, if_event ife) {
+        //each proxy instance ignores foreign interfaces
+        for (auto & e : m_proxy_instances) {
+            e.second->add_msg(std::make_shared<if_state_msg>(if_index, ife));
+        }
+    }));
+}
+
+void proxy::start_metrics_server()
+{
+    HC_LOG_TRACE("");
+
+    if (!m_metrics_path.empty()) {
+        m_metrics_server.reset(new metrics_server(m_metrics_path));
+    }
+}
+
+void proxy::start_state_server()
+{
+    HC_LOG_TRACE("");
+
+    if (!m_state_path.empty()) {
+        m_state_server.reset(new state_server(m_state_path, [this]() {
+            std::vector<std::shared_ptr<const state_snapshot>> result;
+            for (auto & e : m_proxy_instances) {
+                result.push_back(e.second->get_state_snapshot());
+            }
+            return result;
+        }));
+    }
+}
+
 void proxy::start()
 {
     using namespace std;
@@ -278,8 +406,18 @@ void proxy::start()
     while (m_running) {
 
         if (m_print_proxy_status) {
+            //formatted on this thread, the worker only copies the changed groups
             for (auto & e : m_proxy_instances) {
-                e.second->add_msg(std::make_shared<debug_msg>());
+                auto state = e.second->get_state_snapshot();
+                if (state != nullptr) {
+                    cout << *state << endl;
+                }
+
+                auto stats = e.second->get_stats_snapshot();
+                if (stats != nullptr) {
+                    cout << *stats << endl;
+                }
+                cout << endl;
                 sleep(2);
             }
         } else {
@@ -289,6 +427,9 @@ void proxy::start()
     }
 
 
+    m_if_monitor.reset();
+    m_state_server.reset();
+
     //kill all proxy_instances
     std::for_each(begin(m_proxy_instances), end(m_proxy_instances), [](pair<const int, std::unique_ptr<proxy_instance>>& e) {
         e.second->add_msg(std::make_shared<exit_cmd>());
@@ -416,6 +557,23 @@ void proxy::signal_handler(int)
     proxy::m_running = false;
 }
 
+void proxy::log_lvl_handler(int)
+{
+    switch (hc_get_log_lvl()) {
+    case HC_LOG_ERROR_LVL:
+        hc_set_log_lvl(HC_LOG_WARN_LVL);
+        break;
+    case HC_LOG_WARN_LVL:
+        hc_set_log_lvl(HC_LOG_INFO_LVL);
+        break;
+    case HC_LOG_INFO_LVL:
+        hc_set_log_lvl(HC_LOG_DEBUG_LVL);
+        break;
+    default:
+        hc_set_log_lvl(HC_LOG_ERROR_LVL);
+    }
+}
+
 std::string proxy::to_string() const
 {
     using namespace std;
@@ -424,9 +582,11 @@ std::string proxy::to_string() const
     s << "##-- multicast proxy status --##" << endl;
     s << "is running: " << m_running << endl;
     s << "verbose level: " << m_verbose_lvl << endl;
+    s << "log level: " << hc_get_log_lvl() << endl;
     s << "print proxy_status information: " << m_print_proxy_status << endl;
     s << "reset all reverse path filter: " << m_reset_rp_filter << endl;
     s << "config path: " << m_config_path << endl;
+    s << "metrics socket: " << (m_metrics_path.empty() ? "disabled" : m_metrics_path) << endl;
 
     s << "-- proxy configuration --" << endl;
     s << m_configuration.get()->to_string() << endl;
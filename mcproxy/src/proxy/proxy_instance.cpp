@@ -25,17 +25,15 @@
 #include "include/proxy/proxy_instance.hpp"
 
 #include "include/proxy/receiver.hpp"
-#include "include/proxy/igmp_receiver.hpp"
-#include "include/proxy/mld_receiver.hpp"
 #include "include/proxy/sender.hpp"
-#include "include/proxy/igmp_sender.hpp"
-#include "include/proxy/mld_sender.hpp"
 #include "include/proxy/routing.hpp"
 #include "include/proxy/querier.hpp"
 #include "include/proxy/interfaces.hpp"
 #include "include/proxy/timing.hpp"
 #include "include/proxy/routing_management.hpp"
 #include "include/proxy/simple_mc_proxy_routing.hpp"
+#include "include/proxy/kernel_io.hpp"
+#include "include/proxy/membership_reporter.hpp"
 
 #include <sstream>
 #include <iostream>
@@ -45,18 +43,25 @@
 #include <unistd.h>
 #include <net/if.h>
 
-proxy_instance::proxy_instance(group_mem_protocol group_mem_protocol, const std::string& instance_name, int table_number, const std::shared_ptr<const interfaces>& interfaces, const std::shared_ptr<timing>& shared_timing, bool in_debug_testing_mode)
+proxy_instance::proxy_instance(group_mem_protocol group_mem_protocol, const std::string& instance_name, int table_number, mroute_backend mrb, upstream_report_mode urm, const std::shared_ptr<const interfaces>& interfaces, const std::shared_ptr<timing>& shared_timing, unsigned int filter_cache_size, unsigned int stats_interval, bool in_debug_testing_mode)
 : m_group_mem_protocol(group_mem_protocol)
 , m_instance_name(instance_name)
 , m_table_number(table_number)
+, m_mroute_backend(mrb)
+, m_upstream_report_mode(urm)
 , m_in_debug_testing_mode(in_debug_testing_mode)
+, m_filter_cache_size(filter_cache_size)
+, m_stats_interval(stats_interval)
 , m_interfaces(interfaces)
 , m_timing(shared_timing)
 , m_mrt_sock(nullptr)
 , m_sender(nullptr)
 , m_receiver(nullptr)
 , m_routing(nullptr)
-, m_proxy_start_time(std::chrono::steady_clock::now())
+, m_kernel_io(nullptr)
+, m_reporter(nullptr)
+, m_stats_collector(nullptr)
+, m_proxy_start_time(timing_clock::now())
 , m_upstream_input_rule(std::make_shared<rule_binding>(instance_name, IT_UPSTREAM, "*", ID_IN, RMT_FIRST, std::chrono::milliseconds(0)))
 , m_upstream_output_rule(std::make_shared<rule_binding>(instance_name, IT_UPSTREAM, "*", ID_OUT, RMT_ALL, std::chrono::milliseconds(0)))
 {
@@ -64,6 +69,11 @@ proxy_instance::proxy_instance(group_mem_protocol group_mem_protocol, const std:
     //rule_binding(const std::string& instance_name, rb_interface_type interface_type, const std::string& if_name, rb_interface_direction filter_direction, rb_rule_matching_type rule_matching_type, const std::chrono::milliseconds& timeout);
     HC_LOG_TRACE("");
 
+    metrics& m = metrics::get_instance();
+    for (int i = 0; i < LS_COUNT; ++i) {
+        m_latency[i] = &m.get_histogram("record_latency_seconds", "Processing time of the group records per proxy instance and stage: receive (socket to job queue), queue (waiting in the job queue), querier (membership state incl. route calculation), route_calculation, kernel_add_route.", {{"instance", m_instance_name}, {"stage", get_latency_stage_name(static_cast<latency_stage>(i))}});
+    }
+
     if (!init_mrt_socket()) {
         throw "failed to initialize mroute socket";
     }
@@ -80,11 +90,27 @@ proxy_instance::proxy_instance(group_mem_protocol group_mem_protocol, const std:
         throw "failed to initialise routing";
     }
 
+    if (!init_kernel_io()) {
+        throw "failed to initialise kernel io";
+    }
+
+    if (!init_reporter()) {
+        throw "failed to initialise membership reporter";
+    }
+
+    if (!init_stats_collector()) {
+        throw "failed to initialise stats collector";
+    }
+
     if (!init_routing_management()) {
         throw "failed to initialise routing";
     }
 
-    start();
+    m_job_queue.set_metrics(&m.get_gauge("queue_depth", "Messages waiting in the job queue of a proxy instance.", {{"instance", m_instance_name}}), &m.get_counter("queue_drops_total", "Messages dropped because the job queue of a proxy instance was full.", {{"instance", m_instance_name}}));
+
+    if (!init_worker_thread()) {
+        throw "failed to start the worker thread";
+    }
 }
 
 bool proxy_instance::init_mrt_socket()
@@ -115,41 +141,34 @@ bool proxy_instance::init_mrt_socket()
     return true;
 }
 
-bool proxy_instance::init_sender()
+bool proxy_instance::init_routing()
 {
     HC_LOG_TRACE("");
-    if (is_IPv4(m_group_mem_protocol)) {
-        m_sender = std::make_shared<igmp_sender>(m_interfaces);
-    } else if (is_IPv6(m_group_mem_protocol)) {
-        m_sender = std::make_shared<mld_sender>(m_interfaces);
-    } else {
-        HC_LOG_ERROR("unknown ip version");
-        return false;
-    }
-
+    m_routing.reset(new routing(get_addr_family(m_group_mem_protocol), m_mrt_sock, m_interfaces, m_table_number, m_mroute_backend));
+    m_routing->set_metrics(m_latency[LS_KERNEL_ADD_ROUTE]);
     return true;
 }
 
-bool proxy_instance::init_receiver()
+bool proxy_instance::init_reporter()
 {
     HC_LOG_TRACE("");
-
-    if (is_IPv4(m_group_mem_protocol)) {
-        m_receiver.reset(new igmp_receiver(this, m_mrt_sock, m_interfaces, m_in_debug_testing_mode));
-    } else if (is_IPv6(m_group_mem_protocol)) {
-        m_receiver.reset(new mld_receiver(this, m_mrt_sock, m_interfaces, m_in_debug_testing_mode));
-    } else {
-        HC_LOG_ERROR("unknown ip version");
-        return false;
+    if (m_upstream_report_mode == URM_USERSPACE) {
+        m_reporter.reset(new membership_reporter(get_addr_family(m_group_mem_protocol), this, m_kernel_io, m_timing, get_random_seed()));
     }
-
     return true;
 }
 
-bool proxy_instance::init_routing()
+bool proxy_instance::init_stats_collector()
 {
     HC_LOG_TRACE("");
-    m_routing.reset(new routing(get_addr_family(m_group_mem_protocol), m_mrt_sock, m_interfaces, m_table_number));
+    if (m_stats_interval.count() > 0 && !m_in_debug_testing_mode) {
+        try {
+            m_stats_collector.reset(new stats_collector(get_addr_family(m_group_mem_protocol), m_interfaces, m_table_number, m_mrt_sock, m_stats_interval));
+        } catch (const char* e) {
+            HC_LOG_ERROR("failed to create stats collector: " << e);
+            return false;
+        }
+    }
     return true;
 }
 
@@ -166,70 +185,191 @@ proxy_instance::~proxy_instance()
     add_msg(std::make_shared<exit_cmd>());
 }
 
-void proxy_instance::worker_thread()
+std::shared_ptr<const stats_snapshot> proxy_instance::get_stats_snapshot() const
 {
     HC_LOG_TRACE("");
-    while (m_running) {
-        auto msg = m_job_queue.dequeue();
-        switch (msg->get_type()) {
-        case proxy_msg::TEST_MSG:
-            (*msg)();
-            break;
-        case proxy_msg::CONFIG_MSG:
-            handle_config(std::static_pointer_cast<config_msg>(msg));
-            break;
-        case proxy_msg::FILTER_TIMER_MSG:
-        case proxy_msg::SOURCE_TIMER_MSG:
-        case proxy_msg::RET_GROUP_TIMER_MSG:
-        case proxy_msg::RET_SOURCE_TIMER_MSG:
-        case proxy_msg::OLDER_HOST_PRESENT_TIMER_MSG:
-        case proxy_msg::GENERAL_QUERY_TIMER_MSG: {
-            auto it = m_downstreams.find(std::static_pointer_cast<timer_msg>(msg)->get_if_index());
-            if (it != std::end(m_downstreams)) {
-                it->second.m_querier->timer_triggerd(msg);
-            } else {
-                HC_LOG_DEBUG("failed to find querier of interface: " << interfaces::get_if_name(std::static_pointer_cast<timer_msg>(msg)->get_if_index()));
+    if (m_stats_collector == nullptr) {
+        return nullptr;
+    }
+    return m_stats_collector->get_snapshot();
+}
+
+std::shared_ptr<const state_snapshot> proxy_instance::get_state_snapshot(std::chrono::milliseconds timeout)
+{
+    HC_LOG_TRACE("");
+    unsigned long epoch = m_state_publisher.get_epoch() + 1;
+    add_msg(std::make_shared<state_msg>());
+    return m_state_publisher.wait_for_snapshot(epoch, timeout);
+}
+
+void proxy_instance::publish_state_snapshot()
+{
+    HC_LOG_TRACE("");
+    auto previous = m_state_publisher.get_snapshot();
+
+    auto s = std::make_shared<state_snapshot>();
+    s->time = timing_clock::now();
+    s->instance_name = m_instance_name;
+    s->table_number = m_table_number;
+    s->group_mem_protocol_version = m_group_mem_protocol;
+
+    for (auto & e : m_upstreams) {
+        s->upstreams.push_back(e.m_if_index);
+    }
+
+    for (auto & e : m_downstreams) {
+        const querier& q = *e.second.m_querier;
+        const membership_db& db = q.get_membership_db();
+
+        querier_snapshot qs;
+        qs.if_index = e.first;
+        qs.querier_version_mode = db.querier_version_mode;
+        qs.is_querier = db.is_querier;
+        qs.is_suspended = q.is_suspended();
+        qs.general_query_timer = db.general_query_timer != nullptr ? db.general_query_timer->get_end_time() : timing_clock::time_point();
+        qs.startup_query_count = db.startup_query_count;
+
+        std::shared_ptr<const group_snapshot_map> previous_groups;
+        if (previous != nullptr) {
+            auto it = previous->downstreams.find(e.first);
+            if (it != std::end(previous->downstreams)) {
+                previous_groups = it->second.groups;
             }
         }
+        qs.groups = m_state_publisher.get_groups(db.group_info, previous_groups);
+
+        s->downstreams.insert(std::make_pair(e.first, qs));
+    }
+
+    const simple_routing_data* routing_data = m_routing_management->get_routing_data();
+    s->routes = m_state_publisher.get_routes(routing_data != nullptr ? routing_data->get_data() : s_routing_data(), previous != nullptr ? previous->routes : nullptr);
+
+    m_state_publisher.publish(s);
+}
+
+void proxy_instance::record_latency(latency_stage ls, std::chrono::nanoseconds duration) const
+{
+    HC_LOG_TRACE("");
+    m_latency[ls]->record(duration.count());
+}
+
+void proxy_instance::worker_thread()
+{
+    HC_LOG_TRACE("");
+    while (m_running) {
+        handle_msg(m_job_queue.dequeue());
+    }
+
+    HC_LOG_DEBUG("worker thread proxy_instance end");
+}
+
+void proxy_instance::handle_msg(const std::shared_ptr<proxy_msg>& msg)
+{
+    HC_LOG_TRACE("");
+    switch (msg->get_type()) {
+    case proxy_msg::TEST_MSG:
+        m_state_publisher.mark_all_dirty();
+        (*msg)();
         break;
-        case proxy_msg::GROUP_RECORD_MSG: {
-            auto r =  std::static_pointer_cast<group_record_msg>(msg);
+    case proxy_msg::CONFIG_MSG:
+        m_state_publisher.mark_all_dirty();
+        handle_config(std::static_pointer_cast<config_msg>(msg));
+        break;
+    case proxy_msg::FILTER_TIMER_MSG:
+    case proxy_msg::SOURCE_TIMER_MSG:
+    case proxy_msg::RET_GROUP_TIMER_MSG:
+    case proxy_msg::RET_SOURCE_TIMER_MSG:
+    case proxy_msg::OLDER_HOST_PRESENT_TIMER_MSG:
+    case proxy_msg::GENERAL_QUERY_TIMER_MSG: {
+        m_state_publisher.mark_dirty(std::static_pointer_cast<timer_msg>(msg)->get_gaddr());
+        auto it = m_downstreams.find(std::static_pointer_cast<timer_msg>(msg)->get_if_index());
+        if (it != std::end(m_downstreams)) {
+            it->second.m_querier->timer_triggerd(msg);
+        } else {
+            HC_LOG_DEBUG("failed to find querier of interface: " << interfaces::get_if_name(std::static_pointer_cast<timer_msg>(msg)->get_if_index()));
+        }
+    }
+    break;
+    case proxy_msg::GROUP_RECORD_MSG: {
+        auto r =  std::static_pointer_cast<group_record_msg>(msg);
+        m_state_publisher.mark_dirty(r->get_gaddr());
 
-            if (m_in_debug_testing_mode) {
-                std::cout << "!!--ACTION: receive record" << std::endl;
-                std::cout << *r << std::endl;
-                std::cout << std::endl;
-            }
+        auto start = std::chrono::steady_clock::now();
+        if (r->get_enqueue_time() != std::chrono::steady_clock::time_point()) {
+            record_latency(LS_QUEUE, start - r->get_enqueue_time());
+        }
 
-            auto it = m_downstreams.find(r->get_if_index());
-            if (it != std::end(m_downstreams)) {
-                it->second.m_querier->receive_record(msg);
-            } else {
-                HC_LOG_DEBUG("failed to find querier of interface: " << interfaces::get_if_name(std::static_pointer_cast<timer_msg>(msg)->get_if_index()));
-            }
+        if (m_in_debug_testing_mode) {
+            std::cout << "!!--ACTION: receive record" << std::endl;
+            std::cout << *r << std::endl;
+            std::cout << std::endl;
+        }
+
+        auto it = m_downstreams.find(r->get_if_index());
+        if (it != std::end(m_downstreams)) {
+            it->second.m_querier->receive_record(msg);
+            record_latency(LS_QUERIER, std::chrono::steady_clock::now() - start);
+        } else {
+            HC_LOG_DEBUG("failed to find querier of interface: " << interfaces::get_if_name(std::static_pointer_cast<timer_msg>(msg)->get_if_index()));
+        }
+    }
+    break;
+    case proxy_msg::QUERY_MSG: {
+        auto q = std::static_pointer_cast<query_msg>(msg);
+        if (is_upstream(q->get_if_index()) && m_reporter != nullptr) {
+            m_reporter->receive_query(q->get_if_index(), q->get_gaddr(), q->get_max_resp_time());
+        } else if (is_downstream(q->get_if_index())) {
+            HC_LOG_DEBUG("querier election is not implemented, received a query on downstream interface: " << interfaces::get_if_name(q->get_if_index()));
+        }
+    }
+    break;
+    case proxy_msg::UPSTREAM_REPORT_TIMER_MSG:
+        if (m_reporter != nullptr) {
+            m_reporter->timer_triggerd(msg);
         }
         break;
-        case proxy_msg::NEW_SOURCE_MSG:
-            m_routing_management->event_new_source(msg);
-            break;
-        case proxy_msg::NEW_SOURCE_TIMER_MSG:
-            m_routing_management->timer_triggerd_maintain_routing_table(msg);
-            break;
-        case proxy_msg::DEBUG_MSG:
-            std::cout << *this << std::endl;
-            std::cout << std::endl;
-            break;
-        case proxy_msg::EXIT_MSG:
-            HC_LOG_DEBUG("received exit command");
-            stop();
-            break;
-        default:
-            HC_LOG_ERROR("Received unknown message");
-            break;
+    case proxy_msg::NEW_SOURCE_MSG:
+        m_state_publisher.mark_dirty(std::static_pointer_cast<new_source_msg>(msg)->get_gaddr());
+        m_routing_management->event_new_source(msg);
+        break;
+    case proxy_msg::NEW_SOURCE_TIMER_MSG:
+        m_state_publisher.mark_dirty(std::static_pointer_cast<timer_msg>(msg)->get_gaddr());
+        m_routing_management->timer_triggerd_maintain_routing_table(msg);
+        break;
+    case proxy_msg::IF_STATE_MSG:
+        m_state_publisher.mark_all_dirty();
+        handle_if_state(std::static_pointer_cast<if_state_msg>(msg));
+        break;
+    case proxy_msg::KERNEL_IO_RESULT_MSG: {
+        auto r = std::static_pointer_cast<kernel_io_result_msg>(msg);
+        for (auto & e : r->get_failures()) {
+            HC_LOG_ERROR("kernel operation failed: " << e);
         }
+        HC_LOG_DEBUG("kernel operations: " << r->get_executed() << " failed: " << r->get_failures().size());
+    }
+    break;
+    case proxy_msg::DEBUG_MSG:
+        m_kernel_io->sync();
+        std::cout << *this << std::endl;
+        std::cout << std::endl;
+        break;
+    case proxy_msg::STATE_MSG:
+        publish_state_snapshot();
+        break;
+    case proxy_msg::EXIT_MSG:
+        HC_LOG_DEBUG("received exit command");
+        stop();
+        break;
+    default:
+        HC_LOG_ERROR("Received unknown message");
+        break;
     }
 
-    HC_LOG_DEBUG("worker thread proxy_instance end");
+    //all kernel operations of this message in one batch
+    if (m_reporter != nullptr) {
+        m_reporter->flush();
+    }
+    m_kernel_io->commit();
 }
 
 std::string proxy_instance::to_string() const
@@ -237,15 +377,26 @@ std::string proxy_instance::to_string() const
     HC_LOG_TRACE("");
     std::ostringstream s;
 
-    auto current_time = std::chrono::steady_clock::now();
+    auto current_time = timing_clock::now();
     auto time_span = current_time - m_proxy_start_time;
     double seconds = time_span.count()  * std::chrono::steady_clock::period::num / std::chrono::steady_clock::period::den;
 
-    s << "@@##-- proxy instance " << m_instance_name << " (table:" << m_table_number << ",lifetime:" << seconds << "sec)" << " --##@@" << std::endl;;
+    s << "@@##-- proxy instance " << m_instance_name << " (table:" << m_table_number << ",routes:" << get_mroute_backend_name(m_routing->get_mroute_backend()) << ",reports:" << get_upstream_report_mode_name(m_upstream_report_mode) << ",lifetime:" << seconds << "sec)" << " --##@@" << std::endl;;
     s << m_upstream_input_rule->to_string() << std::endl;
     s << m_upstream_output_rule->to_string() << std::endl;
 
     s << *m_routing_management << std::endl;
+    s << *m_kernel_io << std::endl;
+    if (m_reporter != nullptr) {
+        s << *m_reporter << std::endl;
+    } else {
+        s << *m_sender << std::endl;
+    }
+
+    auto snapshot = get_stats_snapshot();
+    if (snapshot != nullptr) {
+        s << *snapshot << std::endl;
+    }
 
     s << "##-- upstream interfaces --##" << std::endl;
     for (auto & e : m_upstreams) {
@@ -276,6 +427,7 @@ void proxy_instance::handle_config(const std::shared_ptr<config_msg>& msg)
 
             //register interface
             if (!is_upstream(msg->get_if_index())) {
+                m_kernel_io->sync();
                 m_routing->add_vif(msg->get_if_index(), m_interfaces->get_virtual_if_index(msg->get_if_index()));
                 m_receiver->registrate_interface(msg->get_if_index());
             } else {
@@ -284,7 +436,7 @@ void proxy_instance::handle_config(const std::shared_ptr<config_msg>& msg)
 
             //create a querier
             std::function<void(unsigned int, const addr_storage&)> cb_state_change = std::bind(&routing_management::event_querier_state_change, m_routing_management.get(), std::placeholders::_1, std::placeholders::_2);
-            std::unique_ptr<querier> q(new querier(this, m_group_mem_protocol, msg->get_if_index(), m_sender, m_timing, msg->get_timers_values(), cb_state_change));
+            std::unique_ptr<querier> q(new querier(this, m_group_mem_protocol, msg->get_if_index(), m_sender, m_kernel_io, m_timing, msg->get_timers_values(), cb_state_change, m_instance_name, &m_group_index));
             m_downstreams.insert(std::pair<unsigned int, downstream_infos>(msg->get_if_index(), downstream_infos(move(q), msg->get_interface())));
         } else {
             HC_LOG_WARN("downstream interface: " << interfaces::get_if_name(msg->get_if_index()) << " already exists");
@@ -298,6 +450,7 @@ void proxy_instance::handle_config(const std::shared_ptr<config_msg>& msg)
 
             //unregister interface
             if (!is_upstream(msg->get_if_index())) {
+                m_kernel_io->sync();
                 m_routing->del_vif(msg->get_if_index(), m_interfaces->get_virtual_if_index(msg->get_if_index()));
                 m_receiver->del_interface(msg->get_if_index());
             } else {
@@ -320,12 +473,17 @@ void proxy_instance::handle_config(const std::shared_ptr<config_msg>& msg)
             HC_LOG_DEBUG("register upstream interface: " << interfaces::get_if_name(msg->get_if_index()) << " with virtual interface index: " << m_interfaces->get_virtual_if_index(msg->get_if_index()));
 
             if (!is_downstream(msg->get_if_index())) {
+                m_kernel_io->sync();
                 m_routing->add_vif(msg->get_if_index(), m_interfaces->get_virtual_if_index(msg->get_if_index()));
                 m_receiver->registrate_interface(msg->get_if_index());
             } else {
                 HC_LOG_DEBUG("interface also used as downstream");
             }
 
+            if (m_reporter != nullptr) {
+                m_reporter->add_interface(msg->get_if_index(), msg->get_timers_values().get_robustness_variable());
+            }
+
             HC_LOG_DEBUG("registerd upstreams: " << m_upstreams.size());
             HC_LOG_DEBUG("upstream priority: " << msg->get_upstream_priority());
             m_upstreams.insert(upstream_infos(msg->get_if_index(), msg->get_interface(), msg->get_upstream_priority()));
@@ -345,12 +503,18 @@ void proxy_instance::handle_config(const std::shared_ptr<config_msg>& msg)
             HC_LOG_DEBUG("del upstream interface: " << interfaces::get_if_name(msg->get_if_index()) << " with virtual interface index: " << m_interfaces->get_virtual_if_index(msg->get_if_index()));
 
             if (!is_downstream(msg->get_if_index())) {
+                m_kernel_io->sync();
                 m_routing->del_vif(msg->get_if_index(), m_interfaces->get_virtual_if_index(msg->get_if_index()));
                 m_receiver->del_interface(msg->get_if_index());
             } else {
                 HC_LOG_DEBUG("interface still used as downstream");
             }
 
+            //leave the reported groups
+            if (m_reporter != nullptr) {
+                m_reporter->del_interface(msg->get_if_index());
+            }
+
             m_upstreams.erase(it);
         } else {
             HC_LOG_WARN("failed to delete upstream interface: " << interfaces::get_if_name(msg->get_if_index()) << " interface not found");
@@ -382,7 +546,65 @@ void proxy_instance::handle_config(const std::shared_ptr<config_msg>& msg)
     break;
     default:
         HC_LOG_ERROR("unknown config message format");
+        return;
+    }
+
+    //memorised filter decisions depend on the interfaces and their rule bindings
+    m_routing_management->event_config_changed();
+}
+
+void proxy_instance::handle_if_state(const std::shared_ptr<if_state_msg>& msg)
+{
+    HC_LOG_TRACE("");
+    unsigned int if_index = msg->get_if_index();
+
+    if (!is_upstream(if_index) && !is_downstream(if_index)) {
+        return;
+    }
+
+    HC_LOG_DEBUG("interface " << interfaces::get_if_name(if_index) << ": " << if_monitor::get_if_event_name(msg->get_if_event()));
+    auto it = m_downstreams.find(if_index);
+
+    switch (msg->get_if_event()) {
+    case IFE_LINK_DOWN:
+        if (m_down_ifs.insert(if_index).second) {
+            m_kernel_io->sync();
+            m_routing->del_vif(if_index, m_interfaces->get_virtual_if_index(if_index));
+
+            if (it != std::end(m_downstreams)) {
+                it->second.m_querier->suspend();
+            }
+        }
+        break;
+    case IFE_LINK_UP:
+        if (m_down_ifs.erase(if_index) > 0) {
+            m_interfaces->refresh_network_interfaces();
+            m_sender->clear_query_templates(if_index);
+            m_kernel_io->sync();
+            m_routing->add_vif(if_index, m_interfaces->get_virtual_if_index(if_index));
+
+            if (it != std::end(m_downstreams)) {
+                it->second.m_querier->resume();
+            }
+
+            //the upstream router may have missed state changes
+            if (is_upstream(if_index) && m_reporter != nullptr) {
+                m_reporter->receive_query(if_index, addr_storage(get_addr_family(m_group_mem_protocol)), std::chrono::milliseconds(0));
+            }
+        }
+        break;
+    case IFE_ADDR_CHANGED:
+        //source address of the queries
+        m_interfaces->refresh_network_interfaces();
+        m_sender->clear_query_templates(if_index);
+        break;
+    default:
+        HC_LOG_ERROR("unknown interface event");
+        return;
     }
+
+    //memorised filter decisions were made with the previous interface state
+    m_routing_management->event_config_changed();
 }
 
 bool proxy_instance::is_upstream(unsigned int if_index) const
@@ -413,7 +635,7 @@ void proxy_instance::test_querier(std::string if_name)
 
     group_mem_protocol memproto = IGMPv3;
     //create a proxy_instance
-    proxy_instance pr_i(memproto, "test", 0,  make_shared<interfaces>(get_addr_family(memproto), false), make_shared<timing>(), true);
+    proxy_instance pr_i(memproto, "test", 0, MRB_SETSOCKOPT, URM_KERNEL, make_shared<interfaces>(get_addr_family(memproto), false), make_shared<timing>(), FILTER_DECISION_CACHE_DEFAULT_SIZE, STATS_COLLECTOR_DEFAULT_INTERVAL, true);
 
     //add a downstream
     timers_values tv;
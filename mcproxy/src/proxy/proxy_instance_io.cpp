@@ -0,0 +1,90 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ *messg written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/*
+ * The parts of the proxy instance that talk to the Linux kernel: the sender,
+ * the receiver, the kernel io thread and the worker thread. The simulation
+ * build links src/sim/sim_proxy_instance_io.cpp instead.
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/proxy/proxy_instance.hpp"
+#include "include/proxy/igmp_receiver.hpp"
+#include "include/proxy/mld_receiver.hpp"
+#include "include/proxy/igmp_sender.hpp"
+#include "include/proxy/mld_sender.hpp"
+#include "include/proxy/kernel_io.hpp"
+
+#include <random>
+
+bool proxy_instance::init_sender()
+{
+    HC_LOG_TRACE("");
+
+    if (is_IPv4(m_group_mem_protocol)) {
+        m_sender = std::make_shared<igmp_sender>(m_interfaces);
+    } else if (is_IPv6(m_group_mem_protocol)) {
+        m_sender = std::make_shared<mld_sender>(m_interfaces);
+    } else {
+        HC_LOG_ERROR("unknown ip version");
+        return false;
+    }
+
+    return true;
+}
+
+bool proxy_instance::init_receiver()
+{
+    HC_LOG_TRACE("");
+
+    if (is_IPv4(m_group_mem_protocol)) {
+        m_receiver.reset(new igmp_receiver(this, m_mrt_sock, m_interfaces, m_in_debug_testing_mode));
+    } else if (is_IPv6(m_group_mem_protocol)) {
+        m_receiver.reset(new mld_receiver(this, m_mrt_sock, m_interfaces, m_in_debug_testing_mode));
+    } else {
+        HC_LOG_ERROR("unknown ip version");
+        return false;
+    }
+
+    return true;
+}
+
+bool proxy_instance::init_kernel_io()
+{
+    HC_LOG_TRACE("");
+    //keep the debug output in order
+    m_kernel_io = std::make_shared<kernel_io>(m_sender, m_routing.get(), this, m_in_debug_testing_mode);
+    return true;
+}
+
+bool proxy_instance::init_worker_thread()
+{
+    HC_LOG_TRACE("");
+    start();
+    return true;
+}
+
+unsigned int proxy_instance::get_random_seed() const
+{
+    HC_LOG_TRACE("");
+    return std::random_device()();
+}
@@ -30,19 +30,25 @@
 #include "include/proxy/sender.hpp"
 #include "include/proxy/igmp_sender.hpp"
 #include "include/proxy/mld_sender.hpp"
+#include "include/proxy/kernel_io.hpp"
 
 #include <unistd.h>
 #include <iostream>
 #include <sstream>
 
-querier::querier(worker* msg_worker, group_mem_protocol querier_version_mode, int if_index, const std::shared_ptr<const sender>& sender, const std::shared_ptr<timing>& timing, const timers_values& tv, callback_querier_state_change cb_state_change)
+querier::querier(worker* msg_worker, group_mem_protocol querier_version_mode, int if_index, const std::shared_ptr<const sender>& sender, const std::shared_ptr<kernel_io>& kio, const std::shared_ptr<timing>& timing, const timers_values& tv, callback_querier_state_change cb_state_change, const std::string& instance_name, group_interface_index* group_index)
     : m_msg_worker(msg_worker)
     , m_if_index(if_index)
     , m_db(querier_version_mode)
     , m_timers_values(tv)
     , m_cb_state_change(cb_state_change)
+    , m_group_index(group_index)
     , m_sender(sender)
+    , m_kernel_io(kio)
     , m_timing(timing)
+    , m_suspended(false)
+    , m_groups_gauge(metrics::get_instance().get_gauge("groups", "Multicast groups in the membership database of a downstream interface.", {{"instance", instance_name}, {"interface", interfaces::get_if_name(if_index)}}))
+    , m_sources_gauge(metrics::get_instance().get_gauge("sources", "Sources of all groups in the membership database of a downstream interface.", {{"instance", instance_name}, {"interface", interfaces::get_if_name(if_index)}}))
 {
     HC_LOG_TRACE("");
 
@@ -111,7 +117,10 @@ bool querier::send_general_query()
     m_db.general_query_timer = gqt;
 
     m_timing->add_time(t, m_msg_worker, gqt);
-    return m_sender->send_general_query(m_if_index, m_timers_values);
+
+    //failures are reported back with a kernel_io_result_msg
+    m_kernel_io->send_general_query(m_if_index, m_timers_values);
+    return true;
 }
 
 void querier::receive_record(const std::shared_ptr<proxy_msg>& msg)
@@ -125,18 +134,29 @@ void querier::receive_record(const std::shared_ptr<proxy_msg>& msg)
 
     auto gr = std::static_pointer_cast<group_record_msg>(msg);
 
+    bool traced = group_tracer::get_instance().is_traced(gr->get_gaddr());
+    timing_clock::time_point trace_start;
+    std::string trace_filter_mode;
+    std::size_t trace_sources = 0;
+    if (traced) {
+        trace_start = timing_clock::now();
+        trace_filter_mode = get_trace_filter_mode(gr->get_gaddr());
+        trace_sources = gr->get_slist().size();
+    }
+
     auto db_info_it = m_db.group_info.find(gr->get_gaddr());
 
     if (db_info_it == end(m_db.group_info)) {
         //add an empty neutral record  to membership database
         HC_LOG_DEBUG("gaddr not found");
-        db_info_it = m_db.group_info.insert(gaddr_pair(gr->get_gaddr(), gaddr_info(m_db.querier_version_mode))).first;
+        db_info_it = m_db.group_info.insert(gaddr_pair(gr->get_gaddr(), gaddr_info(m_db.querier_version_mode, m_db.arena))).first;
+        index_group(gr->get_gaddr(), true);
     }
 
     //backwards compatibility coordination
     if (!is_newest_version(gr->get_grp_mem_proto()) && is_older_or_equal_version(gr->get_grp_mem_proto(), m_db.querier_version_mode) ) {
         db_info_it->second.compatibility_mode_variable = gr->get_grp_mem_proto();
-        auto ohpt = std::make_shared<older_host_present_timer_msg>(m_if_index, db_info_it->first, m_timers_values.get_older_host_present_interval());
+        auto ohpt = db_info_it->second.make_timer<older_host_present_timer_msg>(m_if_index, db_info_it->first, m_timers_values.get_older_host_present_interval());
         db_info_it->second.older_host_present_timer = ohpt;
         m_timing->add_time(m_timers_values.get_older_host_present_interval(), m_msg_worker, ohpt);
     }
@@ -148,6 +168,9 @@ void querier::receive_record(const std::shared_ptr<proxy_msg>& msg)
         if (gr->get_record_type() == CHANGE_TO_EXCLUDE_MODE) {
             gr->get_slist() = {};
         } else if (gr->get_record_type() == BLOCK_OLD_SOURCES){
+            if (traced) {
+                trace_transition("record", gr->get_gaddr(), trace_start, trace_filter_mode, {{"type", get_mcast_addr_record_type_name(gr->get_record_type())}, {"ignored", "older host present"}});
+            }
             return;     
         }
     }
@@ -158,7 +181,7 @@ void querier::receive_record(const std::shared_ptr<proxy_msg>& msg)
 
         //if the new created group is not used delete it
         if (db_info_it->second.filter_mode == INCLUDE_MODE && db_info_it->second.include_requested_list.empty()) {
-            m_db.group_info.erase(db_info_it);
+            erase_group(db_info_it);
         }
 
         break;
@@ -170,6 +193,11 @@ void querier::receive_record(const std::shared_ptr<proxy_msg>& msg)
         break;
     }
 
+    update_metrics(gr->get_gaddr());
+
+    if (traced) {
+        trace_transition("record", gr->get_gaddr(), trace_start, trace_filter_mode, {{"type", get_mcast_addr_record_type_name(gr->get_record_type())}, {"sources", std::to_string(trace_sources)}, {"protocol", get_group_mem_protocol_name(gr->get_grp_mem_proto())}});
+    }
 }
 
 void querier::receive_record_in_include_mode(mcast_addr_record_type record_type, const addr_storage& gaddr, source_list<source>& slist, gaddr_info& ginfo)
@@ -425,6 +453,14 @@ void querier::timer_triggerd(const std::shared_ptr<proxy_msg>& msg)
         return;
     }
 
+    bool traced = msg->get_type() != proxy_msg::GENERAL_QUERY_TIMER_MSG && group_tracer::get_instance().is_traced(tm->get_gaddr());
+    timing_clock::time_point trace_start;
+    std::string trace_filter_mode;
+    if (traced) {
+        trace_start = timing_clock::now();
+        trace_filter_mode = get_trace_filter_mode(tm->get_gaddr());
+    }
+
     switch (msg->get_type()) {
     case proxy_msg::FILTER_TIMER_MSG:
         timer_triggerd_filter_timer(db_info_it, tm);
@@ -448,6 +484,10 @@ void querier::timer_triggerd(const std::shared_ptr<proxy_msg>& msg)
         HC_LOG_ERROR("unknown timer message format");
         return;
     }
+
+    if (traced) {
+        trace_transition(proxy_msg::get_message_type_name(msg->get_type()), tm->get_gaddr(), trace_start, trace_filter_mode);
+    }
 }
 
 void querier::timer_triggerd_filter_timer(gaddr_map::iterator db_info_it, const std::shared_ptr<timer_msg>& msg)
@@ -494,7 +534,7 @@ void querier::timer_triggerd_filter_timer(gaddr_map::iterator db_info_it, const
         if (ginfo.include_requested_list.empty()) {
             addr_storage notify_gaddr = db_info_it->first;
 
-            m_db.group_info.erase(db_info_it);
+            erase_group(db_info_it);
 
             state_change_notification(notify_gaddr); //only A
         } else {
@@ -539,7 +579,7 @@ void querier::timer_triggerd_source_timer(gaddr_map::iterator db_info_it, const
         }
 
         if (ginfo.include_requested_list.empty()) {
-            m_db.group_info.erase(db_info_it);
+            erase_group(db_info_it);
         }
 
 
@@ -603,7 +643,9 @@ void querier::timer_triggerd_general_query_timer(const std::shared_ptr<timer_msg
 {
     HC_LOG_TRACE("");
 
-    if (m_db.general_query_timer.get() == msg.get()) {
+    if (m_suspended) {
+        HC_LOG_DEBUG("querier of interface " << interfaces::get_if_name(m_if_index) << " is suspended");
+    } else if (m_db.general_query_timer.get() == msg.get()) {
         send_general_query();
     } else {
         HC_LOG_ERROR("general query timer not found");
@@ -634,7 +676,7 @@ void querier::timer_triggerd_older_host_present_timer(gaddr_map::iterator db_inf
                 delay = m_timers_values.get_older_host_present_interval();
             }
 
-            auto ohpt = std::make_shared<older_host_present_timer_msg>(m_if_index, db_info_it->first, delay);
+            auto ohpt = ginfo.make_timer<older_host_present_timer_msg>(m_if_index, db_info_it->first, delay);
             ginfo.older_host_present_timer = ohpt;
             m_timing->add_time(delay, m_msg_worker, ohpt);
         }
@@ -644,7 +686,7 @@ void querier::timer_triggerd_older_host_present_timer(gaddr_map::iterator db_inf
 void querier::mali(const addr_storage& gaddr, gaddr_info& ginfo) const
 {
     HC_LOG_TRACE("");
-    auto ft = std::make_shared<filter_timer_msg>(m_if_index, gaddr, m_timers_values.get_multicast_address_listening_interval());
+    auto ft = ginfo.make_timer<filter_timer_msg>(m_if_index, gaddr, m_timers_values.get_multicast_address_listening_interval());
 
     ginfo.shared_filter_timer = ft;
 
@@ -654,7 +696,7 @@ void querier::mali(const addr_storage& gaddr, gaddr_info& ginfo) const
 void querier::mali(const addr_storage& gaddr, source_list<source>& slist) const
 {
     HC_LOG_TRACE("");
-    auto st = std::make_shared<source_timer_msg>(m_if_index, gaddr, m_timers_values.get_multicast_address_listening_interval());
+    auto st = std::allocate_shared<source_timer_msg>(arena_allocator<source_timer_msg, MAK_TIMER>(slist.get_allocator().get_arena()), m_if_index, gaddr, m_timers_values.get_multicast_address_listening_interval());
 
     for (auto & e : slist) {
         e.shared_source_timer = st; //shard_source_timer is mutable
@@ -711,7 +753,7 @@ void querier::send_Q(const addr_storage& gaddr, gaddr_info& ginfo)
     if (ginfo.group_retransmission_timer == nullptr) {
         ginfo.group_retransmission_count = m_timers_values.get_last_listener_query_count();
         auto llqt = m_timers_values.get_last_listener_query_time();
-        auto ftimer = std::make_shared<filter_timer_msg>(m_if_index, gaddr, llqt);
+        auto ftimer = ginfo.make_timer<filter_timer_msg>(m_if_index, gaddr, llqt);
 
         ginfo.shared_filter_timer = ftimer;
 
@@ -723,12 +765,18 @@ void querier::send_Q(const addr_storage& gaddr, gaddr_info& ginfo)
 
         if (ginfo.group_retransmission_count > 0) {
             auto llqi = m_timers_values.get_last_listener_query_interval();
-            auto rtimer = std::make_shared<retransmit_group_timer_msg>(m_if_index, gaddr, llqi);
+            auto rtimer = ginfo.make_timer<retransmit_group_timer_msg>(m_if_index, gaddr, llqi);
             ginfo.group_retransmission_timer = rtimer;
             m_timing->add_time(llqi, m_msg_worker, rtimer);
         }
 
-        m_sender->send_mc_addr_specific_query(m_if_index, m_timers_values, gaddr, ginfo.shared_filter_timer->is_remaining_time_greater_than(m_timers_values.get_last_listener_query_time()));
+        bool s_flag = ginfo.shared_filter_timer->is_remaining_time_greater_than(m_timers_values.get_last_listener_query_time());
+        m_kernel_io->send_mc_addr_specific_query(m_if_index, m_timers_values, gaddr, s_flag);
+
+        group_tracer& gt = group_tracer::get_instance();
+        if (gt.is_traced(gaddr)) {
+            gt.instant(GT_QUERIER, "send_Q", m_if_index, gaddr, {{"retransmissions_left", std::to_string(ginfo.group_retransmission_count)}, {"s_flag", s_flag ? "true" : "false"}});
+        }
 
     } else { //reset itself
         ginfo.group_retransmission_timer = nullptr;
@@ -744,7 +792,7 @@ void querier::send_Q(const addr_storage& gaddr, gaddr_info& ginfo, source_list<s
     bool is_used = false;
 
     auto llqt = m_timers_values.get_last_listener_query_time();
-    auto st = std::make_shared<source_timer_msg>(m_if_index, gaddr, llqt);
+    auto st = ginfo.make_timer<source_timer_msg>(m_if_index, gaddr, llqt);
 
     for (auto & e : tmp_list) {
         auto it = slist.find(e);
@@ -763,25 +811,121 @@ void querier::send_Q(const addr_storage& gaddr, gaddr_info& ginfo, source_list<s
     }
 
     if (is_used  || in_retransmission_state) {
-        if (m_sender->send_mc_addr_and_src_specific_query(m_if_index, m_timers_values, gaddr, slist)) {
+        //the retransmission counters of slist are decremented synchronously, the queries are sent with the next query batch
+        bool retransmit = m_kernel_io->send_mc_addr_and_src_specific_query(m_if_index, m_timers_values, gaddr, slist);
+        if (retransmit) {
             auto llqi = m_timers_values.get_last_listener_query_interval();
-            auto rst = std::make_shared<retransmit_source_timer_msg>(m_if_index, gaddr, llqi);
+            auto rst = ginfo.make_timer<retransmit_source_timer_msg>(m_if_index, gaddr, llqi);
             ginfo.source_retransmission_timer = rst;
             m_timing->add_time(llqi, m_msg_worker, rst);
         }
+
+        group_tracer& gt = group_tracer::get_instance();
+        if (gt.is_traced(gaddr)) {
+            gt.instant(GT_QUERIER, "send_Q(MA,S)", m_if_index, gaddr, {{"sources", std::to_string(tmp_list.size())}, {"retransmission", in_retransmission_state ? "true" : "false"}, {"retransmit_again", retransmit ? "true" : "false"}});
+        }
     }
 }
 
 void querier::state_change_notification(const addr_storage& gaddr)
 {
     HC_LOG_TRACE("");
-    m_cb_state_change(m_if_index, gaddr);
+    update_metrics(gaddr);
+
+    group_tracer& gt = group_tracer::get_instance();
+    if (gt.is_traced(gaddr)) {
+        auto start = timing_clock::now();
+        m_cb_state_change(m_if_index, gaddr);
+        gt.complete(GT_ROUTING, "state_change_notification", m_if_index, gaddr, start);
+    } else {
+        m_cb_state_change(m_if_index, gaddr);
+    }
+}
+
+void querier::update_metrics(const addr_storage& gaddr)
+{
+    HC_LOG_TRACE("");
+
+    auto db_info_it = m_db.group_info.find(gaddr);
+    if (db_info_it != std::end(m_db.group_info)) {
+        gaddr_info& ginfo = db_info_it->second;
+        unsigned int sources = ginfo.include_requested_list.size() + ginfo.exclude_list.size();
+        m_sources_gauge.add(static_cast<long>(sources) - static_cast<long>(ginfo.metric_sources));
+        ginfo.metric_sources = sources;
+    }
+
+    m_groups_gauge.set(m_db.group_info.size());
+}
+
+void querier::erase_group(gaddr_map::iterator db_info_it)
+{
+    HC_LOG_TRACE("");
+    m_sources_gauge.add(-static_cast<long>(db_info_it->second.metric_sources));
+    index_group(db_info_it->first, false);
+    m_db.group_info.erase(db_info_it);
+    m_groups_gauge.set(m_db.group_info.size());
+}
+
+void querier::index_group(const addr_storage& gaddr, bool add)
+{
+    HC_LOG_TRACE("");
+    if (m_group_index == nullptr) {
+        return;
+    }
+
+    if (add) {
+        (*m_group_index)[gaddr].insert(m_if_index);
+    } else {
+        auto it = m_group_index->find(gaddr);
+        if (it != std::end(*m_group_index)) {
+            it->second.erase(m_if_index);
+            if (it->second.empty()) {
+                m_group_index->erase(it);
+            }
+        }
+    }
+}
+
+std::string querier::get_trace_filter_mode(const addr_storage& gaddr) const
+{
+    HC_LOG_TRACE("");
+
+    auto db_info_it = m_db.group_info.find(gaddr);
+    if (db_info_it == std::end(m_db.group_info)) {
+        return "none";
+    }
+    return get_mc_filter_name(db_info_it->second.filter_mode);
+}
+
+void querier::trace_transition(const std::string& name, const addr_storage& gaddr, const timing_clock::time_point& start, const std::string& old_filter_mode, gt_args&& args) const
+{
+    HC_LOG_TRACE("");
+
+    group_tracer& gt = group_tracer::get_instance();
+    std::string filter_mode = get_trace_filter_mode(gaddr);
+    if (filter_mode != old_filter_mode) {
+        gt.instant(GT_QUERIER, "filter_mode", m_if_index, gaddr, {{"from", old_filter_mode}, {"to", filter_mode}});
+    }
+
+    args.emplace_back("filter_mode", filter_mode);
+    gt.complete(GT_QUERIER, name, m_if_index, gaddr, start, std::move(args));
 }
 
 querier::~querier()
 {
     HC_LOG_TRACE("");
     router_groups_function(false);
+    for (auto & e : m_db.group_info) {
+        index_group(e.first, false);
+    }
+    m_groups_gauge.set(0);
+    m_sources_gauge.set(0);
+}
+
+const membership_db& querier::get_membership_db() const
+{
+    HC_LOG_TRACE("");
+    return m_db;
 }
 
 timers_values& querier::get_timers_values()
@@ -866,11 +1010,39 @@ std::pair<mc_filter, source_list<source>> querier::get_group_membership_infos(co
     return rt_pair;
 }
 
+void querier::suspend()
+{
+    HC_LOG_TRACE("");
+    m_suspended = true;
+
+    //outdates the pending general query timer
+    m_db.general_query_timer = nullptr;
+}
+
+void querier::resume()
+{
+    HC_LOG_TRACE("");
+
+    if (m_suspended) {
+        m_suspended = false;
+
+        //without a general query timer the startup query count is reset
+        send_general_query();
+    }
+}
+
+bool querier::is_suspended() const
+{
+    HC_LOG_TRACE("");
+    return m_suspended;
+}
+
 std::string querier::to_string() const
 {
     std::ostringstream s;
-    s << "##-- downstream interface: " << interfaces::get_if_name(m_if_index) << " (index:" << m_if_index << ") --##" << std::endl;
-    s << m_db;
+    s << "##-- downstream interface: " << interfaces::get_if_name(m_if_index) << " (index:" << m_if_index << (m_suspended ? ", suspended" : "") << ") --##" << std::endl;
+    s << m_db << std::endl;
+    s << m_db.get_memory_report();
     return s.str();
 }
 
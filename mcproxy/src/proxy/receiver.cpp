@@ -23,8 +23,11 @@
 
 #include "include/hamcast_logging.h"
 #include "include/proxy/receiver.hpp"
+#include "include/proxy/proxy_instance.hpp"
+#include "include/utils/flight_recorder.hpp"
 
 #include <unistd.h>
+#include <cstring>
 
 receiver::receiver(proxy_instance* pr_i, int addr_family, const std::shared_ptr<const mroute_socket> mrt_sock, const std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode)
     : m_running(false)
@@ -41,6 +44,9 @@ receiver::receiver(proxy_instance* pr_i, int addr_family, const std::shared_ptr<
         throw std::string("failed to set receive timeout");
     }
 
+    if (!m_mrt_sock->set_receive_timestamp(true)) {
+        HC_LOG_WARN("no kernel time stamps, the receive latency is not measured");
+    }
 }
 
 receiver::~receiver()
@@ -56,6 +62,38 @@ bool receiver::is_if_index_relevant(unsigned int if_index) const
     return m_relevant_if_index.find(if_index) != std::end(m_relevant_if_index);
 }
 
+void receiver::count_message(unsigned int if_index, const char* type)
+{
+    HC_LOG_TRACE("");
+
+    auto key = std::make_pair(if_index, type);
+    auto it = m_message_counters.find(key);
+    if (it == std::end(m_message_counters)) {
+        metric_counter* c = &metrics::get_instance().get_counter("messages_received_total", "Membership messages and cache misses received per interface and type.", {{"interface", interfaces::get_if_name(if_index)}, {"type", type}});
+        it = m_message_counters.insert(std::make_pair(key, c)).first;
+    }
+
+    it->second->inc();
+}
+
+void receiver::add_record(const std::shared_ptr<group_record_msg>& msg) const
+{
+    HC_LOG_TRACE("");
+
+    flight_recorder::record(FR_RECORD_RECEIVED, msg->get_if_index(), msg->get_gaddr(), msg->get_record_type(), msg->get_slist().size());
+
+    if (msg->get_receive_time() != std::chrono::system_clock::time_point()) {
+        auto receive = std::chrono::system_clock::now() - msg->get_receive_time();
+        if (receive.count() < 0) {
+            receive = std::chrono::system_clock::duration::zero(); //the clock was set back
+        }
+        m_proxy_instance->record_latency(LS_RECEIVE, receive);
+    }
+
+    msg->set_enqueue_time(std::chrono::steady_clock::now());
+    m_proxy_instance->add_msg(msg);
+}
+
 void receiver::registrate_interface(unsigned int if_index)
 {
     HC_LOG_TRACE("interface: " << interfaces::get_if_name(if_index));
@@ -90,8 +128,9 @@ void receiver::worker_thread()
     iov.iov_base = iov_buf.get();
     iov.iov_len = get_iov_min_size(); //sizeof(iov_buf);
 
-    //control
-    std::unique_ptr<unsigned char[]> ctrl { new unsigned char[get_ctrl_min_size()] };
+    //control, with space for the kernel time stamp
+    const int ctrl_size = get_ctrl_min_size() + CMSG_SPACE(sizeof(struct timespec));
+    std::unique_ptr<unsigned char[]> ctrl { new unsigned char[ctrl_size] };
     //unsigned char ctrl[r->get_ctrl_min_size()];
 
     //create msghdr
@@ -103,12 +142,13 @@ void receiver::worker_thread()
     msg.msg_iovlen = 1;
 
     msg.msg_control = ctrl.get();
-    msg.msg_controllen = get_ctrl_min_size(); //sizeof(ctrl);
+    msg.msg_controllen = ctrl_size; //sizeof(ctrl);
 
     msg.msg_flags = 0;
     //########################
 
     while (m_running) {
+        msg.msg_controllen = ctrl_size;
         if (!m_mrt_sock->receive_msg(&msg, info_size)) {
             HC_LOG_ERROR("received failed");
             sleep(1);
@@ -118,6 +158,15 @@ void receiver::worker_thread()
             continue; //on timeout
         }
 
+        m_receive_time = std::chrono::system_clock::time_point();
+        for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != nullptr; cmsgptr = CMSG_NXTHDR(&msg, cmsgptr)) {
+            if (cmsgptr->cmsg_level == SOL_SOCKET && cmsgptr->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsgptr), sizeof(ts));
+                m_receive_time = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+            }
+        }
+
         m_data_lock.lock();
         analyse_packet(&msg, info_size);
         m_data_lock.unlock();
@@ -150,7 +199,7 @@ void receiver::join()
 {
     HC_LOG_TRACE("");
 
-    if (m_thread.get() != nullptr) {
+    if (m_thread.get() != nullptr && m_thread->joinable()) {
         m_thread->join();
     }
 }
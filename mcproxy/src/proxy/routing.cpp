@@ -26,48 +26,89 @@
 #include "include/proxy/interfaces.hpp"
 #include "include/utils/addr_storage.hpp"
 #include "include/utils/mroute_socket.hpp"
+#include "include/utils/flight_recorder.hpp"
+#include "include/proxy/group_tracer.hpp"
 
 #include <net/if.h>
 #include <linux/mroute.h>
 #include <linux/mroute6.h>
 #include <iostream>
+#include <chrono>
 
-routing::routing(int addr_family, std::shared_ptr<const mroute_socket> mrt_sock, std::shared_ptr<const interfaces> interfaces, int table_number)
+routing::routing(int addr_family, std::shared_ptr<const mroute_socket> mrt_sock, std::shared_ptr<const interfaces> interfaces, int table_number, mroute_backend mrb)
     : m_table_number(table_number)
     , m_addr_family(addr_family)
     , m_interfaces(interfaces)
     , m_mrt_sock(mrt_sock)
+    , m_add_route_latency(nullptr)
 {
     HC_LOG_TRACE("");
 
+    const char* op_names[RO_COUNT] = {"add_vif", "del_vif", "add_route", "del_route", "flush"};
+    metrics& m = metrics::get_instance();
+    for (int i = 0; i < RO_COUNT; ++i) {
+        metric_labels labels {{"table", std::to_string(m_table_number)}, {"operation", op_names[i]}};
+        m_ops[i] = &m.get_counter("kernel_operations_total", "Kernel operations on virtual interfaces and multicast routes per table (batched routes are counted when they are queued).", labels);
+        m_op_failures[i] = &m.get_counter("kernel_operation_failures_total", "Failed kernel operations on virtual interfaces and multicast routes per table.", labels);
+    }
+
     if (!m_if_prop.refresh_network_interfaces()) {
         throw "failed to refresh netwok interfaces";
     }
+
+    if (mrb == MRB_NETLINK) {
+        if (m_addr_family == AF_INET) {
+            try {
+                m_netlink.reset(new mroute_netlink(m_addr_family, m_table_number));
+            } catch (const char* e) {
+                HC_LOG_WARN("failed to initialise the netlink backend (" << e << "), use setsockopt instead");
+            }
+        } else {
+            HC_LOG_WARN("the netlink backend supports only IPv4, use setsockopt instead");
+        }
+    }
+}
+
+bool routing::count_op(routing_op op, bool rc) const
+{
+    HC_LOG_TRACE("");
+    m_ops[op]->inc();
+    if (!rc) {
+        m_op_failures[op]->inc();
+    }
+    return rc;
 }
 
 bool routing::add_vif(int if_index, int vif) const
 {
     HC_LOG_TRACE("");
 
-    char cstr[IF_NAMESIZE];
     const struct ifaddrs* item = nullptr;
 
-    std::string if_name(if_indextoname(if_index, cstr)); //fehler!!!!!! könnte abastürzten ???????????????????????ßß<F8><F8><F8>
+    //the addresses can change while the proxy is running
+    if (!m_if_prop.refresh_network_interfaces()) {
+        return count_op(RO_ADD_VIF, false);
+    }
+
+    std::string if_name = interfaces::get_if_name(if_index);
+    if (if_name.empty()) {
+        return count_op(RO_ADD_VIF, false);
+    }
 
     //useless ????????????????????????????????????????????????????????????????????
     if (m_addr_family == AF_INET) {
         if ((item = m_if_prop.get_ip4_if(if_name)) == nullptr) {
             HC_LOG_ERROR("interface not found: " << if_name);
-            return false;
+            return count_op(RO_ADD_VIF, false);
         }
     } else if (m_addr_family == AF_INET6) {
         if ((item = m_if_prop.get_ip6_if(if_name)->front()) == nullptr) {
             HC_LOG_ERROR("interface not found: " << if_name);
-            return false;
+            return count_op(RO_ADD_VIF, false);
         }
     } else {
         HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
-        return false;
+        return count_op(RO_ADD_VIF, false);
     }
 
     if ((item->ifa_flags & IFF_POINTOPOINT) && (item->ifa_dstaddr != nullptr)) { //tunnel
@@ -75,76 +116,161 @@ bool routing::add_vif(int if_index, int vif) const
         //addr_storage p2p_addr(*(item->ifa_dstaddr));
 
         if (!m_mrt_sock->add_vif(vif, if_index, addr_storage(*(item->ifa_dstaddr)))) {
-            return false;
+            return count_op(RO_ADD_VIF, false);
         }
 
     } else { //phyint
         if (!m_mrt_sock->add_vif(vif, if_index, addr_storage())) {
-            return false;
-        } else {
-            if (!m_added_ifs.insert(if_index).second) {
-                HC_LOG_ERROR("inconsistent database");
-            }
+            return count_op(RO_ADD_VIF, false);
         }
-
     }
 
     if (m_table_number > 0) {
         if (!m_mrt_sock->bind_vif_to_table(if_index, m_table_number)) {
-            return false;
+            return count_op(RO_ADD_VIF, false);
         }
     }
 
+    m_added_ifs.insert(if_index);
+
     HC_LOG_DEBUG("added interface: " << if_name << " to vif_table with vif number:" << vif);
-    return true;
+    return count_op(RO_ADD_VIF, true);
 }
 
 bool routing::add_route(int input_vif, const addr_storage& g_addr, const addr_storage& src_addr, const std::list<int>& output_vif) const
 {
     HC_LOG_TRACE("");
 
+    bool rc = add_kernel_route(input_vif, g_addr, src_addr, output_vif);
+
+    flight_recorder::record(FR_ROUTE_ADDED, m_interfaces->get_if_index(input_vif), g_addr, src_addr, output_vif.size(), rc);
+
+    group_tracer& gt = group_tracer::get_instance();
+    if (gt.is_traced(g_addr)) {
+        gt.instant(GT_KERNEL, "route_added", m_interfaces->get_if_index(input_vif), g_addr, {{"source", src_addr.to_string()}, {"outputs", std::to_string(output_vif.size())}, {"result", rc ? "ok" : "failed"}});
+    }
+    return rc;
+}
+
+bool routing::add_kernel_route(int input_vif, const addr_storage& g_addr, const addr_storage& src_addr, const std::list<int>& output_vif) const
+{
+    HC_LOG_TRACE("");
+
     if (m_addr_family == AF_INET) {
         if (output_vif.size() > MAXVIFS) {
-            return false;
+            return count_op(RO_ADD_ROUTE, false);
         }
     } else if (m_addr_family == AF_INET6) {
         if (output_vif.size() > MAXMIFS) {
-            return false;
+            return count_op(RO_ADD_ROUTE, false);
         }
     } else {
         HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
-        return false;
+        return count_op(RO_ADD_ROUTE, false);
     }
 
-    if (!m_mrt_sock->add_mroute(input_vif, src_addr, g_addr, output_vif)) {
-        return false;
+    if (m_netlink.get() != nullptr) {
+        return count_op(RO_ADD_ROUTE, m_netlink->add_mroute(m_interfaces->get_if_index(input_vif), src_addr, g_addr, output_vif));
     }
 
-    return true;
+    auto start = std::chrono::steady_clock::now();
+    bool rc = m_mrt_sock->add_mroute(input_vif, src_addr, g_addr, output_vif);
+    if (m_add_route_latency != nullptr) {
+        m_add_route_latency->record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    return count_op(RO_ADD_ROUTE, rc);
 }
 
 bool routing::del_route(int vif, const addr_storage& g_addr, const addr_storage& src_addr) const
 {
     HC_LOG_TRACE("");
 
+    bool rc = del_kernel_route(vif, g_addr, src_addr);
+
+    flight_recorder::record(FR_ROUTE_DELETED, m_interfaces->get_if_index(vif), g_addr, src_addr, 0, rc);
+
+    group_tracer& gt = group_tracer::get_instance();
+    if (gt.is_traced(g_addr)) {
+        gt.instant(GT_KERNEL, "route_deleted", m_interfaces->get_if_index(vif), g_addr, {{"source", src_addr.to_string()}, {"result", rc ? "ok" : "failed"}});
+    }
+    return rc;
+}
+
+bool routing::del_kernel_route(int vif, const addr_storage& g_addr, const addr_storage& src_addr) const
+{
+    HC_LOG_TRACE("");
+
+    if (m_netlink.get() != nullptr) {
+        return count_op(RO_DEL_ROUTE, m_netlink->del_mroute(m_interfaces->get_if_index(vif), src_addr, g_addr));
+    }
+
     if (!m_mrt_sock->del_mroute(vif, src_addr, g_addr)) {
-        return false;
+        return count_op(RO_DEL_ROUTE, false);
+    }
+
+    return count_op(RO_DEL_ROUTE, true);
+}
+
+bool routing::flush() const
+{
+    HC_LOG_TRACE("");
+
+    if (m_netlink.get() == nullptr) {
+        return true;
+    }
+
+    bool measure = m_add_route_latency != nullptr && !m_netlink->is_batch_empty();
+    auto start = std::chrono::steady_clock::now();
+    bool rc = m_netlink->flush();
+    if (measure) {
+        m_add_route_latency->record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    //fallback
+    for (auto & e : m_netlink->get_failed_ops()) {
+        int vif = m_interfaces->get_virtual_if_index(e.input_if_index);
+        if (e.add) {
+            rc = m_mrt_sock->add_mroute(vif, e.saddr, e.gaddr, e.output_vif) && rc;
+        } else {
+            rc = m_mrt_sock->del_mroute(vif, e.saddr, e.gaddr) && rc;
+        }
+    }
+
+    if (!m_netlink->is_supported()) {
+        HC_LOG_WARN("the kernel refused the netlink backend, use setsockopt instead");
+        m_netlink.reset();
     }
 
-    return true;
+    return count_op(RO_FLUSH, rc);
+}
+
+void routing::set_metrics(metric_histogram* add_route_latency)
+{
+    HC_LOG_TRACE("");
+    m_add_route_latency = add_route_latency;
+}
+
+mroute_backend routing::get_mroute_backend() const
+{
+    HC_LOG_TRACE("");
+    return m_netlink.get() != nullptr ? MRB_NETLINK : MRB_SETSOCKOPT;
 }
 
 bool routing::del_vif(int if_index, int vif) const
 {
     HC_LOG_TRACE("");
 
+    //routes of this vif must reach the kernel first
+    flush();
+
     if (!m_mrt_sock->del_vif(vif)) {
-        return false;
+        return count_op(RO_DEL_VIF, false);
     }
 
     if (m_table_number > 0) {
         if (!m_mrt_sock->unbind_vif_form_table(if_index, m_table_number)) {
-            return false;
+            return count_op(RO_DEL_VIF, false);
         }
     }
 
@@ -154,15 +280,16 @@ bool routing::del_vif(int if_index, int vif) const
     };
 
     HC_LOG_DEBUG("removed interface with vif number: " << vif) ;
-    return true;
+    return count_op(RO_DEL_VIF, true);
 }
 
 routing::~routing()
 {
     HC_LOG_TRACE("");
 
-    //clean up all added interfaces
-    for (auto e : m_added_ifs) {
+    //clean up all added interfaces, del_vif erases them from m_added_ifs
+    auto added_ifs = m_added_ifs;
+    for (auto e : added_ifs) {
         del_vif(e, m_interfaces->get_virtual_if_index(e));
     }
 }
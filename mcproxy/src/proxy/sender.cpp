@@ -30,6 +30,7 @@
 sender::sender(const std::shared_ptr<const interfaces>& interfaces, group_mem_protocol gmp)
     : m_group_mem_protocol(gmp)
     , m_interfaces(interfaces)
+    , m_membership_sockets(get_addr_family(gmp))
 {
     HC_LOG_TRACE("");
 
@@ -51,6 +52,12 @@ sender::sender(const std::shared_ptr<const interfaces>& interfaces, group_mem_pr
     }
 }
 
+group_mem_protocol sender::get_group_mem_protocol() const
+{
+    HC_LOG_TRACE("");
+    return m_group_mem_protocol;
+}
+
 #ifdef DEBUG_MODE
 bool sender::send_record(unsigned int if_index, mc_filter filter_mode, const addr_storage& gaddr, const source_list<source>& slist) const
 {
@@ -135,6 +142,42 @@ bool sender::send_mc_addr_and_src_specific_query(unsigned int if_index, const ti
 
     return rc;
 }
+
+bool sender::send_queries(std::vector<query_request>& queries) const
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+
+    cout << "!!--ACTION: send " << queries.size() << " queries" << endl;
+    for (auto & e : queries) {
+        cout << "interface: " << interfaces::get_if_name(e.if_index) << " group address: " << e.gaddr << " s-flag: " << (e.s_flag ? "true" : "false") << " sources:";
+        for (auto & a : e.slist) {
+            cout << " " << a;
+        }
+        cout << endl;
+        e.sent = true;
+    }
+    cout << endl;
+    return true;
+}
+
+bool sender::send_report(unsigned int if_index, const std::list<report_record>& records) const
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+
+    cout << "!!--ACTION: send membership report" << endl;
+    cout << "interface: " << interfaces::get_if_name(if_index) << endl;
+    for (auto & e : records) {
+        cout << get_mcast_addr_record_type_name(e.type) << " " << e.gaddr << " sources:";
+        for (auto & a : e.slist) {
+            cout << " " << a;
+        }
+        cout << endl;
+    }
+    cout << endl;
+    return true;
+}
 #else
 
 bool sender::send_record(unsigned int, mc_filter, const addr_storage&, const source_list<source>&) const
@@ -156,8 +199,63 @@ bool sender::send_mc_addr_and_src_specific_query(unsigned int, const timers_valu
     return false;    
 }
 
+bool sender::send_queries(std::vector<query_request>&) const
+{
+    return false;
+}
+
+bool sender::send_report(unsigned int, const std::list<report_record>&) const
+{
+    return false;
+}
+
 #endif /* DEBUG_MODE */
 
+bool sender::split_source_retransmissions(const timers_values& tv, source_list<source>& slist, std::list<addr_storage>& slist_higher, std::list<addr_storage>& slist_lower)
+{
+    HC_LOG_TRACE("");
+
+    bool rc = false;
+    for (auto & e : slist) {
+        if (e.retransmission_count > 0) {
+            e.retransmission_count--;
+
+            if (e.retransmission_count > 0 ) {
+                rc = true;
+            }
+
+            if (e.shared_source_timer.get() != nullptr) {
+                if (e.shared_source_timer->is_remaining_time_greater_than(tv.get_last_listener_query_time())) {
+                    slist_higher.push_back(e.saddr);
+                } else {
+                    slist_lower.push_back(e.saddr);
+                }
+            } else {
+                HC_LOG_ERROR("the shared source timer shouldnt be null");
+            }
+        }
+    }
+
+    return rc;
+}
+
+void sender::clear_query_templates(unsigned int) const
+{
+    HC_LOG_TRACE("");
+}
+
+std::string sender::to_string() const
+{
+    HC_LOG_TRACE("");
+    return m_membership_sockets.to_string();
+}
+
+std::ostream& operator<<(std::ostream& stream, const sender& s)
+{
+    HC_LOG_TRACE("");
+    return stream << s.to_string();
+}
+
 sender::~sender()
 {
     HC_LOG_TRACE("");
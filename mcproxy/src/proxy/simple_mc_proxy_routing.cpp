@@ -29,10 +29,14 @@
 #include "include/proxy/routing.hpp"
 #include "include/proxy/interfaces.hpp"
 #include "include/proxy/sender.hpp"
+#include "include/proxy/kernel_io.hpp"
+#include "include/proxy/membership_reporter.hpp"
 #include "include/proxy/timing.hpp"
+#include "include/proxy/group_tracer.hpp"
 
 #include <algorithm>
 #include <memory>
+#include <sstream>
 
 //-------------------------------------------------------------------------------
 //-------------------------------------------------------------------------------
@@ -95,14 +99,30 @@ void interface_memberships::merge_membership_infos(source_state& merge_to, const
     }
 }
 
-void interface_memberships::process_upstream_in_first(const addr_storage& gaddr, const proxy_instance* pi)
+interface_memberships::state_list interface_memberships::get_downstream_states(const addr_storage& gaddr, const proxy_instance* pi) const
 {
     HC_LOG_TRACE("");
 
-    state_list init_sstate_list;
-    for (auto & downs_e : pi->m_downstreams) {
-        init_sstate_list.push_back(state_pair(source_state(downs_e.second.m_querier->get_group_membership_infos(gaddr)), downs_e.second.m_interface));
+    state_list result;
+    auto git = pi->m_group_index.find(gaddr);
+    if (git == std::end(pi->m_group_index)) {
+        return result;
+    }
+
+    for (auto if_index : git->second) {
+        auto downs_it = pi->m_downstreams.find(if_index);
+        if (downs_it != std::end(pi->m_downstreams)) {
+            result.push_back(state_pair(source_state(downs_it->second.m_querier->get_group_membership_infos(gaddr)), downs_it->second.m_interface));
+        }
     }
+    return result;
+}
+
+void interface_memberships::process_upstream_in_first(const addr_storage& gaddr, const proxy_instance* pi)
+{
+    HC_LOG_TRACE("");
+
+    state_list init_sstate_list = get_downstream_states(gaddr, pi);
 
     //init and fill database
     for (auto & upstr_e : pi->m_upstreams) {
@@ -118,13 +138,13 @@ void interface_memberships::process_upstream_in_first(const addr_storage& gaddr,
             for (auto source_it = cs.first.m_source_list.begin(); source_it != cs.first.m_source_list.end();) {
 
                 //downstream out
-                if (!cs.second->match_output_filter(interfaces::get_if_name(upstr_e.m_if_index), gaddr, source_it->saddr)) {
+                if (!cs.second->match_output_filter(upstr_e.m_if_index, gaddr, source_it->saddr)) {
                     source_it = cs.first.m_source_list.erase(source_it);
                     continue;
                 }
 
                 //upstream in
-                if (!upstr_e.m_interface->match_input_filter(interfaces::get_if_name(upstr_e.m_if_index), gaddr, source_it->saddr)) {
+                if (!upstr_e.m_interface->match_input_filter(upstr_e.m_if_index, gaddr, source_it->saddr)) {
                     tmp_sstate.m_source_list.insert(*source_it);
                     source_it = cs.first.m_source_list.erase(source_it);
                     continue;
@@ -153,11 +173,7 @@ void interface_memberships::process_upstream_in_mutex(const addr_storage& gaddr,
 {
     HC_LOG_TRACE("");
 
-    state_list ref_sstate_list;
-
-    for (auto & downs_e : pi->m_downstreams) {
-        ref_sstate_list.push_back(state_pair(source_state(downs_e.second.m_querier->get_group_membership_infos(gaddr)), downs_e.second.m_interface));
-    }
+    state_list ref_sstate_list = get_downstream_states(gaddr, pi);
     //print(ref_sstate_list);
 
     //init and fill database
@@ -175,13 +191,13 @@ void interface_memberships::process_upstream_in_mutex(const addr_storage& gaddr,
             for (auto source_it = cs_it->first.m_source_list.begin(); source_it != cs_it->first.m_source_list.end();) {
 
                 //downstream out
-                if (!cs_it->second->match_output_filter(interfaces::get_if_name(upstr_e.m_if_index), gaddr, source_it->saddr)) {
+                if (!cs_it->second->match_output_filter(upstr_e.m_if_index, gaddr, source_it->saddr)) {
                     ++source_it;
                     continue;
                 }
 
                 //upstream in
-                if (!upstr_e.m_interface->match_input_filter(interfaces::get_if_name(upstr_e.m_if_index), gaddr, source_it->saddr)) {
+                if (!upstr_e.m_interface->match_input_filter(upstr_e.m_if_index, gaddr, source_it->saddr)) {
                     ++source_it;
                     continue;
                 }
@@ -286,7 +302,8 @@ void interface_memberships::print(const state_list& sl)
 //-------------------------------------------------------------------------------
 simple_mc_proxy_routing::simple_mc_proxy_routing(const proxy_instance* p)
     : routing_management(p)
-    , m_data(p->m_group_mem_protocol, p->m_mrt_sock)
+    , m_data(p->m_group_mem_protocol, p->m_table_number, p->m_stats_collector.get())
+    , m_filter_cache(p->m_filter_cache_size)
 {
     HC_LOG_TRACE("");
 }
@@ -330,7 +347,9 @@ void simple_mc_proxy_routing::event_querier_state_change(unsigned int /*if_index
     HC_LOG_TRACE("");
 
     //route calculation
+    auto start = std::chrono::steady_clock::now();
     set_routes(gaddr, collect_interested_interfaces(gaddr, m_data.get_available_sources(gaddr)));
+    m_p->record_latency(LS_ROUTE_CALCULATION, std::chrono::steady_clock::now() - start);
 
     //membership agregation
     if (is_rule_matching_type(IT_UPSTREAM, ID_IN, RMT_FIRST)) {
@@ -386,6 +405,12 @@ void simple_mc_proxy_routing::timer_triggerd_maintain_routing_table(const std::s
     }
 }
 
+void simple_mc_proxy_routing::event_config_changed()
+{
+    HC_LOG_TRACE("");
+    m_filter_cache.invalidate();
+}
+
 bool simple_mc_proxy_routing::is_rule_matching_type(rb_interface_type interface_type, rb_interface_direction interface_direction, rb_rule_matching_type rule_matching_type) const
 {
     HC_LOG_TRACE("");
@@ -475,8 +500,15 @@ std::list<std::pair<source, std::list<unsigned int>>> simple_mc_proxy_routing::c
         }
     };
 
-    for (auto & dif : m_p->m_downstreams) {
-        dif.second.m_querier->suggest_to_forward_traffic(gaddr, rt_list, std::bind(filter_fun, dif.first, std::placeholders::_1));
+    //only the queriers that know the group can be interested in it
+    auto git = m_p->m_group_index.find(gaddr);
+    if (git != std::end(m_p->m_group_index)) {
+        for (auto if_index : git->second) {
+            auto dif = m_p->m_downstreams.find(if_index);
+            if (dif != std::end(m_p->m_downstreams)) {
+                dif->second.m_querier->suggest_to_forward_traffic(gaddr, rt_list, std::bind(filter_fun, if_index, std::placeholders::_1));
+            }
+        }
     }
 
     return rt_list;
@@ -548,7 +580,16 @@ void simple_mc_proxy_routing::set_routes(const addr_storage& gaddr, const std::l
                 continue;
             }
 
-            m_p->m_routing->add_route(m_p->m_interfaces->get_virtual_if_index(input_if_index), gaddr, e.first.saddr, vif_out);
+            m_p->m_kernel_io->add_route(m_p->m_interfaces->get_virtual_if_index(input_if_index), gaddr, e.first.saddr, vif_out);
+
+            group_tracer& gt = group_tracer::get_instance();
+            if (gt.is_traced(gaddr)) {
+                std::ostringstream outputs;
+                for (auto it = e.second.begin(); it != e.second.end(); ++it) {
+                    outputs << (it == e.second.begin() ? "" : ",") << interfaces::get_if_name(*it);
+                }
+                gt.instant(GT_ROUTING, "add_route", input_if_index, gaddr, {{"source", e.first.saddr.to_string()}, {"outputs", outputs.str()}});
+            }
         }
 
     }
@@ -557,13 +598,27 @@ void simple_mc_proxy_routing::set_routes(const addr_storage& gaddr, const std::l
 void simple_mc_proxy_routing::send_record(unsigned int upstream_if_index, const addr_storage& gaddr, const source_state& sstate) const
 {
     HC_LOG_TRACE("");
-    m_p->m_sender->send_record(upstream_if_index, sstate.m_mc_filter, gaddr, sstate.m_source_list);
+    if (m_p->m_reporter != nullptr) {
+        m_p->m_reporter->set_state(upstream_if_index, sstate.m_mc_filter, gaddr, sstate.m_source_list);
+    } else {
+        m_p->m_kernel_io->send_record(upstream_if_index, sstate.m_mc_filter, gaddr, sstate.m_source_list);
+    }
+
+    group_tracer& gt = group_tracer::get_instance();
+    if (gt.is_traced(gaddr)) {
+        gt.instant(GT_ROUTING, "report", upstream_if_index, gaddr, {{"filter_mode", get_mc_filter_name(sstate.m_mc_filter)}, {"sources", std::to_string(sstate.m_source_list.size())}});
+    }
 }
 
 void simple_mc_proxy_routing::del_route(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr) const
 {
     HC_LOG_TRACE("");
-    m_p->m_routing->del_route(m_p->m_interfaces->get_virtual_if_index(if_index), gaddr, saddr);
+    m_p->m_kernel_io->del_route(m_p->m_interfaces->get_virtual_if_index(if_index), gaddr, saddr);
+
+    group_tracer& gt = group_tracer::get_instance();
+    if (gt.is_traced(gaddr)) {
+        gt.instant(GT_ROUTING, "del_route", if_index, gaddr, {{"source", saddr.to_string()}});
+    }
 }
 
 std::shared_ptr<new_source_timer_msg> simple_mc_proxy_routing::set_source_timer(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr)
@@ -586,6 +641,19 @@ bool simple_mc_proxy_routing::check_interface(rb_interface_type interface_type,
 {
     HC_LOG_TRACE("");
 
+    bool decision;
+    if (!m_filter_cache.lookup(interface_type, interface_direction, checking_if_index, input_if_index, gaddr, saddr, decision)) {
+        decision = check_interface_uncached(interface_type, interface_direction, checking_if_index, input_if_index, gaddr, saddr);
+        m_filter_cache.insert(interface_type, interface_direction, checking_if_index, input_if_index, gaddr, saddr, decision);
+    }
+
+    return decision;
+}
+
+bool simple_mc_proxy_routing::check_interface_uncached(rb_interface_type interface_type, rb_interface_direction interface_direction, unsigned int checking_if_index, unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr) const
+{
+    HC_LOG_TRACE("");
+
     std::shared_ptr<interface> interf;
     if (interface_type == IT_UPSTREAM) {
         auto uinfo_it = std::find_if(m_p->m_upstreams.begin(), m_p->m_upstreams.end(), [&](const proxy_instance::upstream_infos & ui) {
@@ -616,25 +684,33 @@ bool simple_mc_proxy_routing::check_interface(rb_interface_type interface_type,
         return false;
     }
 
-    std::string input_if_index_name = interfaces::get_if_name(input_if_index);
-    if (!input_if_index_name.empty()) {
+    if (input_if_index != 0) {
         if (interface_direction == ID_IN) {
-            return interf->match_input_filter(input_if_index_name, gaddr, saddr);
+            return interf->match_input_filter(input_if_index, gaddr, saddr);
         } else if (interface_direction == ID_OUT) {
-            return interf->match_output_filter(input_if_index_name, gaddr, saddr);
+            return interf->match_output_filter(input_if_index, gaddr, saddr);
         } else {
             HC_LOG_ERROR("unkown interface direction");
             return false;
         }
     } else {
-        HC_LOG_ERROR("failed to map interface index " << input_if_index << " to interface name");
+        HC_LOG_ERROR("invalid input interface index " << input_if_index);
         return false;
     }
 }
 
+const simple_routing_data* simple_mc_proxy_routing::get_routing_data() const
+{
+    HC_LOG_TRACE("");
+    return &m_data;
+}
+
 std::string simple_mc_proxy_routing::to_string() const
 {
     HC_LOG_TRACE("");
-    return m_data.to_string();
+    std::ostringstream s;
+    s << m_data.to_string() << std::endl;
+    s << m_filter_cache.to_string();
+    return s.str();
 }
 
@@ -23,38 +23,38 @@
 #include "include/hamcast_logging.h"
 #include "include/proxy/simple_routing_data.hpp"
 #include "include/proxy/message_format.hpp"
-#include "include/utils/mroute_socket.hpp"
 #include "include/proxy/interfaces.hpp"
+#include "include/proxy/stats_collector.hpp"
 
-simple_routing_data::simple_routing_data(group_mem_protocol group_mem_protocol, const std::shared_ptr<const mroute_socket>& mrt_sock)
+#include <algorithm>
+
+simple_routing_data::simple_routing_data(group_mem_protocol group_mem_protocol, int table_number, const stats_collector* collector)
     : m_group_mem_protocol(group_mem_protocol)
-    , m_mrt_sock(mrt_sock)
+    , m_stats(get_addr_family(group_mem_protocol), table_number)
+    , m_collector(collector)
 {
     HC_LOG_TRACE("");
 }
 
-unsigned long simple_routing_data::get_current_packet_count(const addr_storage& gaddr, const addr_storage& saddr)
+bool simple_routing_data::get_current_packet_count(const addr_storage& gaddr, const addr_storage& saddr, unsigned long& packet_count)
 {
     HC_LOG_TRACE("");
 
-    if (is_IPv4(m_group_mem_protocol)) {
-        struct sioc_sg_req tmp_stat;
-        if (m_mrt_sock->get_mroute_stats(saddr, gaddr, &tmp_stat, nullptr)) {
-            return tmp_stat.pktcnt;
-        } else {
-            return true;
-        }
-    } else if (is_IPv6(m_group_mem_protocol)) {
-        struct sioc_sg_req6 tmp_stat;
-        if (m_mrt_sock->get_mroute_stats(saddr, gaddr, nullptr, &tmp_stat)) {
-            return tmp_stat.pktcnt;
-        } else {
+    if (m_collector != nullptr) {
+        auto snapshot = m_collector->get_snapshot();
+        if (snapshot != nullptr && std::chrono::steady_clock::now() - snapshot->time < std::chrono::milliseconds(SIMPLE_ROUTING_DATA_STATS_MAX_AGE)) {
+            auto it = snapshot->routes.find(std::make_pair(gaddr, saddr));
+            packet_count = it != std::end(snapshot->routes) ? it->second.forwarded.packets : 0;
             return true;
         }
-    } else {
-        HC_LOG_ERROR("unknown IP version");
-        return true;
     }
+
+    if (!m_stats.refresh_if_older_than(std::chrono::milliseconds(SIMPLE_ROUTING_DATA_STATS_MAX_AGE))) {
+        HC_LOG_ERROR("failed to get the packet count of (" << saddr << ", " << gaddr << ")");
+        return false;
+    }
+
+    return m_stats.get_packet_count(gaddr, saddr, packet_count);
 }
 
 void simple_routing_data::set_source(unsigned int if_index, const addr_storage& gaddr, const source& saddr)
@@ -64,7 +64,10 @@ void simple_routing_data::set_source(unsigned int if_index, const addr_storage&
     if (gaddr_it != std::end(m_data)) {
         auto list_result = gaddr_it->second.m_source_list.insert(saddr);
         if (!list_result.second) { //failed to inert
-            saddr.retransmission_count = get_current_packet_count(gaddr, saddr.saddr);
+            unsigned long cnt;
+            if (get_current_packet_count(gaddr, saddr.saddr, cnt)) {
+                saddr.retransmission_count = cnt;
+            }
             gaddr_it->second.m_source_list.erase(list_result.first);
             gaddr_it->second.m_source_list.insert(saddr);
         }
@@ -103,8 +106,11 @@ std::pair<source_list<source>::iterator, bool> simple_routing_data::refresh_sour
         auto saddr_it = gaddr_it->second.m_source_list.find(saddr);
         if (saddr_it != std::end(gaddr_it->second.m_source_list)) {
 
-            auto cnt = get_current_packet_count(gaddr, saddr);
-            if (static_cast<unsigned long>(saddr_it->retransmission_count) == cnt) {
+            unsigned long cnt;
+            if (!get_current_packet_count(gaddr, saddr, cnt)) {
+                //without counters the source is kept alive
+                return std::pair<source_list<source>::iterator, bool>(saddr_it, true);
+            } else if (static_cast<unsigned long>(saddr_it->retransmission_count) == cnt) {
                 gaddr_it->second.m_source_list.erase(saddr_it);
                 gaddr_it->second.m_if_map.erase(saddr);
             } else {
@@ -144,12 +150,13 @@ std::string simple_routing_data::to_string() const
     HC_LOG_TRACE("");
     ostringstream s;
     s << "##-- simple multicast routing information base --##";
+    s << endl << "kernel counters of " << m_stats.size() << " routes";
 
-    for (auto &  d : m_data) {
-        s << endl << "group: " << d.first;
-        s << endl << "\tsources: " << d.second.m_source_list;
+    for (auto d : get_sorted_groups(m_data)) {
+        s << endl << "group: " << d->first;
+        s << endl << "\tsources: " << d->second.m_source_list;
 
-        for (auto & m : d.second.m_if_map) {
+        for (auto & m : d->second.m_if_map) {
             s << endl << "\t" << m.first  << " ==> " << interfaces::get_if_name(m.second);
         }
     }
@@ -157,6 +164,27 @@ std::string simple_routing_data::to_string() const
     return s.str();
 }
 
+const s_routing_data& simple_routing_data::get_data() const
+{
+    HC_LOG_TRACE("");
+    return m_data;
+}
+
+std::vector<s_routing_data::const_iterator> get_sorted_groups(const s_routing_data& data)
+{
+    HC_LOG_TRACE("");
+    std::vector<s_routing_data::const_iterator> result;
+    result.reserve(data.size());
+    for (auto it = std::begin(data); it != std::end(data); ++it) {
+        result.push_back(it);
+    }
+
+    std::sort(std::begin(result), std::end(result), [](const s_routing_data::const_iterator & a, const s_routing_data::const_iterator & b) {
+        return a->first < b->first;
+    });
+    return result;
+}
+
 const std::map<addr_storage, unsigned int>& simple_routing_data::get_interface_map(const addr_storage& gaddr) const
 {
     HC_LOG_TRACE("");
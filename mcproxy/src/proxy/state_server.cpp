@@ -0,0 +1,273 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/proxy/state_server.hpp"
+#include "include/proxy/state_snapshot.hpp"
+#include "include/proxy/group_tracer.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+
+#include <algorithm>
+#include <sstream>
+
+state_server::state_server(const std::string& path, std::function<std::vector<std::shared_ptr<const state_snapshot>>()> get_snapshots)
+    : m_path(path)
+    , m_sock(-1)
+    , m_get_snapshots(get_snapshots)
+    , m_thread(nullptr)
+{
+    HC_LOG_TRACE("");
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (m_path.empty() || m_path.size() >= sizeof(addr.sun_path)) {
+        HC_LOG_ERROR("invalid state socket path: " << m_path);
+        throw "invalid state socket path";
+    }
+    strncpy(addr.sun_path, m_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    m_sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_sock < 0) {
+        HC_LOG_ERROR("failed to create state socket! Error: " << strerror(errno) << " errno: " << errno);
+        throw "failed to create state socket";
+    }
+
+    //remove the socket of a previous run
+    struct stat st;
+    if (stat(m_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(m_path.c_str());
+    }
+
+    if (bind(m_sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        HC_LOG_ERROR("failed to bind state socket to " << m_path << "! Error: " << strerror(errno) << " errno: " << errno);
+        close(m_sock);
+        throw "failed to bind state socket";
+    }
+
+    if (listen(m_sock, STATE_SERVER_BACKLOG) < 0) {
+        HC_LOG_ERROR("failed to listen on state socket! Error: " << strerror(errno) << " errno: " << errno);
+        close(m_sock);
+        unlink(m_path.c_str());
+        throw "failed to listen on state socket";
+    }
+
+    if (pipe2(m_stop_pipe, O_CLOEXEC) < 0) {
+        HC_LOG_ERROR("failed to create pipe! Error: " << strerror(errno) << " errno: " << errno);
+        close(m_sock);
+        unlink(m_path.c_str());
+        throw "failed to create pipe";
+    }
+
+    m_thread.reset(new std::thread(&state_server::worker_thread, this));
+}
+
+state_server::~state_server()
+{
+    HC_LOG_TRACE("");
+
+    char c = 0;
+    if (write(m_stop_pipe[1], &c, sizeof(c)) < 0) {
+        HC_LOG_ERROR("failed to stop the state server! Error: " << strerror(errno) << " errno: " << errno);
+    }
+
+    if (m_thread) {
+        m_thread->join();
+    }
+
+    close(m_stop_pipe[0]);
+    close(m_stop_pipe[1]);
+    close(m_sock);
+    unlink(m_path.c_str());
+}
+
+void state_server::worker_thread()
+{
+    HC_LOG_TRACE("");
+
+    pollfd fds[2];
+    fds[0].fd = m_sock;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_stop_pipe[0];
+    fds[1].events = POLLIN;
+
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            HC_LOG_ERROR("failed to poll state socket! Error: " << strerror(errno) << " errno: " << errno);
+            break;
+        }
+
+        if (fds[1].revents != 0) {
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int client = accept4(m_sock, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) {
+                if (errno != EINTR && errno != EAGAIN && errno != ECONNABORTED) {
+                    HC_LOG_ERROR("failed to accept state client! Error: " << strerror(errno) << " errno: " << errno);
+                }
+                continue;
+            }
+
+            serve(client);
+            close(client);
+        }
+    }
+
+    HC_LOG_DEBUG("worker thread state_server end");
+}
+
+void state_server::serve(int client) const
+{
+    HC_LOG_TRACE("");
+
+    //a client that sends nothing gets the text form after a short wait
+    char buf[STATE_SERVER_RECV_BUF_SIZE];
+    ssize_t size = 0;
+    pollfd pfd;
+    pfd.fd = client;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, STATE_SERVER_RECV_TIMEOUT) > 0) {
+        size = recv(client, buf, sizeof(buf), MSG_DONTWAIT);
+    }
+    std::string request(buf, size > 0 ? size : 0);
+
+    //an HTTP request is mapped to the text command of its path and query, e.g. GET /trace?239.1.1.1+ff05::/16 to "trace 239.1.1.1 ff05::/16"
+    bool is_http = request.compare(0, 4, "GET ") == 0;
+    bool is_json;
+    std::string command;
+    if (is_http) {
+        std::string target = request.substr(4, request.find_first_of(" \r\n", 4) - 4);
+        auto query = target.find('?');
+        command = target.substr(0, query);
+        is_json = command.size() >= 5 && command.compare(command.size() - 5, 5, ".json") == 0;
+        command.erase(0, command.find_first_not_of('/'));
+        if (query != std::string::npos) {
+            std::string args = target.substr(query + 1);
+            std::replace(args.begin(), args.end(), '+', ' ');
+            std::replace(args.begin(), args.end(), ',', ' ');
+            command += " " + args;
+        }
+    } else {
+        auto first = request.find_first_not_of(" \t\r\n");
+        auto last = request.find_last_not_of(" \t\r\n");
+        if (first != std::string::npos) {
+            command = request.substr(first, last - first + 1);
+        }
+        is_json = command == "json" || command == "trace.json";
+    }
+
+    std::ostringstream body;
+    if (command == "trace.json") {
+        body << group_tracer::get_instance().to_json() << std::endl;
+    } else if (command == "trace" || command.compare(0, 6, "trace ") == 0) {
+        body << trace_command(command.substr(std::min(command.size(), std::string("trace ").size())));
+    } else {
+        auto snapshots = m_get_snapshots();
+        if (is_json) {
+            body << "{\"instances\":[";
+            bool first = true;
+            for (auto & e : snapshots) {
+                if (e != nullptr) {
+                    body << (first ? "" : ",") << e->to_json();
+                    first = false;
+                }
+            }
+            body << "]}" << std::endl;
+        } else {
+            for (auto & e : snapshots) {
+                if (e != nullptr) {
+                    body << *e << std::endl << std::endl;
+                }
+            }
+        }
+    }
+
+    std::string answer;
+    if (is_http) {
+        std::string b = body.str();
+        std::ostringstream s;
+        s << "HTTP/1.0 200 OK\r\n";
+        s << "Content-Type: " << (is_json ? "application/json" : "text/plain") << "\r\n";
+        s << "Content-Length: " << b.size() << "\r\n";
+        s << "Connection: close\r\n\r\n";
+        answer = s.str() + b;
+    } else {
+        answer = body.str();
+    }
+
+    //a stalled client must not block the other clients
+    timeval tv;
+    tv.tv_sec = STATE_SERVER_SEND_TIMEOUT / 1000;
+    tv.tv_usec = (STATE_SERVER_SEND_TIMEOUT % 1000) * 1000;
+    if (setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) < 0) {
+        HC_LOG_DEBUG("failed to set the send timeout! Error: " << strerror(errno) << " errno: " << errno);
+        return;
+    }
+
+    const char* data = answer.data();
+    std::size_t remaining = answer.size();
+    while (remaining > 0) {
+        ssize_t sent = send(client, data, remaining, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            HC_LOG_DEBUG("failed to send state! Error: " << strerror(errno) << " errno: " << errno);
+            return;
+        }
+        data += sent;
+        remaining -= sent;
+    }
+}
+
+std::string state_server::trace_command(const std::string& args) const
+{
+    HC_LOG_TRACE("");
+
+    group_tracer& gt = group_tracer::get_instance();
+    std::ostringstream s;
+    if (args == "off") {
+        gt.disable();
+    } else if (args.find_first_not_of(" ") != std::string::npos) {
+        std::string error = gt.set_groups(args);
+        if (!error.empty()) {
+            s << "error: " << error << std::endl;
+            return s.str();
+        }
+    }
+
+    s << gt.get_status() << std::endl;
+    return s.str();
+}
@@ -0,0 +1,521 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/proxy/state_snapshot.hpp"
+#include "include/proxy/interfaces.hpp"
+
+#include <sstream>
+#include <iomanip>
+#include <atomic>
+
+namespace
+{
+//remaining time in milliseconds at the time of the snapshot, -1 if the timer is not running
+long get_remaining_time(const timing_clock::time_point& timer, const timing_clock::time_point& now)
+{
+    if (timer == timing_clock::time_point()) {
+        return -1;
+    } else if (timer <= now) {
+        return 0;
+    } else {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(timer - now).count();
+    }
+}
+
+std::string get_timer_text(const timing_clock::time_point& timer, const timing_clock::time_point& now)
+{
+    std::ostringstream s;
+    s << get_remaining_time(timer, now) / 1000.0 << "sec";
+    return s.str();
+}
+
+std::string get_source_list_text(const std::vector<source_snapshot>& slist, const timing_clock::time_point& now)
+{
+    std::ostringstream s;
+    s << "{";
+    for (auto it = std::begin(slist); it != std::end(slist); ++it) {
+        if (it != std::begin(slist)) {
+            s << ", ";
+        }
+        s << it->saddr;
+
+        bool has_timer = it->timer != timing_clock::time_point();
+        if (has_timer && it->retransmission_count >= 0) {
+            s << "(" << get_timer_text(it->timer, now) << "," << it->retransmission_count << "x)";
+        } else if (has_timer) {
+            s << "(" << get_timer_text(it->timer, now) << ")";
+        } else if (it->retransmission_count >= 0) {
+            s << "(" << it->retransmission_count << "x)";
+        }
+    }
+    s << "}";
+    return s.str();
+}
+
+std::string json_string(const std::string& str)
+{
+    std::ostringstream s;
+    s << "\"";
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            s << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            s << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+        } else {
+            s << c;
+        }
+    }
+    s << "\"";
+    return s.str();
+}
+
+//null if the timer is not running
+std::string json_timer(const timing_clock::time_point& timer, const timing_clock::time_point& now)
+{
+    long remaining = get_remaining_time(timer, now);
+    return remaining < 0 ? "null" : std::to_string(remaining);
+}
+
+std::string json_source_list(const std::vector<source_snapshot>& slist, const timing_clock::time_point& now)
+{
+    std::ostringstream s;
+    s << "[";
+    for (auto it = std::begin(slist); it != std::end(slist); ++it) {
+        if (it != std::begin(slist)) {
+            s << ",";
+        }
+        s << "{\"source\":" << json_string(it->saddr.to_string());
+        s << ",\"timer_ms\":" << json_timer(it->timer, now);
+        s << ",\"retransmission_count\":" << it->retransmission_count << "}";
+    }
+    s << "]";
+    return s.str();
+}
+
+void add_source_list(std::vector<source_snapshot>& to, const source_list<source>& from)
+{
+    to.reserve(from.size());
+    for (auto & e : from) {
+        to.push_back(source_snapshot{e.saddr, e.shared_source_timer != nullptr ? e.shared_source_timer->get_end_time() : timing_clock::time_point(), e.retransmission_count});
+    }
+}
+
+template<typename T>
+timing_clock::time_point get_end_time(const std::shared_ptr<T>& timer)
+{
+    return timer != nullptr ? timer->get_end_time() : timing_clock::time_point();
+}
+}
+
+std::string state_snapshot::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+    s << "##-- state of proxy instance " << instance_name << " (table:" << table_number << ",epoch:" << epoch << ") --##" << std::endl;
+
+    s << "upstream interfaces:";
+    for (auto & e : upstreams) {
+        s << " " << interfaces::get_if_name(e) << "(index:" << e << ")";
+    }
+
+    for (auto & d : downstreams) {
+        const querier_snapshot& q = d.second;
+        s << std::endl << std::endl << "##-- downstream interface " << interfaces::get_if_name(q.if_index) << "(index:" << q.if_index << ") --##" << std::endl;
+        s << "querier version: " << get_group_mem_protocol_name(q.querier_version_mode) << std::endl;
+        s << "is querier: " << (q.is_querier ? "true" : "false") << std::endl;
+        if (q.is_suspended) {
+            s << "suspended: true" << std::endl;
+        }
+        if (q.general_query_timer != timing_clock::time_point()) {
+            s << "general query timer: " << get_timer_text(q.general_query_timer, time) << std::endl;
+        }
+        s << "startup query count: " << q.startup_query_count << std::endl;
+
+        s << "subscribed groups: " << q.groups->size();
+        for (auto & e : *q.groups) {
+            const group_snapshot& g = *e.second;
+            std::ostringstream gs;
+            gs << get_group_mem_protocol_name(g.compatibility_mode);
+            if (g.older_host_present_timer != timing_clock::time_point()) {
+                gs << "(" << get_timer_text(g.older_host_present_timer, time) << ")";
+            }
+
+            gs << ", " << get_mc_filter_name(g.filter_mode);
+            if (g.filter_mode == EXCLUDE_MODE && g.group_retransmission_timer != timing_clock::time_point()) {
+                gs << "(" << get_timer_text(g.filter_timer, time) << "," << get_timer_text(g.group_retransmission_timer, time) << "," << g.group_retransmission_count << "x)";
+            } else if (g.filter_mode == EXCLUDE_MODE) {
+                gs << "(" << get_timer_text(g.filter_timer, time) << ")";
+            }
+            gs << std::endl;
+
+            std::string ret_timer;
+            if (g.source_retransmission_timer != timing_clock::time_point()) {
+                ret_timer = get_timer_text(g.source_retransmission_timer, time) + ", ";
+            }
+            if (g.filter_mode == INCLUDE_MODE) {
+                gs << "included list(" << ret_timer << "#" << g.include_requested_list.size() << "): " << get_source_list_text(g.include_requested_list, time);
+            } else {
+                gs << "requested list(" << ret_timer << "#" << g.include_requested_list.size() << "): " << get_source_list_text(g.include_requested_list, time) << std::endl;
+                gs << "exclude_list(" << ret_timer << "#" << g.exclude_list.size() << "): " << get_source_list_text(g.exclude_list, time);
+            }
+
+            s << std::endl << "-- group address: " << e.first << std::endl;
+            s << indention(gs.str());
+        }
+    }
+
+    s << std::endl << std::endl << "##-- routes --##" << std::endl;
+    s << "groups with sources: " << routes->size();
+    for (auto & e : *routes) {
+        s << std::endl << "group: " << e.first;
+        for (auto & r : e.second->sources) {
+            s << std::endl << "\t" << r.first.saddr;
+            if (r.first.timer != timing_clock::time_point()) {
+                s << "(" << get_timer_text(r.first.timer, time) << ")";
+            }
+            s << " ==> " << interfaces::get_if_name(r.second);
+        }
+    }
+
+    return s.str();
+}
+
+std::string state_snapshot::to_json() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+    s << "{\"instance\":" << json_string(instance_name);
+    s << ",\"table\":" << table_number;
+    s << ",\"epoch\":" << epoch;
+    s << ",\"protocol\":" << json_string(get_group_mem_protocol_name(group_mem_protocol_version));
+
+    s << ",\"upstreams\":[";
+    for (auto it = std::begin(upstreams); it != std::end(upstreams); ++it) {
+        if (it != std::begin(upstreams)) {
+            s << ",";
+        }
+        s << "{\"if_index\":" << *it << ",\"name\":" << json_string(interfaces::get_if_name(*it)) << "}";
+    }
+    s << "]";
+
+    s << ",\"downstreams\":[";
+    for (auto it = std::begin(downstreams); it != std::end(downstreams); ++it) {
+        const querier_snapshot& q = it->second;
+        if (it != std::begin(downstreams)) {
+            s << ",";
+        }
+        s << "{\"if_index\":" << q.if_index << ",\"name\":" << json_string(interfaces::get_if_name(q.if_index));
+        s << ",\"querier_version\":" << json_string(get_group_mem_protocol_name(q.querier_version_mode));
+        s << ",\"is_querier\":" << (q.is_querier ? "true" : "false");
+        s << ",\"suspended\":" << (q.is_suspended ? "true" : "false");
+        s << ",\"general_query_timer_ms\":" << json_timer(q.general_query_timer, time);
+        s << ",\"startup_query_count\":" << q.startup_query_count;
+
+        s << ",\"groups\":[";
+        for (auto git = std::begin(*q.groups); git != std::end(*q.groups); ++git) {
+            const group_snapshot& g = *git->second;
+            if (git != std::begin(*q.groups)) {
+                s << ",";
+            }
+            s << "{\"group\":" << json_string(git->first.to_string());
+            s << ",\"compatibility_mode\":" << json_string(get_group_mem_protocol_name(g.compatibility_mode));
+            s << ",\"older_host_present_timer_ms\":" << json_timer(g.older_host_present_timer, time);
+            s << ",\"filter_mode\":" << json_string(get_mc_filter_name(g.filter_mode));
+            s << ",\"filter_timer_ms\":" << json_timer(g.filter_timer, time);
+            s << ",\"group_retransmission_timer_ms\":" << json_timer(g.group_retransmission_timer, time);
+            s << ",\"group_retransmission_count\":" << g.group_retransmission_count;
+            s << ",\"source_retransmission_timer_ms\":" << json_timer(g.source_retransmission_timer, time);
+            s << ",\"include_requested_list\":" << json_source_list(g.include_requested_list, time);
+            s << ",\"exclude_list\":" << json_source_list(g.exclude_list, time) << "}";
+        }
+        s << "]}";
+    }
+    s << "]";
+
+    s << ",\"routes\":[";
+    for (auto it = std::begin(*routes); it != std::end(*routes); ++it) {
+        if (it != std::begin(*routes)) {
+            s << ",";
+        }
+        s << "{\"group\":" << json_string(it->first.to_string()) << ",\"sources\":[";
+        for (auto sit = std::begin(it->second->sources); sit != std::end(it->second->sources); ++sit) {
+            if (sit != std::begin(it->second->sources)) {
+                s << ",";
+            }
+            s << "{\"source\":" << json_string(sit->first.saddr.to_string());
+            s << ",\"timer_ms\":" << json_timer(sit->first.timer, time);
+            s << ",\"input_if_index\":" << sit->second;
+            s << ",\"input_if\":" << json_string(interfaces::get_if_name(sit->second)) << "}";
+        }
+        s << "]}";
+    }
+    s << "]}";
+
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const state_snapshot& s)
+{
+    HC_LOG_TRACE("");
+    return stream << s.to_string();
+}
+
+state_publisher::state_publisher()
+    : m_tracking(false)
+    , m_all_dirty(true)
+    , m_snapshot(nullptr)
+    , m_epoch(0)
+{
+    HC_LOG_TRACE("");
+}
+
+void state_publisher::mark_dirty(const addr_storage& gaddr)
+{
+    HC_LOG_TRACE("");
+    if (m_tracking && !m_all_dirty) {
+        m_dirty.insert(gaddr);
+    }
+}
+
+void state_publisher::mark_all_dirty()
+{
+    HC_LOG_TRACE("");
+    m_all_dirty = true;
+    m_dirty.clear();
+}
+
+std::shared_ptr<const group_snapshot> state_publisher::make_group_snapshot(const gaddr_info& ginfo)
+{
+    HC_LOG_TRACE("");
+    auto g = std::make_shared<group_snapshot>();
+    g->compatibility_mode = ginfo.compatibility_mode_variable;
+    g->older_host_present_timer = get_end_time(ginfo.older_host_present_timer);
+    g->filter_mode = ginfo.filter_mode;
+    g->filter_timer = get_end_time(ginfo.shared_filter_timer);
+    g->group_retransmission_timer = get_end_time(ginfo.group_retransmission_timer);
+    g->group_retransmission_count = ginfo.group_retransmission_count;
+    g->source_retransmission_timer = get_end_time(ginfo.source_retransmission_timer);
+    add_source_list(g->include_requested_list, ginfo.include_requested_list);
+    add_source_list(g->exclude_list, ginfo.exclude_list);
+    return g;
+}
+
+std::shared_ptr<const route_snapshot> state_publisher::make_route_snapshot(const sr_data_value& data)
+{
+    HC_LOG_TRACE("");
+    auto r = std::make_shared<route_snapshot>();
+    r->sources.reserve(data.m_source_list.size());
+    for (auto & e : data.m_source_list) {
+        auto it = data.m_if_map.find(e.saddr);
+        r->sources.push_back(std::make_pair(source_snapshot{e.saddr, get_end_time(e.shared_source_timer), e.retransmission_count}, it != std::end(data.m_if_map) ? it->second : 0));
+    }
+    return r;
+}
+
+std::shared_ptr<const group_snapshot_map> state_publisher::get_groups(const gaddr_map& groups, const std::shared_ptr<const group_snapshot_map>& previous) const
+{
+    HC_LOG_TRACE("");
+
+    if (previous == nullptr || m_all_dirty) {
+        auto result = std::make_shared<group_snapshot_map>();
+        for (auto & e : groups) {
+            result->push_back(e.first, make_group_snapshot(e.second));
+        }
+        return result;
+    }
+
+    //copy on write, only the chunks with a changed group of this interface are copied
+    group_snapshot_map::change_list changes;
+    for (auto & gaddr : m_dirty) {
+        auto it = groups.find(gaddr);
+        if (it != std::end(groups)) {
+            changes.push_back(std::make_pair(gaddr, make_group_snapshot(it->second)));
+        } else if (previous->count(gaddr) > 0) {
+            changes.push_back(std::make_pair(gaddr, nullptr));
+        }
+    }
+
+    if (changes.empty()) {
+        return previous;
+    }
+
+    auto result = std::make_shared<group_snapshot_map>(*previous);
+    result->apply(changes);
+    return result;
+}
+
+std::shared_ptr<const route_snapshot_map> state_publisher::get_routes(const s_routing_data& data, const std::shared_ptr<const route_snapshot_map>& previous) const
+{
+    HC_LOG_TRACE("");
+
+    if (previous == nullptr || m_all_dirty) {
+        //the snapshot map is sorted, the routing data not
+        auto result = std::make_shared<route_snapshot_map>();
+        for (auto e : get_sorted_groups(data)) {
+            result->push_back(e->first, make_route_snapshot(e->second));
+        }
+        return result;
+    }
+
+    route_snapshot_map::change_list changes;
+    for (auto & gaddr : m_dirty) {
+        auto it = data.find(gaddr);
+        if (it != std::end(data)) {
+            changes.push_back(std::make_pair(gaddr, make_route_snapshot(it->second)));
+        } else if (previous->count(gaddr) > 0) {
+            changes.push_back(std::make_pair(gaddr, nullptr));
+        }
+    }
+
+    if (changes.empty()) {
+        return previous;
+    }
+
+    auto result = std::make_shared<route_snapshot_map>(*previous);
+    result->apply(changes);
+    return result;
+}
+
+void state_publisher::publish(const std::shared_ptr<state_snapshot>& s)
+{
+    HC_LOG_TRACE("");
+
+    m_tracking = true;
+    m_all_dirty = false;
+    m_dirty.clear();
+
+    std::lock_guard<std::mutex> lock(m_epoch_lock);
+    s->epoch = ++m_epoch;
+    std::atomic_store(&m_snapshot, std::shared_ptr<const state_snapshot>(s));
+    m_epoch_con_var.notify_all();
+}
+
+unsigned long state_publisher::get_epoch() const
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_epoch_lock);
+    return m_epoch;
+}
+
+std::shared_ptr<const state_snapshot> state_publisher::get_snapshot() const
+{
+    HC_LOG_TRACE("");
+    return std::atomic_load(&m_snapshot);
+}
+
+std::shared_ptr<const state_snapshot> state_publisher::wait_for_snapshot(unsigned long epoch, std::chrono::milliseconds timeout)
+{
+    HC_LOG_TRACE("");
+    std::unique_lock<std::mutex> lock(m_epoch_lock);
+    if (!m_epoch_con_var.wait_for(lock, timeout, [this, epoch]() {
+            return m_epoch >= epoch;
+        })) {
+        HC_LOG_WARN("no new state snapshot within " << timeout.count() << "ms, the latest one is returned");
+    }
+    return get_snapshot();
+}
+
+#ifdef DEBUG_MODE
+void state_publisher::test_state_publisher()
+{
+    using namespace std;
+    cout << "##-- test state_publisher --##" << endl;
+
+    state_publisher sp;
+    membership_db db(IGMPv3);
+    addr_storage g1("239.1.1.1");
+    addr_storage g2("239.1.1.2");
+    db.group_info.insert(gaddr_pair(g1, gaddr_info(IGMPv3, db.arena)));
+    db.group_info.insert(gaddr_pair(g2, gaddr_info(IGMPv3, db.arena)));
+    db.group_info.find(g1)->second.include_requested_list.insert(source(addr_storage("10.1.1.1")));
+
+    auto publish = [&](const std::shared_ptr<const state_snapshot>& previous) {
+        auto s = std::make_shared<state_snapshot>();
+        s->time = timing_clock::now();
+        s->instance_name = "test";
+        querier_snapshot q;
+        q.if_index = 1;
+        q.groups = sp.get_groups(db.group_info, previous != nullptr ? previous->downstreams.at(1).groups : nullptr);
+        s->downstreams[1] = q;
+        s->routes = sp.get_routes(s_routing_data(), previous != nullptr ? previous->routes : nullptr);
+        sp.publish(s);
+        return sp.get_snapshot();
+    };
+
+    auto first = publish(nullptr);
+    cout << "first epoch: " << (first->epoch == 1 ? "OK" : "FAILED") << endl;
+    cout << "groups: " << (first->downstreams.at(1).groups->size() == 2 ? "OK" : "FAILED") << endl;
+
+    auto second = publish(first);
+    cout << "unchanged groups shared: " << (second->downstreams.at(1).groups == first->downstreams.at(1).groups ? "OK" : "FAILED") << endl;
+
+    db.group_info.find(g2)->second.include_requested_list.insert(source(addr_storage("10.2.2.2")));
+    sp.mark_dirty(g2);
+    auto third = publish(second);
+    const group_snapshot_map& g_old = *second->downstreams.at(1).groups;
+    const group_snapshot_map& g_new = *third->downstreams.at(1).groups;
+    cout << "changed group copied: " << (g_new.at(g2) != g_old.at(g2) && g_new.at(g2)->include_requested_list.size() == 1 ? "OK" : "FAILED") << endl;
+    cout << "other group shared: " << (g_new.at(g1) == g_old.at(g1) ? "OK" : "FAILED") << endl;
+
+    db.group_info.erase(g1);
+    sp.mark_dirty(g1);
+    auto fourth = publish(third);
+    cout << "deleted group removed: " << (fourth->downstreams.at(1).groups->count(g1) == 0 ? "OK" : "FAILED") << endl;
+    cout << "epoch: " << (sp.get_epoch() == 4 ? "OK" : "FAILED") << endl;
+
+    cout << *fourth << endl;
+    cout << fourth->to_json() << endl;
+
+    //many groups are split into chunks
+    addr_storage g("239.2.0.0");
+    for (int i = 0; i < 1000; ++i) {
+        db.group_info.insert(gaddr_pair(++g, gaddr_info(IGMPv3, db.arena)));
+    }
+    sp.mark_all_dirty();
+    auto fifth = publish(fourth);
+    cout << "chunks of 1001 groups (expected 4): " << fifth->downstreams.at(1).groups->get_chunk_count() << endl;
+
+    //600 new groups in the first chunk split it
+    g = addr_storage("239.1.2.0");
+    for (int i = 0; i < 600; ++i) {
+        db.group_info.insert(gaddr_pair(++g, gaddr_info(IGMPv3, db.arena)));
+        sp.mark_dirty(g);
+    }
+    auto sixth = publish(fifth);
+    const group_snapshot_map& g_split = *sixth->downstreams.at(1).groups;
+    bool sorted = std::equal(std::begin(g_split), std::end(g_split), std::begin(db.group_info), [](const group_snapshot_map::value_type & a, const gaddr_pair & b) {
+        return a.first == b.first;
+    });
+    cout << "groups: " << (g_split.size() == 1601 && sorted ? "OK" : "FAILED") << endl;
+    cout << "chunks after the split (expected 5): " << g_split.get_chunk_count() << endl;
+    cout << "previous snapshot unchanged: " << (fifth->downstreams.at(1).groups->size() == 1001 ? "OK" : "FAILED") << endl;
+
+    for (auto & e : db.group_info) {
+        sp.mark_dirty(e.first);
+    }
+    db.group_info.clear();
+    auto seventh = publish(sixth);
+    const group_snapshot_map& g_empty = *seventh->downstreams.at(1).groups;
+    cout << "all groups removed: " << (g_empty.size() == 0 && g_empty.get_chunk_count() == 0 && std::begin(g_empty) == std::end(g_empty) ? "OK" : "FAILED") << endl;
+}
+#endif /* DEBUG_MODE */
@@ -0,0 +1,250 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/proxy/stats_collector.hpp"
+#include "include/proxy/interfaces.hpp"
+#include "include/proxy/def.hpp"
+#include "include/utils/mroute_socket.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+
+std::list<std::pair<std::pair<addr_storage, addr_storage>, route_traffic>> stats_snapshot::get_top_routes(unsigned int count) const
+{
+    HC_LOG_TRACE("");
+
+    std::vector<std::pair<std::pair<addr_storage, addr_storage>, route_traffic>> routes(std::begin(this->routes), std::end(this->routes));
+    std::size_t n = std::min(static_cast<std::size_t>(count), routes.size());
+    std::partial_sort(std::begin(routes), std::begin(routes) + n, std::end(routes), [](const std::pair<std::pair<addr_storage, addr_storage>, route_traffic>& a, const std::pair<std::pair<addr_storage, addr_storage>, route_traffic>& b) {
+        return a.second.forwarded.byte_rate > b.second.forwarded.byte_rate;
+    });
+
+    return std::list<std::pair<std::pair<addr_storage, addr_storage>, route_traffic>>(std::begin(routes), std::begin(routes) + n);
+}
+
+std::string stats_snapshot::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(1);
+    s << "traffic statistics (interval " << interval.count() << "ms):";
+
+    for (auto & e : vifs) {
+        s << std::endl << "\t" << interfaces::get_if_name(e.first) << ": in " << e.second.in.packet_rate << " pkt/s " << e.second.in.byte_rate << " B/s, out " << e.second.out.packet_rate << " pkt/s " << e.second.out.byte_rate << " B/s";
+    }
+
+    s << std::endl << "\t" << routes.size() << " routes, hottest:";
+    for (auto & e : get_top_routes(STATS_COLLECTOR_TOP_ROUTES)) {
+        s << std::endl << "\t\t(" << e.first.second << ", " << e.first.first << ") from " << interfaces::get_if_name(e.second.iif) << ": " << e.second.forwarded.packet_rate << " pkt/s " << e.second.forwarded.byte_rate << " B/s, " << e.second.forwarded.packets << " packets";
+        if (e.second.wrong_if > 0) {
+            s << ", " << e.second.wrong_if << " on wrong interface";
+        }
+    }
+
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const stats_snapshot& s)
+{
+    HC_LOG_TRACE("");
+    return stream << s.to_string();
+}
+
+stats_collector::stats_collector(int addr_family, const std::shared_ptr<const interfaces>& interfaces, int table_number, const std::shared_ptr<const mroute_socket>& mrt_sock, const std::chrono::milliseconds& interval)
+    : m_interfaces(interfaces)
+    , m_interval(interval)
+    , m_mrt_sock(mrt_sock)
+    , m_mfc(addr_family, table_number)
+    , m_running(false)
+{
+    HC_LOG_TRACE("");
+
+    sample();
+
+    if (m_interval.count() > 0) {
+        m_running = true;
+        m_thread.reset(new std::thread(&stats_collector::worker_thread, this));
+    }
+}
+
+stats_collector::~stats_collector()
+{
+    HC_LOG_TRACE("");
+
+    if (m_thread) {
+        {
+            std::lock_guard<std::mutex> lock(m_running_lock);
+            m_running = false;
+        }
+        m_running_con_var.notify_all();
+        m_thread->join();
+    }
+}
+
+void stats_collector::worker_thread()
+{
+    HC_LOG_TRACE("");
+
+    std::unique_lock<std::mutex> lock(m_running_lock);
+    while (m_running) {
+        if (!m_running_con_var.wait_for(lock, m_interval, [this]() {
+        return !m_running;
+    })) {
+            lock.unlock();
+            sample();
+            lock.lock();
+        }
+    }
+}
+
+void stats_collector::set_rate(traffic_counter& current, const traffic_counter* previous, double seconds)
+{
+    HC_LOG_TRACE("");
+
+    //a counter that went down was reset, e.g. the route was deleted and added again
+    if (previous == nullptr || seconds <= 0 || current.packets < previous->packets || current.bytes < previous->bytes) {
+        current.packet_rate = 0;
+        current.byte_rate = 0;
+    } else {
+        current.packet_rate = (current.packets - previous->packets) / seconds;
+        current.byte_rate = (current.bytes - previous->bytes) / seconds;
+    }
+}
+
+bool stats_collector::sample()
+{
+    HC_LOG_TRACE("");
+
+    bool rc = true;
+    std::shared_ptr<stats_snapshot> s = std::make_shared<stats_snapshot>();
+    s->time = std::chrono::steady_clock::now();
+
+    //one ioctl per virtual interface, the kernel has no bulk request for them
+    std::map<int, unsigned int> vif_map = m_interfaces->get_vif_map();
+    std::list<int> vifs;
+    for (auto & e : vif_map) {
+        vifs.push_back(e.first);
+    }
+
+    std::map<int, vif_counter> vif_counters;
+    rc &= m_mrt_sock->get_vif_counters(vifs, vif_counters);
+    for (auto & e : vif_counters) {
+        vif_traffic& v = s->vifs[vif_map[e.first]];
+        v.in.packets = e.second.in_packets;
+        v.in.bytes = e.second.in_bytes;
+        v.out.packets = e.second.out_packets;
+        v.out.bytes = e.second.out_bytes;
+    }
+
+    //one rtnetlink dump for all routes of the table
+    rc &= m_mfc.refresh();
+    for (auto & e : m_mfc.get_counters()) {
+        route_traffic& r = s->routes[e.first];
+        r.iif = e.second.iif;
+        r.forwarded.packets = e.second.packets;
+        r.forwarded.bytes = e.second.bytes;
+        r.wrong_if = e.second.wrong_if;
+    }
+
+    std::shared_ptr<const stats_snapshot> previous = get_snapshot();
+    if (previous != nullptr) {
+        s->interval = std::chrono::duration_cast<std::chrono::milliseconds>(s->time - previous->time);
+        double seconds = std::chrono::duration<double>(s->time - previous->time).count();
+
+        for (auto & e : s->vifs) {
+            auto it = previous->vifs.find(e.first);
+            set_rate(e.second.in, it != std::end(previous->vifs) ? &it->second.in : nullptr, seconds);
+            set_rate(e.second.out, it != std::end(previous->vifs) ? &it->second.out : nullptr, seconds);
+        }
+
+        for (auto & e : s->routes) {
+            auto it = previous->routes.find(e.first);
+            set_rate(e.second.forwarded, it != std::end(previous->routes) ? &it->second.forwarded : nullptr, seconds);
+        }
+    } else {
+        s->interval = std::chrono::milliseconds(0);
+    }
+
+    std::atomic_store(&m_snapshot, std::shared_ptr<const stats_snapshot>(s));
+    return rc;
+}
+
+std::shared_ptr<const stats_snapshot> stats_collector::get_snapshot() const
+{
+    HC_LOG_TRACE("");
+    return std::atomic_load(&m_snapshot);
+}
+
+std::chrono::milliseconds stats_collector::get_interval() const
+{
+    HC_LOG_TRACE("");
+    return m_interval;
+}
+
+std::string stats_collector::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::shared_ptr<const stats_snapshot> s = get_snapshot();
+    if (s == nullptr) {
+        return "no traffic statistics";
+    }
+    return s->to_string();
+}
+
+std::ostream& operator<<(std::ostream& stream, const stats_collector& s)
+{
+    HC_LOG_TRACE("");
+    return stream << s.to_string();
+}
+
+#ifdef DEBUG_MODE
+void stats_collector::test_stats_collector()
+{
+    using namespace std;
+    cout << "##-- test stats_collector --##" << endl;
+
+    try {
+        std::shared_ptr<mroute_socket> ms = std::make_shared<mroute_socket>();
+        ms->create_raw_ipv4_socket();
+        ms->set_mrt_flag(true);
+
+        std::shared_ptr<interfaces> interf = std::make_shared<interfaces>(AF_INET, false);
+        interf->add_interface(interfaces::get_if_index("lo"));
+        ms->add_vif(interf->get_virtual_if_index(interfaces::get_if_index("lo")), interfaces::get_if_index("lo"), addr_storage());
+
+        stats_collector sc(AF_INET, interf, 0, ms, std::chrono::milliseconds(100));
+        this_thread::sleep_for(chrono::milliseconds(350));
+
+        std::shared_ptr<const stats_snapshot> s = sc.get_snapshot();
+        cout << "sample: " << (sc.sample() ? "OK" : "FAILED") << endl;
+        cout << "new snapshot published: " << (s != sc.get_snapshot() ? "OK" : "FAILED") << endl;
+        cout << sc << endl;
+
+        ms->set_mrt_flag(false);
+    } catch (const char* e) {
+        cout << "failed: " << e << endl;
+    }
+}
+#endif /* DEBUG_MODE */
@@ -23,15 +23,24 @@
 #include "include/hamcast_logging.h"
 #include "include/proxy/timing.hpp"
 #include "include/proxy/worker.hpp"
+#include "include/utils/flight_recorder.hpp"
 
 #include <iostream>
 #include <unistd.h>
 
+#ifdef SIM
+timing_clock::time_point timing_clock::m_now;
+#endif
+
 timing::timing():
     m_running(false), m_thread(nullptr)
+    , m_outstanding(metrics::get_instance().get_gauge("timers_outstanding", "Timer events waiting in the timing module."))
 {
     HC_LOG_TRACE("");
+
+#ifndef SIM //the simulation advances the virtual clock itself
     start();
+#endif
 }
 
 timing::~timing()
@@ -57,37 +66,49 @@ void timing::worker_thread()
         }
 
         std::lock_guard<std::mutex> lock(m_global_lock);
+        deliver(timing_clock::now());
+    }
+}
 
-        timing_db_key now = std::chrono::steady_clock::now();
-
-        for (auto it = begin(m_db); it != end(m_db);) {
-            if (it->first <= now) {
-                timing_db_value& db_value = it->second;
-                (*std::get<1>(db_value).get())();
-                if (std::get<0>(db_value) != nullptr) {
-                    std::get<0>(db_value)->add_msg(std::get<1>(db_value));
-                }
+void timing::deliver(const timing_db_key& now)
+{
+    HC_LOG_TRACE("");
 
-                it = m_db.erase(it);
-                continue;
+    for (auto it = begin(m_db); it != end(m_db);) {
+        if (it->first <= now) {
+            timing_db_value& db_value = it->second;
+
+            auto tm = dynamic_cast<timer_msg*>(std::get<1>(db_value).get());
+            auto nstm = dynamic_cast<new_source_timer_msg*>(tm);
+            if (nstm != nullptr) {
+                flight_recorder::record(FR_TIMER_FIRED, nstm->get_if_index(), nstm->get_gaddr(), nstm->get_saddr(), nstm->get_type());
+            } else if (tm != nullptr) {
+                flight_recorder::record(FR_TIMER_FIRED, tm->get_if_index(), tm->get_gaddr(), tm->get_type());
+            }
 
-            } else {
-                break;
+            (*std::get<1>(db_value).get())();
+            if (std::get<0>(db_value) != nullptr) {
+                std::get<0>(db_value)->add_msg(std::get<1>(db_value));
             }
 
-            ++it;
+            it = m_db.erase(it);
+        } else {
+            break;
         }
     }
+
+    m_outstanding.set(m_db.size());
 }
 
 void timing::add_time(std::chrono::milliseconds delay, const worker* msg_worker, const std::shared_ptr<proxy_msg>& pr_msg)
 {
     HC_LOG_TRACE("");
-    timing_db_key until = std::chrono::steady_clock::now() + delay;
+    timing_db_key until = timing_clock::now() + delay;
 
     std::lock_guard<std::mutex> lock(m_global_lock);
 
     m_db.insert(timing_db_pair(until, std::make_tuple(msg_worker, pr_msg)));
+    m_outstanding.set(m_db.size());
     m_con_var.notify_one();
 }
 
@@ -105,7 +126,32 @@ void timing::stop_all_time(const worker* msg_worker)
         ++it;
     }
 
+    m_outstanding.set(m_db.size());
+}
+
+#ifdef SIM
+bool timing::get_next_time(timing_db_key& next)
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+
+    if (m_db.empty()) {
+        return false;
+    }
+
+    next = m_db.begin()->first;
+    return true;
+}
+
+void timing::advance(const timing_db_key& until)
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+
+    timing_clock::set(until);
+    deliver(until);
 }
+#endif
 
 void timing::start()
 {
@@ -0,0 +1,120 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/*
+ * Substitute of src/utils/if_prop.cpp for the simulation build: the interface
+ * list belongs to the simulated network and is not released here.
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/utils/if_prop.hpp"
+#include "include/sim/sim_network.hpp"
+
+if_prop::if_prop():
+    m_if_addrs(0)
+{
+    HC_LOG_TRACE("");
+}
+
+bool if_prop::refresh_network_interfaces()
+{
+    HC_LOG_TRACE("");
+
+    m_if_map.clear();
+    m_if_addrs = sim_network::get_instance().get_ifaddrs();
+    if (m_if_addrs == nullptr) {
+        HC_LOG_ERROR("no simulated interfaces");
+        return false;
+    }
+
+    //one address per simulated interface
+    for (struct ifaddrs* ifEntry = m_if_addrs; ifEntry != nullptr; ifEntry = ifEntry->ifa_next) {
+        if (ifEntry->ifa_addr->sa_family == AF_INET) {
+            m_if_map.insert(if_prop_pair(ifEntry->ifa_name, ipv4_6_pair(ifEntry, std::list<const struct ifaddrs*>())));
+        } else {
+            m_if_map.insert(if_prop_pair(ifEntry->ifa_name, ipv4_6_pair(nullptr, std::list<const struct ifaddrs*> {ifEntry})));
+        }
+    }
+    return true;
+}
+
+const if_prop_map* if_prop::get_if_props() const
+{
+    HC_LOG_TRACE("");
+
+    if (!is_getaddrs_valid()) {
+        HC_LOG_ERROR("data invalid");
+        return nullptr;
+    }
+
+    return &m_if_map;
+}
+
+const struct ifaddrs* if_prop::get_ip4_if(const std::string& if_name) const {
+    HC_LOG_TRACE("");
+
+    if (!is_getaddrs_valid()) {
+        HC_LOG_ERROR("data invalid");
+        return nullptr;
+    }
+
+    if_prop_map::const_iterator if_prop_iter = m_if_map.find(if_name);
+    if (if_prop_iter == m_if_map.end()) {
+        return nullptr;
+    }
+
+    return if_prop_iter->second.ip4_addr;
+}
+
+const std::list<const struct ifaddrs*>* if_prop::get_ip6_if(const std::string& if_name) const
+{
+    HC_LOG_TRACE("");
+
+    if (!is_getaddrs_valid()) {
+        HC_LOG_ERROR("data invalid");
+        return nullptr;
+    }
+
+    if_prop_map::const_iterator if_prop_iter = m_if_map.find(if_name);
+    if (if_prop_iter == m_if_map.end()) {
+        return nullptr;
+    }
+
+    return &(if_prop_iter->second.ip6_addr);
+}
+
+if_prop::~if_prop()
+{
+    HC_LOG_TRACE("");
+}
+
+unsigned int if_prop::get_if_index(const char* if_name)
+{
+    HC_LOG_TRACE("");
+    return sim_network::get_instance().get_if_index(if_name);
+}
+
+std::string if_prop::get_if_name(unsigned int if_index)
+{
+    HC_LOG_TRACE("");
+    return sim_network::get_instance().get_if_name(if_index);
+}
@@ -0,0 +1,202 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/*
+ * Substitute of src/utils/mroute_socket.cpp for the simulation build: the
+ * multicast routing calls go to the simulated kernel, the socket itself is a
+ * plain UDP socket so that the inherited socket options still work.
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/utils/mroute_socket.hpp"
+#include "include/sim/sim_network.hpp"
+
+mroute_socket::mroute_socket()
+{
+    HC_LOG_TRACE("");
+}
+
+bool mroute_socket::create_raw_ipv4_socket()
+{
+    HC_LOG_TRACE("");
+    return mc_socket::create_udp_ipv4_socket();
+}
+
+bool mroute_socket::create_raw_ipv6_socket()
+{
+    HC_LOG_TRACE("");
+    return mc_socket::create_udp_ipv6_socket();
+}
+
+bool mroute_socket::set_kernel_table(int) const
+{
+    HC_LOG_TRACE("");
+    return true;
+}
+
+bool mroute_socket::set_no_ip_hdr(bool) const
+{
+    HC_LOG_TRACE("");
+    return true;
+}
+
+u_int16_t mroute_socket::calc_checksum(const unsigned char* buf, int buf_size) const
+{
+    HC_LOG_TRACE("");
+
+    u_int16_t* b = (u_int16_t*)buf;
+    u_int32_t sum = 0;
+
+    for (int i = 0; i < buf_size / 2; i++) {
+        sum += b[i];
+    }
+
+    if (buf_size % 2 == 1) {
+        sum += buf[buf_size - 1];
+    }
+
+    //fold the carries into the lower 16 bit
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+
+    return ~sum;
+}
+
+bool mroute_socket::set_ipv6_auto_icmp6_checksum_calc(bool) const
+{
+    HC_LOG_TRACE("");
+    return true;
+}
+
+bool mroute_socket::add_ipv6_extension_header(const unsigned char*, unsigned int) const
+{
+    HC_LOG_TRACE("");
+    return true;
+}
+
+bool mroute_socket::send_packets(std::vector<mroute_packet>& packets) const
+{
+    HC_LOG_TRACE("");
+
+    //the simulated sender records the messages before they are encoded
+    for (auto & e : packets) {
+        e.sent = true;
+    }
+
+    return true;
+}
+
+bool mroute_socket::set_ipv4_receive_packets_with_router_alert_header(bool) const
+{
+    HC_LOG_TRACE("");
+    return true;
+}
+
+bool mroute_socket::set_ipv6_recv_icmpv6_msg() const
+{
+    HC_LOG_TRACE("");
+    return true;
+}
+
+bool mroute_socket::set_ipv6_recv_pkt_info() const
+{
+    HC_LOG_TRACE("");
+    return true;
+}
+
+bool mroute_socket::set_ipv6_recv_hop_by_hop_msg() const
+{
+    HC_LOG_TRACE("");
+    return true;
+}
+
+bool mroute_socket::set_mrt_flag(bool) const
+{
+    HC_LOG_TRACE("");
+    return true;
+}
+
+bool mroute_socket::add_vif(int vifNum, uint32_t if_index, const addr_storage&) const
+{
+    HC_LOG_TRACE("");
+    return sim_network::get_instance().add_vif(vifNum, if_index);
+}
+
+bool mroute_socket::bind_vif_to_table(uint32_t, int) const
+{
+    HC_LOG_TRACE("");
+    return true;
+}
+
+bool mroute_socket::unbind_vif_form_table(uint32_t, int) const
+{
+    HC_LOG_TRACE("");
+    return true;
+}
+
+bool mroute_socket::del_vif(int vif_index) const
+{
+    HC_LOG_TRACE("");
+    return sim_network::get_instance().del_vif(vif_index);
+}
+
+bool mroute_socket::add_mroute(int vif_index, const addr_storage& source_addr, const addr_storage& group_addr, const std::list<int>& output_vif) const
+{
+    HC_LOG_TRACE("");
+    return sim_network::get_instance().add_route(vif_index, group_addr, source_addr, output_vif);
+}
+
+bool mroute_socket::del_mroute(int vif_index, const addr_storage& source_addr, const addr_storage& group_addr) const
+{
+    HC_LOG_TRACE("");
+    return sim_network::get_instance().del_route(vif_index, group_addr, source_addr);
+}
+
+bool mroute_socket::get_vif_stats(int, struct sioc_vif_req*, struct sioc_mif_req6*) const
+{
+    HC_LOG_TRACE("");
+    return false;
+}
+
+bool mroute_socket::get_vif_counters(const std::list<int>& vifs, std::map<int, vif_counter>& result) const
+{
+    HC_LOG_TRACE("");
+
+    result.clear();
+    for (auto e : vifs) {
+        result[e] = vif_counter();
+    }
+
+    return true;
+}
+
+bool mroute_socket::get_mroute_stats(const addr_storage&, const addr_storage&, struct sioc_sg_req*, struct sioc_sg_req6*) const
+{
+    HC_LOG_TRACE("");
+    return false;
+}
+
+mroute_socket::~mroute_socket()
+{
+    HC_LOG_TRACE("");
+}
@@ -0,0 +1,134 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/*
+ * Substitute of src/utils/mroute_stats.cpp for the simulation build: the
+ * packet counts are read from the simulated kernel per route instead of a
+ * rtnetlink dump of the whole table, get_counters() stays empty.
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/utils/mroute_stats.hpp"
+#include "include/sim/sim_network.hpp"
+
+#include <sstream>
+
+mroute_stats::mroute_stats(int addr_family, int table)
+    : m_sock(-1)
+    , m_addr_family(addr_family)
+    , m_table(table)
+    , m_seq(0)
+    , m_valid(false)
+{
+    HC_LOG_TRACE("");
+
+    if (m_addr_family != AF_INET && m_addr_family != AF_INET6) {
+        HC_LOG_ERROR("wrong address family: " << m_addr_family);
+        throw "wrong address family";
+    }
+}
+
+mroute_stats::~mroute_stats()
+{
+    HC_LOG_TRACE("");
+}
+
+bool mroute_stats::send_dump_request()
+{
+    HC_LOG_TRACE("");
+    return true;
+}
+
+bool mroute_stats::receive_dump(mfc_counter_map&)
+{
+    HC_LOG_TRACE("");
+    return true;
+}
+
+bool mroute_stats::refresh()
+{
+    HC_LOG_TRACE("");
+
+    mfc_counter_map result;
+    if (send_dump_request() && receive_dump(result)) {
+        m_counters.swap(result);
+        m_valid = true;
+    } else {
+        m_counters.clear();
+        m_valid = false;
+    }
+
+    m_last_refresh = timing_clock::now();
+    return m_valid;
+}
+
+bool mroute_stats::refresh_if_older_than(const std::chrono::milliseconds& max_age)
+{
+    HC_LOG_TRACE("");
+
+    if (m_valid && timing_clock::now() - m_last_refresh < max_age) {
+        return true;
+    }
+
+    return refresh();
+}
+
+bool mroute_stats::get_packet_count(const addr_storage& gaddr, const addr_storage& saddr, unsigned long& packet_count) const
+{
+    HC_LOG_TRACE("");
+
+    if (!m_valid) {
+        return false;
+    }
+
+    packet_count = sim_network::get_instance().get_route_packets(gaddr, saddr);
+    return true;
+}
+
+const mfc_counter_map& mroute_stats::get_counters() const
+{
+    HC_LOG_TRACE("");
+    return m_counters;
+}
+
+unsigned int mroute_stats::size() const
+{
+    HC_LOG_TRACE("");
+    return m_counters.size();
+}
+
+std::string mroute_stats::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+    s << "simulated multicast route statistics (" << (m_valid ? "valid" : "invalid") << "): " << m_counters.size() << " routes";
+    for (auto & e : m_counters) {
+        s << std::endl << "(" << e.first.second << ", " << e.first.first << "): " << e.second.packets << " packets";
+    }
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const mroute_stats& m)
+{
+    HC_LOG_TRACE("");
+    return stream << m.to_string();
+}
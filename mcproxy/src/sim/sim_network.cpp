@@ -0,0 +1,381 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/sim/sim_network.hpp"
+#include "include/proxy/interfaces.hpp"
+
+#include <sstream>
+#include <cstring>
+
+#include <net/if.h>
+#include <arpa/inet.h>
+
+sim_network::sim_network()
+    : m_addr_family(AF_INET)
+    , m_seed(0)
+    , m_log(nullptr)
+{
+    HC_LOG_TRACE("");
+    memset(m_counters, 0, sizeof(m_counters));
+}
+
+sim_network& sim_network::get_instance()
+{
+    static sim_network instance;
+    return instance;
+}
+
+void sim_network::init(int addr_family, unsigned int if_count, unsigned int seed)
+{
+    HC_LOG_TRACE("");
+
+    m_addr_family = addr_family;
+    m_seed = seed;
+    m_if_names.clear();
+    m_if_addrs.assign(if_count, sockaddr_storage());
+    m_if_netmasks.assign(if_count, sockaddr_storage());
+    m_ifaddrs.assign(if_count, ifaddrs());
+
+    for (unsigned int i = 0; i < if_count; ++i) {
+        m_if_names.push_back(SIM_IF_NAME_PREFIX + std::to_string(i));
+    }
+
+    //IPv4 10.<i / 256>.<i % 256>.1/24, IPv6 fe80::<i>:1/64
+    for (unsigned int i = 0; i < if_count; ++i) {
+        if (m_addr_family == AF_INET) {
+            auto addr = reinterpret_cast<sockaddr_in*>(&m_if_addrs[i]);
+            addr->sin_family = AF_INET;
+            addr->sin_addr.s_addr = htonl(0x0a000001 | (i << 8));
+
+            auto mask = reinterpret_cast<sockaddr_in*>(&m_if_netmasks[i]);
+            mask->sin_family = AF_INET;
+            mask->sin_addr.s_addr = htonl(0xffffff00);
+        } else {
+            auto addr = reinterpret_cast<sockaddr_in6*>(&m_if_addrs[i]);
+            addr->sin6_family = AF_INET6;
+            addr->sin6_addr.s6_addr[0] = 0xfe;
+            addr->sin6_addr.s6_addr[1] = 0x80;
+            addr->sin6_addr.s6_addr[12] = i >> 8;
+            addr->sin6_addr.s6_addr[13] = i & 0xff;
+            addr->sin6_addr.s6_addr[15] = 1;
+            addr->sin6_scope_id = SIM_IF_INDEX_BASE + i;
+
+            auto mask = reinterpret_cast<sockaddr_in6*>(&m_if_netmasks[i]);
+            mask->sin6_family = AF_INET6;
+            memset(mask->sin6_addr.s6_addr, 0xff, 8);
+        }
+
+        ifaddrs& e = m_ifaddrs[i];
+        e.ifa_next = (i + 1 < if_count) ? &m_ifaddrs[i + 1] : nullptr;
+        e.ifa_name = const_cast<char*>(m_if_names[i].c_str());
+        e.ifa_flags = IFF_UP | IFF_RUNNING | IFF_MULTICAST;
+        e.ifa_addr = reinterpret_cast<sockaddr*>(&m_if_addrs[i]);
+        e.ifa_netmask = reinterpret_cast<sockaddr*>(&m_if_netmasks[i]);
+    }
+}
+
+void sim_network::set_log(std::ostream* log)
+{
+    HC_LOG_TRACE("");
+    m_log = log;
+}
+
+int sim_network::get_addr_family() const
+{
+    HC_LOG_TRACE("");
+    return m_addr_family;
+}
+
+unsigned int sim_network::get_if_count() const
+{
+    HC_LOG_TRACE("");
+    return m_if_names.size();
+}
+
+unsigned int sim_network::get_seed() const
+{
+    HC_LOG_TRACE("");
+    return m_seed;
+}
+
+unsigned int sim_network::get_if_index(const std::string& if_name) const
+{
+    HC_LOG_TRACE("");
+
+    for (unsigned int i = 0; i < m_if_names.size(); ++i) {
+        if (m_if_names[i] == if_name) {
+            return SIM_IF_INDEX_BASE + i;
+        }
+    }
+
+    return INTERFACES_UNKOWN_IF_INDEX;
+}
+
+std::string sim_network::get_if_name(unsigned int if_index) const
+{
+    HC_LOG_TRACE("");
+
+    if (if_index >= SIM_IF_INDEX_BASE && if_index - SIM_IF_INDEX_BASE < m_if_names.size()) {
+        return m_if_names[if_index - SIM_IF_INDEX_BASE];
+    }
+
+    return std::string();
+}
+
+struct ifaddrs* sim_network::get_ifaddrs()
+{
+    HC_LOG_TRACE("");
+    return m_ifaddrs.empty() ? nullptr : &m_ifaddrs[0];
+}
+
+std::string sim_network::get_vif_name(int vif) const
+{
+    HC_LOG_TRACE("");
+
+    auto it = m_vifs.find(vif);
+    if (it != std::end(m_vifs)) {
+        return get_if_name(it->second);
+    }
+
+    return "vif" + std::to_string(vif);
+}
+
+#define SIM_LOG(message) \
+    if (m_log != nullptr) { \
+        *m_log << std::chrono::duration_cast<std::chrono::milliseconds>(timing_clock::now().time_since_epoch()).count() << " " << message << std::endl; \
+    }
+
+bool sim_network::add_vif(int vif, unsigned int if_index)
+{
+    HC_LOG_TRACE("");
+    ++m_counters[SO_ADD_VIF];
+
+    if (!m_vifs.insert(std::make_pair(vif, if_index)).second) {
+        return false;
+    }
+
+    SIM_LOG("ADD_VIF " << vif << " " << get_if_name(if_index));
+    return true;
+}
+
+bool sim_network::del_vif(int vif)
+{
+    HC_LOG_TRACE("");
+    ++m_counters[SO_DEL_VIF];
+    SIM_LOG("DEL_VIF " << vif << " " << get_vif_name(vif));
+    return m_vifs.erase(vif) > 0;
+}
+
+bool sim_network::add_route(int input_vif, const addr_storage& gaddr, const addr_storage& saddr, const std::list<int>& output_vif)
+{
+    HC_LOG_TRACE("");
+    ++m_counters[SO_ADD_ROUTE];
+
+    auto key = std::make_pair(gaddr, saddr);
+    auto it = m_routes.find(key);
+    if (it == std::end(m_routes)) {
+        it = m_routes.insert(std::make_pair(key, sim_route {input_vif, output_vif, 0, false, timing_clock::now()})).first;
+    } else {
+        //the kernel keeps the counters of an updated route
+        it->second.packets = get_packets(it->second);
+        it->second.since = timing_clock::now();
+        it->second.input_vif = input_vif;
+        it->second.output_vif = output_vif;
+    }
+    it->second.counting = is_source_active(gaddr, saddr);
+
+    if (m_log != nullptr) {
+        std::ostringstream s;
+        for (auto e : output_vif) {
+            s << " " << get_vif_name(e);
+        }
+        SIM_LOG("ADD_ROUTE (" << saddr << ", " << gaddr << ") " << get_vif_name(input_vif) << " ==>" << s.str());
+    }
+    return true;
+}
+
+bool sim_network::del_route(int input_vif, const addr_storage& gaddr, const addr_storage& saddr)
+{
+    HC_LOG_TRACE("");
+    ++m_counters[SO_DEL_ROUTE];
+    SIM_LOG("DEL_ROUTE (" << saddr << ", " << gaddr << ") " << get_vif_name(input_vif));
+
+    if (m_routes.erase(std::make_pair(gaddr, saddr)) == 0) {
+        return false;
+    }
+
+    m_deleted_routes.push_back(std::make_pair(gaddr, saddr));
+    return true;
+}
+
+bool sim_network::has_route(const addr_storage& gaddr, const addr_storage& saddr) const
+{
+    HC_LOG_TRACE("");
+    return m_routes.find(std::make_pair(gaddr, saddr)) != std::end(m_routes);
+}
+
+unsigned long sim_network::get_packets(const sim_route& r)
+{
+    HC_LOG_TRACE("");
+
+    if (r.counting) {
+        return r.packets + std::chrono::duration_cast<std::chrono::milliseconds>(timing_clock::now() - r.since).count();
+    }
+
+    return r.packets;
+}
+
+unsigned long sim_network::get_route_packets(const addr_storage& gaddr, const addr_storage& saddr) const
+{
+    HC_LOG_TRACE("");
+
+    auto it = m_routes.find(std::make_pair(gaddr, saddr));
+    if (it != std::end(m_routes)) {
+        return get_packets(it->second);
+    }
+
+    return 0;
+}
+
+void sim_network::set_source_active(const addr_storage& gaddr, const addr_storage& saddr, bool active)
+{
+    HC_LOG_TRACE("");
+
+    auto key = std::make_pair(gaddr, saddr);
+    if (active) {
+        m_active_sources.insert(key);
+    } else {
+        m_active_sources.erase(key);
+    }
+
+    auto it = m_routes.find(key);
+    if (it != std::end(m_routes) && it->second.counting != active) {
+        it->second.packets = get_packets(it->second);
+        it->second.since = timing_clock::now();
+        it->second.counting = active;
+    }
+}
+
+bool sim_network::is_source_active(const addr_storage& gaddr, const addr_storage& saddr) const
+{
+    HC_LOG_TRACE("");
+    return m_active_sources.find(std::make_pair(gaddr, saddr)) != std::end(m_active_sources);
+}
+
+void sim_network::add_query(const sim_query& query)
+{
+    HC_LOG_TRACE("");
+
+    if (query.gaddr == addr_storage(query.gaddr.get_addr_family())) {
+        ++m_counters[SO_GENERAL_QUERY];
+        SIM_LOG("GENERAL_QUERY " << get_if_name(query.if_index));
+    } else {
+        ++m_counters[SO_GROUP_QUERY];
+        if (m_log != nullptr) {
+            std::ostringstream s;
+            for (auto & e : query.slist) {
+                s << " " << e;
+            }
+            SIM_LOG("GROUP_QUERY " << get_if_name(query.if_index) << " " << query.gaddr << s.str());
+        }
+    }
+
+    m_queries.push_back(query);
+}
+
+void sim_network::add_record(unsigned int if_index, mc_filter filter_mode, const addr_storage& gaddr, const source_list<source>& slist)
+{
+    HC_LOG_TRACE("");
+    ++m_counters[SO_RECORD];
+
+    if (m_log != nullptr) {
+        std::ostringstream s;
+        for (auto & e : slist) {
+            s << " " << e.saddr;
+        }
+        SIM_LOG("RECORD " << get_if_name(if_index) << " " << get_mc_filter_name(filter_mode) << "(" << gaddr << s.str() << ")");
+    }
+}
+
+void sim_network::add_report(unsigned int if_index, const std::list<report_record>& records)
+{
+    HC_LOG_TRACE("");
+    ++m_counters[SO_REPORT];
+
+    if (m_log != nullptr) {
+        std::ostringstream s;
+        for (auto & e : records) {
+            s << " " << get_mcast_addr_record_type_name(e.type) << "(" << e.gaddr;
+            for (auto & a : e.slist) {
+                s << " " << a;
+            }
+            s << ")";
+        }
+        SIM_LOG("REPORT " << get_if_name(if_index) << s.str());
+    }
+}
+
+std::vector<sim_query> sim_network::take_queries()
+{
+    HC_LOG_TRACE("");
+    std::vector<sim_query> result;
+    result.swap(m_queries);
+    return result;
+}
+
+std::vector<std::pair<addr_storage, addr_storage>> sim_network::take_deleted_routes()
+{
+    HC_LOG_TRACE("");
+    std::vector<std::pair<addr_storage, addr_storage>> result;
+    result.swap(m_deleted_routes);
+    return result;
+}
+
+unsigned long sim_network::get_counter(sim_op op) const
+{
+    HC_LOG_TRACE("");
+    return m_counters[op];
+}
+
+unsigned int sim_network::get_route_count() const
+{
+    HC_LOG_TRACE("");
+    return m_routes.size();
+}
+
+std::string sim_network::get_sim_op_name(sim_op op)
+{
+    HC_LOG_TRACE("");
+
+    std::map<sim_op, std::string> name_map = {
+        {SO_ADD_VIF,        "add_vif"       },
+        {SO_DEL_VIF,        "del_vif"       },
+        {SO_ADD_ROUTE,      "add_route"     },
+        {SO_DEL_ROUTE,      "del_route"     },
+        {SO_GENERAL_QUERY,  "general_query" },
+        {SO_GROUP_QUERY,    "group_query"   },
+        {SO_RECORD,         "record"        },
+        {SO_REPORT,         "report"        }
+    };
+    return name_map[op];
+}
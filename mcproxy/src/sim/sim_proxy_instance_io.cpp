@@ -0,0 +1,69 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ *messg written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/*
+ * Substitute of src/proxy/proxy_instance_io.cpp for the simulation build: the
+ * proxy instance sends to and receives from the simulated network, and the
+ * simulation processes its messages on the simulation thread.
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/proxy/proxy_instance.hpp"
+#include "include/proxy/kernel_io.hpp"
+#include "include/sim/sim_sender.hpp"
+#include "include/sim/sim_receiver.hpp"
+#include "include/sim/sim_network.hpp"
+
+bool proxy_instance::init_sender()
+{
+    HC_LOG_TRACE("");
+    m_sender = std::make_shared<sim_sender>(m_interfaces, m_group_mem_protocol);
+    return true;
+}
+
+bool proxy_instance::init_receiver()
+{
+    HC_LOG_TRACE("");
+    m_receiver.reset(new sim_receiver(this, get_addr_family(m_group_mem_protocol), m_mrt_sock, m_interfaces));
+    return true;
+}
+
+bool proxy_instance::init_kernel_io()
+{
+    HC_LOG_TRACE("");
+    //the simulation is single threaded and deterministic
+    m_kernel_io = std::make_shared<kernel_io>(m_sender, m_routing.get(), this, true);
+    return true;
+}
+
+bool proxy_instance::init_worker_thread()
+{
+    HC_LOG_TRACE("");
+    //the simulation processes the messages in its own thread
+    return true;
+}
+
+unsigned int proxy_instance::get_random_seed() const
+{
+    HC_LOG_TRACE("");
+    return sim_network::get_instance().get_seed();
+}
@@ -0,0 +1,76 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/sim/sim_receiver.hpp"
+#include "include/proxy/proxy_instance.hpp"
+
+sim_receiver::sim_receiver(proxy_instance* pr_i, int addr_family, const std::shared_ptr<const mroute_socket> mrt_sock, const std::shared_ptr<const interfaces> interfaces)
+    : receiver(pr_i, addr_family, mrt_sock, interfaces)
+{
+    HC_LOG_TRACE("");
+}
+
+int sim_receiver::get_ctrl_min_size()
+{
+    HC_LOG_TRACE("");
+    return 0;
+}
+
+int sim_receiver::get_iov_min_size()
+{
+    HC_LOG_TRACE("");
+    return 0;
+}
+
+void sim_receiver::analyse_packet(struct msghdr*, int)
+{
+    HC_LOG_TRACE("");
+}
+
+bool sim_receiver::receive_record(unsigned int if_index, mcast_addr_record_type record_type, const addr_storage& gaddr, source_list<source>&& slist, group_mem_protocol gmp)
+{
+    HC_LOG_TRACE("");
+
+    if (!is_if_index_relevant(if_index)) {
+        HC_LOG_DEBUG("interface is not relevant");
+        return false;
+    }
+
+    count_message(if_index, is_IPv4(gmp) ? "igmpv3_report" : "mldv2_report");
+    add_record(std::make_shared<group_record_msg>(if_index, record_type, gaddr, std::move(slist), gmp));
+    return true;
+}
+
+bool sim_receiver::receive_cache_miss(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr)
+{
+    HC_LOG_TRACE("");
+
+    if (!is_if_index_relevant(if_index)) {
+        HC_LOG_DEBUG("interface is not relevant");
+        return false;
+    }
+
+    count_message(if_index, "cache_miss");
+    m_proxy_instance->add_msg(std::make_shared<new_source_msg>(if_index, gaddr, saddr));
+    return true;
+}
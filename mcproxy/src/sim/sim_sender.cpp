@@ -0,0 +1,102 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/sim/sim_sender.hpp"
+#include "include/sim/sim_network.hpp"
+#include "include/proxy/timers_values.hpp"
+
+sim_sender::sim_sender(const std::shared_ptr<const interfaces>& interfaces, group_mem_protocol gmp)
+    : sender(interfaces, gmp)
+{
+    HC_LOG_TRACE("");
+}
+
+bool sim_sender::send_record(unsigned int if_index, mc_filter filter_mode, const addr_storage& gaddr, const source_list<source>& slist) const
+{
+    HC_LOG_TRACE("");
+    sim_network::get_instance().add_record(if_index, filter_mode, gaddr, slist);
+    return true;
+}
+
+bool sim_sender::send_general_query(unsigned int if_index, const timers_values& tv) const
+{
+    HC_LOG_TRACE("");
+
+    std::vector<query_request> queries { query_request{if_index, &tv, addr_storage(get_addr_family(m_group_mem_protocol)), false, {}, false} };
+    return send_queries(queries);
+}
+
+bool sim_sender::send_mc_addr_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag) const
+{
+    HC_LOG_TRACE("");
+
+    std::vector<query_request> queries { query_request{if_index, &tv, gaddr, s_flag, {}, false} };
+    return send_queries(queries);
+}
+
+bool sim_sender::send_mc_addr_and_src_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, source_list<source>& slist) const
+{
+    HC_LOG_TRACE("");
+
+    std::list<addr_storage> slist_higher;
+    std::list<addr_storage> slist_lower;
+    bool rc = split_source_retransmissions(tv, slist, slist_higher, slist_lower);
+
+    std::vector<query_request> queries;
+    if (!slist_higher.empty()) {
+        queries.push_back(query_request{if_index, &tv, gaddr, true, std::move(slist_higher), false});
+    }
+
+    if (!slist_lower.empty()) {
+        queries.push_back(query_request{if_index, &tv, gaddr, false, std::move(slist_lower), false});
+    }
+
+    send_queries(queries);
+    return rc;
+}
+
+bool sim_sender::send_queries(std::vector<query_request>& queries) const
+{
+    HC_LOG_TRACE("");
+
+    for (auto & q : queries) {
+        bool general = q.gaddr == addr_storage(q.gaddr.get_addr_family());
+        auto max_resp_time = general ? q.tv->get_query_response_interval() : q.tv->get_last_listener_query_time();
+        sim_network::get_instance().add_query(sim_query {q.if_index, q.gaddr, max_resp_time, q.slist});
+        q.sent = true;
+    }
+
+    return true;
+}
+
+bool sim_sender::send_report(unsigned int if_index, const std::list<report_record>& records) const
+{
+    HC_LOG_TRACE("");
+    sim_network::get_instance().add_report(if_index, records);
+    return true;
+}
+
+void sim_sender::clear_query_templates(unsigned int) const
+{
+    HC_LOG_TRACE("");
+}
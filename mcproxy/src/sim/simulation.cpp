@@ -0,0 +1,594 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/sim/simulation.hpp"
+#include "include/sim/sim_network.hpp"
+#include "include/sim/sim_receiver.hpp"
+#include "include/proxy/timing.hpp"
+#include "include/proxy/interfaces.hpp"
+#include "include/proxy/proxy_instance.hpp"
+#include "include/proxy/message_format.hpp"
+#include "include/proxy/timers_values.hpp"
+#include "include/parser/interface.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+
+#include <unistd.h> //for getopt
+#include <sys/resource.h>
+#include <arpa/inet.h>
+
+simulation::simulation(int arg_count, char* args[])
+    : m_gmp(IGMPv3)
+    , m_urm(URM_KERNEL)
+    , m_group_count(SIM_DEFAULT_GROUPS)
+    , m_if_count(SIM_DEFAULT_INTERFACES)
+    , m_duration(SIM_DEFAULT_DURATION)
+    , m_membership(SIM_DEFAULT_MEMBERSHIP)
+    , m_hold_time(SIM_DEFAULT_HOLD_TIME)
+    , m_join_spread(SIM_DEFAULT_JOIN_SPREAD)
+    , m_source_count(SIM_DEFAULT_SOURCES)
+    , m_seed(SIM_DEFAULT_SEED)
+    , m_print_state(false)
+    , m_network(sim_network::get_instance())
+    , m_receiver(nullptr)
+    , m_event_count(0)
+    , m_record_count(0)
+    , m_message_count(0)
+{
+    HC_LOG_TRACE("");
+
+    hc_set_default_log_fun(HC_LOG_FATAL_LVL);
+
+    int c;
+    while ((c = getopt(arg_count, args, "hg:n:d:m:t:j:s:r:f:o:pu6")) != -1) {
+        switch (c) {
+        case 'h':
+            help();
+            return;
+        case 'g':
+            m_group_count = std::max(1, atoi(optarg));
+            break;
+        case 'n':
+            m_if_count = std::max(2, atoi(optarg));
+            break;
+        case 'd':
+            m_duration = std::chrono::seconds(std::max(1, atoi(optarg)));
+            break;
+        case 'm':
+            m_membership = std::min(100, std::max(0, atoi(optarg)));
+            break;
+        case 't':
+            m_hold_time = std::chrono::seconds(std::max(0, atoi(optarg)));
+            break;
+        case 'j':
+            m_join_spread = std::chrono::seconds(std::max(0, atoi(optarg)));
+            break;
+        case 's':
+            m_source_count = std::max(0, atoi(optarg));
+            break;
+        case 'r':
+            m_seed = atoi(optarg);
+            break;
+        case 'f':
+            m_script_file = optarg;
+            break;
+        case 'o':
+            m_log_file = optarg;
+            break;
+        case 'p':
+            m_print_state = true;
+            break;
+        case 'u':
+            m_urm = URM_USERSPACE;
+            break;
+        case '6':
+            m_gmp = MLDv2;
+            break;
+        default:
+            std::cerr << "Unknown argument! See help (-h) for more information." << std::endl;
+            return;
+        }
+    }
+
+    if (optind < arg_count) {
+        std::cerr << "Unknown option argument: " << args[optind] << std::endl;
+        return;
+    }
+
+    m_random.seed(m_seed);
+    m_network.init(get_addr_family(m_gmp), m_if_count, m_seed);
+
+    if (!m_log_file.empty()) {
+        m_log.open(m_log_file, std::ios::out | std::ios::trunc);
+        if (!m_log.is_open()) {
+            throw "failed to open the operation log";
+        }
+        m_network.set_log(&m_log);
+    }
+
+    if (!m_script_file.empty() && !parse_script()) {
+        throw "failed to parse the script";
+    }
+
+    init_proxy();
+    init_population();
+
+    auto start = std::chrono::steady_clock::now();
+    run();
+    print_summary(std::chrono::steady_clock::now() - start);
+}
+
+simulation::~simulation()
+{
+    HC_LOG_TRACE("");
+    m_network.set_log(nullptr);
+}
+
+void simulation::help()
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+
+    cout << "Mcproxy simulation" << endl;
+
+    cout << "Project page: http://mcproxy.realmv6.org/" << endl;
+    cout << endl;
+    cout << "Usage:" << endl;
+    cout << "  sim [-h] [-6] [-p] [-u] [-g <groups>] [-n <interfaces>] [-d <sec>] [-m <percent>] [-t <sec>] [-j <sec>] [-s <sources>] [-r <seed>] [-f <script>] [-o <log>]" << endl;
+    cout << endl;
+    cout << "\t-h" << endl;
+    cout << "\t\tDisplay this help screen." << endl;
+
+    cout << "\t-6" << endl;
+    cout << "\t\tSimulate MLDv2 instead of IGMPv3." << endl;
+
+    cout << "\t-p" << endl;
+    cout << "\t\tPrint the state of the proxy instance at the end." << endl;
+
+    cout << "\t-u" << endl;
+    cout << "\t\tThe proxy sends the upstream reports itself (user_reports) instead of joining the groups." << endl;
+
+    cout << "\t-g" << endl;
+    cout << "\t\tNumber of groups (default " << SIM_DEFAULT_GROUPS << ")." << endl;
+
+    cout << "\t-n" << endl;
+    cout << "\t\tNumber of interfaces, " << SIM_IF_NAME_PREFIX << "0 is the upstream (default " << SIM_DEFAULT_INTERFACES << ")." << endl;
+
+    cout << "\t-d" << endl;
+    cout << "\t\tSimulated time in seconds (default " << SIM_DEFAULT_DURATION << ")." << endl;
+
+    cout << "\t-m" << endl;
+    cout << "\t\tPercent of the (downstream, group) pairs with a listener (default " << SIM_DEFAULT_MEMBERSHIP << ")." << endl;
+
+    cout << "\t-t" << endl;
+    cout << "\t\tMean membership and pause time of a listener in seconds, 0 = endless (default " << SIM_DEFAULT_HOLD_TIME << ")." << endl;
+
+    cout << "\t-j" << endl;
+    cout << "\t\tThe first joins and the sources start within this time in seconds (default " << SIM_DEFAULT_JOIN_SPREAD << ")." << endl;
+
+    cout << "\t-s" << endl;
+    cout << "\t\tActive sources per group on the upstream (default " << SIM_DEFAULT_SOURCES << ")." << endl;
+
+    cout << "\t-r" << endl;
+    cout << "\t\tSeed of the random generator (default " << SIM_DEFAULT_SEED << ")." << endl;
+
+    cout << "\t-f" << endl;
+    cout << "\t\tScript with additional events, one per line:" << endl;
+    cout << "\t\t  <msec> record <interface> <record type> <group> [<source> ...]" << endl;
+    cout << "\t\t  <msec> source <interface> <group> <source>" << endl;
+    cout << "\t\t  <msec> source_stop <group> <source>" << endl;
+
+    cout << "\t-o" << endl;
+    cout << "\t\tWrite every kernel operation, query and report with its virtual time to this file." << endl;
+}
+
+bool simulation::parse_script()
+{
+    HC_LOG_TRACE("");
+
+    std::ifstream file(m_script_file);
+    if (!file.is_open()) {
+        std::cerr << "failed to open script: " << m_script_file << std::endl;
+        return false;
+    }
+
+    std::string line;
+    for (unsigned int line_number = 1; std::getline(file, line); ++line_number) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream s(line);
+
+        long msec;
+        if (!(s >> msec)) {
+            continue; //empty line or comment
+        }
+        std::chrono::milliseconds delay(std::max(0L, msec));
+
+        std::string op;
+        std::string if_name;
+        std::string record_type;
+        std::string gaddr;
+        std::string saddr;
+        s >> op;
+
+        if (op == "record" && s >> if_name >> record_type >> gaddr) {
+            script_record r {static_cast<mcast_addr_record_type>(0), addr_storage(gaddr), {}};
+            for (int i = MODE_IS_INCLUDE; i <= BLOCK_OLD_SOURCES; ++i) {
+                if (get_mcast_addr_record_type_name(static_cast<mcast_addr_record_type>(i)) == record_type) {
+                    r.record_type = static_cast<mcast_addr_record_type>(i);
+                }
+            }
+
+            while (s >> saddr) {
+                r.slist.push_back(addr_storage(saddr));
+            }
+
+            if (r.record_type == 0) {
+                std::cerr << m_script_file << ":" << line_number << ": unknown record type: " << record_type << std::endl;
+                return false;
+            }
+
+            if (!r.gaddr.is_multicast_addr() || std::any_of(r.slist.begin(), r.slist.end(), [](const addr_storage & a) {
+            return !a.is_valid();
+            })) {
+                std::cerr << m_script_file << ":" << line_number << ": invalid address: " << line << std::endl;
+                return false;
+            }
+
+            add_event(delay, SE_RECORD, m_network.get_if_index(if_name), m_script.size());
+            m_script.push_back(r);
+        } else if ((op == "source" && s >> if_name >> gaddr >> saddr) || (op == "source_stop" && s >> gaddr >> saddr)) {
+            addr_storage g(gaddr);
+            addr_storage a(saddr);
+            if (!g.is_multicast_addr() || !a.is_valid()) {
+                std::cerr << m_script_file << ":" << line_number << ": invalid address: " << line << std::endl;
+                return false;
+            }
+
+            if (op == "source") {
+                add_event(delay, SE_SOURCE_START, 0, get_source_id(m_network.get_if_index(if_name), g, a));
+            } else {
+                add_event(delay, SE_SOURCE_STOP, 0, get_source_id(INTERFACES_UNKOWN_IF_INDEX, g, a));
+            }
+        } else {
+            std::cerr << m_script_file << ":" << line_number << ": unknown event: " << line << std::endl;
+            return false;
+        }
+
+        if (!if_name.empty() && m_network.get_if_index(if_name) == INTERFACES_UNKOWN_IF_INDEX) {
+            std::cerr << m_script_file << ":" << line_number << ": unknown interface: " << if_name << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//address number i after base, i is added to the last 32 bit
+static addr_storage get_addr(const char* base, unsigned int i)
+{
+    addr_storage a(base);
+    if (a.get_addr_family() == AF_INET) {
+        in_addr addr = a.get_in_addr();
+        addr.s_addr = htonl(ntohl(addr.s_addr) + i);
+        return addr_storage(addr);
+    } else {
+        in6_addr addr = a.get_in6_addr();
+        uint32_t last;
+        memcpy(&last, &addr.s6_addr[12], sizeof(last));
+        last = htonl(ntohl(last) + i);
+        memcpy(&addr.s6_addr[12], &last, sizeof(last));
+        return addr_storage(addr);
+    }
+}
+
+addr_storage simulation::get_group(unsigned int group) const
+{
+    HC_LOG_TRACE("");
+
+    return get_addr(is_IPv4(m_gmp) ? "239.1.0.0" : "ff05::1:0", group);
+}
+
+addr_storage simulation::get_source(unsigned int source) const
+{
+    HC_LOG_TRACE("");
+
+    return get_addr(is_IPv4(m_gmp) ? "198.18.0.1" : "2001:db8::1", source);
+}
+
+std::chrono::milliseconds simulation::get_uniform(std::chrono::milliseconds max)
+{
+    HC_LOG_TRACE("");
+
+    if (max.count() <= 0) {
+        return std::chrono::milliseconds(0);
+    }
+
+    return std::chrono::milliseconds(std::uniform_int_distribution<long>(0, max.count() - 1)(m_random));
+}
+
+std::chrono::milliseconds simulation::get_exponential(std::chrono::milliseconds mean)
+{
+    HC_LOG_TRACE("");
+    return std::chrono::milliseconds(1 + static_cast<long>(std::exponential_distribution<double>(1.0 / mean.count())(m_random)));
+}
+
+void simulation::add_event(std::chrono::milliseconds delay, sim_event_type type, unsigned int if_index, unsigned int id)
+{
+    HC_LOG_TRACE("");
+    m_events.insert(std::make_pair(timing_clock::now() + delay, sim_event {type, if_index, id}));
+}
+
+unsigned int simulation::get_source_id(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr)
+{
+    HC_LOG_TRACE("");
+
+    auto rc = m_source_ids.insert(std::make_pair(std::make_pair(gaddr, saddr), m_sources.size()));
+    if (rc.second) {
+        m_sources.push_back(sim_source {if_index, gaddr, saddr, false});
+    } else if (if_index != INTERFACES_UNKOWN_IF_INDEX) {
+        m_sources[rc.first->second].if_index = if_index;
+    }
+
+    return rc.first->second;
+}
+
+void simulation::init_proxy()
+{
+    HC_LOG_TRACE("");
+
+    m_timing = std::make_shared<timing>();
+    m_interfaces = std::make_shared<interfaces>(get_addr_family(m_gmp), false);
+    for (unsigned int i = 0; i < m_if_count; ++i) {
+        if (!m_interfaces->add_interface(SIM_IF_INDEX_BASE + i)) {
+            throw "failed to add a simulated interface";
+        }
+    }
+
+    m_proxy.reset(new proxy_instance(m_gmp, "sim", 0, MRB_SETSOCKOPT, m_urm, m_interfaces, m_timing, FILTER_DECISION_CACHE_DEFAULT_SIZE, 0));
+    m_receiver = static_cast<sim_receiver*>(m_proxy->m_receiver.get());
+
+    m_proxy->add_msg(std::make_shared<config_msg>(config_msg::ADD_UPSTREAM, SIM_IF_INDEX_BASE, 0, std::make_shared<interface>(m_network.get_if_name(SIM_IF_INDEX_BASE))));
+    for (unsigned int i = 1; i < m_if_count; ++i) {
+        m_proxy->add_msg(std::make_shared<config_msg>(config_msg::ADD_DOWNSTREAM, SIM_IF_INDEX_BASE + i, std::make_shared<interface>(m_network.get_if_name(SIM_IF_INDEX_BASE + i)), timers_values()));
+    }
+
+    drain();
+}
+
+void simulation::init_population()
+{
+    HC_LOG_TRACE("");
+
+    m_joined.resize(m_if_count);
+    for (unsigned int g = 0; g < m_group_count; ++g) {
+        m_group_index[get_group(g)] = g;
+    }
+
+    std::bernoulli_distribution listener(m_membership / 100.0);
+    for (unsigned int i = 1; i < m_if_count; ++i) {
+        for (unsigned int g = 0; g < m_group_count; ++g) {
+            if (listener(m_random)) {
+                add_event(get_uniform(m_join_spread), SE_JOIN, SIM_IF_INDEX_BASE + i, g);
+            }
+        }
+    }
+
+    for (unsigned int g = 0; g < m_group_count; ++g) {
+        for (unsigned int s = 0; s < m_source_count; ++s) {
+            add_event(get_uniform(m_join_spread), SE_SOURCE_START, 0, get_source_id(SIM_IF_INDEX_BASE, get_group(g), get_source(s)));
+        }
+    }
+}
+
+void simulation::run()
+{
+    HC_LOG_TRACE("");
+
+    const timing_clock::time_point end = timing_clock::time_point() + m_duration;
+
+    while (true) {
+        timing_clock::time_point next_timer;
+        bool timer = m_timing->get_next_time(next_timer);
+
+        //the timers go first, an event of the same time sees their result
+        if (timer && (m_events.empty() || next_timer <= m_events.begin()->first)) {
+            if (next_timer > end) {
+                break;
+            }
+
+            m_timing->advance(std::max(next_timer, timing_clock::now()));
+            drain();
+        } else if (!m_events.empty()) {
+            auto it = m_events.begin();
+            if (it->first > end) {
+                break;
+            }
+
+            m_timing->advance(it->first);
+            sim_event e = it->second;
+            m_events.erase(it);
+
+            handle_event(e);
+            drain();
+        } else {
+            break;
+        }
+    }
+
+    m_timing->advance(end);
+}
+
+void simulation::drain()
+{
+    HC_LOG_TRACE("");
+
+    while (!m_proxy->m_job_queue.is_empty()) {
+        m_proxy->handle_msg(m_proxy->m_job_queue.dequeue());
+        ++m_message_count;
+    }
+
+    for (auto & e : m_network.take_queries()) {
+        answer(e);
+    }
+
+    //the kernel reports the next packet of an active source again
+    for (auto & e : m_network.take_deleted_routes()) {
+        if (m_network.is_source_active(e.first, e.second)) {
+            auto it = m_source_ids.find(e);
+            if (it != std::end(m_source_ids)) {
+                schedule_cache_miss(it->second, std::chrono::milliseconds(SIM_CACHE_MISS_DELAY));
+            }
+        }
+    }
+}
+
+void simulation::answer(const sim_query& q)
+{
+    HC_LOG_TRACE("");
+
+    unsigned int i = q.if_index - SIM_IF_INDEX_BASE;
+    if (i >= m_joined.size()) {
+        return;
+    }
+
+    //each listener answers with its current state at a random time within the maximum response time
+    if (q.gaddr == addr_storage(q.gaddr.get_addr_family())) {
+        for (auto g : m_joined[i]) {
+            add_event(get_uniform(q.max_resp_time), SE_ANSWER, q.if_index, g);
+        }
+    } else {
+        auto g = m_group_index.find(q.gaddr);
+        if (g != std::end(m_group_index) && m_joined[i].find(g->second) != std::end(m_joined[i])) {
+            add_event(get_uniform(q.max_resp_time), SE_ANSWER, q.if_index, g->second);
+        }
+    }
+}
+
+void simulation::handle_event(const sim_event& e)
+{
+    HC_LOG_TRACE("");
+    ++m_event_count;
+
+    switch (e.type) {
+    case SE_JOIN:
+        if (m_joined[e.if_index - SIM_IF_INDEX_BASE].insert(e.id).second) {
+            send_record(e.if_index, CHANGE_TO_EXCLUDE_MODE, get_group(e.id), {});
+        }
+
+        if (m_hold_time.count() > 0) {
+            add_event(get_exponential(m_hold_time), SE_LEAVE, e.if_index, e.id);
+        }
+        break;
+    case SE_LEAVE:
+        if (m_joined[e.if_index - SIM_IF_INDEX_BASE].erase(e.id) > 0) {
+            send_record(e.if_index, CHANGE_TO_INCLUDE_MODE, get_group(e.id), {});
+        }
+
+        add_event(get_exponential(m_hold_time), SE_JOIN, e.if_index, e.id);
+        break;
+    case SE_ANSWER:
+        if (m_joined[e.if_index - SIM_IF_INDEX_BASE].count(e.id) > 0) {
+            send_record(e.if_index, MODE_IS_EXCLUDE, get_group(e.id), {});
+        }
+        break;
+    case SE_SOURCE_START:
+        m_network.set_source_active(m_sources[e.id].gaddr, m_sources[e.id].saddr, true);
+        schedule_cache_miss(e.id, std::chrono::milliseconds(0));
+        break;
+    case SE_SOURCE_STOP:
+        m_network.set_source_active(m_sources[e.id].gaddr, m_sources[e.id].saddr, false);
+        break;
+    case SE_CACHE_MISS: {
+        sim_source& s = m_sources[e.id];
+        s.cache_miss_pending = false;
+        if (m_network.is_source_active(s.gaddr, s.saddr) && !m_network.has_route(s.gaddr, s.saddr)) {
+            m_receiver->receive_cache_miss(s.if_index, s.gaddr, s.saddr);
+            schedule_cache_miss(e.id, std::chrono::milliseconds(SIM_UNRESOLVED_TIMEOUT));
+        }
+        break;
+    }
+    case SE_RECORD:
+        send_record(e.if_index, m_script[e.id].record_type, m_script[e.id].gaddr, m_script[e.id].slist);
+        break;
+    default:
+        HC_LOG_ERROR("unknown simulation event");
+    }
+}
+
+void simulation::send_record(unsigned int if_index, mcast_addr_record_type record_type, const addr_storage& gaddr, const std::list<addr_storage>& slist)
+{
+    HC_LOG_TRACE("");
+
+    source_list<source> sl;
+    for (auto & e : slist) {
+        sl.insert(source(e));
+    }
+
+    if (m_receiver->receive_record(if_index, record_type, gaddr, std::move(sl), m_gmp)) {
+        ++m_record_count;
+    }
+}
+
+void simulation::schedule_cache_miss(unsigned int source_id, std::chrono::milliseconds delay)
+{
+    HC_LOG_TRACE("");
+
+    if (!m_sources[source_id].cache_miss_pending) {
+        m_sources[source_id].cache_miss_pending = true;
+        add_event(delay, SE_CACHE_MISS, 0, source_id);
+    }
+}
+
+void simulation::print_summary(std::chrono::nanoseconds wall_time)
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+
+    if (m_print_state) {
+        cout << m_proxy->to_string() << endl;
+    }
+
+    double wall_sec = chrono::duration_cast<chrono::microseconds>(wall_time).count() / 1000000.0;
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    cout << "protocol: " << get_group_mem_protocol_name(m_gmp) << ", upstream reports: " << get_upstream_report_mode_name(m_urm) << endl;
+    cout << "groups: " << m_group_count << ", interfaces: " << m_if_count << ", sources per group: " << m_source_count << ", seed: " << m_seed << endl;
+    cout << "virtual time: " << m_duration.count() << "s, wall time: " << wall_sec << "s, speedup: " << (wall_sec > 0 ? m_duration.count() / wall_sec : 0) << endl;
+    cout << "events: " << m_event_count << ", group records: " << m_record_count << ", proxy messages: " << m_message_count << endl;
+
+    for (int i = 0; i < SO_COUNT; ++i) {
+        cout << sim_network::get_sim_op_name(static_cast<sim_op>(i)) << ": " << m_network.get_counter(static_cast<sim_op>(i)) << endl;
+    }
+
+    unsigned long joined = 0;
+    for (auto & e : m_joined) {
+        joined += e.size();
+    }
+    cout << "joined (interface, group) pairs: " << joined << endl;
+    cout << "routes: " << m_network.get_route_count() << endl;
+    cout << "peak rss: " << usage.ru_maxrss << " KiB" << endl;
+}
@@ -0,0 +1,496 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/tester/flow_traffic.hpp"
+#include "include/proxy/interfaces.hpp"
+
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#include <endian.h>
+#include <sys/socket.h>
+
+flow_traffic::flow_stats::flow_stats()
+    : received(0)
+    , duplicates(0)
+    , reordered(0)
+    , first_sequence(0)
+    , highest_sequence(0)
+    , started(false)
+{
+    memset(window, 0, sizeof(window));
+}
+
+unsigned long flow_traffic::flow_stats::get_lost() const
+{
+    unsigned long count = received.load(std::memory_order_relaxed);
+    if (count == 0) {
+        return 0;
+    }
+
+    unsigned long expected = highest_sequence.load(std::memory_order_relaxed) - first_sequence.load(std::memory_order_relaxed) + 1;
+    return expected > count ? expected - count : 0;
+}
+
+flow_traffic::flow_traffic(const flow_traffic_config& config)
+    : m_config(config)
+    , m_if_index(interfaces::get_if_index(config.if_name))
+    , m_flow_count(0)
+    , m_unknown(0)
+    , m_total(0)
+{
+    HC_LOG_TRACE("");
+
+    if (m_if_index == 0) {
+        throw "interface not found";
+    }
+
+    if (m_config.group_count == 0 || m_config.batch_size == 0) {
+        throw "group_count and batch_size must be greater than zero";
+    }
+
+    if (m_config.packet_size < sizeof(flow_header)) {
+        throw "packet_size is smaller than the packet header (24 byte)";
+    }
+
+    addr_storage gaddr = m_config.first_gaddr;
+    for (unsigned int i = 0; i < m_config.group_count; ++i, ++gaddr) {
+        if (!gaddr.is_multicast_addr()) {
+            throw "the groups have to be multicast addresses";
+        }
+        m_groups.push_back(gaddr);
+    }
+
+    if (m_config.slist.empty()) {
+        m_sources.push_back(addr_storage(m_config.first_gaddr.get_addr_family()));
+    } else {
+        m_sources.assign(m_config.slist.begin(), m_config.slist.end());
+    }
+
+    m_flow_count = m_sources.size() * m_groups.size();
+}
+
+std::unique_ptr<mc_socket> flow_traffic::create_socket() const
+{
+    HC_LOG_TRACE("");
+
+    std::unique_ptr<mc_socket> ms(new mc_socket);
+    if (m_config.first_gaddr.get_addr_family() == AF_INET) {
+        if (!ms->create_udp_ipv4_socket()) {
+            throw "failed to create an udp socket";
+        }
+    } else {
+        if (!ms->create_udp_ipv6_socket()) {
+            throw "failed to create an udp socket";
+        }
+    }
+    return ms;
+}
+
+unsigned int flow_traffic::get_flow_id(unsigned int source_index, unsigned int group_index) const
+{
+    return source_index * m_groups.size() + group_index;
+}
+
+uint64_t flow_traffic::get_realtime_nsec()
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void flow_traffic::send(const bool& running)
+{
+    HC_LOG_TRACE("");
+    using namespace std::chrono;
+
+    //one socket per source address, the kernel takes the bound address as source of the packets
+    std::vector<std::unique_ptr<mc_socket>> socks;
+    for (auto & e : m_sources) {
+        auto ms = create_socket();
+        if (!ms->choose_if(m_if_index) || !ms->set_ttl(m_config.ttl)) {
+            throw "failed to set the multicast interface or the ttl";
+        }
+
+        if (!m_config.slist.empty() && !ms->bind_udp_socket(e, 0)) {
+            throw "failed to bind a source address, it has to be an address of this host";
+        }
+        socks.push_back(std::move(ms));
+    }
+
+    std::vector<addr_storage> dsts = m_groups;
+    for (auto & e : dsts) {
+        e.set_port(m_config.port);
+    }
+
+    //with pacing a batch holds the traffic of FLOW_TRAFFIC_MAX_PACING_BURST at most
+    unsigned int batch_size = m_config.batch_size;
+    if (m_config.packet_rate != 0) {
+        unsigned long burst = m_config.packet_rate * FLOW_TRAFFIC_MAX_PACING_BURST / 1000000;
+        batch_size = std::max(1UL, std::min<unsigned long>(batch_size, burst));
+    }
+
+    std::vector<unsigned char> bufs(batch_size * m_config.packet_size, 0);
+    std::vector<struct iovec> iovs(batch_size);
+    std::vector<struct mmsghdr> msgs(batch_size);
+    std::vector<unsigned int> batch_flows(batch_size);
+    for (unsigned int i = 0; i < batch_size; ++i) {
+        iovs[i].iov_base = &bufs[i * m_config.packet_size];
+        iovs[i].iov_len = m_config.packet_size;
+        memset(&msgs[i], 0, sizeof(struct mmsghdr));
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    std::vector<uint64_t> sequences(m_flow_count, 0);
+    std::vector<unsigned int> next_group(socks.size(), 0);
+
+    std::cout << "send " << m_flow_count << " flows on interface " << m_config.if_name << " with ";
+    if (m_config.packet_rate != 0) {
+        std::cout << m_config.packet_rate << " packets per sec";
+    } else {
+        std::cout << "maximum rate";
+    }
+    std::cout << ", " << m_config.packet_size << " byte per packet, batches of " << batch_size << std::endl;
+
+    unsigned long sent = 0;
+    unsigned long send_errors = 0;
+    unsigned long batch_number = 0;
+    auto start = steady_clock::now();
+    auto next_status = start + milliseconds(FLOW_TRAFFIC_STATUS_INTERVAL);
+
+    while (running && (m_config.max_count == 0 || sent < m_config.max_count)) {
+        if (m_config.packet_rate != 0) {
+            auto deadline = start + duration_cast<steady_clock::duration>(duration<double>(static_cast<double>(sent) / m_config.packet_rate));
+
+            //sleep for the coarse part and spin for the last 100 usec
+            if (deadline - steady_clock::now() > microseconds(200)) {
+                std::this_thread::sleep_until(deadline - microseconds(100));
+            }
+            while (steady_clock::now() < deadline) {}
+        }
+
+        unsigned int count = batch_size;
+        if (m_config.max_count != 0) {
+            count = std::min<unsigned long>(count, m_config.max_count - sent);
+        }
+
+        //the sockets (sources) take turns, each batch cycles through the groups
+        unsigned int s = batch_number++ % socks.size();
+        uint64_t send_time = htobe64(get_realtime_nsec());
+        for (unsigned int i = 0; i < count; ++i) {
+            unsigned int g = next_group[s]++ % m_groups.size();
+            unsigned int flow_id = get_flow_id(s, g);
+            batch_flows[i] = flow_id;
+
+            flow_header hdr;
+            hdr.magic = htonl(FLOW_TRAFFIC_MAGIC);
+            hdr.flow_id = htonl(flow_id);
+            hdr.sequence = htobe64(sequences[flow_id]++);
+            hdr.send_time = send_time;
+            memcpy(iovs[i].iov_base, &hdr, sizeof(hdr));
+
+            msgs[i].msg_hdr.msg_name = const_cast<sockaddr*>(&dsts[g].get_sockaddr());
+            msgs[i].msg_hdr.msg_namelen = dsts[g].get_addr_len();
+        }
+
+        int rc = sendmmsg(socks[s]->get_socket(), msgs.data(), count, 0);
+        unsigned int n = rc > 0 ? rc : 0;
+        if (n < count) {
+            if (rc < 0 && errno != EINTR) {
+                HC_LOG_ERROR("failed to send! Error: " << strerror(errno) << " errno: " << errno);
+                ++send_errors;
+            }
+
+            //the sequence numbers of unsent packets are used again, so they are not counted as lost
+            for (unsigned int i = n; i < count; ++i) {
+                --sequences[batch_flows[i]];
+            }
+            next_group[s] -= count - n;
+        }
+        sent += n;
+
+        if (m_config.print_status_msg && steady_clock::now() >= next_status) {
+            std::cout << "\rsent: " << sent << "; send errors: " << send_errors;
+            std::flush(std::cout);
+            next_status += milliseconds(FLOW_TRAFFIC_STATUS_INTERVAL);
+        }
+    }
+
+    auto duration = duration_cast<microseconds>(steady_clock::now() - start).count();
+    double packets_per_sec = duration > 0 ? sent * 1000000.0 / duration : 0;
+
+    if (m_config.print_status_msg) {
+        std::cout << std::endl;
+    }
+
+    std::cout << "--- summary==> flows(#): " << m_flow_count << "; packets sent(#): " << sent << "; send errors(#): " << send_errors << "; duration(ms): " << duration / 1000 << "; packets per sec: " << static_cast<unsigned long>(packets_per_sec) << "; goodput(Mbit/s): " << packets_per_sec * m_config.packet_size * 8 / 1000000 << std::endl;
+}
+
+void flow_traffic::analyse_packet(const unsigned char* buf, unsigned int size, uint64_t receive_time)
+{
+    flow_header hdr;
+    if (size < sizeof(hdr)) {
+        m_unknown.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    memcpy(&hdr, buf, sizeof(hdr));
+    unsigned int flow_id = ntohl(hdr.flow_id);
+    if (ntohl(hdr.magic) != FLOW_TRAFFIC_MAGIC || flow_id >= m_flow_count) {
+        m_unknown.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    uint64_t sequence = be64toh(hdr.sequence);
+    uint64_t send_time = be64toh(hdr.send_time);
+    flow_stats& f = *m_flow_stats[flow_id];
+
+    auto bit = [](uint64_t seq) {
+        return 1ULL << (seq % 64);
+    };
+    auto word = [&f](uint64_t seq) -> uint64_t& {
+        return f.window[(seq % FLOW_TRAFFIC_DUPLICATE_WINDOW) / 64];
+    };
+
+    uint64_t highest = f.highest_sequence.load(std::memory_order_relaxed);
+    if (!f.started) {
+        f.started = true;
+        f.first_sequence.store(sequence, std::memory_order_relaxed);
+        f.highest_sequence.store(sequence, std::memory_order_relaxed);
+        word(sequence) |= bit(sequence);
+    } else if (sequence > highest) {
+        //the window slides, the sequence numbers that leave it are forgotten
+        if (sequence - highest >= FLOW_TRAFFIC_DUPLICATE_WINDOW) {
+            memset(f.window, 0, sizeof(f.window));
+        } else {
+            for (uint64_t s = highest + 1; s < sequence; ++s) {
+                word(s) &= ~bit(s);
+            }
+        }
+        word(sequence) |= bit(sequence);
+        f.highest_sequence.store(sequence, std::memory_order_relaxed);
+    } else if (highest - sequence >= FLOW_TRAFFIC_DUPLICATE_WINDOW) {
+        f.reordered.fetch_add(1, std::memory_order_relaxed); //too late to detect a duplicate
+    } else if (word(sequence) & bit(sequence)) {
+        f.duplicates.fetch_add(1, std::memory_order_relaxed);
+        return;
+    } else {
+        word(sequence) |= bit(sequence);
+        f.reordered.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    f.received.fetch_add(1, std::memory_order_relaxed);
+    f.latency.record(receive_time > send_time ? receive_time - send_time : 0);
+    m_total.fetch_add(1, std::memory_order_relaxed);
+}
+
+void flow_traffic::receive(const bool& running)
+{
+    HC_LOG_TRACE("");
+    using namespace std::chrono;
+
+    auto ms = create_socket();
+    if (!ms->set_reuse_port(true) || !ms->set_multicast_all(false)) {
+        throw "failed to set socket option reuse port or multicast all";
+    }
+
+    if (!ms->bind_udp_socket(addr_storage(m_config.first_gaddr.get_addr_family()), m_config.port)) {
+        throw "failed to bind the port";
+    }
+
+    if (!ms->set_receive_timeout(100) || !ms->set_receive_timestamp(true)) {
+        throw "failed to set the receive timeout or the time stamps";
+    }
+
+    //bursts of the sender are buffered, the kernel limits it to net.core.rmem_max
+    int rcvbuf = FLOW_TRAFFIC_RECEIVE_BUFFER;
+    if (setsockopt(ms->get_socket(), SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) != 0) {
+        HC_LOG_WARN("failed to set the receive buffer! Error: " << strerror(errno) << " errno: " << errno);
+    }
+
+    for (auto & e : m_groups) {
+        if (!ms->join_group(e, m_if_index)) {
+            throw "failed to join a group (the groups per socket are limited by net.ipv4.igmp_max_memberships)";
+        }
+
+        if (!m_config.slist.empty() && !ms->set_source_filter(m_if_index, e, m_config.filter_mode, m_config.slist)) {
+            throw "failed to set the source filter";
+        }
+    }
+
+    m_flow_stats.clear();
+    for (unsigned int i = 0; i < m_flow_count; ++i) {
+        m_flow_stats.emplace_back(new flow_stats);
+    }
+
+    //only the header is analysed, longer packets are truncated
+    const unsigned int batch_size = m_config.batch_size;
+    const unsigned int buf_size = sizeof(flow_header);
+    const unsigned int ctrl_size = CMSG_SPACE(sizeof(struct timespec));
+    std::vector<unsigned char> bufs(batch_size * buf_size);
+    std::vector<unsigned char> ctrls(batch_size * ctrl_size);
+    std::vector<struct iovec> iovs(batch_size);
+    std::vector<struct mmsghdr> msgs(batch_size);
+    for (unsigned int i = 0; i < batch_size; ++i) {
+        iovs[i].iov_base = &bufs[i * buf_size];
+        iovs[i].iov_len = buf_size;
+        memset(&msgs[i], 0, sizeof(struct mmsghdr));
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_control = &ctrls[i * ctrl_size];
+    }
+
+    std::cout << "receive " << m_flow_count << " flows on interface " << m_config.if_name << " port " << m_config.port << std::endl;
+
+    //the status thread reads the counters of the flows without locks
+    std::atomic<bool> receiving(true);
+    std::thread status_thread;
+    if (m_config.print_status_msg) {
+        status_thread = std::thread([this, &receiving]() {
+            while (receiving.load()) {
+                std::this_thread::sleep_for(milliseconds(FLOW_TRAFFIC_STATUS_INTERVAL));
+                print_receive_status();
+            }
+        });
+    }
+
+    steady_clock::time_point first_packet;
+    steady_clock::time_point last_packet;
+    while (running && (m_config.max_count == 0 || m_total.load(std::memory_order_relaxed) < m_config.max_count)) {
+        for (unsigned int i = 0; i < batch_size; ++i) {
+            msgs[i].msg_hdr.msg_controllen = ctrl_size;
+        }
+
+        //blocks for the first packet only (receive timeout), the others are taken if already queued
+        int n = recvmmsg(ms->get_socket(), msgs.data(), batch_size, MSG_WAITFORONE, nullptr);
+        if (n <= 0) {
+            continue;
+        }
+
+        last_packet = steady_clock::now();
+        if (first_packet == steady_clock::time_point()) {
+            first_packet = last_packet;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            uint64_t receive_time = 0;
+            for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsgptr != nullptr; cmsgptr = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsgptr)) {
+                if (cmsgptr->cmsg_level == SOL_SOCKET && cmsgptr->cmsg_type == SCM_TIMESTAMPNS) {
+                    struct timespec ts;
+                    memcpy(&ts, CMSG_DATA(cmsgptr), sizeof(ts));
+                    receive_time = static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+                }
+            }
+
+            if (receive_time == 0) {
+                receive_time = get_realtime_nsec();
+            }
+
+            analyse_packet(&bufs[i * buf_size], msgs[i].msg_len, receive_time);
+        }
+    }
+
+    receiving.store(false);
+    if (status_thread.joinable()) {
+        status_thread.join();
+        std::cout << std::endl;
+    }
+
+    print_receive_summary(last_packet - first_packet);
+}
+
+void flow_traffic::print_receive_status() const
+{
+    unsigned long received = 0;
+    unsigned long lost = 0;
+    unsigned long reordered = 0;
+    unsigned long duplicates = 0;
+    for (auto & e : m_flow_stats) {
+        received += e->received.load(std::memory_order_relaxed);
+        lost += e->get_lost();
+        reordered += e->reordered.load(std::memory_order_relaxed);
+        duplicates += e->duplicates.load(std::memory_order_relaxed);
+    }
+
+    std::cout << "\rreceived: " << received << "; lost: " << lost << "; reordered: " << reordered << "; duplicates: " << duplicates << "; unknown: " << m_unknown.load(std::memory_order_relaxed);
+    std::flush(std::cout);
+}
+
+void flow_traffic::print_receive_summary(const std::chrono::steady_clock::duration& duration)
+{
+    HC_LOG_TRACE("");
+
+    std::ofstream file;
+    if (m_config.save_to_file) {
+        file.open(m_config.file_name, m_config.file_operation_mode.compare("append") == 0 ? std::ios::app : std::ios::trunc);
+        if (!file.is_open()) {
+            std::cout << "failed to open file: " << m_config.file_name << std::endl;
+        } else if (m_config.include_file_header) {
+            file << "flow_id,source,group,received,lost,reordered,duplicates,latency_p50_us,latency_p99_us,latency_max_us" << std::endl;
+        }
+    }
+
+    unsigned long received = 0;
+    unsigned long lost = 0;
+    unsigned long reordered = 0;
+    unsigned long duplicates = 0;
+    unsigned long silent_flows = 0;
+    unsigned long latency_p50 = 0;
+    unsigned long latency_p99 = 0;
+    unsigned long latency_max = 0;
+
+    for (unsigned int s = 0; s < m_sources.size(); ++s) {
+        for (unsigned int g = 0; g < m_groups.size(); ++g) {
+            const flow_stats& f = *m_flow_stats[get_flow_id(s, g)];
+            unsigned long flow_received = f.received.load(std::memory_order_relaxed);
+
+            received += flow_received;
+            lost += f.get_lost();
+            reordered += f.reordered.load(std::memory_order_relaxed);
+            duplicates += f.duplicates.load(std::memory_order_relaxed);
+            if (flow_received == 0) {
+                ++silent_flows;
+            }
+
+            //the worst flow is reported
+            latency_p50 = std::max(latency_p50, f.latency.get_quantile(0.5));
+            latency_p99 = std::max(latency_p99, f.latency.get_quantile(0.99));
+            latency_max = std::max(latency_max, f.latency.get_quantile(1.0));
+
+            if (file.is_open()) {
+                file << get_flow_id(s, g) << "," << m_sources[s] << "," << m_groups[g] << "," << flow_received << "," << f.get_lost() << "," << f.reordered.load(std::memory_order_relaxed) << "," << f.duplicates.load(std::memory_order_relaxed) << "," << f.latency.get_quantile(0.5) / 1000.0 << "," << f.latency.get_quantile(0.99) / 1000.0 << "," << f.latency.get_quantile(1.0) / 1000.0 << std::endl;
+            }
+        }
+    }
+
+    auto usec = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    unsigned long packets_per_sec = usec > 0 ? received * 1000000.0 / usec : 0;
+    double loss = received + lost > 0 ? 100.0 * lost / (received + lost) : 0;
+
+    std::cout << "--- summary==> flows(#): " << m_flow_count << "; silent flows(#): " << silent_flows << "; received(#): " << received << "; lost(#): " << lost << "; loss(%): " << loss << "; reordered(#): " << reordered << "; duplicates(#): " << duplicates << "; unknown(#): " << m_unknown.load(std::memory_order_relaxed) << "; packets per sec: " << packets_per_sec << std::endl;
+    std::cout << "--- latency of the worst flow==> p50(us): " << latency_p50 / 1000.0 << "; p99(us): " << latency_p99 / 1000.0 << "; max(us): " << latency_max / 1000.0 << std::endl;
+}
@@ -0,0 +1,889 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/tester/host_population.hpp"
+#include "include/proxy/interfaces.hpp"
+#include "include/proxy/timers_values.hpp"
+#include "include/utils/mc_socket.hpp"
+#include "include/utils/extended_igmp_defines.hpp"
+#include "include/utils/extended_mld_defines.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <poll.h>
+#include <unistd.h>
+#include <net/ethernet.h>
+#include <netinet/ip.h>
+#include <netpacket/packet.h>
+
+#ifndef IP6OPT_ROUTER_ALERT
+#define IP6OPT_ROUTER_ALERT 0x05
+#endif
+
+//internet checksum of RFC 1071 in network byte order
+static uint16_t get_checksum(const unsigned char* buf, unsigned int size)
+{
+    uint32_t sum = 0;
+    for (unsigned int i = 0; i + 1 < size; i += 2) {
+        sum += (buf[i] << 8) | buf[i + 1];
+    }
+
+    if (size % 2 != 0) {
+        sum += buf[size - 1] << 8;
+    }
+
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+
+    return htons(~sum & 0xffff);
+}
+
+static bool is_leave_record(mcast_addr_record_type type)
+{
+    return type == BLOCK_OLD_SOURCES || type == CHANGE_TO_INCLUDE_MODE;
+}
+
+host_population::host_population(const host_population_config& config)
+    : m_config(config)
+    , m_addr_family(config.first_gaddr.get_addr_family())
+    , m_if_index(interfaces::get_if_index(config.if_name))
+    , m_upstream_if_index(0)
+    , m_mtu(0)
+    , m_sock(-1)
+    , m_upstream_sock(-1)
+    , m_membership_id(0)
+    , m_rand(config.seed != 0 ? config.seed : std::random_device()())
+    , m_joins(0)
+    , m_leaves(0)
+    , m_zaps(0)
+    , m_packets_sent(0)
+    , m_send_errors(0)
+    , m_queries(0)
+    , m_upstream_records(0)
+{
+    HC_LOG_TRACE("");
+
+    if (m_config.gmp == IGMPv1) {
+        throw "IGMPv1 hosts are not supported";
+    }
+
+    if (get_addr_family(m_config.gmp) != m_addr_family) {
+        throw "the protocol does not match the ip version of the group";
+    }
+
+    if (m_config.first_host_addr.get_addr_family() != m_addr_family) {
+        throw "host_addr is not an ip address or has the wrong ip version";
+    }
+
+    if (m_config.group_count == 0 || m_config.host_count == 0) {
+        throw "group_count and host_count must be greater than zero";
+    }
+
+    if (is_newest_version(m_config.gmp) && m_config.filter_mode == INCLUDE_MODE && m_config.slist.empty()) {
+        throw "include mode requires sources";
+    }
+
+    if (m_if_index == 0) {
+        throw "interface not found";
+    }
+
+    m_mtu = interfaces::get_mtu(m_if_index);
+
+    if (!m_config.upstream_if_name.empty()) {
+        m_upstream_if_index = interfaces::get_if_index(m_config.upstream_if_name);
+        if (m_upstream_if_index == 0) {
+            throw "upstream interface not found";
+        }
+    }
+
+    addr_storage gaddr = m_config.first_gaddr;
+    std::vector<double> weights;
+    for (unsigned int i = 0; i < m_config.group_count; ++i, ++gaddr) {
+        if (!gaddr.is_multicast_addr()) {
+            throw "the groups have to be multicast addresses";
+        }
+
+        m_groups.push_back(gaddr);
+        weights.push_back(m_config.zipf_popularity ? 1.0 / (i + 1) : 1.0);
+    }
+    m_group_distribution = std::discrete_distribution<unsigned int>(weights.begin(), weights.end());
+
+    addr_storage haddr = m_config.first_host_addr;
+    m_hosts.resize(m_config.host_count);
+    for (auto & e : m_hosts) {
+        e.addr = haddr++;
+    }
+
+    m_sock = open_packet_socket(m_if_index);
+    if (m_sock < 0) {
+        throw "failed to open a packet socket on the interface";
+    }
+
+    if (m_upstream_if_index != 0) {
+        m_upstream_sock = open_packet_socket(m_upstream_if_index);
+        if (m_upstream_sock < 0) {
+            close(m_sock);
+            throw "failed to open a packet socket on the upstream interface";
+        }
+    }
+
+    if (m_config.save_to_file) {
+        m_file.open(m_config.file_name, m_config.file_operation_mode.compare("append") == 0 ? std::ios::app : std::ios::trunc);
+        if (!m_file.is_open()) {
+            close(m_sock);
+            if (m_upstream_sock >= 0) {
+                close(m_upstream_sock);
+            }
+            throw "failed to open the output file";
+        }
+
+        if (m_config.include_file_header) {
+            m_file << "event(join/leave) group(addr) upstream_reaction(ms)" << std::endl;
+        }
+    }
+}
+
+host_population::~host_population()
+{
+    HC_LOG_TRACE("");
+
+    close(m_sock);
+    if (m_upstream_sock >= 0) {
+        close(m_upstream_sock);
+    }
+}
+
+int host_population::open_packet_socket(unsigned int if_index) const
+{
+    HC_LOG_TRACE("");
+
+    //ETH_P_ALL: the packets sent by the proxy itself are captured as well
+    int sock = socket(AF_PACKET, SOCK_DGRAM, htons(ETH_P_ALL));
+    if (sock < 0) {
+        HC_LOG_ERROR("failed to create packet socket! Error: " << strerror(errno) << " errno: " << errno);
+        return -1;
+    }
+
+    sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = if_index;
+    if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        HC_LOG_ERROR("failed to bind packet socket! Error: " << strerror(errno) << " errno: " << errno);
+        close(sock);
+        return -1;
+    }
+
+    packet_mreq mreq;
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.mr_ifindex = if_index;
+    mreq.mr_type = PACKET_MR_ALLMULTI;
+    if (setsockopt(sock, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        HC_LOG_ERROR("failed to receive all multicast packets! Error: " << strerror(errno) << " errno: " << errno);
+        close(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+mcast_addr_record_type host_population::get_join_record_type() const
+{
+    return m_config.filter_mode == INCLUDE_MODE ? ALLOW_NEW_SOURCES : CHANGE_TO_EXCLUDE_MODE;
+}
+
+mcast_addr_record_type host_population::get_leave_record_type() const
+{
+    return m_config.filter_mode == INCLUDE_MODE ? BLOCK_OLD_SOURCES : CHANGE_TO_INCLUDE_MODE;
+}
+
+mcast_addr_record_type host_population::get_current_state_record_type() const
+{
+    return m_config.filter_mode == INCLUDE_MODE ? MODE_IS_INCLUDE : MODE_IS_EXCLUDE;
+}
+
+std::chrono::microseconds host_population::get_exponential_interval(double mean_msec)
+{
+    std::exponential_distribution<double> distribution(1.0 / mean_msec);
+    return std::chrono::microseconds(static_cast<long long>(distribution(m_rand) * 1000));
+}
+
+void host_population::schedule(const std::chrono::microseconds& delay, const std::function<void()>& f)
+{
+    m_schedule.insert(std::make_pair(clock::now() + delay, f));
+}
+
+void host_population::schedule_join()
+{
+    HC_LOG_TRACE("");
+
+    if (m_config.join_rate == 0) {
+        return;
+    }
+
+    schedule(get_exponential_interval(1000.0 / m_config.join_rate), [this]() {
+        if (m_config.max_count == 0 || m_joins < m_config.max_count) {
+            unsigned int host_index = std::uniform_int_distribution<unsigned int>(0, m_hosts.size() - 1)(m_rand);
+            const addr_storage& gaddr = m_groups[m_group_distribution(m_rand)];
+            if (m_hosts[host_index].groups.find(gaddr) == m_hosts[host_index].groups.end()) {
+                join(host_index, gaddr);
+            }
+        }
+        schedule_join();
+    });
+}
+
+void host_population::schedule_zap()
+{
+    HC_LOG_TRACE("");
+
+    if (m_config.zap_rate == 0) {
+        return;
+    }
+
+    schedule(get_exponential_interval(1000.0 / m_config.zap_rate), [this]() {
+        zap();
+        schedule_zap();
+    });
+}
+
+void host_population::schedule_leave(unsigned int host_index, const addr_storage& gaddr)
+{
+    HC_LOG_TRACE("");
+
+    if (m_config.hold_time.count() == 0) {
+        return;
+    }
+
+    //a leave of an older membership (the host changed the channel meanwhile) is ignored
+    unsigned long membership_id = m_hosts[host_index].groups[gaddr];
+    schedule(get_exponential_interval(m_config.hold_time.count()), [this, host_index, gaddr, membership_id]() {
+        leave(host_index, gaddr, membership_id);
+    });
+}
+
+void host_population::join(unsigned int host_index, const addr_storage& gaddr)
+{
+    HC_LOG_TRACE("");
+
+    m_hosts[host_index].groups[gaddr] = ++m_membership_id;
+    add_member(gaddr);
+    ++m_joins;
+
+    send_state_change(host_index, {record{get_join_record_type(), gaddr}});
+    schedule_leave(host_index, gaddr);
+}
+
+void host_population::leave(unsigned int host_index, const addr_storage& gaddr, unsigned long membership_id)
+{
+    HC_LOG_TRACE("");
+
+    auto& groups = m_hosts[host_index].groups;
+    auto it = groups.find(gaddr);
+    if (it == groups.end() || it->second != membership_id) {
+        return;
+    }
+
+    groups.erase(it);
+    del_member(gaddr);
+    ++m_leaves;
+
+    send_state_change(host_index, {record{get_leave_record_type(), gaddr}});
+}
+
+void host_population::zap()
+{
+    HC_LOG_TRACE("");
+
+    unsigned int host_index = std::uniform_int_distribution<unsigned int>(0, m_hosts.size() - 1)(m_rand);
+    auto& groups = m_hosts[host_index].groups;
+    if (groups.empty()) {
+        return;
+    }
+
+    auto old_it = groups.begin();
+    std::advance(old_it, std::uniform_int_distribution<unsigned int>(0, groups.size() - 1)(m_rand));
+    addr_storage old_gaddr = old_it->first;
+
+    const addr_storage& new_gaddr = m_groups[m_group_distribution(m_rand)];
+    if (groups.find(new_gaddr) != groups.end()) {
+        return;
+    }
+
+    groups.erase(old_it);
+    del_member(old_gaddr);
+    groups[new_gaddr] = ++m_membership_id;
+    add_member(new_gaddr);
+    ++m_zaps;
+
+    //IGMPv3 and MLDv2 hosts report both changes in one message
+    send_state_change(host_index, {record{get_leave_record_type(), old_gaddr}, record{get_join_record_type(), new_gaddr}});
+    schedule_leave(host_index, new_gaddr);
+}
+
+void host_population::add_member(const addr_storage& gaddr)
+{
+    HC_LOG_TRACE("");
+
+    if (++m_group_members[gaddr] == 1) {
+        m_pending_leaves.erase(gaddr);
+        m_pending_joins.insert(std::make_pair(gaddr, clock::now()));
+    }
+}
+
+void host_population::del_member(const addr_storage& gaddr)
+{
+    HC_LOG_TRACE("");
+
+    auto it = m_group_members.find(gaddr);
+    if (it != m_group_members.end() && --it->second == 0) {
+        m_group_members.erase(it);
+        m_pending_joins.erase(gaddr);
+        m_pending_leaves.insert(std::make_pair(gaddr, clock::now()));
+    }
+}
+
+void host_population::send_state_change(unsigned int host_index, const std::list<record>& records)
+{
+    HC_LOG_TRACE("");
+
+    auto packets = build_packets(m_hosts[host_index].addr, records);
+    for (auto & e : packets) {
+        send_packet(e);
+    }
+
+    //retransmissions of the state change report, RFC 3376 Section 5.1
+    std::uniform_int_distribution<long long> distribution(0, HOST_POPULATION_UNSOLICITED_REPORT_INTERVAL * 1000);
+    std::chrono::microseconds delay(0);
+    for (unsigned int i = 1; i < m_config.robustness; ++i) {
+        delay += std::chrono::microseconds(distribution(m_rand));
+        schedule(delay, [this, packets]() {
+            for (auto & e : packets) {
+                send_packet(e);
+            }
+        });
+    }
+}
+
+void host_population::send_current_state(unsigned int host_index, const addr_storage& gaddr)
+{
+    HC_LOG_TRACE("");
+
+    const auto& groups = m_hosts[host_index].groups;
+    std::list<record> records;
+    if (gaddr.is_multicast_addr()) {
+        if (groups.find(gaddr) != groups.end()) {
+            records.push_back(record{get_current_state_record_type(), gaddr});
+        }
+    } else { //general query, all memberships are aggregated
+        for (auto & e : groups) {
+            records.push_back(record{get_current_state_record_type(), e.first});
+        }
+    }
+
+    for (auto & e : build_packets(m_hosts[host_index].addr, records)) {
+        send_packet(e);
+    }
+}
+
+std::list<std::vector<unsigned char>> host_population::build_packets(const addr_storage& saddr, const std::list<record>& records) const
+{
+    HC_LOG_TRACE("");
+
+    std::list<std::vector<unsigned char>> packets;
+
+    if (m_config.gmp == IGMPv2) {
+        for (auto & e : records) {
+            std::vector<unsigned char> payload(sizeof(igmp), 0);
+            igmp* msg = reinterpret_cast<igmp*>(payload.data());
+            msg->igmp_type = is_leave_record(e.type) ? IGMP_V2_LEAVE_GROUP : IGMP_V2_MEMBERSHIP_REPORT;
+            msg->igmp_group = e.gaddr.get_in_addr();
+            msg->igmp_cksum = get_checksum(payload.data(), payload.size());
+            packets.push_back(build_ipv4_packet(saddr, is_leave_record(e.type) ? addr_storage(IPV4_ALL_IGMP_ROUTERS_ADDR) : e.gaddr, payload));
+        }
+    } else if (m_config.gmp == MLDv1) {
+        for (auto & e : records) {
+            std::vector<unsigned char> payload(sizeof(mldv1), 0);
+            mldv1* msg = reinterpret_cast<mldv1*>(payload.data());
+            msg->type = is_leave_record(e.type) ? MLD_LISTENER_REDUCTION : MLD_LISTENER_REPORT;
+            msg->gaddr = e.gaddr.get_in6_addr();
+            packets.push_back(build_ipv6_packet(saddr, is_leave_record(e.type) ? addr_storage(IPV6_ALL_LINK_LOCAL_ROUTER) : e.gaddr, payload));
+        }
+    } else { //IGMPv3 and MLDv2, the records are split into reports that fit the mtu
+        const bool ipv4 = m_addr_family == AF_INET;
+        const unsigned int addr_size = ipv4 ? sizeof(in_addr) : sizeof(in6_addr);
+        const unsigned int header_size = ipv4 ? sizeof(igmpv3_mc_report) : sizeof(mldv2_mc_report);
+        const unsigned int record_header_size = ipv4 ? sizeof(igmpv3_mc_record) : sizeof(mldv2_mc_record);
+        const unsigned int max_size = m_mtu - (ipv4 ? sizeof(ip) + sizeof(router_alert_option) : sizeof(ip6_hdr) + 8);
+
+        std::vector<unsigned char> payload;
+        unsigned int num_records = 0;
+
+        auto finish_report = [&]() {
+            if (num_records == 0) {
+                return;
+            }
+
+            //the report headers of IGMPv3 and MLDv2 have the same layout
+            igmpv3_mc_report* report = reinterpret_cast<igmpv3_mc_report*>(payload.data());
+            report->type = ipv4 ? IGMP_V3_MEMBERSHIP_REPORT : MLD_V2_LISTENER_REPORT;
+            report->num_of_mc_records = htons(num_records);
+
+            if (ipv4) {
+                report->checksum = get_checksum(payload.data(), payload.size());
+                packets.push_back(build_ipv4_packet(saddr, addr_storage(IPV4_IGMPV3_ADDR), payload));
+            } else {
+                packets.push_back(build_ipv6_packet(saddr, addr_storage(IPV6_ALL_MLDv2_CAPABLE_ROUTERS), payload));
+            }
+
+            payload.clear();
+            num_records = 0;
+        };
+
+        for (auto & e : records) {
+            //the sources are reported in all records except for leaving the exclude mode
+            const std::list<addr_storage> empty_slist;
+            const std::list<addr_storage>& slist = e.type == CHANGE_TO_INCLUDE_MODE ? empty_slist : m_config.slist;
+            unsigned int record_size = record_header_size + slist.size() * addr_size;
+
+            if (payload.size() + record_size > max_size) {
+                finish_report();
+            }
+
+            if (payload.empty()) {
+                payload.assign(header_size, 0);
+            }
+
+            std::size_t offset = payload.size();
+            payload.resize(offset + record_size, 0);
+            if (ipv4) {
+                igmpv3_mc_record* rec = reinterpret_cast<igmpv3_mc_record*>(&payload[offset]);
+                rec->type = e.type;
+                rec->num_of_srcs = htons(slist.size());
+                rec->gaddr = e.gaddr.get_in_addr();
+            } else {
+                mldv2_mc_record* rec = reinterpret_cast<mldv2_mc_record*>(&payload[offset]);
+                rec->type = e.type;
+                rec->num_of_srcs = htons(slist.size());
+                rec->gaddr = e.gaddr.get_in6_addr();
+            }
+
+            offset += record_header_size;
+            for (auto & s : slist) {
+                memcpy(&payload[offset], ipv4 ? static_cast<const void*>(&s.get_in_addr()) : static_cast<const void*>(&s.get_in6_addr()), addr_size);
+                offset += addr_size;
+            }
+            ++num_records;
+        }
+
+        finish_report();
+    }
+
+    return packets;
+}
+
+std::vector<unsigned char> host_population::build_ipv4_packet(const addr_storage& saddr, const addr_storage& daddr, const std::vector<unsigned char>& payload) const
+{
+    HC_LOG_TRACE("");
+
+    const unsigned int header_size = sizeof(ip) + sizeof(router_alert_option);
+    std::vector<unsigned char> packet(header_size + payload.size(), 0);
+
+    ip* ip_hdr = reinterpret_cast<ip*>(packet.data());
+    ip_hdr->ip_v = 4;
+    ip_hdr->ip_hl = header_size / 4;
+    ip_hdr->ip_tos = 0xc0; //RFC 3376 Section 4: Internetwork Control
+    ip_hdr->ip_len = htons(packet.size());
+    ip_hdr->ip_off = htons(0 | IP_DF);
+    ip_hdr->ip_ttl = 1;
+    ip_hdr->ip_p = IPPROTO_IGMP;
+    ip_hdr->ip_src = saddr.get_in_addr();
+    ip_hdr->ip_dst = daddr.get_in_addr();
+
+    router_alert_option* ra_hdr = reinterpret_cast<router_alert_option*>(packet.data() + sizeof(ip));
+    *ra_hdr = router_alert_option();
+
+    ip_hdr->ip_sum = get_checksum(packet.data(), header_size);
+
+    memcpy(packet.data() + header_size, payload.data(), payload.size());
+    return packet;
+}
+
+std::vector<unsigned char> host_population::build_ipv6_packet(const addr_storage& saddr, const addr_storage& daddr, std::vector<unsigned char> payload) const
+{
+    HC_LOG_TRACE("");
+
+    //ICMPv6 checksum over the pseudo header of RFC 2460 Section 8.1
+    std::vector<unsigned char> pseudo(2 * sizeof(in6_addr) + 8, 0);
+    memcpy(&pseudo[0], &saddr.get_in6_addr(), sizeof(in6_addr));
+    memcpy(&pseudo[sizeof(in6_addr)], &daddr.get_in6_addr(), sizeof(in6_addr));
+    uint32_t length = htonl(payload.size());
+    memcpy(&pseudo[2 * sizeof(in6_addr)], &length, sizeof(length));
+    pseudo.back() = IPPROTO_ICMPV6;
+    pseudo.insert(pseudo.end(), payload.begin(), payload.end());
+    uint16_t checksum = get_checksum(pseudo.data(), pseudo.size());
+    memcpy(&payload[2], &checksum, sizeof(checksum));
+
+    //hop-by-hop header with router alert option (MLD) and two bytes padding
+    const unsigned char hop_by_hop[] = {IPPROTO_ICMPV6, 0, IP6OPT_ROUTER_ALERT, 2, 0, 0, IP6OPT_PADN, 0};
+
+    std::vector<unsigned char> packet(sizeof(ip6_hdr) + sizeof(hop_by_hop) + payload.size(), 0);
+    ip6_hdr* ip6 = reinterpret_cast<ip6_hdr*>(packet.data());
+    ip6->ip6_flow = htonl(6 << 28);
+    ip6->ip6_plen = htons(sizeof(hop_by_hop) + payload.size());
+    ip6->ip6_nxt = IPPROTO_HOPOPTS;
+    ip6->ip6_hlim = 1;
+    ip6->ip6_src = saddr.get_in6_addr();
+    ip6->ip6_dst = daddr.get_in6_addr();
+
+    memcpy(packet.data() + sizeof(ip6_hdr), hop_by_hop, sizeof(hop_by_hop));
+    memcpy(packet.data() + sizeof(ip6_hdr) + sizeof(hop_by_hop), payload.data(), payload.size());
+    return packet;
+}
+
+bool host_population::send_packet(const std::vector<unsigned char>& packet)
+{
+    HC_LOG_TRACE("");
+
+    sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_ifindex = m_if_index;
+    addr.sll_halen = ETH_ALEN;
+
+    //multicast mac address of the destination, RFC 1112 Section 6.4 and RFC 2464 Section 7
+    if (m_addr_family == AF_INET) {
+        addr.sll_protocol = htons(ETH_P_IP);
+        const unsigned char* daddr = reinterpret_cast<const unsigned char*>(&reinterpret_cast<const ip*>(packet.data())->ip_dst);
+        const unsigned char mac[ETH_ALEN] = {0x01, 0x00, 0x5e, static_cast<unsigned char>(daddr[1] & 0x7f), daddr[2], daddr[3]};
+        memcpy(addr.sll_addr, mac, ETH_ALEN);
+    } else {
+        addr.sll_protocol = htons(ETH_P_IPV6);
+        const unsigned char* daddr = reinterpret_cast<const ip6_hdr*>(packet.data())->ip6_dst.s6_addr;
+        const unsigned char mac[ETH_ALEN] = {0x33, 0x33, daddr[12], daddr[13], daddr[14], daddr[15]};
+        memcpy(addr.sll_addr, mac, ETH_ALEN);
+    }
+
+    if (sendto(m_sock, packet.data(), packet.size(), 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        HC_LOG_ERROR("failed to send report! Error: " << strerror(errno) << " errno: " << errno);
+        ++m_send_errors;
+        return false;
+    }
+
+    ++m_packets_sent;
+    return true;
+}
+
+void host_population::receive_packets(int sock, bool upstream)
+{
+    HC_LOG_TRACE("");
+
+    std::vector<unsigned char> buf(IP_MAXPACKET);
+    const uint16_t protocol = htons(m_addr_family == AF_INET ? ETH_P_IP : ETH_P_IPV6);
+
+    while (true) {
+        sockaddr_ll from;
+        socklen_t from_size = sizeof(from);
+        int size = recvfrom(sock, buf.data(), buf.size(), MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&from), &from_size);
+        if (size <= 0) {
+            return;
+        }
+
+        if (from.sll_protocol != protocol) {
+            continue;
+        }
+
+        if (upstream) {
+            analyse_upstream_report(buf.data(), size);
+        } else if (from.sll_pkttype != PACKET_OUTGOING) { //not a report of the simulated hosts
+            analyse_query(buf.data(), size);
+        }
+    }
+}
+
+const unsigned char* host_population::get_payload(const unsigned char* buf, unsigned int& size, addr_storage& saddr) const
+{
+    HC_LOG_TRACE("");
+
+    if (m_addr_family == AF_INET) {
+        if (size < sizeof(ip)) {
+            return nullptr;
+        }
+
+        const ip* ip_hdr = reinterpret_cast<const ip*>(buf);
+        unsigned int header_size = ip_hdr->ip_hl * 4;
+        unsigned int total_size = ntohs(ip_hdr->ip_len);
+        if (ip_hdr->ip_v != 4 || ip_hdr->ip_p != IPPROTO_IGMP || total_size > size || header_size > total_size) {
+            return nullptr;
+        }
+
+        saddr = addr_storage(ip_hdr->ip_src);
+        size = total_size - header_size;
+        return buf + header_size;
+    } else {
+        if (size < sizeof(ip6_hdr)) {
+            return nullptr;
+        }
+
+        const ip6_hdr* ip6 = reinterpret_cast<const ip6_hdr*>(buf);
+        unsigned int total_size = sizeof(ip6_hdr) + ntohs(ip6->ip6_plen);
+        if (total_size > size) {
+            return nullptr;
+        }
+
+        //MLD messages follow a hop-by-hop header
+        unsigned int offset = sizeof(ip6_hdr);
+        uint8_t next_header = ip6->ip6_nxt;
+        if (next_header == IPPROTO_HOPOPTS) {
+            if (offset + 8 > total_size) {
+                return nullptr;
+            }
+            next_header = buf[offset];
+            offset += (buf[offset + 1] + 1) * 8;
+        }
+
+        if (next_header != IPPROTO_ICMPV6 || offset > total_size) {
+            return nullptr;
+        }
+
+        saddr = addr_storage(ip6->ip6_src);
+        size = total_size - offset;
+        return buf + offset;
+    }
+}
+
+void host_population::analyse_query(const unsigned char* buf, unsigned int size)
+{
+    HC_LOG_TRACE("");
+
+    addr_storage saddr;
+    const unsigned char* payload = get_payload(buf, size, saddr);
+    if (payload == nullptr) {
+        return;
+    }
+
+    timers_values tv;
+    if (m_addr_family == AF_INET) {
+        if (size < sizeof(igmp) || payload[0] != IGMP_MEMBERSHIP_QUERY) {
+            return;
+        }
+
+        //the max response code of IGMPv2 is a plain value, IGMPv1 queries have none
+        const igmp* query = reinterpret_cast<const igmp*>(payload);
+        std::chrono::milliseconds max_resp_time = query->igmp_code == 0 ? std::chrono::seconds(10) : tv.maxrespc_igmpv3_to_maxrespi(query->igmp_code);
+        ++m_queries;
+        answer_query(addr_storage(query->igmp_group), max_resp_time);
+    } else {
+        if (size < sizeof(mldv1) || payload[0] != MLD_LISTENER_QUERY) {
+            return;
+        }
+
+        const mldv1* query = reinterpret_cast<const mldv1*>(payload);
+        std::chrono::milliseconds max_resp_time = tv.maxrespc_mldv2_to_maxrespi(ntohs(query->max_resp_delay));
+        ++m_queries;
+        answer_query(addr_storage(query->gaddr), max_resp_time);
+    }
+}
+
+void host_population::answer_query(const addr_storage& gaddr, const std::chrono::milliseconds& max_resp_time)
+{
+    HC_LOG_TRACE("");
+
+    //each host answers after a random delay within the max response time
+    std::uniform_int_distribution<long long> distribution(0, std::chrono::duration_cast<std::chrono::microseconds>(max_resp_time).count());
+    for (unsigned int i = 0; i < m_hosts.size(); ++i) {
+        const auto& groups = m_hosts[i].groups;
+        if (groups.empty() || (gaddr.is_multicast_addr() && groups.find(gaddr) == groups.end())) {
+            continue;
+        }
+
+        schedule(std::chrono::microseconds(distribution(m_rand)), [this, i, gaddr]() {
+            send_current_state(i, gaddr);
+        });
+    }
+}
+
+void host_population::analyse_upstream_report(const unsigned char* buf, unsigned int size)
+{
+    HC_LOG_TRACE("");
+
+    addr_storage saddr;
+    const unsigned char* payload = get_payload(buf, size, saddr);
+    if (payload == nullptr || size < 1) {
+        return;
+    }
+
+    //a record with sources or in exclude mode subscribes the group, the others unsubscribe it
+    auto analyse_record = [this](uint8_t type, uint16_t num_of_srcs, const addr_storage & gaddr) {
+        bool join = type == MODE_IS_EXCLUDE || type == CHANGE_TO_EXCLUDE_MODE || (type != BLOCK_OLD_SOURCES && num_of_srcs > 0);
+        upstream_reaction(gaddr, join);
+    };
+
+    if (m_addr_family == AF_INET) {
+        uint8_t type = payload[0];
+        if ((type == IGMP_V1_MEMBERSHIP_REPORT || type == IGMP_V2_MEMBERSHIP_REPORT || type == IGMP_V2_LEAVE_GROUP) && size >= sizeof(igmp)) {
+            upstream_reaction(addr_storage(reinterpret_cast<const igmp*>(payload)->igmp_group), type != IGMP_V2_LEAVE_GROUP);
+        } else if (type == IGMP_V3_MEMBERSHIP_REPORT && size >= sizeof(igmpv3_mc_report)) {
+            unsigned int num_records = ntohs(reinterpret_cast<const igmpv3_mc_report*>(payload)->num_of_mc_records);
+            unsigned int offset = sizeof(igmpv3_mc_report);
+            for (unsigned int i = 0; i < num_records && offset + sizeof(igmpv3_mc_record) <= size; ++i) {
+                const igmpv3_mc_record* rec = reinterpret_cast<const igmpv3_mc_record*>(payload + offset);
+                analyse_record(rec->type, ntohs(rec->num_of_srcs), addr_storage(rec->gaddr));
+                offset += sizeof(igmpv3_mc_record) + ntohs(rec->num_of_srcs) * sizeof(in_addr) + rec->aux_data_len * 4;
+            }
+        }
+    } else {
+        uint8_t type = payload[0];
+        if ((type == MLD_LISTENER_REPORT || type == MLD_LISTENER_REDUCTION) && size >= sizeof(mldv1)) {
+            upstream_reaction(addr_storage(reinterpret_cast<const mldv1*>(payload)->gaddr), type == MLD_LISTENER_REPORT);
+        } else if (type == MLD_V2_LISTENER_REPORT && size >= sizeof(mldv2_mc_report)) {
+            unsigned int num_records = ntohs(reinterpret_cast<const mldv2_mc_report*>(payload)->num_of_mc_records);
+            unsigned int offset = sizeof(mldv2_mc_report);
+            for (unsigned int i = 0; i < num_records && offset + sizeof(mldv2_mc_record) <= size; ++i) {
+                const mldv2_mc_record* rec = reinterpret_cast<const mldv2_mc_record*>(payload + offset);
+                analyse_record(rec->type, ntohs(rec->num_of_srcs), addr_storage(rec->gaddr));
+                offset += sizeof(mldv2_mc_record) + ntohs(rec->num_of_srcs) * sizeof(in6_addr) + rec->aux_data_len * 4;
+            }
+        }
+    }
+}
+
+void host_population::upstream_reaction(const addr_storage& gaddr, bool join)
+{
+    HC_LOG_TRACE("");
+
+    ++m_upstream_records;
+
+    auto& pending = join ? m_pending_joins : m_pending_leaves;
+    auto it = pending.find(gaddr);
+    if (it == pending.end()) {
+        return; //retransmission or answer to a query
+    }
+
+    double latency = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - it->second).count() / 1000.0;
+    (join ? m_join_latency : m_leave_latency).push_back(latency);
+    pending.erase(it);
+
+    if (m_file.is_open()) {
+        m_file << (join ? "join " : "leave ") << gaddr << " " << latency << std::endl;
+    }
+}
+
+void host_population::run(const bool& running)
+{
+    HC_LOG_TRACE("");
+
+    std::cout << "simulate " << m_hosts.size() << " " << get_group_mem_protocol_name(m_config.gmp) << " hosts on interface " << m_config.if_name;
+    if (m_upstream_sock >= 0) {
+        std::cout << ", measure the upstream reaction on interface " << m_config.upstream_if_name;
+    }
+    std::cout << std::endl;
+
+    schedule_join();
+    schedule_zap();
+
+    auto next_status = clock::now() + std::chrono::milliseconds(HOST_POPULATION_STATUS_INTERVAL);
+
+    //with max_count the simulation ends after the last join and its upstream reaction
+    while (running && (m_config.max_count == 0 || m_joins < m_config.max_count || (m_upstream_sock >= 0 && !m_pending_joins.empty()))) {
+        auto now = clock::now();
+        while (!m_schedule.empty() && m_schedule.begin()->first <= now) {
+            auto f = m_schedule.begin()->second;
+            m_schedule.erase(m_schedule.begin());
+            f();
+        }
+
+        if (m_config.print_status_msg && now >= next_status) {
+            print_status();
+            next_status += std::chrono::milliseconds(HOST_POPULATION_STATUS_INTERVAL);
+        }
+
+        int timeout = 100; //msec
+        if (!m_schedule.empty()) {
+            timeout = std::min<long long>(timeout, std::chrono::duration_cast<std::chrono::milliseconds>(m_schedule.begin()->first - clock::now()).count());
+            timeout = std::max(timeout, 0);
+        }
+
+        pollfd fds[2] = {{m_sock, POLLIN, 0}, {m_upstream_sock, POLLIN, 0}};
+        if (poll(fds, m_upstream_sock >= 0 ? 2 : 1, timeout) > 0) { //interrupted by SIGINT or timeout otherwise
+            if (fds[0].revents & POLLIN) {
+                receive_packets(m_sock, false);
+            }
+
+            if (m_upstream_sock >= 0 && (fds[1].revents & POLLIN)) {
+                receive_packets(m_upstream_sock, true);
+            }
+        }
+    }
+
+    print_summary();
+}
+
+void host_population::print_status() const
+{
+    unsigned long memberships = 0;
+    for (auto & e : m_hosts) {
+        memberships += e.groups.size();
+    }
+
+    std::cout << "\rmemberships: " << memberships << "; active groups: " << m_group_members.size() << "; joins: " << m_joins << "; leaves: " << m_leaves << "; zaps: " << m_zaps << "; packets sent: " << m_packets_sent << "; queries: " << m_queries;
+    std::flush(std::cout);
+}
+
+std::string host_population::latency_to_string(std::vector<double>& latency)
+{
+    if (latency.empty()) {
+        return "no samples";
+    }
+
+    std::sort(latency.begin(), latency.end());
+    auto quantile = [&](double q) {
+        return latency[static_cast<unsigned int>(q * (latency.size() - 1) + 0.5)];
+    };
+
+    std::ostringstream s;
+    s << "samples(#): " << latency.size() << "; min(ms): " << latency.front() << "; median(ms): " << quantile(0.5) << "; p90(ms): " << quantile(0.9) << "; p99(ms): " << quantile(0.99) << "; max(ms): " << latency.back();
+    return s.str();
+}
+
+void host_population::print_summary()
+{
+    HC_LOG_TRACE("");
+
+    if (m_config.print_status_msg) {
+        std::cout << std::endl;
+    }
+
+    std::cout << "--- summary==> joins(#): " << m_joins << "; leaves(#): " << m_leaves << "; zaps(#): " << m_zaps << "; packets sent(#): " << m_packets_sent << "; send errors(#): " << m_send_errors << "; queries received(#): " << m_queries << std::endl;
+
+    if (m_upstream_sock >= 0) {
+        std::cout << "--- upstream join reaction==> " << latency_to_string(m_join_latency) << "; unanswered(#): " << m_pending_joins.size() << std::endl;
+        std::cout << "--- upstream leave reaction==> " << latency_to_string(m_leave_latency) << "; unanswered(#): " << m_pending_leaves.size() << std::endl;
+        std::cout << "--- upstream records(#): " << m_upstream_records << std::endl;
+    }
+}
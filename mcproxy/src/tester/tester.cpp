@@ -23,6 +23,8 @@
 
 #include "include/hamcast_logging.h"
 #include "include/tester/tester.hpp"
+#include "include/tester/host_population.hpp"
+#include "include/tester/flow_traffic.hpp"
 #include "include/utils/mc_socket.hpp"
 #include "include/proxy/interfaces.hpp"
 
@@ -384,6 +386,44 @@ std::chrono::milliseconds tester::get_lifetime(const std::string& to_do)
     return std::chrono::milliseconds(lifetime);
 }
 
+group_mem_protocol tester::get_group_mem_protocol(const std::string& to_do, int addr_family)
+{
+    HC_LOG_TRACE("");
+
+    std::string str_gmp = m_config_map.get(to_do, "protocol");
+    if (str_gmp.empty()) {
+        return addr_family == AF_INET ? IGMPv3 : MLDv2;
+    }
+
+    for (auto gmp : {IGMPv2, IGMPv3, MLDv1, MLDv2}) {
+        if (str_gmp.compare(get_group_mem_protocol_name(gmp)) == 0) {
+            return gmp;
+        }
+    }
+
+    std::cout << str_gmp << " is not a protocol (IGMPv2, IGMPv3, MLDv1 or MLDv2)" << std::endl;
+    exit(0);
+}
+
+addr_storage tester::get_host_addr(const std::string& to_do, int addr_family)
+{
+    HC_LOG_TRACE("");
+
+    std::string str_haddr = m_config_map.get(to_do, "host_addr");
+    if (str_haddr.empty()) {
+        std::cout << "no host_addr found" << std::endl;
+        exit(0);
+    }
+
+    addr_storage haddr(str_haddr);
+    if (addr_family != haddr.get_addr_family()) {
+        std::cout << "host_addr is not an ip address or has the wrong ip version" << std::endl;
+        exit(0);
+    }
+
+    return haddr;
+}
+
 int tester::get_int(const std::string& to_do, std::string&& compare, int default_return)
 {
     HC_LOG_TRACE("");
@@ -806,6 +846,83 @@ void tester::run(const std::string& to_do, const std::string& output_file, unsig
             run(to_do_next, output_file, current_packet_number, pmanager, send_msg);
         }
 
+        return;
+    } else if (action.compare("host_population") == 0) {
+        ms->close_socket();
+
+        host_population_config config;
+        config.if_name = if_name;
+        config.upstream_if_name = m_config_map.get(to_do, "upstream_interface");
+        config.gmp = get_group_mem_protocol(to_do, gaddr.get_addr_family());
+        config.first_gaddr = gaddr;
+        config.group_count = get_int(to_do, "group_count", 10);
+        config.zipf_popularity = get_boolean(to_do, "zipf_popularity", false);
+        config.first_host_addr = get_host_addr(to_do, gaddr.get_addr_family());
+        config.host_count = get_int(to_do, "host_count", 100);
+        config.filter_mode = slist.empty() ? EXCLUDE_MODE : mfilter;
+        config.slist = slist;
+        config.join_rate = get_int(to_do, "join_rate", 10);
+        config.hold_time = std::chrono::milliseconds(get_int(to_do, "hold_time", 10000));
+        config.zap_rate = get_int(to_do, "zap_rate", 0);
+        config.robustness = get_int(to_do, "robustness", 2);
+        config.seed = get_int(to_do, "seed", 0);
+        config.max_count = max_count;
+        config.print_status_msg = print_status_msg;
+        config.save_to_file = save_to_file;
+        config.file_name = file_name;
+        config.file_operation_mode = file_operation_mode;
+        config.include_file_header = include_file_header;
+
+        try {
+            host_population hp(config);
+            hp.run(m_running);
+        } catch (const char* e) {
+            std::cout << e << std::endl;
+            exit(0);
+        }
+
+        if (to_do_next.compare("null") != 0) {
+            run(to_do_next, output_file, current_packet_number, pmanager, send_msg);
+        }
+
+        return;
+    } else if (action.compare("flow_send") == 0 || action.compare("flow_receive") == 0) {
+        ms->close_socket();
+
+        flow_traffic_config config;
+        config.if_name = if_name;
+        config.first_gaddr = gaddr;
+        config.group_count = get_int(to_do, "group_count", 1);
+        config.slist = slist;
+        config.filter_mode = slist.empty() ? EXCLUDE_MODE : mfilter;
+        config.port = port;
+        config.ttl = ttl;
+        config.packet_rate = get_int(to_do, "packet_rate", 1000);
+        config.packet_size = get_int(to_do, "packet_size", 64);
+        config.batch_size = get_int(to_do, "batch_size", 32);
+        config.max_count = max_count;
+        config.print_status_msg = print_status_msg;
+        config.save_to_file = save_to_file;
+        config.file_name = file_name;
+        config.file_operation_mode = file_operation_mode;
+        config.include_file_header = include_file_header;
+
+        try {
+            flow_traffic ft(config);
+            if (action.compare("flow_send") == 0) {
+                ft.send(m_running);
+            } else {
+                ft.receive(m_running);
+            }
+        } catch (const char* e) {
+            std::cout << e << std::endl;
+            exit(0);
+        }
+
+        if (to_do_next.compare("null") != 0) {
+            run(to_do_next, output_file, current_packet_number, pmanager, send_msg);
+        }
+
         return;
     } else {
         std::cout << "action " << action << " not available" << std::endl;
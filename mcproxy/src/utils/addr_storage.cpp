@@ -219,6 +219,20 @@ bool operator<(const addr_storage& addr1, const addr_storage& addr2)
     }
 }
 
+std::size_t std::hash<addr_storage>::operator()(const addr_storage& addr) const
+{
+    //the multiplications spread the consecutive addresses of a subnet over all buckets
+    if (addr.get_addr_family() == AF_INET) {
+        return static_cast<uint64_t>(ntohl(addr.get_in_addr().s_addr)) * 0x9e3779b97f4a7c15ULL;
+    } else if (addr.get_addr_family() == AF_INET6) {
+        uint64_t words[2];
+        memcpy(words, addr.get_in6_addr().s6_addr, sizeof(words));
+        return (words[0] * 0x9e3779b97f4a7c15ULL) ^ (words[1] * 0xc2b2ae3d27d4eb4fULL);
+    } else {
+        return 0;
+    }
+}
+
 bool operator>(const addr_storage& addr1, const addr_storage& addr2)
 {
     return !(addr1 < addr2) &&  !(addr1 == addr2);
@@ -0,0 +1,278 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/utils/flight_recorder.hpp"
+
+#include <sys/syscall.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <errno.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+static_assert(sizeof(fr_event) == 56, "the size of a flight recorder event is part of the file format");
+static_assert((FLIGHT_RECORDER_RING_SIZE & (FLIGHT_RECORDER_RING_SIZE - 1)) == 0, "the ring size must be a power of two");
+
+namespace
+{
+struct fr_ring {
+    fr_ring_header header; //the head of the header is written at dump time
+    std::atomic<uint64_t> head;
+    fr_event events[FLIGHT_RECORDER_RING_SIZE];
+};
+
+//rings are never released, a dump may run at any time
+std::atomic<fr_ring*> s_rings[FLIGHT_RECORDER_MAX_THREADS];
+std::atomic<unsigned int> s_ring_count(0);
+
+char s_path[FLIGHT_RECORDER_PATH_SIZE] = {0};
+std::atomic_flag s_dumping = ATOMIC_FLAG_INIT;
+
+thread_local fr_ring* t_ring = nullptr;
+thread_local bool t_no_ring = false;
+
+uint64_t get_time()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+fr_ring* get_ring()
+{
+    if (t_ring == nullptr && !t_no_ring) {
+        unsigned int i = s_ring_count.fetch_add(1);
+        if (i >= FLIGHT_RECORDER_MAX_THREADS) {
+            t_no_ring = true;
+            return nullptr;
+        }
+
+        fr_ring* r = new fr_ring();
+        r->header.tid = syscall(SYS_gettid);
+        pthread_getname_np(pthread_self(), r->header.thread_name, sizeof(r->header.thread_name));
+        r->head.store(0);
+        s_rings[i].store(r);
+        t_ring = r;
+    }
+    return t_ring;
+}
+
+void copy_addr(uint8_t* to, const addr_storage& addr)
+{
+    if (addr.get_addr_family() == AF_INET) {
+        memcpy(to, &addr.get_in_addr(), sizeof(in_addr));
+    } else if (addr.get_addr_family() == AF_INET6) {
+        memcpy(to, &addr.get_in6_addr(), sizeof(in6_addr));
+    }
+}
+
+bool write_all(int fd, const void* buf, size_t size)
+{
+    const char* data = static_cast<const char*>(buf);
+    while (size > 0) {
+        ssize_t rc = write(fd, data, size);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += rc;
+        size -= rc;
+    }
+    return true;
+}
+}
+
+std::string get_fr_event_type_name(fr_event_type type)
+{
+    switch (type) {
+    case FR_RECORD_RECEIVED:
+        return "RECORD_RECEIVED";
+    case FR_TIMER_FIRED:
+        return "TIMER_FIRED";
+    case FR_QUERY_SENT:
+        return "QUERY_SENT";
+    case FR_ROUTE_ADDED:
+        return "ROUTE_ADDED";
+    case FR_ROUTE_DELETED:
+        return "ROUTE_DELETED";
+    case FR_QUEUE_OVERFLOW:
+        return "QUEUE_OVERFLOW";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+void flight_recorder::record(fr_event_type type, unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr, uint32_t arg, uint32_t arg2)
+{
+    fr_ring* r = get_ring();
+    if (r == nullptr) {
+        return;
+    }
+
+    fr_event e;
+    memset(&e, 0, sizeof(e));
+    e.time = get_time();
+    e.type = type;
+    e.addr_family = gaddr.get_addr_family() == AF_INET || gaddr.get_addr_family() == AF_INET6 ? gaddr.get_addr_family() : 0;
+    e.if_index = if_index;
+    e.arg = arg;
+    e.arg2 = arg2;
+    copy_addr(e.gaddr, gaddr);
+    copy_addr(e.saddr, saddr);
+
+    //only this thread writes the ring
+    uint64_t head = r->head.load(std::memory_order_relaxed);
+    r->events[head & (FLIGHT_RECORDER_RING_SIZE - 1)] = e;
+    r->head.store(head + 1, std::memory_order_release);
+}
+
+void flight_recorder::record(fr_event_type type, unsigned int if_index, const addr_storage& gaddr, uint32_t arg, uint32_t arg2)
+{
+    static const addr_storage no_saddr;
+    record(type, if_index, gaddr, no_saddr, arg, arg2);
+}
+
+bool flight_recorder::init(const std::string& path)
+{
+    HC_LOG_TRACE("");
+
+    if (path.empty() || path.size() >= sizeof(s_path)) {
+        HC_LOG_ERROR("invalid flight recorder file: " << path);
+        return false;
+    }
+    strncpy(s_path, path.c_str(), sizeof(s_path) - 1);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = flight_recorder::signal_handler;
+    sigemptyset(&sa.sa_mask);
+
+    sa.sa_flags = SA_RESTART;
+    if (sigaction(SIGUSR1, &sa, nullptr) < 0) {
+        HC_LOG_ERROR("failed to install the flight recorder signal handler! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    }
+
+    //the default action runs after the dump
+    sa.sa_flags = SA_RESETHAND;
+    for (int sig : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT}) {
+        if (sigaction(sig, &sa, nullptr) < 0) {
+            HC_LOG_ERROR("failed to install the flight recorder signal handler! Error: " << strerror(errno) << " errno: " << errno);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void flight_recorder::signal_handler(int sig)
+{
+    int saved_errno = errno;
+    dump(sig);
+    errno = saved_errno;
+
+    if (sig != SIGUSR1) {
+        raise(sig);
+    }
+}
+
+bool flight_recorder::dump(int sig)
+{
+    if (s_path[0] == '\0' || s_dumping.test_and_set()) {
+        return false;
+    }
+
+    fr_ring* rings[FLIGHT_RECORDER_MAX_THREADS];
+    uint32_t ring_count = 0;
+    for (auto & e : s_rings) {
+        fr_ring* r = e.load();
+        if (r != nullptr) {
+            rings[ring_count++] = r;
+        }
+    }
+
+    fr_file_header fh;
+    memset(&fh, 0, sizeof(fh));
+    memcpy(fh.magic, FLIGHT_RECORDER_MAGIC, sizeof(fh.magic));
+    fh.version = FLIGHT_RECORDER_VERSION;
+    fh.event_size = sizeof(fr_event);
+    fh.ring_size = FLIGHT_RECORDER_RING_SIZE;
+    fh.ring_count = ring_count;
+    fh.pid = getpid();
+    fh.signal = sig;
+    fh.time = get_time();
+
+    //a new file only, a symlink or a file planted at the path is never followed or truncated
+    bool rc = false;
+    unlink(s_path);
+    int fd = open(s_path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        rc = write_all(fd, &fh, sizeof(fh));
+        for (uint32_t i = 0; rc && i < ring_count; ++i) {
+            fr_ring_header rh = rings[i]->header;
+            rh.head = rings[i]->head.load(std::memory_order_acquire);
+            rc = write_all(fd, &rh, sizeof(rh)) && write_all(fd, rings[i]->events, sizeof(rings[i]->events));
+        }
+        close(fd);
+    }
+
+    s_dumping.clear();
+    return rc;
+}
+
+#ifdef DEBUG_MODE
+void flight_recorder::test_flight_recorder()
+{
+    using namespace std;
+    cout << "##-- test flight_recorder --##" << endl;
+
+    const char* path = "/tmp/mcproxy_test.flight";
+    cout << "init: " << (init(path) ? "OK" : "FAILED") << endl;
+
+    for (unsigned int i = 0; i < FLIGHT_RECORDER_RING_SIZE + 10; ++i) {
+        record(FR_RECORD_RECEIVED, 1, addr_storage("239.1.1.1"), 2, i);
+    }
+    std::thread t([]() {
+        record(FR_ROUTE_ADDED, 2, addr_storage("ff05::1"), addr_storage("2001:db8::1"), 3, 1);
+    });
+    t.join();
+
+    cout << "dump: " << (dump() ? "OK" : "FAILED") << endl;
+
+    int fd = open(path, O_RDONLY);
+    fr_file_header fh;
+    fr_ring_header rh;
+    bool ok = fd >= 0 && read(fd, &fh, sizeof(fh)) == sizeof(fh) && memcmp(fh.magic, FLIGHT_RECORDER_MAGIC, 4) == 0 && fh.ring_count >= 2;
+    ok = ok && read(fd, &rh, sizeof(rh)) == sizeof(rh) && rh.head >= FLIGHT_RECORDER_RING_SIZE + 10;
+    if (fd >= 0) {
+        close(fd);
+    }
+    cout << "file: " << (ok ? "OK" : "FAILED") << endl;
+}
+#endif /* DEBUG_MODE */
@@ -0,0 +1,315 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/utils/if_monitor.hpp"
+
+#include <sys/socket.h>
+#include <net/if.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+
+#include <map>
+#include <iostream>
+
+std::atomic<unsigned int> if_monitor::m_link_generation(0);
+
+if_monitor::if_monitor(int addr_family, const if_monitor_callback& cb)
+    : m_addr_family(addr_family)
+    , m_cb(cb)
+    , m_sock(-1)
+    , m_thread(nullptr)
+    , m_dump_pending(false)
+    , m_dump_again(false)
+    , m_dump_seq(0)
+{
+    HC_LOG_TRACE("");
+
+    if (m_addr_family != AF_INET && m_addr_family != AF_INET6) {
+        HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
+        throw "wrong addr_family";
+    }
+
+    m_sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (m_sock < 0) {
+        HC_LOG_ERROR("failed to create rtnetlink socket! Error: " << strerror(errno) << " errno: " << errno);
+        throw "failed to create rtnetlink socket";
+    }
+
+    sockaddr_nl local;
+    memset(&local, 0, sizeof(local));
+    local.nl_family = AF_NETLINK;
+    local.nl_groups = RTMGRP_LINK | (m_addr_family == AF_INET ? RTMGRP_IPV4_IFADDR : RTMGRP_IPV6_IFADDR);
+    if (bind(m_sock, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0) {
+        HC_LOG_ERROR("failed to bind rtnetlink socket! Error: " << strerror(errno) << " errno: " << errno);
+        close(m_sock);
+        throw "failed to bind rtnetlink socket";
+    }
+
+    if (pipe2(m_stop_pipe, O_CLOEXEC) < 0) {
+        HC_LOG_ERROR("failed to create pipe! Error: " << strerror(errno) << " errno: " << errno);
+        close(m_sock);
+        throw "failed to create pipe";
+    }
+
+    //the links that are down already, the answer is read by the thread
+    if (!request_link_dump()) {
+        close(m_stop_pipe[0]);
+        close(m_stop_pipe[1]);
+        close(m_sock);
+        throw "failed to request the link dump";
+    }
+
+    m_thread.reset(new std::thread(&if_monitor::worker_thread, this));
+}
+
+if_monitor::~if_monitor()
+{
+    HC_LOG_TRACE("");
+
+    char c = 0;
+    if (write(m_stop_pipe[1], &c, sizeof(c)) < 0) {
+        HC_LOG_ERROR("failed to stop the interface monitor! Error: " << strerror(errno) << " errno: " << errno);
+    }
+
+    if (m_thread) {
+        m_thread->join();
+    }
+
+    close(m_stop_pipe[0]);
+    close(m_stop_pipe[1]);
+    close(m_sock);
+}
+
+void if_monitor::worker_thread()
+{
+    HC_LOG_TRACE("");
+    unsigned char buf[IF_MONITOR_RECV_BUF_SIZE];
+
+    pollfd fds[2];
+    fds[0].fd = m_sock;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_stop_pipe[0];
+    fds[1].events = POLLIN;
+
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            HC_LOG_ERROR("failed to poll rtnetlink socket! Error: " << strerror(errno) << " errno: " << errno);
+            break;
+        }
+
+        if (fds[1].revents != 0) {
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int size = recv(m_sock, buf, sizeof(buf), 0);
+            if (size < 0) {
+                if (errno == ENOBUFS) {
+                    //notifications lost, read the state of all links again
+                    HC_LOG_WARN("rtnetlink notifications lost");
+                    if (m_dump_pending) {
+                        m_dump_again = true;
+                    } else {
+                        request_link_dump();
+                    }
+                } else if (errno != EINTR && errno != EAGAIN) {
+                    HC_LOG_ERROR("failed to receive rtnetlink notification! Error: " << strerror(errno) << " errno: " << errno);
+                }
+                continue;
+            }
+
+            parse(buf, size);
+        }
+    }
+
+    HC_LOG_DEBUG("worker thread if_monitor end");
+}
+
+void if_monitor::parse(const unsigned char* buf, int size)
+{
+    HC_LOG_TRACE("");
+
+    for (auto nh = reinterpret_cast<const nlmsghdr*>(buf); NLMSG_OK(nh, static_cast<unsigned int>(size)); nh = NLMSG_NEXT(nh, size)) {
+        bool dump_msg = m_dump_pending && nh->nlmsg_seq == m_dump_seq;
+
+        switch (nh->nlmsg_type) {
+        case RTM_NEWLINK:
+        case RTM_DELLINK: {
+            auto ifi = reinterpret_cast<const ifinfomsg*>(NLMSG_DATA(nh));
+            unsigned int if_index = ifi->ifi_index;
+            ++m_link_generation;
+
+            //a link created during the dump is not missing from it
+            if (m_dump_pending) {
+                m_dump_links.insert(if_index);
+            }
+
+            if (nh->nlmsg_type == RTM_NEWLINK) {
+                m_links.insert(if_index);
+            } else {
+                m_links.erase(if_index);
+            }
+
+            link_changed(if_index, nh->nlmsg_type == RTM_NEWLINK && (ifi->ifi_flags & IFF_UP) && (ifi->ifi_flags & IFF_RUNNING));
+        }
+        break;
+        case RTM_NEWADDR:
+        case RTM_DELADDR: {
+            auto ifa = reinterpret_cast<const ifaddrmsg*>(NLMSG_DATA(nh));
+            if (ifa->ifa_family == m_addr_family) {
+                m_cb(ifa->ifa_index, IFE_ADDR_CHANGED);
+            }
+        }
+        break;
+        case NLMSG_DONE:
+            if (dump_msg) {
+                finish_link_dump();
+            }
+            break;
+        case NLMSG_ERROR:
+            if (dump_msg) {
+                auto err = reinterpret_cast<const nlmsgerr*>(NLMSG_DATA(nh));
+                HC_LOG_ERROR("failed to dump the links! Error: " << strerror(-err->error) << " errno: " << -err->error);
+                m_dump_pending = false;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void if_monitor::link_changed(unsigned int if_index, bool running)
+{
+    HC_LOG_TRACE("");
+
+    if (running) {
+        if (m_down_links.erase(if_index) > 0) {
+            m_cb(if_index, IFE_LINK_UP);
+        }
+    } else {
+        if (m_down_links.insert(if_index).second) {
+            m_cb(if_index, IFE_LINK_DOWN);
+        }
+    }
+}
+
+bool if_monitor::request_link_dump()
+{
+    HC_LOG_TRACE("");
+
+    struct {
+        nlmsghdr nh;
+        ifinfomsg ifi;
+    } req;
+
+    memset(&req, 0, sizeof(req));
+    req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(req.ifi));
+    req.nh.nlmsg_type = RTM_GETLINK;
+    req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nh.nlmsg_seq = ++m_dump_seq;
+    req.ifi.ifi_family = AF_UNSPEC;
+
+    sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+
+    if (sendto(m_sock, &req, req.nh.nlmsg_len, 0, reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel)) < 0) {
+        HC_LOG_ERROR("failed to request the link dump! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    }
+
+    m_dump_pending = true;
+    m_dump_again = false;
+    m_dump_links.clear();
+    return true;
+}
+
+void if_monitor::finish_link_dump()
+{
+    HC_LOG_TRACE("");
+    m_dump_pending = false;
+
+    if (m_dump_again) {
+        //notifications were lost during the dump
+        request_link_dump();
+        return;
+    }
+
+    //links whose removal was missed
+    for (auto it = m_links.begin(); it != m_links.end();) {
+        if (m_dump_links.find(*it) == m_dump_links.end()) {
+            ++m_link_generation;
+            link_changed(*it, false);
+            it = m_links.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::string if_monitor::get_if_event_name(if_event ife)
+{
+    HC_LOG_TRACE("");
+
+    std::map<if_event, std::string> name_map = {
+        {IFE_LINK_UP,      "LINK_UP"     },
+        {IFE_LINK_DOWN,    "LINK_DOWN"   },
+        {IFE_ADDR_CHANGED, "ADDR_CHANGED"}
+    };
+    return name_map[ife];
+}
+
+unsigned int if_monitor::get_link_generation()
+{
+    HC_LOG_TRACE("");
+    return m_link_generation.load();
+}
+
+#ifdef DEBUG_MODE
+void if_monitor::test_if_monitor()
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+    cout << "##-- test if_monitor --##" << endl;
+    cout << "change a link or an address within 10 seconds" << endl;
+
+    {
+        if_monitor m(AF_INET, [](unsigned int if_index, if_event ife) {
+            char name[IF_NAMESIZE] = "?";
+            if_indextoname(if_index, name);
+            cout << name << " (index:" << if_index << "): " << get_if_event_name(ife) << endl;
+        });
+
+        sleep(10);
+    }
+
+    cout << "finished" << endl;
+}
+#endif /* DEBUG_MODE */
@@ -144,6 +144,20 @@ if_prop::~if_prop()
     }
 }
 
+unsigned int if_prop::get_if_index(const char* if_name)
+{
+    HC_LOG_TRACE("");
+    return if_nametoindex(if_name);
+}
+
+std::string if_prop::get_if_name(unsigned int if_index)
+{
+    HC_LOG_TRACE("");
+    char tmp[IF_NAMESIZE];
+    const char* if_name = if_indextoname(if_index, tmp);
+    return if_name != nullptr ? std::string(if_name) : std::string();
+}
+
 #ifdef DEBUG_MODE
 void if_prop::print_if_info(if_prop* p)
 {
@@ -444,6 +444,26 @@ bool mc_socket::set_receive_timeout(long msec) const
     }
 }
 
+bool mc_socket::set_receive_timestamp(bool enable) const
+{
+    HC_LOG_TRACE("");
+
+    if (!is_udp_valid()) {
+        HC_LOG_ERROR("udp_socket invalid");
+        return false;
+    }
+
+    int on = enable ? 1 : 0;
+    int rc = setsockopt(m_sock, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+
+    if (rc == -1) {
+        HC_LOG_ERROR("failed to set receive timestamp! Error: " << strerror(errno)  << " errno: " << errno);
+        return false;
+    } else {
+        return true;
+    }
+}
+
 bool mc_socket::choose_if(uint32_t if_index) const
 {
     HC_LOG_TRACE("");
@@ -586,7 +606,10 @@ bool mc_socket::generic_group_sockopt(const addr_storage& gaddr, uint32_t if_ind
     rc = setsockopt (m_sock, family_to_level(gaddr.get_addr_family()), optname, &req, sizeof(req));
 
     if (rc == -1) {
-        HC_LOG_WARN("failed to set socket option! Error: " << strerror(errno) << " errno: " << errno);
+        //the caller may evaluate errno
+        int err = errno;
+        HC_LOG_WARN("failed to set socket option! Error: " << strerror(err) << " errno: " << err);
+        errno = err;
         return false;
     } else {
         return true;
@@ -0,0 +1,306 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/utils/mc_socket_pool.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include <net/if.h>
+#include <errno.h>
+#include <string.h>
+
+mc_socket_pool::mc_socket_pool(int addr_family, unsigned int max_memberships)
+    : m_addr_family(addr_family)
+    , m_max_memberships(max_memberships)
+    , m_max_msf(0)
+{
+    HC_LOG_TRACE("");
+
+    if (m_addr_family == AF_INET) {
+        if (m_max_memberships == 0) {
+            m_max_memberships = read_limit(MC_SOCKET_POOL_IGMP_MAX_MEMBERSHIPS_PATH);
+        }
+        m_max_msf = read_limit(MC_SOCKET_POOL_IGMP_MAX_MSF_PATH);
+    } else if (m_addr_family == AF_INET6) {
+        //IPv6 memberships are only limited by the socket option memory (optmem_max)
+        m_max_msf = read_limit(MC_SOCKET_POOL_MLD_MAX_MSF_PATH);
+    } else {
+        HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
+        throw "wrong addr_family";
+    }
+}
+
+unsigned int mc_socket_pool::read_limit(const std::string& path)
+{
+    HC_LOG_TRACE("");
+    std::ifstream f(path);
+    unsigned int result = 0;
+    if (!(f >> result)) {
+        HC_LOG_DEBUG("failed to read " << path);
+        return 0;
+    }
+    return result;
+}
+
+bool mc_socket_pool::open_socket(pool_socket& ps)
+{
+    HC_LOG_TRACE("");
+    std::unique_ptr<mc_socket> sock(new mc_socket);
+
+    if (m_addr_family == AF_INET) {
+        if (!sock->create_udp_ipv4_socket()) {
+            return false;
+        }
+    } else {
+        if (!sock->create_udp_ipv6_socket()) {
+            return false;
+        }
+    }
+
+    ps.sock = std::move(sock);
+    ps.memberships = 0;
+    ps.capacity = m_max_memberships;
+    return true;
+}
+
+bool mc_socket_pool::join(unsigned int if_index, const addr_storage& gaddr, unsigned int& index)
+{
+    HC_LOG_TRACE("");
+
+    for (;;) {
+        //the first open socket with free capacity, otherwise a new one
+        unsigned int i = 0;
+        for (; i < m_sockets.size(); ++i) {
+            auto& ps = m_sockets[i];
+            if (ps.sock != nullptr && (ps.capacity == 0 || ps.memberships < ps.capacity)) {
+                break;
+            }
+        }
+
+        if (i == m_sockets.size() || m_sockets[i].sock == nullptr) {
+            for (i = 0; i < m_sockets.size() && m_sockets[i].sock != nullptr; ++i) {}
+            if (i == m_sockets.size()) {
+                m_sockets.push_back(pool_socket());
+            }
+
+            if (!open_socket(m_sockets[i])) {
+                HC_LOG_ERROR("failed to open membership socket " << i);
+                release(i);
+                return false;
+            }
+            HC_LOG_DEBUG("opened membership socket " << i);
+        }
+
+        auto& ps = m_sockets[i];
+        if (ps.sock->join_group(gaddr, if_index)) {
+            ++ps.memberships;
+            index = i;
+            return true;
+        }
+        int err = errno;
+
+        if (ps.memberships == 0) {
+            HC_LOG_ERROR("failed to join group " << gaddr << " on interface " << if_index << " with an empty socket");
+            release(i);
+            return false;
+        }
+
+        //only a membership limit of the socket is worth another socket,
+        //e.g. an unknown interface or an invalid group fails on every socket
+        if (err != ENOBUFS && err != ENOMEM) {
+            HC_LOG_ERROR("failed to join group " << gaddr << " on interface " << if_index << "! Error: " << strerror(err) << " errno: " << err);
+            return false;
+        }
+
+        //the kernel refused before the expected limit, e.g. by the socket option memory
+        HC_LOG_DEBUG("membership socket " << i << " is full with " << ps.memberships << " memberships");
+        ps.capacity = ps.memberships;
+    }
+}
+
+void mc_socket_pool::release(unsigned int index)
+{
+    HC_LOG_TRACE("");
+    if (index >= m_sockets.size() || m_sockets[index].memberships > 0) {
+        return;
+    }
+
+    m_sockets[index].sock.reset();
+    HC_LOG_DEBUG("closed membership socket " << index);
+
+    while (!m_sockets.empty() && m_sockets.back().sock == nullptr) {
+        m_sockets.pop_back();
+    }
+}
+
+bool mc_socket_pool::set_source_filter(unsigned int if_index, const addr_storage& gaddr, uint32_t filter_mode, const std::list<addr_storage>& src_list)
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+
+    if (m_max_msf > 0 && src_list.size() > m_max_msf) {
+        HC_LOG_ERROR("failed to set source filter of group " << gaddr << ", " << src_list.size() << " sources exceed the kernel limit of " << m_max_msf << " (" << (m_addr_family == AF_INET ? "igmp_max_msf" : "mld_max_msf") << ")");
+        return false;
+    }
+
+    auto key = std::make_pair(if_index, gaddr);
+    auto it = m_owner.find(key);
+    if (it == std::end(m_owner)) {
+        unsigned int index;
+        if (!join(if_index, gaddr, index)) {
+            return false;
+        }
+        it = m_owner.insert(std::make_pair(key, index)).first;
+    }
+
+    return m_sockets[it->second].sock->set_source_filter(if_index, gaddr, filter_mode, src_list);
+}
+
+bool mc_socket_pool::leave_group(unsigned int if_index, const addr_storage& gaddr)
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+
+    auto it = m_owner.find(std::make_pair(if_index, gaddr));
+    if (it == std::end(m_owner)) {
+        HC_LOG_DEBUG("group " << gaddr << " is not joined on interface " << if_index);
+        return false;
+    }
+
+    unsigned int index = it->second;
+    m_owner.erase(it);
+
+    auto& ps = m_sockets[index];
+    bool rc = ps.sock->leave_group(gaddr, if_index);
+    --ps.memberships;
+    release(index);
+    return rc;
+}
+
+bool mc_socket_pool::is_joined(unsigned int if_index, const addr_storage& gaddr) const
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+    return m_owner.find(std::make_pair(if_index, gaddr)) != std::end(m_owner);
+}
+
+unsigned int mc_socket_pool::get_socket_count() const
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+    unsigned int result = 0;
+    for (auto & e : m_sockets) {
+        if (e.sock != nullptr) {
+            ++result;
+        }
+    }
+    return result;
+}
+
+unsigned int mc_socket_pool::get_membership_count() const
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+    return m_owner.size();
+}
+
+std::vector<unsigned int> mc_socket_pool::get_occupancy() const
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+    std::vector<unsigned int> result;
+    for (auto & e : m_sockets) {
+        if (e.sock != nullptr) {
+            result.push_back(e.memberships);
+        }
+    }
+    return result;
+}
+
+std::string mc_socket_pool::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+    std::ostringstream s;
+    s << "##-- membership sockets (memberships:" << m_owner.size();
+    s << ",max per socket:" << (m_max_memberships == 0 ? std::string("unlimited") : std::to_string(m_max_memberships));
+    s << ",max sources:" << (m_max_msf == 0 ? std::string("unlimited") : std::to_string(m_max_msf)) << ") --##";
+    for (unsigned int i = 0; i < m_sockets.size(); ++i) {
+        auto& ps = m_sockets[i];
+        if (ps.sock != nullptr) {
+            s << std::endl << "socket " << i << ": " << ps.memberships;
+            if (ps.capacity != 0) {
+                s << "/" << ps.capacity;
+            }
+        }
+    }
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const mc_socket_pool& p)
+{
+    HC_LOG_TRACE("");
+    return stream << p.to_string();
+}
+
+#ifdef DEBUG_MODE
+void mc_socket_pool::test_mc_socket_pool()
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+    cout << "##-- test mc_socket_pool --##" << endl;
+
+    unsigned int if_index = if_nametoindex("lo");
+    mc_socket_pool pool(AF_INET, 4);
+
+    addr_storage gaddr("239.3.0.0");
+    list<addr_storage> gaddrs;
+    for (int i = 0; i < 10; ++i) {
+        gaddrs.push_back(++gaddr);
+        pool.set_source_filter(if_index, gaddrs.back(), MCAST_EXCLUDE, list<addr_storage>());
+    }
+    cout << pool << endl;
+    cout << "expected: 10 memberships on 3 sockets (4 4 2)" << endl;
+
+    cout << "source filter update of " << gaddrs.front() << ": ";
+    cout << (pool.set_source_filter(if_index, gaddrs.front(), MCAST_INCLUDE, {addr_storage("10.0.0.1")}) ? "OK" : "FAILED") << endl;
+
+    for (int i = 0; i < 8; ++i) {
+        pool.leave_group(if_index, gaddrs.front());
+        gaddrs.pop_front();
+    }
+    cout << pool << endl;
+    cout << "expected: 2 memberships on 1 socket" << endl;
+
+    cout << "join on an unknown interface: ";
+    cout << (pool.set_source_filter(if_index + 1000, gaddrs.front(), MCAST_EXCLUDE, list<addr_storage>()) ? "OK" : "FAILED") << endl;
+    cout << "sockets (expected FAILED and 1): " << pool.get_socket_count() << endl;
+
+    for (auto & e : gaddrs) {
+        pool.leave_group(if_index, e);
+    }
+    cout << "sockets after leaving all groups (expected 0): " << pool.get_socket_count() << endl;
+}
+#endif /* DEBUG_MODE */
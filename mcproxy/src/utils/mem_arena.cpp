@@ -0,0 +1,241 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/utils/mem_arena.hpp"
+
+#include <sstream>
+#include <iostream>
+#include <set>
+#include <map>
+#include <chrono>
+
+std::string get_mem_arena_kind_name(mem_arena_kind kind)
+{
+    HC_LOG_TRACE("");
+
+    switch (kind) {
+    case MAK_GROUP:
+        return "group";
+    case MAK_SOURCE:
+        return "source";
+    case MAK_TIMER:
+        return "timer";
+    default:
+        return "ERROR";
+    }
+}
+
+mem_arena::mem_arena()
+    : m_pools(MEM_ARENA_MAX_BLOCK_SIZE / MEM_ARENA_ALIGNMENT)
+    , m_bytes_reserved(0)
+{
+    HC_LOG_TRACE("");
+
+    for (int i = 0; i < MAK_COUNT; ++i) {
+        m_bytes_in_use[i] = 0;
+        m_blocks_in_use[i] = 0;
+    }
+}
+
+mem_arena::~mem_arena()
+{
+    HC_LOG_TRACE("");
+
+    for (auto e : m_chunks) {
+        ::operator delete(e);
+    }
+}
+
+std::size_t mem_arena::get_block_size(std::size_t bytes)
+{
+    if (bytes < sizeof(free_block)) {
+        bytes = sizeof(free_block);
+    }
+
+    return (bytes + MEM_ARENA_ALIGNMENT - 1) / MEM_ARENA_ALIGNMENT * MEM_ARENA_ALIGNMENT;
+}
+
+void mem_arena::refill(pool& p, std::size_t block_size)
+{
+    HC_LOG_TRACE("");
+
+    std::size_t chunk_size = block_size * p.next_chunk_blocks;
+    char* chunk = static_cast<char*>(::operator new(chunk_size));
+    m_chunks.push_back(chunk);
+    m_bytes_reserved += chunk_size;
+
+    //thread the new blocks into the free list
+    for (unsigned int i = 0; i < p.next_chunk_blocks; ++i) {
+        free_block* b = reinterpret_cast<free_block*>(chunk + i * block_size);
+        b->next = p.free_list;
+        p.free_list = b;
+    }
+
+    if (p.next_chunk_blocks < MEM_ARENA_MAX_CHUNK_BLOCKS) {
+        p.next_chunk_blocks *= 2;
+    }
+}
+
+void* mem_arena::allocate(std::size_t bytes, mem_arena_kind kind)
+{
+    std::size_t block_size = get_block_size(bytes);
+
+    if (block_size > MEM_ARENA_MAX_BLOCK_SIZE) {
+        void* rt = ::operator new(bytes);
+        std::lock_guard<std::mutex> lock(m_global_lock);
+        m_bytes_in_use[kind] += bytes;
+        m_blocks_in_use[kind]++;
+        return rt;
+    }
+
+    std::lock_guard<std::mutex> lock(m_global_lock);
+    pool& p = m_pools[block_size / MEM_ARENA_ALIGNMENT - 1];
+
+    if (p.free_list == nullptr) {
+        refill(p, block_size);
+    }
+
+    free_block* b = p.free_list;
+    p.free_list = b->next;
+
+    m_bytes_in_use[kind] += block_size;
+    m_blocks_in_use[kind]++;
+    return b;
+}
+
+void mem_arena::deallocate(void* p, std::size_t bytes, mem_arena_kind kind)
+{
+    if (p == nullptr) {
+        return;
+    }
+
+    std::size_t block_size = get_block_size(bytes);
+
+    if (block_size > MEM_ARENA_MAX_BLOCK_SIZE) {
+        ::operator delete(p);
+        std::lock_guard<std::mutex> lock(m_global_lock);
+        m_bytes_in_use[kind] -= bytes;
+        m_blocks_in_use[kind]--;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_global_lock);
+    pool& po = m_pools[block_size / MEM_ARENA_ALIGNMENT - 1];
+
+    free_block* b = static_cast<free_block*>(p);
+    b->next = po.free_list;
+    po.free_list = b;
+
+    m_bytes_in_use[kind] -= block_size;
+    m_blocks_in_use[kind]--;
+}
+
+std::size_t mem_arena::get_bytes_reserved() const
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+    return m_bytes_reserved;
+}
+
+std::size_t mem_arena::get_bytes_in_use(mem_arena_kind kind) const
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+    return m_bytes_in_use[kind];
+}
+
+std::size_t mem_arena::get_blocks_in_use(mem_arena_kind kind) const
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+    return m_blocks_in_use[kind];
+}
+
+std::string mem_arena::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::lock_guard<std::mutex> lock(m_global_lock);
+    std::ostringstream s;
+    s << "reserved: " << m_bytes_reserved << " bytes in " << m_chunks.size() << " chunks";
+    for (int i = 0; i < MAK_COUNT; ++i) {
+        s << std::endl << get_mem_arena_kind_name(static_cast<mem_arena_kind>(i)) << ": " << m_blocks_in_use[i] << " blocks, " << m_bytes_in_use[i] << " bytes";
+    }
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const mem_arena& m)
+{
+    HC_LOG_TRACE("");
+    return stream << m.to_string();
+}
+
+#ifdef DEBUG_MODE
+void mem_arena::test_mem_arena()
+{
+    using namespace std;
+    using namespace std::chrono;
+    cout << "##-- test mem_arena --##" << endl;
+
+    const int count = 100000;
+    {
+        auto arena = make_shared<mem_arena>();
+        set<int, less<int>, arena_allocator<int, MAK_SOURCE>> s {arena_allocator<int, MAK_SOURCE>(arena)};
+        for (int i = 0; i < count; ++i) {
+            s.insert(i);
+        }
+        cout << "after inserting " << count << " elements:" << endl << *arena << endl;
+
+        for (int i = 0; i < count; i += 2) {
+            s.erase(i);
+        }
+        cout << "after erasing every second element:" << endl << *arena << endl;
+
+        //freed blocks are reused before the arena grows
+        size_t reserved = arena->get_bytes_reserved();
+        for (int i = 0; i < count; i += 2) {
+            s.insert(i);
+        }
+        cout << "reinserted, arena grew: " << (arena->get_bytes_reserved() != reserved ? "yes (FAILED)" : "no (OK)") << endl;
+
+        auto copy = s;
+        cout << "copy uses the heap: " << (copy.get_allocator().get_arena() == nullptr ? "yes (OK)" : "no (FAILED)") << endl;
+
+        auto t = allocate_shared<string>(arena_allocator<string, MAK_TIMER>(arena), "timer");
+        cout << "shared object in arena: " << *t << ", timer blocks: " << arena->get_blocks_in_use(MAK_TIMER) << endl;
+    }
+
+    auto bench = [&](const arena_allocator<int, MAK_SOURCE>& a) {
+        auto start = steady_clock::now();
+        for (int r = 0; r < 20; ++r) {
+            set<int, less<int>, arena_allocator<int, MAK_SOURCE>> s(a);
+            for (int i = 0; i < count / 10; ++i) {
+                s.insert(i);
+            }
+        }
+        return duration_cast<microseconds>(steady_clock::now() - start).count();
+    };
+
+    cout << "heap: " << bench(arena_allocator<int, MAK_SOURCE>()) << "us" << endl;
+    cout << "arena: " << bench(arena_allocator<int, MAK_SOURCE>(make_shared<mem_arena>())) << "us" << endl;
+}
+#endif /* DEBUG_MODE */
@@ -0,0 +1,351 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/utils/metrics.hpp"
+
+#include <sstream>
+#include <iostream>
+#include <thread>
+#include <cmath>
+
+metric_counter::metric_counter()
+{
+    HC_LOG_TRACE("");
+    for (auto & s : m_slots) {
+        s.value.store(0, std::memory_order_relaxed);
+    }
+}
+
+unsigned long metric_counter::get() const
+{
+    HC_LOG_TRACE("");
+    unsigned long sum = 0;
+    for (auto & s : m_slots) {
+        sum += s.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+unsigned int metric_counter::get_thread_slot()
+{
+    static std::atomic<unsigned int> next_slot(0);
+    thread_local unsigned int slot = next_slot.fetch_add(1, std::memory_order_relaxed) % METRICS_SLOTS;
+    return slot;
+}
+
+metric_gauge::metric_gauge()
+    : m_value(0)
+{
+    HC_LOG_TRACE("");
+}
+
+long metric_gauge::get() const
+{
+    HC_LOG_TRACE("");
+    return m_value.load(std::memory_order_relaxed);
+}
+
+metric_histogram::metric_histogram()
+    : m_count(0)
+    , m_sum(0)
+{
+    HC_LOG_TRACE("");
+    for (auto & b : m_buckets) {
+        b.store(0, std::memory_order_relaxed);
+    }
+}
+
+unsigned long metric_histogram::get_count() const
+{
+    HC_LOG_TRACE("");
+    return m_count.load(std::memory_order_relaxed);
+}
+
+unsigned long metric_histogram::get_sum() const
+{
+    HC_LOG_TRACE("");
+    return m_sum.load(std::memory_order_relaxed);
+}
+
+unsigned long metric_histogram::get_quantile(double q) const
+{
+    HC_LOG_TRACE("");
+
+    //the buckets are read one after another, the total is taken from the same reads
+    std::vector<unsigned long> counts(METRICS_HISTOGRAM_BUCKETS);
+    unsigned long total = 0;
+    for (unsigned int i = 0; i < METRICS_HISTOGRAM_BUCKETS; ++i) {
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    if (total == 0) {
+        return 0;
+    }
+
+    unsigned long rank = static_cast<unsigned long>(std::ceil(q * total));
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    unsigned long seen = 0;
+    for (unsigned int i = 0; i < METRICS_HISTOGRAM_BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return get_bucket_upper_bound(i);
+        }
+    }
+
+    return get_bucket_upper_bound(METRICS_HISTOGRAM_BUCKETS - 1);
+}
+
+unsigned long metric_histogram::get_bucket_upper_bound(unsigned int bucket)
+{
+    HC_LOG_TRACE("");
+
+    if (bucket < 2 * METRICS_HISTOGRAM_HALF) {
+        return bucket;
+    }
+
+    unsigned int shift = bucket / METRICS_HISTOGRAM_HALF - 1;
+    unsigned long top = bucket % METRICS_HISTOGRAM_HALF + METRICS_HISTOGRAM_HALF;
+    return ((top + 1) << shift) - 1;
+}
+
+metrics& metrics::get_instance()
+{
+    static metrics m;
+    return m;
+}
+
+metrics::family& metrics::get_family(const std::string& name, const std::string& help, metric_type type)
+{
+    HC_LOG_TRACE("");
+
+    auto it = m_families.find(name);
+    if (it == std::end(m_families)) {
+        family f;
+        f.help = help;
+        f.type = type;
+        it = m_families.insert(std::make_pair(name, std::move(f))).first;
+    } else if (it->second.type != type) {
+        HC_LOG_ERROR("metric " << name << " is registered with another type");
+        throw "metric is registered with another type";
+    }
+
+    return it->second;
+}
+
+metric_counter& metrics::get_counter(const std::string& name, const std::string& help, const metric_labels& labels)
+{
+    HC_LOG_TRACE("");
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto& counters = get_family(name, help, MT_COUNTER).counters;
+    auto& c = counters[render_labels(labels)];
+    if (c == nullptr) {
+        c.reset(new metric_counter());
+    }
+    return *c;
+}
+
+metric_gauge& metrics::get_gauge(const std::string& name, const std::string& help, const metric_labels& labels)
+{
+    HC_LOG_TRACE("");
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto& gauges = get_family(name, help, MT_GAUGE).gauges;
+    auto& g = gauges[render_labels(labels)];
+    if (g == nullptr) {
+        g.reset(new metric_gauge());
+    }
+    return *g;
+}
+
+metric_histogram& metrics::get_histogram(const std::string& name, const std::string& help, const metric_labels& labels)
+{
+    HC_LOG_TRACE("");
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto& histograms = get_family(name, help, MT_SUMMARY).histograms;
+    auto& h = histograms[render_labels(labels)];
+    if (h == nullptr) {
+        h.reset(new metric_histogram());
+    }
+    return *h;
+}
+
+std::string metrics::render_labels(const metric_labels& labels)
+{
+    HC_LOG_TRACE("");
+
+    if (labels.empty()) {
+        return std::string();
+    }
+
+    std::ostringstream s;
+    s << "{";
+    for (auto it = std::begin(labels); it != std::end(labels); ++it) {
+        if (it != std::begin(labels)) {
+            s << ",";
+        }
+        s << it->first << "=\"" << escape_label_value(it->second) << "\"";
+    }
+    s << "}";
+    return s.str();
+}
+
+std::string metrics::add_label(const std::string& rendered_labels, const std::string& label)
+{
+    HC_LOG_TRACE("");
+
+    if (rendered_labels.empty()) {
+        return "{" + label + "}";
+    }
+
+    return rendered_labels.substr(0, rendered_labels.size() - 1) + "," + label + "}";
+}
+
+std::string metrics::escape_label_value(const std::string& value)
+{
+    HC_LOG_TRACE("");
+
+    std::string result;
+    for (auto c : value) {
+        switch (c) {
+        case '\\':
+            result += "\\\\";
+            break;
+        case '"':
+            result += "\\\"";
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        default:
+            result += c;
+        }
+    }
+    return result;
+}
+
+std::string metrics::escape_help(const std::string& help)
+{
+    HC_LOG_TRACE("");
+
+    std::string result;
+    for (auto c : help) {
+        switch (c) {
+        case '\\':
+            result += "\\\\";
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        default:
+            result += c;
+        }
+    }
+    return result;
+}
+
+std::string metrics::to_prometheus() const
+{
+    HC_LOG_TRACE("");
+
+    std::ostringstream s;
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (auto & f : m_families) {
+        s << "# HELP " << METRICS_PREFIX << f.first << " " << escape_help(f.second.help) << "\n";
+        if (f.second.type == MT_COUNTER) {
+            s << "# TYPE " << METRICS_PREFIX << f.first << " counter\n";
+            for (auto & c : f.second.counters) {
+                s << METRICS_PREFIX << f.first << c.first << " " << c.second->get() << "\n";
+            }
+        } else if (f.second.type == MT_GAUGE) {
+            s << "# TYPE " << METRICS_PREFIX << f.first << " gauge\n";
+            for (auto & g : f.second.gauges) {
+                s << METRICS_PREFIX << f.first << g.first << " " << g.second->get() << "\n";
+            }
+        } else {
+            s << "# TYPE " << METRICS_PREFIX << f.first << " summary\n";
+            for (auto & h : f.second.histograms) {
+                for (auto q : {"0.5", "0.9", "0.99", "0.999"}) {
+                    s << METRICS_PREFIX << f.first << add_label(h.first, std::string("quantile=\"") + q + "\"") << " " << h.second->get_quantile(std::stod(q)) / 1e9 << "\n";
+                }
+                s << METRICS_PREFIX << f.first << "_sum" << h.first << " " << h.second->get_sum() / 1e9 << "\n";
+                s << METRICS_PREFIX << f.first << "_count" << h.first << " " << h.second->get_count() << "\n";
+            }
+        }
+    }
+    return s.str();
+}
+
+#ifdef DEBUG_MODE
+void metrics::test_metrics()
+{
+    using namespace std;
+    cout << "##-- test metrics --##" << endl;
+
+    metrics& m = metrics::get_instance();
+    metric_counter& c = m.get_counter("test_events_total", "Events of the metrics test.", {{"thread", "all"}, {"quote", "a\"b"}});
+    metric_gauge& g = m.get_gauge("test_depth", "Depth of the metrics test.");
+
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.push_back(thread([&c]() {
+            for (int j = 0; j < 100000; ++j) {
+                c.inc();
+            }
+        }));
+    }
+    for (auto & t : threads) {
+        t.join();
+    }
+    g.set(7);
+    g.add(-2);
+
+    cout << "counter: " << (c.get() == 400000 ? "OK" : "FAILED") << endl;
+    cout << "gauge: " << (g.get() == 5 ? "OK" : "FAILED") << endl;
+    metric_histogram& h = m.get_histogram("test_latency_seconds", "Latency of the metrics test.", {{"stage", "all"}});
+    for (unsigned long i = 1; i <= 1000; ++i) {
+        h.record(i * 1000);
+    }
+    bool buckets_ok = true;
+    for (unsigned long v = 0; v < 100000; v += 7) {
+        unsigned int b = metric_histogram::get_bucket(v);
+        if (v > metric_histogram::get_bucket_upper_bound(b) || (b > 0 && v <= metric_histogram::get_bucket_upper_bound(b - 1))) {
+            buckets_ok = false;
+        }
+    }
+    unsigned long p50 = h.get_quantile(0.5);
+    unsigned long p99 = h.get_quantile(0.99);
+
+    cout << "buckets: " << (buckets_ok ? "OK" : "FAILED") << endl;
+    cout << "histogram count: " << (h.get_count() == 1000 ? "OK" : "FAILED") << endl;
+    cout << "p50: " << (p50 >= 500000 && p50 < 500000 * 1.0625 ? "OK" : "FAILED") << " (" << p50 << ")" << endl;
+    cout << "p99: " << (p99 >= 990000 && p99 < 990000 * 1.0625 ? "OK" : "FAILED") << " (" << p99 << ")" << endl;
+    cout << "same counter: " << (&m.get_counter("test_events_total", "", {{"thread", "all"}, {"quote", "a\"b"}}) == &c ? "OK" : "FAILED") << endl;
+    cout << m.to_prometheus();
+}
+#endif /* DEBUG_MODE */
@@ -0,0 +1,239 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/utils/metrics_server.hpp"
+#include "include/utils/metrics.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+
+#include <sstream>
+#include <iostream>
+
+metrics_server::metrics_server(const std::string& path)
+    : m_path(path)
+    , m_sock(-1)
+    , m_thread(nullptr)
+{
+    HC_LOG_TRACE("");
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (m_path.empty() || m_path.size() >= sizeof(addr.sun_path)) {
+        HC_LOG_ERROR("invalid metrics socket path: " << m_path);
+        throw "invalid metrics socket path";
+    }
+    strncpy(addr.sun_path, m_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    m_sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_sock < 0) {
+        HC_LOG_ERROR("failed to create metrics socket! Error: " << strerror(errno) << " errno: " << errno);
+        throw "failed to create metrics socket";
+    }
+
+    //remove the socket of a previous run
+    struct stat st;
+    if (stat(m_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(m_path.c_str());
+    }
+
+    if (bind(m_sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        HC_LOG_ERROR("failed to bind metrics socket to " << m_path << "! Error: " << strerror(errno) << " errno: " << errno);
+        close(m_sock);
+        throw "failed to bind metrics socket";
+    }
+
+    if (listen(m_sock, METRICS_SERVER_BACKLOG) < 0) {
+        HC_LOG_ERROR("failed to listen on metrics socket! Error: " << strerror(errno) << " errno: " << errno);
+        close(m_sock);
+        unlink(m_path.c_str());
+        throw "failed to listen on metrics socket";
+    }
+
+    if (pipe2(m_stop_pipe, O_CLOEXEC) < 0) {
+        HC_LOG_ERROR("failed to create pipe! Error: " << strerror(errno) << " errno: " << errno);
+        close(m_sock);
+        unlink(m_path.c_str());
+        throw "failed to create pipe";
+    }
+
+    m_thread.reset(new std::thread(&metrics_server::worker_thread, this));
+}
+
+metrics_server::~metrics_server()
+{
+    HC_LOG_TRACE("");
+
+    char c = 0;
+    if (write(m_stop_pipe[1], &c, sizeof(c)) < 0) {
+        HC_LOG_ERROR("failed to stop the metrics server! Error: " << strerror(errno) << " errno: " << errno);
+    }
+
+    if (m_thread) {
+        m_thread->join();
+    }
+
+    close(m_stop_pipe[0]);
+    close(m_stop_pipe[1]);
+    close(m_sock);
+    unlink(m_path.c_str());
+}
+
+void metrics_server::worker_thread()
+{
+    HC_LOG_TRACE("");
+
+    pollfd fds[2];
+    fds[0].fd = m_sock;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_stop_pipe[0];
+    fds[1].events = POLLIN;
+
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            HC_LOG_ERROR("failed to poll metrics socket! Error: " << strerror(errno) << " errno: " << errno);
+            break;
+        }
+
+        if (fds[1].revents != 0) {
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int client = accept4(m_sock, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) {
+                if (errno != EINTR && errno != EAGAIN && errno != ECONNABORTED) {
+                    HC_LOG_ERROR("failed to accept metrics client! Error: " << strerror(errno) << " errno: " << errno);
+                }
+                continue;
+            }
+
+            serve(client);
+            close(client);
+        }
+    }
+
+    HC_LOG_DEBUG("worker thread metrics_server end");
+}
+
+void metrics_server::serve(int client) const
+{
+    HC_LOG_TRACE("");
+
+    //a client that sends nothing gets the plain exposition after a short wait
+    char buf[METRICS_SERVER_RECV_BUF_SIZE];
+    ssize_t size = 0;
+    pollfd pfd;
+    pfd.fd = client;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, METRICS_SERVER_RECV_TIMEOUT) > 0) {
+        size = recv(client, buf, sizeof(buf), MSG_DONTWAIT);
+    }
+
+    std::string body = metrics::get_instance().to_prometheus();
+    std::string answer;
+    if (size >= 4 && strncmp(buf, "GET ", 4) == 0) {
+        std::ostringstream s;
+        s << "HTTP/1.0 200 OK\r\n";
+        s << "Content-Type: text/plain; version=0.0.4\r\n";
+        s << "Content-Length: " << body.size() << "\r\n";
+        s << "Connection: close\r\n\r\n";
+        answer = s.str() + body;
+    } else {
+        answer.swap(body);
+    }
+
+    //a stalled client must not block the other clients
+    timeval tv;
+    tv.tv_sec = METRICS_SERVER_SEND_TIMEOUT / 1000;
+    tv.tv_usec = (METRICS_SERVER_SEND_TIMEOUT % 1000) * 1000;
+    if (setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) < 0) {
+        HC_LOG_DEBUG("failed to set the send timeout! Error: " << strerror(errno) << " errno: " << errno);
+        return;
+    }
+
+    const char* data = answer.data();
+    std::size_t remaining = answer.size();
+    while (remaining > 0) {
+        ssize_t sent = send(client, data, remaining, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            HC_LOG_DEBUG("failed to send metrics! Error: " << strerror(errno) << " errno: " << errno);
+            return;
+        }
+        data += sent;
+        remaining -= sent;
+    }
+}
+
+#ifdef DEBUG_MODE
+void metrics_server::test_metrics_server()
+{
+    using namespace std;
+    cout << "##-- test metrics_server --##" << endl;
+
+    try {
+        metrics::get_instance().get_counter("test_requests_total", "Requests of the metrics server test.").inc();
+        metrics_server ms("/tmp/mcproxy_test.metrics");
+
+        int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, "/tmp/mcproxy_test.metrics", sizeof(addr.sun_path) - 1);
+        if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            cout << "connect: FAILED" << endl;
+            close(sock);
+            return;
+        }
+
+        string request = "GET /metrics HTTP/1.0\r\n\r\n";
+        send(sock, request.data(), request.size(), 0);
+
+        string answer;
+        char buf[1024];
+        ssize_t size;
+        while ((size = recv(sock, buf, sizeof(buf), 0)) > 0) {
+            answer.append(buf, size);
+        }
+        close(sock);
+
+        cout << "http answer: " << (answer.compare(0, 15, "HTTP/1.0 200 OK") == 0 ? "OK" : "FAILED") << endl;
+        cout << "metric found: " << (answer.find("mcproxy_test_requests_total 1") != string::npos ? "OK" : "FAILED") << endl;
+    } catch (const char* e) {
+        cout << "failed: " << e << endl;
+    }
+}
+#endif /* DEBUG_MODE */
@@ -0,0 +1,369 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/utils/mroute_netlink.hpp"
+#include "include/utils/mroute_socket.hpp"
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+std::string mroute_netlink_op::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+    s << (add ? "add" : "del") << " (" << saddr << ", " << gaddr << ") input if index: " << input_if_index;
+    if (add) {
+        s << " output vifs:";
+        for (auto e : output_vif) {
+            s << " " << e;
+        }
+    }
+    return s.str();
+}
+
+mroute_netlink::mroute_netlink(int addr_family, int table)
+    : m_sock(-1)
+    , m_table(table > 0 ? table : static_cast<int>(RT_TABLE_DEFAULT))
+    , m_seq(0)
+    , m_supported(true)
+{
+    HC_LOG_TRACE("");
+
+    if (addr_family != AF_INET) {
+        HC_LOG_ERROR("rtnetlink multicast routes are only supported for IPv4");
+        throw "wrong address family";
+    }
+
+    m_sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (m_sock < 0) {
+        HC_LOG_ERROR("failed to create rtnetlink socket! Error: " << strerror(errno) << " errno: " << errno);
+        throw "failed to create rtnetlink socket";
+    }
+
+    sockaddr_nl local;
+    memset(&local, 0, sizeof(local));
+    local.nl_family = AF_NETLINK;
+    if (bind(m_sock, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0) {
+        HC_LOG_ERROR("failed to bind rtnetlink socket! Error: " << strerror(errno) << " errno: " << errno);
+        close(m_sock);
+        throw "failed to bind rtnetlink socket";
+    }
+
+    //acknowledgements without the copy of the request
+    int one = 1;
+    if (setsockopt(m_sock, SOL_NETLINK, NETLINK_CAP_ACK, &one, sizeof(one)) < 0) {
+        HC_LOG_DEBUG("NETLINK_CAP_ACK not supported");
+    }
+
+    m_batch.reserve(MROUTE_NETLINK_MAX_BATCH_SIZE);
+}
+
+mroute_netlink::~mroute_netlink()
+{
+    HC_LOG_TRACE("");
+
+    flush();
+
+    if (m_sock >= 0) {
+        close(m_sock);
+    }
+}
+
+void mroute_netlink::add_attr(unsigned short type, const void* data, unsigned int size)
+{
+    std::size_t offset = m_batch.size();
+    m_batch.resize(offset + RTA_SPACE(size), 0);
+
+    rtattr* rta = reinterpret_cast<rtattr*>(&m_batch[offset]);
+    rta->rta_type = type;
+    rta->rta_len = RTA_LENGTH(size);
+    memcpy(RTA_DATA(rta), data, size);
+}
+
+bool mroute_netlink::queue(const mroute_netlink_op& op)
+{
+    HC_LOG_TRACE("");
+
+    if (!m_supported) {
+        //an older operation of this route that is still in flight must not be retried after this one
+        m_latest_seq.erase(std::make_pair(op.saddr, op.gaddr));
+        m_failed.push_back(op);
+        return false;
+    }
+
+    if (m_batch.size() >= MROUTE_NETLINK_MAX_BATCH_SIZE) {
+        flush();
+    }
+
+    std::size_t offset = m_batch.size();
+    m_batch.resize(offset + NLMSG_SPACE(sizeof(rtmsg)), 0);
+
+    nlmsghdr* nlh = reinterpret_cast<nlmsghdr*>(&m_batch[offset]);
+    nlh->nlmsg_type = op.add ? RTM_NEWROUTE : RTM_DELROUTE;
+    nlh->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+    if (op.add) {
+        nlh->nlmsg_flags |= NLM_F_CREATE | NLM_F_REPLACE;
+    }
+    nlh->nlmsg_seq = ++m_seq;
+    nlh->nlmsg_pid = 0;
+
+    rtmsg* rtm = reinterpret_cast<rtmsg*>(NLMSG_DATA(nlh));
+    rtm->rtm_family = RTNL_FAMILY_IPMR;
+    rtm->rtm_dst_len = 32;
+    rtm->rtm_src_len = 32;
+    rtm->rtm_table = m_table < 256 ? m_table : static_cast<int>(RT_TABLE_UNSPEC);
+    rtm->rtm_protocol = RTPROT_MROUTED; //behave like a route of the mroute socket
+    rtm->rtm_scope = RT_SCOPE_UNIVERSE;
+    rtm->rtm_type = RTN_MULTICAST;
+
+    uint32_t table = m_table;
+    add_attr(RTA_TABLE, &table, sizeof(table));
+    add_attr(RTA_SRC, &op.saddr.get_in_addr(), sizeof(in_addr));
+    add_attr(RTA_DST, &op.gaddr.get_in_addr(), sizeof(in_addr));
+    uint32_t iif = op.input_if_index;
+    add_attr(RTA_IIF, &iif, sizeof(iif));
+
+    if (op.add && !op.output_vif.empty()) {
+        //the kernel reads one next hop per virtual interface, the hop count is the ttl threshold
+        int max_vif = 0;
+        for (auto e : op.output_vif) {
+            if (e < 0 || e >= MAXVIFS) {
+                HC_LOG_ERROR("virtual interface out of range: " << e);
+                m_batch.resize(offset);
+                --m_seq;
+                return false;
+            }
+            max_vif = std::max(max_vif, e);
+        }
+
+        std::vector<rtnexthop> nhs(max_vif + 1);
+        memset(nhs.data(), 0, nhs.size() * sizeof(rtnexthop));
+        for (auto & e : nhs) {
+            e.rtnh_len = sizeof(rtnexthop);
+        }
+        for (auto e : op.output_vif) {
+            nhs[e].rtnh_hops = MROUTE_DEFAULT_TTL;
+        }
+        add_attr(RTA_MULTIPATH, nhs.data(), nhs.size() * sizeof(rtnexthop));
+    }
+
+    nlh = reinterpret_cast<nlmsghdr*>(&m_batch[offset]);
+    nlh->nlmsg_len = m_batch.size() - offset;
+
+    m_batch_ops.push_back(std::make_pair(m_seq, op));
+    m_latest_seq[std::make_pair(op.saddr, op.gaddr)] = m_seq;
+    return true;
+}
+
+void mroute_netlink::finish(uint32_t seq, const mroute_netlink_op& op)
+{
+    auto it = m_latest_seq.find(std::make_pair(op.saddr, op.gaddr));
+    if (it != std::end(m_latest_seq) && it->second == seq) {
+        m_latest_seq.erase(it);
+    }
+}
+
+void mroute_netlink::fail(uint32_t seq, mroute_netlink_op&& op)
+{
+    auto it = m_latest_seq.find(std::make_pair(op.saddr, op.gaddr));
+    if (it != std::end(m_latest_seq) && it->second == seq) {
+        m_latest_seq.erase(it);
+        m_failed.push_back(std::move(op));
+    } else {
+        HC_LOG_DEBUG("a later operation replaces the failed one: " << op.to_string());
+    }
+}
+
+bool mroute_netlink::add_mroute(unsigned int input_if_index, const addr_storage& saddr, const addr_storage& gaddr, const std::list<int>& output_vif)
+{
+    HC_LOG_TRACE("");
+    return queue(mroute_netlink_op {true, input_if_index, saddr, gaddr, output_vif});
+}
+
+bool mroute_netlink::del_mroute(unsigned int input_if_index, const addr_storage& saddr, const addr_storage& gaddr)
+{
+    HC_LOG_TRACE("");
+    return queue(mroute_netlink_op {false, input_if_index, saddr, gaddr, std::list<int>()});
+}
+
+bool mroute_netlink::flush()
+{
+    HC_LOG_TRACE("");
+
+    if (m_batch.empty()) {
+        collect_acks();
+        return true;
+    }
+
+    sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+
+    iovec iov;
+    iov.iov_base = m_batch.data();
+    iov.iov_len = m_batch.size();
+
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &kernel;
+    msg.msg_namelen = sizeof(kernel);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    bool rc = true;
+    if (sendmsg(m_sock, &msg, 0) < 0) {
+        HC_LOG_ERROR("failed to send " << m_batch_ops.size() << " multicast routes! Error: " << strerror(errno) << " errno: " << errno);
+        for (auto & e : m_batch_ops) {
+            fail(e.first, std::move(e.second));
+        }
+        rc = false;
+    } else {
+        HC_LOG_DEBUG("sent " << m_batch_ops.size() << " multicast routes with one sendmsg");
+        for (auto & e : m_batch_ops) {
+            m_pending.insert(std::make_pair(e.first, std::move(e.second)));
+        }
+    }
+
+    m_batch.clear();
+    m_batch_ops.clear();
+
+    collect_acks();
+    return rc;
+}
+
+void mroute_netlink::collect_acks()
+{
+    HC_LOG_TRACE("");
+
+    unsigned char buf[MROUTE_NETLINK_RECV_BUF_SIZE];
+
+    while (!m_pending.empty()) {
+        ssize_t len = recv(m_sock, buf, sizeof(buf), MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == ENOBUFS) {
+                HC_LOG_WARN("lost rtnetlink acknowledgements of " << m_pending.size() << " multicast routes");
+                for (auto & e : m_pending) {
+                    finish(e.first, e.second);
+                }
+                m_pending.clear();
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                HC_LOG_ERROR("failed to receive rtnetlink acknowledgements! Error: " << strerror(errno) << " errno: " << errno);
+            }
+            return;
+        }
+
+        int remaining = len;
+        for (nlmsghdr* nlh = reinterpret_cast<nlmsghdr*>(buf); NLMSG_OK(nlh, remaining); nlh = NLMSG_NEXT(nlh, remaining)) {
+            if (nlh->nlmsg_type != NLMSG_ERROR) {
+                continue;
+            }
+
+            auto it = m_pending.find(nlh->nlmsg_seq);
+            if (it == std::end(m_pending)) {
+                continue;
+            }
+
+            int error = -reinterpret_cast<nlmsgerr*>(NLMSG_DATA(nlh))->error;
+            if (error == 0) {
+                //acknowledged
+                finish(it->first, it->second);
+            } else if (error == EOPNOTSUPP || error == EAFNOSUPPORT) {
+                HC_LOG_WARN("kernel does not support multicast routes over rtnetlink");
+                m_supported = false;
+                fail(it->first, std::move(it->second));
+            } else if (!it->second.add && error == ENOENT) {
+                HC_LOG_WARN("failed to delete multicast route! Error: " << strerror(error) << " " << it->second.to_string());
+                finish(it->first, it->second);
+            } else {
+                HC_LOG_ERROR("kernel refused multicast route! Error: " << strerror(error) << " " << it->second.to_string());
+                fail(it->first, std::move(it->second));
+            }
+            m_pending.erase(it);
+        }
+    }
+
+    if (!m_supported) {
+        //the remaining operations will be refused as well
+        for (auto & e : m_pending) {
+            fail(e.first, std::move(e.second));
+        }
+        m_pending.clear();
+    }
+}
+
+std::list<mroute_netlink_op> mroute_netlink::get_failed_ops()
+{
+    HC_LOG_TRACE("");
+    std::list<mroute_netlink_op> rt;
+    rt.swap(m_failed);
+    return rt;
+}
+
+bool mroute_netlink::is_supported() const
+{
+    HC_LOG_TRACE("");
+    return m_supported;
+}
+
+unsigned int mroute_netlink::get_pending_count() const
+{
+    HC_LOG_TRACE("");
+    return m_pending.size();
+}
+
+bool mroute_netlink::is_batch_empty() const
+{
+    HC_LOG_TRACE("");
+    return m_batch.empty();
+}
+
+#ifdef DEBUG_MODE
+void mroute_netlink::test_mroute_netlink()
+{
+    using namespace std;
+    cout << "##-- test mroute_netlink --##" << endl;
+
+    try {
+        mroute_netlink n(AF_INET, 0);
+        for (int i = 1; i <= 100; ++i) {
+            n.add_mroute(1, addr_storage("10.0.0.1"), addr_storage(string("239.99.0.") + std::to_string(i)), {0, 1});
+        }
+        cout << "flush: " << (n.flush() ? "OK" : "FAILED") << endl;
+        cout << "pending: " << n.get_pending_count() << ", failed: " << n.get_failed_ops().size() << ", supported: " << (n.is_supported() ? "true" : "false") << endl;
+
+        for (int i = 1; i <= 100; ++i) {
+            n.del_mroute(1, addr_storage("10.0.0.1"), addr_storage(string("239.99.0.") + std::to_string(i)));
+        }
+        cout << "flush: " << (n.flush() ? "OK" : "FAILED") << endl;
+        cout << "pending: " << n.get_pending_count() << ", failed: " << n.get_failed_ops().size() << endl;
+    } catch (const char* e) {
+        cout << "failed: " << e << endl;
+    }
+}
+#endif /* DEBUG_MODE */
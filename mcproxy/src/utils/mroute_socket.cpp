@@ -36,6 +36,7 @@
 #include <cstdlib>
 
 #include <cstring>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -156,16 +157,19 @@ u_int16_t mroute_socket::calc_checksum(const unsigned char* buf, int buf_size) c
     HC_LOG_TRACE("");
 
     u_int16_t* b = (u_int16_t*)buf;
-    int sum = 0;
+    u_int32_t sum = 0;
 
     for (int i = 0; i < buf_size / 2; i++) {
-        ADD_SIGNED_NUM_U16(sum, b[i]);
-        //sum +=b[i];
+        sum += b[i];
     }
 
     if (buf_size % 2 == 1) {
-        //sum += buf[buf_size-1];
-        ADD_SIGNED_NUM_U16(sum, buf[buf_size - 1]);
+        sum += buf[buf_size - 1];
+    }
+
+    //fold the carries into the lower 16 bit
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
     }
 
     return ~sum;
@@ -216,6 +220,7 @@ bool mroute_socket::add_ipv6_extension_header(const unsigned char* buf, unsigned
             HC_LOG_ERROR("failed to add extension header! Error: " << strerror(errno) << " errno: " << errno);
             return false;
         } else {
+            m_ipv6_hop_by_hop.assign(buf, buf + buf_size);
             return true;
         }
     } else {
@@ -224,6 +229,97 @@ bool mroute_socket::add_ipv6_extension_header(const unsigned char* buf, unsigned
     }
 }
 
+bool mroute_socket::send_packets(std::vector<mroute_packet>& packets) const
+{
+    HC_LOG_TRACE("");
+
+    if (!is_udp_valid()) {
+        HC_LOG_ERROR("raw_socket invalid");
+        return false;
+    }
+
+    if (packets.empty()) {
+        return true;
+    }
+
+    std::size_t pktinfo_space;
+    std::size_t hbh_space = 0;
+    if (m_addrFamily == AF_INET) {
+        pktinfo_space = CMSG_SPACE(sizeof(struct in_pktinfo));
+    } else if (m_addrFamily == AF_INET6) {
+        pktinfo_space = CMSG_SPACE(sizeof(struct in6_pktinfo));
+        if (!m_ipv6_hop_by_hop.empty()) {
+            hbh_space = CMSG_SPACE(m_ipv6_hop_by_hop.size());
+        }
+    } else {
+        HC_LOG_ERROR("wrong address family");
+        return false;
+    }
+
+    const std::size_t ctrl_size = pktinfo_space + hbh_space;
+    std::vector<struct mmsghdr> msgs(packets.size());
+    std::vector<struct iovec> iovs(packets.size());
+    std::vector<unsigned char> ctrl(ctrl_size * packets.size(), 0);
+
+    for (unsigned int i = 0; i < packets.size(); ++i) {
+        mroute_packet& p = packets[i];
+        p.sent = false;
+
+        iovs[i].iov_base = const_cast<unsigned char*>(p.data);
+        iovs[i].iov_len = p.size;
+
+        struct msghdr& msg = msgs[i].msg_hdr;
+        msg.msg_name = const_cast<sockaddr*>(&p.dst.get_sockaddr());
+        msg.msg_namelen = p.dst.get_addr_len();
+        msg.msg_iov = &iovs[i];
+        msg.msg_iovlen = 1;
+        msg.msg_control = &ctrl[i * ctrl_size];
+        msg.msg_controllen = ctrl_size;
+        msg.msg_flags = 0;
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        if (m_addrFamily == AF_INET) {
+            cmsg->cmsg_level = IPPROTO_IP;
+            cmsg->cmsg_type = IP_PKTINFO;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+            reinterpret_cast<struct in_pktinfo*>(CMSG_DATA(cmsg))->ipi_ifindex = p.if_index;
+        } else {
+            cmsg->cmsg_level = IPPROTO_IPV6;
+            cmsg->cmsg_type = IPV6_PKTINFO;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
+            reinterpret_cast<struct in6_pktinfo*>(CMSG_DATA(cmsg))->ipi6_ifindex = p.if_index;
+
+            if (hbh_space > 0) {
+                cmsg = CMSG_NXTHDR(&msg, cmsg);
+                cmsg->cmsg_level = IPPROTO_IPV6;
+                cmsg->cmsg_type = IPV6_HOPOPTS;
+                cmsg->cmsg_len = CMSG_LEN(m_ipv6_hop_by_hop.size());
+                memcpy(CMSG_DATA(cmsg), m_ipv6_hop_by_hop.data(), m_ipv6_hop_by_hop.size());
+            }
+        }
+    }
+
+    bool rc = true;
+    unsigned int offset = 0;
+    while (offset < msgs.size()) {
+        unsigned int vlen = std::min<std::size_t>(msgs.size() - offset, MROUTE_SENDMMSG_MAX_PACKETS);
+        int sent = sendmmsg(m_sock, &msgs[offset], vlen, 0);
+
+        if (sent < 0) {
+            HC_LOG_ERROR("failed to send packet to " << packets[offset].dst << " on interface " << packets[offset].if_index << "! Error: " << strerror(errno) << " errno: " << errno);
+            rc = false;
+            ++offset; //skip the failed packet
+        } else {
+            for (int i = 0; i < sent; ++i) {
+                packets[offset + i].sent = true;
+            }
+            offset += sent;
+        }
+    }
+
+    return rc;
+}
+
 bool mroute_socket::set_ipv4_receive_packets_with_router_alert_header(bool enable) const
 {
     HC_LOG_TRACE("");
@@ -269,6 +365,7 @@ bool mroute_socket::set_ipv6_recv_icmpv6_msg() const
         ICMP6_FILTER_SETPASS(MLD_LISTENER_REPORT, &myfilter);
         ICMP6_FILTER_SETPASS(MLD_LISTENER_REDUCTION, &myfilter);
         ICMP6_FILTER_SETPASS(MLD_V2_LISTENER_REPORT, &myfilter);
+        ICMP6_FILTER_SETPASS(MLD_LISTENER_QUERY, &myfilter); //answered on the upstreams
 
         if (setsockopt(m_sock, IPPROTO_ICMPV6, ICMP6_FILTER, &myfilter, sizeof(myfilter)) < 0) {
             HC_LOG_ERROR("failed to set ICMP6 filter! Error: " << strerror(errno) << " errno: " << errno);
@@ -754,6 +851,54 @@ bool mroute_socket::get_vif_stats(int vif_index, struct sioc_vif_req* req_v4, st
     return false;
 }
 
+bool mroute_socket::get_vif_counters(const std::list<int>& vifs, std::map<int, vif_counter>& result) const
+{
+    HC_LOG_TRACE("");
+
+    if (!is_udp_valid()) {
+        HC_LOG_ERROR("raw_socket invalid");
+        return false;
+    }
+
+    bool rc = true;
+    for (auto vif : vifs) {
+        vif_counter counter;
+        int ioctl_rc;
+
+        if (m_addrFamily == AF_INET) {
+            struct sioc_vif_req req;
+            memset(&req, 0, sizeof(req));
+            req.vifi = vif;
+            ioctl_rc = ioctl(m_sock, SIOCGETVIFCNT, &req);
+            counter.in_packets = req.icount;
+            counter.in_bytes = req.ibytes;
+            counter.out_packets = req.ocount;
+            counter.out_bytes = req.obytes;
+        } else if (m_addrFamily == AF_INET6) {
+            struct sioc_mif_req6 req;
+            memset(&req, 0, sizeof(req));
+            req.mifi = vif;
+            ioctl_rc = ioctl(m_sock, SIOCGETMIFCNT_IN6, &req);
+            counter.in_packets = req.icount;
+            counter.in_bytes = req.ibytes;
+            counter.out_packets = req.ocount;
+            counter.out_bytes = req.obytes;
+        } else {
+            HC_LOG_ERROR("wrong address family");
+            return false;
+        }
+
+        if (ioctl_rc == 0) {
+            result[vif] = counter;
+        } else if (errno != EADDRNOTAVAIL && errno != EINVAL) { //not added or beyond the highest added vif
+            HC_LOG_ERROR("failed to get the counters of vif " << vif << "! Error: " << strerror(errno) << " errno: " << errno);
+            rc = false;
+        }
+    }
+
+    return rc;
+}
+
 bool mroute_socket::get_mroute_stats(const addr_storage& source_addr, const addr_storage& group_addr, struct sioc_sg_req* sgreq_v4, struct sioc_sg_req6* sgreq_v6) const
 {
     HC_LOG_TRACE("");
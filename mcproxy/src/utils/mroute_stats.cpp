@@ -0,0 +1,294 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/utils/mroute_stats.hpp"
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#include <sstream>
+#include <iostream>
+
+mroute_stats::mroute_stats(int addr_family, int table)
+    : m_sock(-1)
+    , m_addr_family(addr_family)
+    , m_table(table > 0 ? table : static_cast<int>(RT_TABLE_DEFAULT))
+    , m_seq(0)
+    , m_valid(false)
+{
+    HC_LOG_TRACE("");
+
+    if (m_addr_family != AF_INET && m_addr_family != AF_INET6) {
+        HC_LOG_ERROR("wrong address family: " << m_addr_family);
+        throw "wrong address family";
+    }
+
+    m_sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (m_sock < 0) {
+        HC_LOG_ERROR("failed to create rtnetlink socket! Error: " << strerror(errno) << " errno: " << errno);
+        throw "failed to create rtnetlink socket";
+    }
+
+    sockaddr_nl local;
+    memset(&local, 0, sizeof(local));
+    local.nl_family = AF_NETLINK;
+    if (bind(m_sock, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0) {
+        HC_LOG_ERROR("failed to bind rtnetlink socket! Error: " << strerror(errno) << " errno: " << errno);
+        close(m_sock);
+        throw "failed to bind rtnetlink socket";
+    }
+}
+
+mroute_stats::~mroute_stats()
+{
+    HC_LOG_TRACE("");
+
+    if (m_sock >= 0) {
+        close(m_sock);
+    }
+}
+
+bool mroute_stats::send_dump_request()
+{
+    HC_LOG_TRACE("");
+
+    struct {
+        nlmsghdr nlh;
+        rtmsg rtm;
+    } req;
+    memset(&req, 0, sizeof(req));
+
+    req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(rtmsg));
+    req.nlh.nlmsg_type = RTM_GETROUTE;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nlh.nlmsg_seq = ++m_seq;
+    req.rtm.rtm_family = m_addr_family == AF_INET ? RTNL_FAMILY_IPMR : RTNL_FAMILY_IP6MR;
+
+    sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+
+    if (sendto(m_sock, &req, req.nlh.nlmsg_len, 0, reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel)) < 0) {
+        HC_LOG_ERROR("failed to request multicast route dump! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    }
+
+    return true;
+}
+
+bool mroute_stats::receive_dump(mfc_counter_map& result)
+{
+    HC_LOG_TRACE("");
+
+    unsigned char buf[MROUTE_STATS_RECV_BUF_SIZE];
+    std::size_t addr_size = m_addr_family == AF_INET ? sizeof(in_addr) : sizeof(in6_addr);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(MROUTE_STATS_DUMP_TIMEOUT);
+
+    while (true) {
+        auto remaining_time = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        pollfd fd;
+        fd.fd = m_sock;
+        fd.events = POLLIN;
+        fd.revents = 0;
+        int rc = poll(&fd, 1, remaining_time > 0 ? remaining_time : 0);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            HC_LOG_ERROR("failed to poll rtnetlink socket! Error: " << strerror(errno) << " errno: " << errno);
+            return false;
+        } else if (rc == 0) {
+            HC_LOG_ERROR("multicast route dump not complete after " << MROUTE_STATS_DUMP_TIMEOUT << " msec");
+            return false;
+        }
+
+        ssize_t len = recv(m_sock, buf, sizeof(buf), MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+                continue;
+            }
+            HC_LOG_ERROR("failed to receive multicast route dump! Error: " << strerror(errno) << " errno: " << errno);
+            return false;
+        }
+
+        int remaining = len;
+        for (nlmsghdr* nlh = reinterpret_cast<nlmsghdr*>(buf); NLMSG_OK(nlh, remaining); nlh = NLMSG_NEXT(nlh, remaining)) {
+            if (nlh->nlmsg_seq != m_seq) {
+                continue; //answer of an older request
+            }
+
+            if (nlh->nlmsg_type == NLMSG_DONE) {
+                return true;
+            } else if (nlh->nlmsg_type == NLMSG_ERROR) {
+                int error = -reinterpret_cast<nlmsgerr*>(NLMSG_DATA(nlh))->error;
+                HC_LOG_ERROR("kernel refused multicast route dump! Error: " << strerror(error));
+                return false;
+            } else if (nlh->nlmsg_type != RTM_NEWROUTE) {
+                continue;
+            }
+
+            rtmsg* rtm = reinterpret_cast<rtmsg*>(NLMSG_DATA(nlh));
+            int table = rtm->rtm_table;
+            const void* src = nullptr;
+            const void* dst = nullptr;
+            mfc_counter counter;
+
+            int attr_len = RTM_PAYLOAD(nlh);
+            for (rtattr* rta = RTM_RTA(rtm); RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len)) {
+                switch (rta->rta_type) {
+                case RTA_TABLE:
+                    table = *reinterpret_cast<uint32_t*>(RTA_DATA(rta));
+                    break;
+                case RTA_SRC:
+                    src = RTA_PAYLOAD(rta) == addr_size ? RTA_DATA(rta) : nullptr;
+                    break;
+                case RTA_DST:
+                    dst = RTA_PAYLOAD(rta) == addr_size ? RTA_DATA(rta) : nullptr;
+                    break;
+                case RTA_IIF:
+                    counter.iif = *reinterpret_cast<uint32_t*>(RTA_DATA(rta));
+                    break;
+                case RTA_MFC_STATS: {
+                    rta_mfc_stats* stats = reinterpret_cast<rta_mfc_stats*>(RTA_DATA(rta));
+                    counter.packets = stats->mfcs_packets;
+                    counter.bytes = stats->mfcs_bytes;
+                    counter.wrong_if = stats->mfcs_wrong_if;
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+
+            if (table != m_table || src == nullptr || dst == nullptr) {
+                continue;
+            }
+
+            if (m_addr_family == AF_INET) {
+                result[std::make_pair(addr_storage(*reinterpret_cast<const in_addr*>(dst)), addr_storage(*reinterpret_cast<const in_addr*>(src)))] = counter;
+            } else {
+                result[std::make_pair(addr_storage(*reinterpret_cast<const in6_addr*>(dst)), addr_storage(*reinterpret_cast<const in6_addr*>(src)))] = counter;
+            }
+        }
+    }
+}
+
+bool mroute_stats::refresh()
+{
+    HC_LOG_TRACE("");
+
+    mfc_counter_map result;
+    if (send_dump_request() && receive_dump(result)) {
+        m_counters.swap(result);
+        m_valid = true;
+    } else {
+        m_counters.clear();
+        m_valid = false;
+    }
+
+    m_last_refresh = std::chrono::steady_clock::now();
+    return m_valid;
+}
+
+bool mroute_stats::refresh_if_older_than(const std::chrono::milliseconds& max_age)
+{
+    HC_LOG_TRACE("");
+
+    if (m_valid && std::chrono::steady_clock::now() - m_last_refresh < max_age) {
+        return true;
+    }
+
+    return refresh();
+}
+
+bool mroute_stats::get_packet_count(const addr_storage& gaddr, const addr_storage& saddr, unsigned long& packet_count) const
+{
+    HC_LOG_TRACE("");
+
+    if (!m_valid) {
+        return false;
+    }
+
+    auto it = m_counters.find(std::make_pair(gaddr, saddr));
+    if (it != std::end(m_counters)) {
+        packet_count = it->second.packets;
+    } else {
+        packet_count = 0;
+    }
+
+    return true;
+}
+
+const mfc_counter_map& mroute_stats::get_counters() const
+{
+    HC_LOG_TRACE("");
+    return m_counters;
+}
+
+unsigned int mroute_stats::size() const
+{
+    HC_LOG_TRACE("");
+    return m_counters.size();
+}
+
+std::string mroute_stats::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+    s << "multicast route statistics (table " << m_table << ", " << (m_valid ? "valid" : "invalid") << "): " << m_counters.size() << " routes";
+    for (auto & e : m_counters) {
+        s << std::endl << "(" << e.first.second << ", " << e.first.first << "): " << e.second.packets << " packets, " << e.second.bytes << " bytes";
+    }
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const mroute_stats& m)
+{
+    HC_LOG_TRACE("");
+    return stream << m.to_string();
+}
+
+#ifdef DEBUG_MODE
+void mroute_stats::test_mroute_stats()
+{
+    using namespace std;
+    cout << "##-- test mroute_stats --##" << endl;
+
+    try {
+        mroute_stats ms4(AF_INET, 0);
+        cout << "refresh: " << (ms4.refresh() ? "OK" : "FAILED") << endl;
+        cout << ms4 << endl;
+
+        mroute_stats ms6(AF_INET6, 0);
+        cout << "refresh: " << (ms6.refresh() ? "OK" : "FAILED") << endl;
+        cout << ms6 << endl;
+    } catch (const char* e) {
+        cout << "failed: " << e << endl;
+    }
+}
+#endif /* DEBUG_MODE */